@@ -446,6 +446,19 @@ enum library_type {
   library_throughput
 };
 
+// Engines behind the runtime's fast memory (task descriptors, dependence
+// nodes): free lists on top of the per-thread bget pool, or size-class slabs
+enum fast_mem_engine { fast_mem_bget, fast_mem_slab };
+
+// Backing of worker stacks and bget pool expansions (KMP_HUGE_PAGES), and how
+// they are faulted in (KMP_PREFAULT_PAGES)
+enum huge_pages_type {
+  huge_pages_off,
+  huge_pages_transparent,
+  huge_pages_explicit
+};
+enum prefault_type { prefault_off, prefault_touch, prefault_mlock };
+
 #if KMP_OS_LINUX
 enum clock_function_type {
   clock_function_gettimeofday,
@@ -697,6 +710,11 @@ enum affinity_gran {
   affinity_gran_fine = 0,
   affinity_gran_thread,
   affinity_gran_core,
+  // Cache and NUMA domains between the core and the package; topology maps
+  // that do not model them use the package instead.
+  affinity_gran_tile,
+  affinity_gran_llc,
+  affinity_gran_numa,
   affinity_gran_package,
   affinity_gran_node,
 #if KMP_GROUP_AFFINITY
@@ -714,6 +732,9 @@ enum affinity_top_method {
   affinity_top_method_x2apicid,
 #endif /* KMP_ARCH_X86 || KMP_ARCH_X86_64 */
   affinity_top_method_cpuinfo, // KMP_CPUINFO_FILE is usable on Windows* OS, too
+#if KMP_OS_LINUX
+  affinity_top_method_sysfs,
+#endif /* KMP_OS_LINUX */
 #if KMP_GROUP_AFFINITY
   affinity_top_method_group,
 #endif /* KMP_GROUP_AFFINITY */
@@ -739,10 +760,15 @@ extern int __kmp_affinity_respect_mask; // Respect process' init affinity mask?
 extern char *__kmp_affinity_proclist; /* proc ID list */
 extern kmp_affin_mask_t *__kmp_affinity_masks;
 extern unsigned __kmp_affinity_num_masks;
+extern int *__kmp_affinity_place_pkg; /* package of each place */
+extern int __kmp_affinity_num_pkgs; /* number of packages in the places */
+extern int *__kmp_affinity_proc_pkg; /* package of each OS proc, -1 if none */
+extern int __kmp_affinity_num_proc_pkg; /* size of __kmp_affinity_proc_pkg */
 extern void __kmp_affinity_bind_thread(int which);
 
 extern kmp_affin_mask_t *__kmp_affin_fullMask;
 extern char const *__kmp_cpuinfo_file;
+extern char const *__kmp_topology_cache_file;
 
 #endif /* KMP_AFFINITY_SUPPORTED */
 
@@ -813,8 +839,20 @@ extern int __kmp_hws_abs_flag; // absolute or per-item number requested
 #define KMP_GTID_UNKNOWN (-5) /* Is not known */
 #define KMP_GTID_MIN (-6) /* Minimal gtid for low bound check in DEBUG */
 
+#if defined(KMP_TDATA_GTID) && KMP_OS_LINUX
+// With the gtid in static TLS (mode 3) the lookup needs no call; threads that
+// are not registered yet still go through the functions, which register them
+#define KMP_GTID_TDATA()                                                       \
+  (TCR_4(__kmp_gtid_mode) >= 3 && TCR_4(__kmp_init_gtid))
+#define __kmp_get_gtid()                                                       \
+  (KMP_GTID_TDATA() ? __kmp_gtid : __kmp_get_global_thread_id())
+#define __kmp_entry_gtid()                                                     \
+  (KMP_GTID_TDATA() && __kmp_gtid >= 0 ? __kmp_gtid                            \
+                                       : __kmp_get_global_thread_id_reg())
+#else
 #define __kmp_get_gtid() __kmp_get_global_thread_id()
 #define __kmp_entry_gtid() __kmp_get_global_thread_id_reg()
+#endif
 
 #define __kmp_tid_from_gtid(gtid)                                              \
   (KMP_DEBUG_ASSERT((gtid) >= 0), __kmp_threads[(gtid)]->th.th_info.ds.ds_tid)
@@ -880,6 +918,9 @@ extern int __kmp_hws_abs_flag; // absolute or per-item number requested
 #define KMP_MAX_MALLOC_POOL_INCR                                               \
   (~((size_t)1 << ((sizeof(size_t) * (1 << 3)) - 1)))
 
+#define KMP_HUGE_PAGE_SIZE ((size_t)(2 * 1024 * 1024))
+#define KMP_DEFAULT_ALLOC_MMAP_THRESHOLD KMP_HUGE_PAGE_SIZE
+
 #define KMP_MIN_STKOFFSET (0)
 #define KMP_MAX_STKOFFSET KMP_MAX_STKSIZE
 #if KMP_OS_DARWIN
@@ -966,6 +1007,16 @@ extern kmp_uint64 __kmp_now_nsec();
 #define KMP_DEFAULT_NEXT_WAIT 1024U
 
 #define KMP_DFLT_DISP_NUM_BUFF 7
+// buffer_flags of an overflow dispatch buffer that is free for reuse
+#define KMP_DISP_BUFFER_FREE 0x1
+// buffer_flags of a ring slot some of whose loops were diverted
+#define KMP_DISP_BUFFER_DIVERTED 0x2
+#define KMP_DFLT_DOACROSS_DENSE_LIMIT ((size_t)(4 * 1024 * 1024))
+#define KMP_MAX_DOACROSS_DENSE_LIMIT KMP_SIZE_T_MAX
+#define KMP_MIN_DOACROSS_WINDOW 1024 /* in 64-bit slots */
+/* nsec a doacross post waits for a window slot that does not move before it
+   uses the dense vector, at least; see __kmp_doacross_stall_nsec() */
+#define KMP_DOACROSS_WINDOW_STALL ((kmp_uint64)100000000)
 #define KMP_MAX_ORDERED 8
 
 #define KMP_MAX_FIELDS 32
@@ -1464,7 +1515,6 @@ struct private_data {
 };
 
 struct private_common {
-  struct private_common *next;
   struct private_common *link;
   void *gbl_addr;
   void *par_addr; /* par_addr == gbl_addr for MASTER thread */
@@ -1491,6 +1541,8 @@ struct shared_common {
   size_t vec_len;
   int is_vec;
   size_t cmn_size;
+  int slot; /* index of the thread copies in th_pri_slots */
+  int lazy_fd; /* initial image for lazy copies, -1 unset, -2 unavailable */
 };
 
 #define KMP_HASH_TABLE_LOG2 9 /* log2 of the hash table size */
@@ -1500,10 +1552,6 @@ struct shared_common {
 #define KMP_HASH(x)                                                            \
   ((((kmp_uintptr_t)x) >> KMP_HASH_SHIFT) & (KMP_HASH_TABLE_SIZE - 1))
 
-struct common_table {
-  struct private_common *data[KMP_HASH_TABLE_SIZE];
-};
-
 struct shared_table {
   struct shared_common *data[KMP_HASH_TABLE_SIZE];
 };
@@ -1636,6 +1684,9 @@ typedef struct KMP_ALIGN_CACHE dispatch_private_info {
   kmp_int32 nomerge; /* don't merge iters if serialized */
   kmp_int32 type_size; /* the size of types in private_info */
   enum cons_type pushed_ws;
+#if KMP_STATIC_STEAL_ENABLED
+  kmp_lock_t *steal_lock; // lock used for chunk stealing (8-byte variable)
+#endif
 } dispatch_private_info_t;
 
 typedef struct dispatch_shared_info32 {
@@ -1664,6 +1715,14 @@ typedef struct dispatch_shared_info {
     dispatch_shared_info64_t s64;
   } u;
   volatile kmp_uint32 buffer_index;
+  // KMP_DISP_BUFFER_* state, changed under the team's t_disp_lock
+  kmp_uint32 buffer_flags;
+  // first loop index that may use a ring slot again after loops were diverted
+  // to overflow buffers while the slot was busy
+  kmp_uint32 buffer_skip;
+  struct dispatch_shared_info *buffer_next; // overflow buffers of a ring slot
+  // per-thread private buffers of the loops using an overflow buffer
+  struct dispatch_private_info *buffer_private;
 #if OMP_45_ENABLED
   volatile kmp_int32 doacross_buf_idx; // teamwise index
   volatile kmp_uint32 *doacross_flags; // shared array of iteration flags (0/1)
@@ -1691,19 +1750,10 @@ typedef struct kmp_disp {
 #if OMP_45_ENABLED
   kmp_int32 th_doacross_buf_idx; // thread's doacross buffer index
   volatile kmp_uint32 *th_doacross_flags; // pointer to shared array of flags
-  union { // we can use union here because doacross cannot be used in
-    // nonmonotonic loops
-    kmp_int64 *th_doacross_info; // info on loop bounds
-    kmp_lock_t *th_steal_lock; // lock used for chunk stealing (8-byte variable)
-  };
-#else
-#if KMP_STATIC_STEAL_ENABLED
-  kmp_lock_t *th_steal_lock; // lock used for chunk stealing (8-byte variable)
-  void *dummy_padding[1]; // make it 64 bytes on Intel(R) 64
+  kmp_int64 *th_doacross_info; // info on loop bounds
 #else
   void *dummy_padding[2]; // make it 64 bytes on Intel(R) 64
 #endif
-#endif
 #if KMP_USE_INTERNODE_ALIGNMENT
   char more_padding[INTERNODE_CACHE_LINE];
 #endif
@@ -1920,6 +1970,10 @@ typedef struct kmp_desc_base {
   kmp_thread_t ds_thread;
   volatile int ds_tid;
   int ds_gtid;
+#if KMP_OS_UNIX
+  void *ds_stack_map; // Stack mapped by __kmp_map_pages(), NULL if none
+  size_t ds_stack_map_size;
+#endif
 #if KMP_OS_WINDOWS
   volatile int ds_alive;
   DWORD ds_thread_id;
@@ -1971,6 +2025,92 @@ typedef struct kmp_local {
 
 } kmp_local_t;
 
+#if OMP_50_ENABLED
+// OpenMP 5.0 memory management support
+#ifndef __OMP_H
+// Duplicate type definitions from omp.h
+typedef uintptr_t omp_uintptr_t;
+
+typedef enum {
+  omp_atk_sync_hint = 1,
+  omp_atk_alignment = 2,
+  omp_atk_access = 3,
+  omp_atk_pool_size = 4,
+  omp_atk_fallback = 5,
+  omp_atk_fb_data = 6,
+  omp_atk_pinned = 7,
+  omp_atk_partition = 8
+} omp_alloctrait_key_t;
+
+typedef enum {
+  omp_atv_false = 0,
+  omp_atv_true = 1,
+  omp_atv_default = 2,
+  omp_atv_contended = 3,
+  omp_atv_uncontended = 4,
+  omp_atv_sequential = 5,
+  omp_atv_private = 6,
+  omp_atv_all = 7,
+  omp_atv_thread = 8,
+  omp_atv_pteam = 9,
+  omp_atv_cgroup = 10,
+  omp_atv_default_mem_fb = 11,
+  omp_atv_null_fb = 12,
+  omp_atv_abort_fb = 13,
+  omp_atv_allocator_fb = 14,
+  omp_atv_environment = 15,
+  omp_atv_nearest = 16,
+  omp_atv_blocked = 17,
+  omp_atv_interleaved = 18
+} omp_alloctrait_value_t;
+
+typedef struct {
+  omp_alloctrait_key_t key;
+  omp_uintptr_t value;
+} omp_alloctrait_t;
+
+typedef enum {
+  omp_null_allocator = 0,
+  omp_default_mem_alloc = 1,
+  omp_large_cap_mem_alloc = 2,
+  omp_const_mem_alloc = 3,
+  omp_high_bw_mem_alloc = 4,
+  omp_low_lat_mem_alloc = 5,
+  omp_cgroup_mem_alloc = 6,
+  omp_pteam_mem_alloc = 7,
+  omp_thread_mem_alloc = 8,
+  KMP_ALLOCATOR_MAX_HANDLE = UINTPTR_MAX
+} omp_allocator_handle_t;
+
+typedef enum {
+  omp_default_mem_space = 0,
+  omp_large_cap_mem_space = 1,
+  omp_const_mem_space = 2,
+  omp_high_bw_mem_space = 3,
+  omp_low_lat_mem_space = 4,
+  KMP_MEMSPACE_MAX_HANDLE = UINTPTR_MAX
+} omp_memspace_handle_t;
+#endif // __OMP_H
+
+// Allocators created by omp_init_allocator; their handles are pointers to
+// this structure, while the predefined allocators are small integers.
+typedef struct kmp_allocator_t {
+  omp_memspace_handle_t memspace;
+  void **memkind; // memkind kind for the memspace and partition, if any
+  size_t alignment;
+  omp_alloctrait_value_t fb; // fallback
+  omp_allocator_handle_t fb_data;
+  omp_alloctrait_value_t access;
+  omp_alloctrait_value_t partition;
+  int pinned;
+  kmp_uint64 pool_size; // 0 if unlimited
+  volatile kmp_uint64 pool_used;
+} kmp_allocator_t;
+
+#define KMP_IS_PREDEFINED_ALLOCATOR(al)                                        \
+  ((kmp_uintptr_t)(al) <= (kmp_uintptr_t)omp_thread_mem_alloc)
+#endif // OMP_50_ENABLED
+
 #define KMP_CHECK_UPDATE(a, b)                                                 \
   if ((a) != (b))                                                              \
   (a) = (b)
@@ -2058,6 +2198,11 @@ extern kmp_int32 __kmp_default_device; // Set via OMP_DEFAULT_DEVICE if
 extern kmp_int32 __kmp_max_task_priority;
 // Set via KMP_TASKLOOP_MIN_TASKS if specified, defaults to 0 otherwise
 extern kmp_uint64 __kmp_taskloop_min_tasks;
+// Set via KMP_TASKLOOP_LAZY_SPLIT, split taskloop tasks off on demand only
+extern int __kmp_taskloop_lazy_split;
+// Size in bytes above which doacross loops switch from the dense per-iteration
+// bit-vector to the sliding window of flag words (KMP_DOACROSS_DENSE_LIMIT)
+extern size_t __kmp_doacross_dense_limit;
 #endif
 
 /* NOTE: kmp_taskdata_t and kmp_task_t structures allocated in single block with
@@ -2236,7 +2381,9 @@ typedef struct kmp_tasking_flags { /* Total struct must be exactly 32 bits */
   unsigned complete : 1; /* 1==complete, 0==not complete   */
   unsigned freed : 1; /* 1==freed, 0==allocateed        */
   unsigned native : 1; /* 1==gcc-compiled task, 0==intel */
-  unsigned reserved31 : 7; /* reserved for library use */
+  unsigned included : 1; /* 1==generated in a final task, not counted by the
+                            parent, its taskgroup or the task team */
+  unsigned reserved31 : 6; /* reserved for library use */
 
 } kmp_tasking_flags_t;
 
@@ -2301,6 +2448,11 @@ typedef struct kmp_base_thread_data {
 #endif // BUILD_TIED_TASK_STACK
 } kmp_base_thread_data_t;
 
+// Lazily split taskloops start with chunks of tc / (nproc * CHUNKS) iterations
+// and let them grow up to MAX_GROW times that while no thread needs work
+#define KMP_TASKLOOP_LAZY_CHUNKS 40
+#define KMP_TASKLOOP_LAZY_MAX_GROW 8
+
 #define TASK_DEQUE_BITS 8 // Used solely to define INITIAL_TASK_DEQUE_SIZE
 #define INITIAL_TASK_DEQUE_SIZE (1 << TASK_DEQUE_BITS)
 
@@ -2357,6 +2509,16 @@ typedef struct kmp_free_list {
   void *th_free_list_other; // Non-self free list (to be returned to owner's
   // sync list)
 } kmp_free_list_t;
+
+// Per-thread state of one size class of the slab fast memory engine
+#define KMP_SLAB_CLASSES 26
+typedef struct kmp_slab_class {
+  struct kmp_slab *sc_partial; // Own slabs with free objects, head is current
+  void *sc_batch; // Objects of another thread's slabs, to be returned to it
+  void *sc_batch_tail;
+  struct kmp_slab_owner *sc_batch_owner; // Owner of the objects in sc_batch
+  kmp_int32 sc_batch_count;
+} kmp_slab_class_t;
 #endif
 #if KMP_NESTED_HOT_TEAMS
 // Hot teams array keeps hot teams and their sizes for given thread. Hot teams
@@ -2410,6 +2572,10 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
 
 #if KMP_AFFINITY_SUPPORTED
   kmp_affin_mask_t *th_affin_mask; /* thread's current affinity mask */
+#if KMP_OS_LINUX
+  int th_numa_local; /* descriptor has pages of its own to move */
+  int th_numa_node; /* node they were last moved to, -1 if not yet */
+#endif
 #endif
 
   /* The data set by the master at reinit, then R/W by the worker */
@@ -2437,6 +2603,9 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
 #endif /* USE_ITT_BUILD */
   kmp_local_t th_local;
   struct private_common *th_pri_head;
+#if OMP_50_ENABLED
+  omp_allocator_handle_t th_def_allocator; /* default allocator */
+#endif
 
   /* Now the data only used by the worker (after initial allocation) */
   /* TODO the first serial team should actually be stored in the info_t
@@ -2449,7 +2618,8 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
 #endif
 
   /* The following are also read by the master during reinit */
-  struct common_table *th_pri_common;
+  struct private_common **th_pri_slots; // threadprivate copies, by slot
+  int th_pri_nslots; // size of th_pri_slots
 
   volatile kmp_uint32 th_spin_here; /* thread-local location for spinning */
   /* while awaiting queuing lock acquire */
@@ -2487,7 +2657,26 @@ typedef struct KMP_ALIGN_CACHE kmp_base_info {
 #define NUM_LISTS 4
   kmp_free_list_t th_free_lists[NUM_LISTS]; // Free lists for fast memory
 // allocation routines
-#endif
+  kmp_slab_class_t th_slab_classes[KMP_SLAB_CLASSES]; // Slab engine state
+  struct kmp_slab_owner *th_slab_owner; // Slabs and remote frees, may outlive
+  // the thread
+  struct kmp_slab *th_slab_reserve; // Empty slabs kept for reuse
+  kmp_int32 th_slab_reserve_size;
+#endif
+
+#if KMP_USE_DYNAMIC_LOCK
+  kmp_indirect_lock_t *th_i_lock_cache[KMP_NUM_I_LOCKS]; // Destroyed indirect
+  // locks kept for reuse, one list per lock kind
+  kmp_int32 th_i_lock_cache_size[KMP_NUM_I_LOCKS];
+  kmp_lock_index_t th_i_lock_next; // Next free index in the owned chunk of the
+  kmp_lock_index_t th_i_lock_end; // indirect lock table, end of that chunk
+  kmp_int32 th_cohort_pkg; // Package of the proc the thread ran on when it
+  // was last looked up by a cohort lock, -1 if unknown
+  kmp_uint32 th_cohort_pkg_age; // Cohort lock acquisitions until the next
+  // lookup
+#endif
+  kmp_uint32 th_lock_prof_count; // Lock acquisitions since the last sampled
+  // one, see KMP_LOCK_PROFILE
 
 #if KMP_OS_WINDOWS
   kmp_win32_cond_t th_suspend_cv;
@@ -2559,6 +2748,7 @@ typedef struct KMP_ALIGN_CACHE kmp_base_team {
   kmp_balign_team_t t_bar[bs_last_barrier];
   volatile int t_construct; // count of single directive encountered by team
   kmp_lock_t t_single_lock; // team specific lock
+  kmp_lock_t t_disp_lock; // guards diversion of loops to overflow buffers
 
   // Master only
   // ---------------------------------------------------------------------------
@@ -2833,11 +3023,24 @@ extern int __kmp_stkpadding; /* Should we pad root thread(s) stack */
 
 extern size_t
     __kmp_malloc_pool_incr; /* incremental size of pool for kmp_malloc() */
+extern enum fast_mem_engine
+    __kmp_fast_mem_engine; /* allocator behind __kmp_fast_allocate() */
+extern int __kmp_numa_local_threads; /* keep workers' data on their node */
+extern enum huge_pages_type __kmp_huge_pages; /* KMP_HUGE_PAGES */
+extern enum prefault_type __kmp_prefault_pages; /* KMP_PREFAULT_PAGES */
+// Stacks and pools come from __kmp_map_pages() rather than pthread and malloc
+#define KMP_MAP_PAGES()                                                        \
+  (__kmp_huge_pages != huge_pages_off || __kmp_prefault_pages != prefault_off)
+#if OMP_50_ENABLED
+extern omp_allocator_handle_t __kmp_def_allocator; /* OMP_ALLOCATOR */
+extern size_t __kmp_alloc_mmap_threshold; /* omp_alloc blocks from mmap */
+#endif
 extern int __kmp_env_stksize; /* was KMP_STACKSIZE specified? */
 extern int __kmp_env_blocktime; /* was KMP_BLOCKTIME specified? */
 extern int __kmp_env_checks; /* was KMP_CHECKS specified?    */
 extern int __kmp_env_consistency_check; // was KMP_CONSISTENCY_CHECK specified?
 extern int __kmp_generate_warnings; /* should we issue warnings? */
+extern int __kmp_critical_delegate; /* delegate critical section bodies? */
 extern int __kmp_reserve_warn; /* have we issued reserve_threads warning? */
 
 #ifdef DEBUG_SUSPEND
@@ -2871,6 +3074,14 @@ extern int __kmp_dflt_team_nth; /* default number of threads in a parallel
                                    region a la OMP_NUM_THREADS */
 extern int __kmp_dflt_team_nth_ub; /* upper bound on "" determined at serial
                                       initialization */
+#if KMP_OS_LINUX
+extern int __kmp_cgroup_quota; /* cap the default team size by the CPU quota */
+extern int __kmp_cgroup_cpu_limit; /* cgroup CPU quota in procs, 0 if none */
+extern int __kmp_cgroup_recheck_interval; /* msec between cgroup rechecks */
+extern volatile kmp_uint64
+    __kmp_cgroup_next_check; /* time of the next recheck, nsec */
+extern char const *__kmp_cgroup_path; /* KMP_CGROUP_PATH */
+#endif
 extern int __kmp_tp_capacity; /* capacity of __kmp_threads if threadprivate is
                                  used (fixed) */
 extern int __kmp_tp_cached; /* whether threadprivate cache has been created
@@ -2911,6 +3122,12 @@ extern int
 #if KMP_OS_WINDOWS
 extern __declspec(
     thread) int __kmp_gtid; /* This thread's gtid, if __kmp_gtid_mode == 3 */
+#elif KMP_OS_LINUX && KMP_USE_INITIAL_EXEC_TLS
+// initial-exec: a single load relative to the thread pointer instead of a
+// __tls_get_addr() call from the shared library. The variable takes static TLS
+// space then, and a late dlopen() of the library fails if none is left; build
+// with LIBOMP_USE_INITIAL_EXEC_TLS off for such uses.
+extern __thread int __kmp_gtid __attribute__((tls_model("initial-exec")));
 #else
 extern __thread int __kmp_gtid;
 #endif /* KMP_OS_WINDOWS - workaround because Intel(R) Many Integrated Core    \
@@ -2918,6 +3135,7 @@ extern __thread int __kmp_gtid;
 #endif
 extern int __kmp_tls_gtid_min; /* #threads below which use sp search for gtid */
 extern int __kmp_foreign_tp; // If true, separate TP var for each foreign thread
+extern size_t __kmp_tp_lazy_size; // map TP copies this large copy-on-write
 #if KMP_ARCH_X86 || KMP_ARCH_X86_64
 extern int __kmp_inherit_fp_control; // copy fp creg(s) parent->workers at fork
 extern kmp_int16 __kmp_init_x87_fpu_control_word; // init thread's FP ctrl reg
@@ -2929,6 +3147,8 @@ extern int __kmp_dflt_max_active_levels; /* max_active_levels for nested
                                             OMP_MAX_ACTIVE_LEVELS */
 extern int __kmp_dispatch_num_buffers; /* max possible dynamic loops in
                                           concurrent execution per team */
+extern int __kmp_dispatch_grow_buffers; /* divert loops to overflow buffers
+                                           instead of waiting for ring slots */
 #if KMP_NESTED_HOT_TEAMS
 extern int __kmp_hot_teams_mode;
 extern int __kmp_hot_teams_max_level;
@@ -2965,6 +3185,11 @@ struct kmp_adaptive_backoff_params_t {
   // Badness is a bit mask : 0,1,3,7,15,... on each hard failure we move one to
   // the right
   kmp_uint32 max_badness;
+  // Number of speculative attempts over which each lock measures its success
+  // rate.
+  kmp_uint32 window;
+  // Success rate, in percent, below which a lock stops speculating for a while.
+  kmp_uint32 min_success;
 };
 
 extern kmp_adaptive_backoff_params_t __kmp_adaptive_backoff_params;
@@ -3095,6 +3320,8 @@ extern void ___kmp_free(void *ptr KMP_SRC_LOC_DECL);
 #define __kmp_allocate(size) ___kmp_allocate((size)KMP_SRC_LOC_CURR)
 #define __kmp_page_allocate(size) ___kmp_page_allocate((size)KMP_SRC_LOC_CURR)
 #define __kmp_free(ptr) ___kmp_free((ptr)KMP_SRC_LOC_CURR)
+extern void *__kmp_map_pages(size_t size, int guard, void **base, size_t *len);
+extern void __kmp_unmap_pages(void *base, size_t len);
 
 #if USE_FAST_MEMORY
 extern void *___kmp_fast_allocate(kmp_info_t *this_thr,
@@ -3102,12 +3329,19 @@ extern void *___kmp_fast_allocate(kmp_info_t *this_thr,
 extern void ___kmp_fast_free(kmp_info_t *this_thr, void *ptr KMP_SRC_LOC_DECL);
 extern void __kmp_free_fast_memory(kmp_info_t *this_thr);
 extern void __kmp_initialize_fast_memory(kmp_info_t *this_thr);
+extern void __kmp_flush_fast_memory(kmp_info_t *this_thr);
 #define __kmp_fast_allocate(this_thr, size)                                    \
   ___kmp_fast_allocate((this_thr), (size)KMP_SRC_LOC_CURR)
 #define __kmp_fast_free(this_thr, ptr)                                         \
   ___kmp_fast_free((this_thr), (ptr)KMP_SRC_LOC_CURR)
 #endif
 
+#if KMP_USE_DYNAMIC_LOCK
+// Returns the indirect locks cached by a thread and its partially used lock
+// table chunk; called when the thread is reaped.
+extern void __kmp_free_indirect_lock_cache(kmp_info_t *th);
+#endif
+
 extern void *___kmp_thread_malloc(kmp_info_t *th, size_t size KMP_SRC_LOC_DECL);
 extern void *___kmp_thread_calloc(kmp_info_t *th, size_t nelem,
                                   size_t elsize KMP_SRC_LOC_DECL);
@@ -3236,6 +3470,12 @@ extern void __kmp_clear_system_time(void);
 extern void __kmp_read_system_time(double *delta);
 
 extern void __kmp_check_stack_overlap(kmp_info_t *thr);
+#if KMP_OS_LINUX
+extern int __kmp_move_pages_local(void *addr, size_t size, int from_node);
+#if KMP_AFFINITY_SUPPORTED
+extern void __kmp_move_thread_local(kmp_info_t *th);
+#endif
+#endif
 
 extern void __kmp_expand_host_name(char *buffer, size_t size);
 extern void __kmp_expand_file_name(char *result, size_t rlen, char *pattern);
@@ -3269,6 +3509,8 @@ extern int __kmp_aux_get_affinity_mask_proc(int proc, void **mask);
 extern void __kmp_balanced_affinity(int tid, int team_size);
 #if KMP_OS_LINUX
 extern int kmp_set_thread_affinity_mask_initial(void);
+extern kmp_affin_mask_t *__kmp_affinity_cgroup_read(void);
+extern int __kmp_affinity_cgroup_update(kmp_affin_mask_t *cpuset);
 #endif
 #endif /* KMP_AFFINITY_SUPPORTED */
 
@@ -3317,6 +3559,7 @@ extern void __kmp_resume_oncore(int target_gtid, kmp_flag_oncore *flag);
 
 extern void __kmp_elapsed(double *);
 extern void __kmp_elapsed_tick(double *);
+extern kmp_uint64 __kmp_now_nsec();
 
 extern void __kmp_enable(int old_state);
 extern void __kmp_disable(int *old_state);
@@ -3368,6 +3611,23 @@ KMP_EXPORT void *kmpc_calloc(size_t nelem, size_t elsize);
 KMP_EXPORT void *kmpc_realloc(void *ptr, size_t size);
 KMP_EXPORT void kmpc_free(void *ptr);
 
+#if OMP_50_ENABLED
+extern void __kmp_init_memkind();
+extern void __kmp_fini_memkind();
+KMP_EXPORT omp_allocator_handle_t
+__kmpc_init_allocator(int gtid, omp_memspace_handle_t memspace, int ntraits,
+                      const omp_alloctrait_t traits[]);
+KMP_EXPORT void __kmpc_destroy_allocator(int gtid,
+                                         omp_allocator_handle_t allocator);
+KMP_EXPORT void __kmpc_set_default_allocator(int gtid,
+                                             omp_allocator_handle_t allocator);
+KMP_EXPORT omp_allocator_handle_t __kmpc_get_default_allocator(int gtid);
+KMP_EXPORT void *__kmpc_alloc(int gtid, size_t size,
+                              omp_allocator_handle_t allocator);
+KMP_EXPORT void __kmpc_free(int gtid, void *ptr,
+                            omp_allocator_handle_t allocator);
+#endif
+
 /* declarations for internal use */
 
 extern int __kmp_barrier(enum barrier_type bt, int gtid, int is_split,
@@ -3498,6 +3758,11 @@ extern kmp_uint64 __kmp_hardware_timestamp(void);
 #if KMP_OS_UNIX
 extern int __kmp_read_from_file(char const *path, char const *format, ...);
 #endif
+#if KMP_OS_LINUX
+extern int __kmp_get_cgroup_cpu_limit(void);
+extern int __kmp_get_cgroup_cpuset_file(char *path, size_t size);
+extern void __kmp_cgroup_recheck(int gtid);
+#endif
 
 /* ------------------------------------------------------------------------ */
 //
@@ -3569,6 +3834,10 @@ KMP_EXPORT void __kmpc_end_critical(ident_t *, kmp_int32 global_tid,
 KMP_EXPORT void __kmpc_critical_with_hint(ident_t *, kmp_int32 global_tid,
                                           kmp_critical_name *, uintptr_t hint);
 #endif
+KMP_EXPORT void __kmpc_critical_delegate(ident_t *, kmp_int32 global_tid,
+                                        kmp_critical_name *,
+                                        void (*body)(void *), void *data);
+extern void __kmp_cleanup_critical_delegates(void);
 
 KMP_EXPORT kmp_int32 __kmpc_barrier_master(ident_t *, kmp_int32 global_tid);
 KMP_EXPORT void __kmpc_end_barrier_master(ident_t *, kmp_int32 global_tid);
@@ -20,6 +20,13 @@
 #include "kmp_str.h"
 #include "kmp_wrapper_getpid.h"
 
+#if KMP_OS_LINUX
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#endif
+
 // Store the real or imagined machine hierarchy here
 static hierarchy_info machine_hierarchy;
 
@@ -226,6 +233,34 @@ static int __kmp_nThreadsPerCore;
 static int __kmp_ncores;
 #endif
 static int *__kmp_pu_os_idx = NULL;
+// Package label of each proc in __kmp_pu_os_idx, if the method knows it
+static int *__kmp_pu_pkg = NULL;
+// Levels of the topology map holding NUMA domains, last level caches and L2
+// tiles, -1 if the map does not model them. A domain that coincides with the
+// package, the core or another domain is held by that level.
+static int __kmp_affinity_numa_level = -1;
+static int __kmp_affinity_llc_level = -1;
+static int __kmp_affinity_tile_level = -1;
+// Levels of the packages, cores and threads in the map the topology method
+// built, -1 if the map does not model them; saved in the topology cache.
+static int __kmp_affinity_pkg_level = -1;
+static int __kmp_affinity_core_level = -1;
+static int __kmp_affinity_thread_level = -1;
+
+#if KMP_OS_LINUX
+// Set while the places are rebuilt for a changed cgroup cpuset. The rebuild
+// gives up where the first build would have stopped the program or turned
+// affinity off, and leaves the topology cache alone.
+static bool __kmp_affinity_rebuilding = false;
+static bool __kmp_affinity_rebuild_failed = false;
+#define KMP_AFF_REBUILD_GIVE_UP()                                              \
+  if (__kmp_affinity_rebuilding) {                                             \
+    __kmp_affinity_rebuild_failed = true;                                      \
+    return;                                                                    \
+  }
+#else
+#define KMP_AFF_REBUILD_GIVE_UP()
+#endif
 
 // __kmp_affinity_uniform_topology() doesn't work when called from
 // places which support arbitrarily many levels in the machine topology
@@ -254,6 +289,12 @@ static void __kmp_affinity_print_topology(AddrUnsPair *address2os, int len,
         __kmp_str_buf_print(&buf, "%s ", KMP_I18N_STR(Core));
       } else if (level == pkgLevel) {
         __kmp_str_buf_print(&buf, "%s ", KMP_I18N_STR(Package));
+      } else if (level == __kmp_affinity_numa_level) {
+        __kmp_str_buf_print(&buf, "%s ", KMP_I18N_STR(NumaDomain));
+      } else if (level == __kmp_affinity_llc_level) {
+        __kmp_str_buf_print(&buf, "%s ", KMP_I18N_STR(LLCache));
+      } else if (level == __kmp_affinity_tile_level) {
+        __kmp_str_buf_print(&buf, "%s ", KMP_I18N_STR(Tile));
       } else if (level > pkgLevel) {
         __kmp_str_buf_print(&buf, "%s_%d ", KMP_I18N_STR(Node),
                             level - pkgLevel - 1);
@@ -390,6 +431,7 @@ static int __kmp_affinity_create_hwloc_map(AddrUnsPair **address2os,
   AddrUnsPair *retval =
       (AddrUnsPair *)__kmp_allocate(sizeof(AddrUnsPair) * __kmp_avail_proc);
   __kmp_pu_os_idx = (int *)__kmp_allocate(sizeof(int) * __kmp_avail_proc);
+  __kmp_pu_pkg = (int *)__kmp_allocate(sizeof(int) * __kmp_avail_proc);
 
   // When affinity is off, this routine will still be called to set
   // __kmp_ncores, as well as __kmp_nThreadsPerCore,
@@ -443,6 +485,7 @@ static int __kmp_affinity_create_hwloc_map(AddrUnsPair **address2os,
         retval[nActiveThreads] = AddrUnsPair(addr, pu->os_index);
         __kmp_pu_os_idx[nActiveThreads] =
             pu->os_index; // keep os index for each active pu
+        __kmp_pu_pkg[nActiveThreads] = socket_identifier;
         nActiveThreads++;
         ++num_active_threads; // count active threads per core
       }
@@ -657,6 +700,9 @@ static int __kmp_affinity_create_flat_map(AddrUnsPair **address2os,
     addr.labels[0] = i;
     (*address2os)[avail_ct++] = AddrUnsPair(addr, i);
   }
+  __kmp_affinity_pkg_level = 0;
+  __kmp_affinity_core_level = -1;
+  __kmp_affinity_thread_level = -1;
   if (__kmp_affinity_verbose) {
     KMP_INFORM(OSProcToPackage, "KMP_AFFINITY");
   }
@@ -725,6 +771,12 @@ static int __kmp_affinity_create_proc_group_map(AddrUnsPair **address2os,
       const char *gran_str = NULL;
       if (__kmp_affinity_gran == affinity_gran_core) {
         gran_str = "core";
+      } else if (__kmp_affinity_gran == affinity_gran_tile) {
+        gran_str = "tile";
+      } else if (__kmp_affinity_gran == affinity_gran_llc) {
+        gran_str = "llc";
+      } else if (__kmp_affinity_gran == affinity_gran_numa) {
+        gran_str = "numa";
       } else if (__kmp_affinity_gran == affinity_gran_package) {
         gran_str = "package";
       } else if (__kmp_affinity_gran == affinity_gran_node) {
@@ -1022,6 +1074,9 @@ static int __kmp_affinity_create_apicid_map(AddrUnsPair **address2os,
       return 0;
     }
 
+    __kmp_affinity_pkg_level = 0;
+    __kmp_affinity_core_level = -1;
+    __kmp_affinity_thread_level = -1;
     *address2os = (AddrUnsPair *)__kmp_allocate(sizeof(AddrUnsPair));
     Address addr(1);
     addr.labels[0] = threadInfo[0].pkgId;
@@ -1155,8 +1210,10 @@ static int __kmp_affinity_create_apicid_map(AddrUnsPair **address2os,
   KMP_DEBUG_ASSERT(__kmp_pu_os_idx == NULL);
   KMP_DEBUG_ASSERT(nApics == __kmp_avail_proc);
   __kmp_pu_os_idx = (int *)__kmp_allocate(sizeof(int) * __kmp_avail_proc);
+  __kmp_pu_pkg = (int *)__kmp_allocate(sizeof(int) * __kmp_avail_proc);
   for (i = 0; i < nApics; ++i) {
     __kmp_pu_os_idx[i] = threadInfo[i].osId;
+    __kmp_pu_pkg[i] = threadInfo[i].pkgId;
   }
   if (__kmp_affinity_type == affinity_none) {
     __kmp_free(threadInfo);
@@ -1208,6 +1265,9 @@ static int __kmp_affinity_create_apicid_map(AddrUnsPair **address2os,
     }
   }
 
+  __kmp_affinity_pkg_level = pkgLevel;
+  __kmp_affinity_core_level = coreLevel;
+  __kmp_affinity_thread_level = threadLevel;
   if (__kmp_affinity_verbose) {
     __kmp_affinity_print_topology(*address2os, nApics, depth, pkgLevel,
                                   coreLevel, threadLevel);
@@ -1438,6 +1498,9 @@ static int __kmp_affinity_create_x2apicid_map(AddrUnsPair **address2os,
       return 0;
     }
 
+    __kmp_affinity_pkg_level = 0;
+    __kmp_affinity_core_level = -1;
+    __kmp_affinity_thread_level = -1;
     // Form an Address object which only includes the package level.
     Address addr(1);
     addr.labels[0] = retval[0].first.labels[pkgLevel];
@@ -1572,8 +1635,10 @@ static int __kmp_affinity_create_x2apicid_map(AddrUnsPair **address2os,
   KMP_DEBUG_ASSERT(__kmp_pu_os_idx == NULL);
   KMP_DEBUG_ASSERT(nApics == __kmp_avail_proc);
   __kmp_pu_os_idx = (int *)__kmp_allocate(sizeof(int) * __kmp_avail_proc);
+  __kmp_pu_pkg = (int *)__kmp_allocate(sizeof(int) * __kmp_avail_proc);
   for (proc = 0; (int)proc < nApics; ++proc) {
     __kmp_pu_os_idx[proc] = retval[proc].second;
+    __kmp_pu_pkg[proc] = retval[proc].first.labels[pkgLevel];
   }
   if (__kmp_affinity_type == affinity_none) {
     __kmp_free(last);
@@ -1653,6 +1718,9 @@ static int __kmp_affinity_create_x2apicid_map(AddrUnsPair **address2os,
     }
   }
 
+  __kmp_affinity_pkg_level = pkgLevel;
+  __kmp_affinity_core_level = coreLevel;
+  __kmp_affinity_thread_level = threadLevel;
   if (__kmp_affinity_verbose) {
     __kmp_affinity_print_topology(retval, nApics, depth, pkgLevel, coreLevel,
                                   threadLevel);
@@ -2019,6 +2087,9 @@ static int __kmp_affinity_create_cpuinfo_map(AddrUnsPair **address2os,
       return 0;
     }
 
+    __kmp_affinity_pkg_level = 0;
+    __kmp_affinity_core_level = -1;
+    __kmp_affinity_thread_level = -1;
     *address2os = (AddrUnsPair *)__kmp_allocate(sizeof(AddrUnsPair));
     Address addr(1);
     addr.labels[0] = threadInfo[0][pkgIdIndex];
@@ -2242,8 +2313,10 @@ restart_radix_check:
   KMP_DEBUG_ASSERT(__kmp_pu_os_idx == NULL);
   KMP_DEBUG_ASSERT(num_avail == __kmp_avail_proc);
   __kmp_pu_os_idx = (int *)__kmp_allocate(sizeof(int) * __kmp_avail_proc);
+  __kmp_pu_pkg = (int *)__kmp_allocate(sizeof(int) * __kmp_avail_proc);
   for (i = 0; i < num_avail; ++i) { // fill the os indices
     __kmp_pu_os_idx[i] = threadInfo[i][osIdIndex];
+    __kmp_pu_pkg[i] = threadInfo[i][pkgIdIndex];
   }
 
   if (__kmp_affinity_type == affinity_none) {
@@ -2337,6 +2410,9 @@ restart_radix_check:
     }
   }
 
+  __kmp_affinity_pkg_level = pkgLevel;
+  __kmp_affinity_core_level = coreLevel;
+  __kmp_affinity_thread_level = threadLevel;
   if (__kmp_affinity_verbose) {
     __kmp_affinity_print_topology(*address2os, num_avail, depth, pkgLevel,
                                   coreLevel, threadLevel);
@@ -2351,6 +2427,890 @@ restart_radix_check:
   return depth;
 }
 
+#if KMP_OS_LINUX
+
+// Fields of a per-proc record read from sysfs. NUMA node, last level cache, L2
+// tile and core key are global ids; a value of UINT_MAX means that we didn't
+// find it. The caches and the core are identified by the lowest OS proc that
+// shares them.
+enum {
+  sysfsOsId,
+  sysfsPkgId,
+  sysfsNodeId,
+  sysfsLlcId,
+  sysfsTileId,
+  sysfsCoreId,
+  sysfsCoreKey,
+  sysfsThreadId,
+  sysfsNumFields
+};
+typedef unsigned SysfsProcInfo[sysfsNumFields];
+
+// Parse a sysfs cpu list such as "0-3,8-11". If ids is not NULL, set ids[proc]
+// to value for every listed proc below max. Returns the lowest listed proc, or
+// -1 if the list is missing, empty or malformed.
+static int __kmp_affinity_sysfs_read_list(const char *path, unsigned *ids,
+                                          unsigned value, unsigned max) {
+  char buf[4096];
+  if (__kmp_read_from_file(path, "%4095s", buf) != 1) {
+    return -1;
+  }
+  int lowest = -1;
+  const char *scan = buf;
+  while (*scan != '\0') {
+    char *next;
+    long first = strtol(scan, &next, 10);
+    long last = first;
+    if (next == scan || first < 0) {
+      return -1;
+    }
+    if (*next == '-') {
+      scan = next + 1;
+      last = strtol(scan, &next, 10);
+      if (next == scan || last < first) {
+        return -1;
+      }
+    }
+    if (lowest < 0 || first < lowest) {
+      lowest = (int)first;
+    }
+    if (ids != NULL) {
+      for (long proc = first; proc <= last && proc < (long)max; proc++) {
+        ids[proc] = value;
+      }
+    }
+    scan = next;
+    if (*scan == ',') {
+      scan++;
+    } else if (*scan != '\0') {
+      return -1;
+    }
+  }
+  return lowest;
+}
+
+// Count the distinct values of a field.
+static int __kmp_affinity_sysfs_count(SysfsProcInfo *procs, int n, int field) {
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    int j;
+    for (j = 0; j < i; j++) {
+      if (procs[j][field] == procs[i][field]) {
+        break;
+      }
+    }
+    if (j == i) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Check that procs which agree on the inner field also agree on the outer one,
+// i.e. that every inner object lies within a single outer object.
+static bool __kmp_affinity_sysfs_nested(SysfsProcInfo *procs, int n, int inner,
+                                        int outer) {
+  for (int i = 1; i < n; i++) {
+    for (int j = 0; j < i; j++) {
+      if (procs[j][inner] == procs[i][inner]) {
+        if (procs[j][outer] != procs[i][outer]) {
+          return false;
+        }
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+// The topology cache (KMP_TOPOLOGY_CACHE) holds the map built by the topology
+// method together with a key describing the machine, the process and the
+// method it was built for. A map is only read back if the key still matches,
+// so a change of host, kernel, CPU model, online procs, cpuset, affinity mask
+// or KMP_TOPOLOGY_METHOD makes the next process probe the topology again and
+// replace the file.
+#define KMP_TOPOLOGY_CACHE_VERSION 3
+
+// Append the first line of a file, or with a list of prefixes, the first line
+// that starts with one of them.
+static void __kmp_affinity_cache_key_file(kmp_str_buf_t *key, const char *path,
+                                          const char *const *prefixes) {
+  char buf[256];
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    return;
+  }
+  while (fgets(buf, sizeof(buf), f) != NULL) {
+    bool match = (prefixes == NULL);
+    for (int i = 0; !match && prefixes[i] != NULL; i++) {
+      match = (strncmp(buf, prefixes[i], KMP_STRLEN(prefixes[i])) == 0);
+    }
+    if (match) {
+      buf[strcspn(buf, "\n")] = '\0';
+      __kmp_str_buf_print(key, "%s", buf);
+      break;
+    }
+  }
+  fclose(f);
+}
+
+static void __kmp_affinity_topology_cache_key(kmp_str_buf_t *key) {
+  static const char *const cpuModel[] = {"model name", "cpu model", "CPU part",
+                                         "cpu\t", NULL};
+  char host[256];
+  struct utsname uts;
+  if (gethostname(host, sizeof(host)) != 0) {
+    host[0] = '\0';
+  }
+  host[sizeof(host) - 1] = '\0';
+  __kmp_str_buf_print(key, "host=%s method=%d", host,
+                      (int)__kmp_affinity_top_method);
+  if (uname(&uts) == 0) {
+    __kmp_str_buf_print(key, " kernel=%s %s", uts.release, uts.machine);
+  }
+  __kmp_str_buf_print(key, " cpu=");
+  __kmp_affinity_cache_key_file(key, "/proc/cpuinfo", cpuModel);
+  __kmp_str_buf_print(key, " online=");
+  __kmp_affinity_cache_key_file(key, "/sys/devices/system/cpu/online", NULL);
+  __kmp_str_buf_print(key, " cpuset=");
+  __kmp_affinity_cache_key_file(key, "/proc/self/cpuset", NULL);
+
+  // The procs of the full mask, as ranges
+  __kmp_str_buf_print(key, " procs=");
+  int first = -1;
+  int last = -1;
+  unsigned i;
+  KMP_CPU_SET_ITERATE(i, __kmp_affin_fullMask) {
+    if (!KMP_CPU_ISSET(i, __kmp_affin_fullMask)) {
+      continue;
+    }
+    if (first >= 0 && (int)i == last + 1) {
+      last = i;
+      continue;
+    }
+    if (first >= 0) {
+      __kmp_str_buf_print(key, "%d-%d,", first, last);
+    }
+    first = last = i;
+  }
+  __kmp_str_buf_print(key, "%d-%d", first, last);
+}
+
+// Read the map from the topology cache file. Returns NULL if there is no file,
+// or if it is stale or damaged.
+static AddrUnsPair *__kmp_affinity_read_topology_cache(kmp_str_buf_t *key,
+                                                       int *depth,
+                                                       int *pkgLevel,
+                                                       int *coreLevel,
+                                                       int *threadLevel) {
+  FILE *f = fopen(__kmp_topology_cache_file, "r");
+  if (f == NULL) {
+    return NULL;
+  }
+
+  unsigned maxOsId = 0;
+  unsigned i;
+  KMP_CPU_SET_ITERATE(i, __kmp_affin_fullMask) {
+    if (KMP_CPU_ISSET(i, __kmp_affin_fullMask)) {
+      maxOsId = i;
+    }
+  }
+
+  int version = 0;
+  int num = 0;
+  int pkgs, coresPerPkg, threadsPerCore, ncores, numaLevel, llcLevel,
+      tileLevel;
+  char *line = (char *)__kmp_allocate(key->used + 2);
+  bool ok =
+      fscanf(f, "libomp topology cache %d\n", &version) == 1 &&
+      version == KMP_TOPOLOGY_CACHE_VERSION &&
+      fgets(line, key->used + 2, f) != NULL &&
+      KMP_STRLEN(line) == (size_t)key->used + 1 && line[key->used] == '\n' &&
+      strncmp(line, key->str, key->used) == 0 &&
+      fscanf(f, "%d %d %d %d %d %d %d %d %d %d %d %d", depth, &num, &pkgs,
+             &coresPerPkg, &threadsPerCore, &ncores, pkgLevel, coreLevel,
+             threadLevel, &numaLevel, &llcLevel, &tileLevel) == 12 &&
+      num == __kmp_avail_proc && *depth >= 1 &&
+      *depth <= (int)Address::maxDepth && *pkgLevel >= 0 &&
+      *pkgLevel < *depth &&
+      *coreLevel >= -1 && *coreLevel < *depth && *threadLevel >= -1 &&
+      *threadLevel < *depth && numaLevel >= -1 && numaLevel < *depth &&
+      llcLevel >= -1 && llcLevel < *depth && tileLevel >= -1 &&
+      tileLevel < *depth && pkgs >= 1 && coresPerPkg >= 1 &&
+      threadsPerCore >= 1 && ncores >= 1;
+  __kmp_free(line);
+
+  AddrUnsPair *retval = NULL;
+  if (ok) {
+    bool *seen = (bool *)__kmp_allocate((maxOsId + 1) * sizeof(bool));
+    retval = (AddrUnsPair *)__kmp_allocate(sizeof(AddrUnsPair) * num);
+    for (int p = 0; ok && p < num; p++) {
+      unsigned os;
+      Address addr(*depth);
+      ok = fscanf(f, "%u", &os) == 1 && os <= maxOsId &&
+           KMP_CPU_ISSET(os, __kmp_affin_fullMask) && !seen[os];
+      for (int level = 0; ok && level < *depth; level++) {
+        ok = fscanf(f, "%u", &addr.labels[level]) == 1;
+      }
+      if (ok) {
+        seen[os] = true;
+        retval[p] = AddrUnsPair(addr, os);
+      }
+    }
+    __kmp_free(seen);
+  }
+  fclose(f);
+
+  if (!ok) {
+    if (retval != NULL) {
+      __kmp_free(retval);
+    }
+    if (__kmp_affinity_verbose) {
+      KMP_INFORM(AffTopologyCacheStale, "KMP_AFFINITY",
+                 __kmp_topology_cache_file);
+    }
+    return NULL;
+  }
+
+  qsort(retval, num, sizeof(*retval), __kmp_affinity_cmp_Address_labels);
+  nPackages = pkgs;
+  nCoresPerPkg = coresPerPkg;
+  __kmp_nThreadsPerCore = threadsPerCore;
+  __kmp_ncores = ncores;
+  __kmp_affinity_numa_level = numaLevel;
+  __kmp_affinity_llc_level = llcLevel;
+  __kmp_affinity_tile_level = tileLevel;
+  if (__kmp_affinity_verbose) {
+    KMP_INFORM(AffTopologyCacheLoaded, "KMP_AFFINITY",
+               __kmp_topology_cache_file);
+  }
+  return retval;
+}
+
+// Save the map to the topology cache file. The file is written under a new,
+// unique temporary name and renamed, so that concurrent readers never see it
+// partly written and no existing file or symbolic link is written through.
+// Failures just leave the cache as it was.
+static void __kmp_affinity_write_topology_cache(kmp_str_buf_t *key,
+                                                AddrUnsPair *retval,
+                                                int num_avail, int depth,
+                                                int pkgLevel, int coreLevel,
+                                                int threadLevel) {
+  kmp_str_buf_t tmp;
+  __kmp_str_buf_init(&tmp);
+  __kmp_str_buf_print(&tmp, "%s.XXXXXX", __kmp_topology_cache_file);
+  int fd = mkstemp(tmp.str);
+  if (fd < 0) {
+    __kmp_str_buf_free(&tmp);
+    return;
+  }
+  FILE *f = NULL;
+  if (fchmod(fd, 0644) == 0) {
+    f = fdopen(fd, "w");
+  }
+  if (f == NULL) {
+    close(fd);
+    unlink(tmp.str);
+    __kmp_str_buf_free(&tmp);
+    return;
+  }
+  fprintf(f, "libomp topology cache %d\n%s\n", KMP_TOPOLOGY_CACHE_VERSION,
+          key->str);
+  fprintf(f, "%d %d %d %d %d %d %d %d %d %d %d %d\n", depth, num_avail,
+          nPackages, nCoresPerPkg, __kmp_nThreadsPerCore, __kmp_ncores,
+          pkgLevel, coreLevel, threadLevel, __kmp_affinity_numa_level,
+          __kmp_affinity_llc_level, __kmp_affinity_tile_level);
+  for (int p = 0; p < num_avail; p++) {
+    fprintf(f, "%u", retval[p].second);
+    for (int level = 0; level < depth; level++) {
+      fprintf(f, " %u", retval[p].first.labels[level]);
+    }
+    fprintf(f, "\n");
+  }
+  bool ok = !ferror(f);
+  ok = (fclose(f) == 0) && ok;
+  if (ok && rename(tmp.str, __kmp_topology_cache_file) == 0) {
+    if (__kmp_affinity_verbose) {
+      KMP_INFORM(AffTopologyCacheSaved, "KMP_AFFINITY",
+                 __kmp_topology_cache_file);
+    }
+  } else {
+    unlink(tmp.str);
+  }
+  __kmp_str_buf_free(&tmp);
+}
+
+// Set the granularity level based on what levels are modeled in the machine
+// topology map. At tile, llc or numa granularity, everything below the level
+// holding that domain goes away; if there is no such level, the places are
+// packages. Levels above the package (the nodes of a cached /proc/cpuinfo map)
+// always stay.
+static void __kmp_affinity_set_gran_levels(int depth, int pkgLevel,
+                                           int threadLevel) {
+  int granLevel = -1;
+  if (__kmp_affinity_gran == affinity_gran_tile) {
+    granLevel = __kmp_affinity_tile_level;
+  } else if (__kmp_affinity_gran == affinity_gran_llc) {
+    granLevel = __kmp_affinity_llc_level;
+  } else if (__kmp_affinity_gran == affinity_gran_numa) {
+    granLevel = __kmp_affinity_numa_level;
+  }
+  __kmp_affinity_gran_levels = 0;
+  for (int level = depth - 1; level >= 0; level--) {
+    if (granLevel >= 0) {
+      if (level > granLevel) {
+        __kmp_affinity_gran_levels++;
+      }
+    } else if (level == threadLevel) {
+      if (__kmp_affinity_gran > affinity_gran_thread) {
+        __kmp_affinity_gran_levels++;
+      }
+    } else if (level == pkgLevel) {
+      if (__kmp_affinity_gran > affinity_gran_package) {
+        __kmp_affinity_gran_levels++;
+      }
+    } else if (level > pkgLevel && __kmp_affinity_gran > affinity_gran_core) {
+      __kmp_affinity_gran_levels++;
+    }
+  }
+}
+
+// Finish a map probed from sysfs or read from the topology cache: fill in the
+// OS proc indices, set the granularity and print the map. nPackages,
+// nCoresPerPkg, __kmp_nThreadsPerCore and __kmp_ncores are already set.
+static int __kmp_affinity_publish_map(AddrUnsPair **address2os,
+                                      AddrUnsPair *retval, int num_avail,
+                                      int depth, int pkgLevel, int coreLevel,
+                                      int threadLevel) {
+  // Print the machine topology summary.
+  if (__kmp_affinity_verbose) {
+    char mask[KMP_AFFIN_MASK_PRINT_LEN];
+    __kmp_affinity_print_mask(mask, KMP_AFFIN_MASK_PRINT_LEN,
+                              __kmp_affin_fullMask);
+    if (__kmp_affinity_respect_mask) {
+      KMP_INFORM(InitOSProcSetRespect, "KMP_AFFINITY", mask);
+    } else {
+      KMP_INFORM(InitOSProcSetNotRespect, "KMP_AFFINITY", mask);
+    }
+    KMP_INFORM(AvailableOSProc, "KMP_AFFINITY", __kmp_avail_proc);
+    if (__kmp_affinity_uniform_topology()) {
+      KMP_INFORM(Uniform, "KMP_AFFINITY");
+    } else {
+      KMP_INFORM(NonUniform, "KMP_AFFINITY");
+    }
+    kmp_str_buf_t buf;
+    __kmp_str_buf_init(&buf);
+    __kmp_str_buf_print(&buf, "%d", nPackages);
+    KMP_INFORM(TopologyExtra, "KMP_AFFINITY", buf.str, nCoresPerPkg,
+               __kmp_nThreadsPerCore, __kmp_ncores);
+    __kmp_str_buf_free(&buf);
+  }
+
+  KMP_DEBUG_ASSERT(__kmp_pu_os_idx == NULL);
+  __kmp_pu_os_idx = (int *)__kmp_allocate(sizeof(int) * num_avail);
+  __kmp_pu_pkg = (int *)__kmp_allocate(sizeof(int) * num_avail);
+  for (int p = 0; p < num_avail; p++) { // fill the os indices
+    __kmp_pu_os_idx[p] = retval[p].second;
+    __kmp_pu_pkg[p] = retval[p].first.labels[pkgLevel];
+  }
+
+  if (__kmp_affinity_type == affinity_none) {
+    __kmp_free(retval);
+    __kmp_affinity_numa_level = -1;
+    __kmp_affinity_llc_level = -1;
+    __kmp_affinity_tile_level = -1;
+    return 0;
+  }
+  __kmp_affinity_pkg_level = pkgLevel;
+  __kmp_affinity_core_level = coreLevel;
+  __kmp_affinity_thread_level = threadLevel;
+
+  if (__kmp_affinity_gran_levels < 0) {
+    __kmp_affinity_set_gran_levels(depth, pkgLevel, threadLevel);
+  }
+
+  if (__kmp_affinity_verbose) {
+    __kmp_affinity_print_topology(retval, num_avail, depth, pkgLevel,
+                                  coreLevel, threadLevel);
+  }
+
+  *address2os = retval;
+  return depth;
+}
+
+// Whether the map of this process goes through the topology cache. hwloc
+// keeps a topology object of its own, KMP_CPUINFO_FILE describes a made up
+// machine and KMP_HW_SUBSET changes the levels of the map, so none of them is
+// cached.
+static bool __kmp_affinity_topology_cacheable() {
+  if (__kmp_topology_cache_file == NULL || __kmp_hws_requested != 0 ||
+      __kmp_cpuinfo_file != NULL || !KMP_AFFINITY_CAPABLE()) {
+    return false;
+  }
+#if KMP_USE_HWLOC
+  if (__kmp_affinity_dispatch->get_api_type() == KMPAffinity::HWLOC) {
+    return false;
+  }
+#endif
+  return true;
+}
+
+// Read the map from the topology cache and finish it as a topology method
+// would. Returns the depth of the map, or -1 if it still has to be probed.
+static int __kmp_affinity_load_topology_cache(AddrUnsPair **address2os) {
+  int depth, pkgLevel, coreLevel, threadLevel;
+  kmp_str_buf_t key;
+  __kmp_str_buf_init(&key);
+  __kmp_affinity_topology_cache_key(&key);
+  AddrUnsPair *retval = __kmp_affinity_read_topology_cache(
+      &key, &depth, &pkgLevel, &coreLevel, &threadLevel);
+  __kmp_str_buf_free(&key);
+  if (retval == NULL) {
+    return -1;
+  }
+  return __kmp_affinity_publish_map(address2os, retval, __kmp_avail_proc,
+                                    depth, pkgLevel, coreLevel, threadLevel);
+}
+
+// Save the map the topology method just built
+static void __kmp_affinity_save_topology_cache(AddrUnsPair *address2os,
+                                               int depth) {
+  kmp_str_buf_t key;
+  __kmp_str_buf_init(&key);
+  __kmp_affinity_topology_cache_key(&key);
+  __kmp_affinity_write_topology_cache(
+      &key, address2os, __kmp_avail_proc, depth, __kmp_affinity_pkg_level,
+      __kmp_affinity_core_level, __kmp_affinity_thread_level);
+  __kmp_str_buf_free(&key);
+}
+
+// Read the last level cache, the highest level data or unified one, and the
+// L2 tile, the procs sharing the level 2 cache, of a proc. They stay UINT_MAX
+// if sysfs doesn't list them.
+static void __kmp_affinity_sysfs_read_caches(unsigned *proc) {
+  char path[256];
+  unsigned i = proc[sysfsOsId];
+  unsigned llcLevel = 0;
+  proc[sysfsLlcId] = UINT_MAX;
+  proc[sysfsTileId] = UINT_MAX;
+  for (unsigned index = 0;; index++) {
+    unsigned level;
+    char type[16];
+    KMP_SNPRINTF(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/cache/index%u/level", i, index);
+    if (__kmp_read_from_file(path, "%u", &level) != 1) {
+      break;
+    }
+    KMP_SNPRINTF(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/cache/index%u/type", i, index);
+    if (__kmp_read_from_file(path, "%15s", type) != 1 ||
+        strcmp(type, "Instruction") == 0 || (level < llcLevel && level != 2)) {
+      continue;
+    }
+    KMP_SNPRINTF(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/cache/index%u/shared_cpu_list",
+                 i, index);
+    int shared = __kmp_affinity_sysfs_read_list(path, NULL, 0, 0);
+    if (shared < 0) {
+      continue;
+    }
+    if (level == 2) {
+      proc[sysfsTileId] = shared;
+    }
+    if (level >= llcLevel) {
+      llcLevel = level;
+      proc[sysfsLlcId] = shared;
+    }
+  }
+}
+
+// Read the NUMA node of each proc, UINT_MAX if no node lists it. Each node
+// lists its procs; memory-only nodes have an empty list.
+static void __kmp_affinity_sysfs_read_nodes(SysfsProcInfo *procs, int n,
+                                            unsigned maxOsId) {
+  char path[256];
+  unsigned *nodeOf =
+      (unsigned *)__kmp_allocate((maxOsId + 1) * sizeof(unsigned));
+  for (unsigned i = 0; i <= maxOsId; i++) {
+    nodeOf[i] = UINT_MAX;
+  }
+  DIR *dir = opendir("/sys/devices/system/node");
+  if (dir != NULL) {
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+      unsigned node;
+      if (KMP_SSCANF(entry->d_name, "node%u", &node) != 1) {
+        continue;
+      }
+      KMP_SNPRINTF(path, sizeof(path),
+                   "/sys/devices/system/node/node%u/cpulist", node);
+      __kmp_affinity_sysfs_read_list(path, nodeOf, node, maxOsId + 1);
+    }
+    closedir(dir);
+  }
+  for (int p = 0; p < n; p++) {
+    procs[p][sysfsNodeId] = nodeOf[procs[p][sysfsOsId]];
+  }
+  __kmp_free(nodeOf);
+}
+
+// Lay out the map of the procs, with packages, NUMA domains, caches, cores
+// and threads, and set the domain levels and the machine totals. Returns the
+// depth of the map.
+static int __kmp_affinity_sysfs_layout(SysfsProcInfo *procs, int num_avail,
+                                       AddrUnsPair **retval, int *pkgLevel,
+                                       int *coreLevel, int *threadLevel) {
+  int nPkgs = __kmp_affinity_sysfs_count(procs, num_avail, sysfsPkgId);
+  int nCores = __kmp_affinity_sysfs_count(procs, num_avail, sysfsCoreKey);
+  bool haveNode = true;
+  bool haveLlc = true;
+  bool haveTile = true;
+  for (int p = 0; p < num_avail; p++) {
+    haveNode = haveNode && procs[p][sysfsNodeId] != UINT_MAX;
+    haveLlc = haveLlc && procs[p][sysfsLlcId] != UINT_MAX;
+    haveTile = haveTile && procs[p][sysfsTileId] != UINT_MAX;
+  }
+
+  // NUMA domains, last level caches and L2 tiles become levels between the
+  // package and the core if they divide the packages and are made of whole
+  // cores. The coarser domains are the outer levels, and each one has to nest
+  // within the one outside it. A domain that matches the package, the core or
+  // an outer domain is not a level of its own; it is held by the level it
+  // matches. Domains spanning several packages are not modeled, nor are any
+  // with KMP_HW_SUBSET, which without hwloc only handles package/core/thread
+  // maps.
+  const int nDoms = 3;
+  int domField[nDoms] = {sysfsNodeId, sysfsLlcId, sysfsTileId};
+  bool haveDom[nDoms] = {haveNode, haveLlc, haveTile};
+  int domCount[nDoms];
+  int domHeldBy[nDoms]; // the field of the level holding it, -1 if none
+  int order[nDoms];
+  for (int d = 0; d < nDoms; d++) {
+    domCount[d] = 0;
+    domHeldBy[d] = -1;
+    if (haveDom[d] && __kmp_hws_requested == 0 &&
+        __kmp_affinity_sysfs_nested(procs, num_avail, domField[d],
+                                    sysfsPkgId) &&
+        __kmp_affinity_sysfs_nested(procs, num_avail, sysfsCoreKey,
+                                    domField[d])) {
+      domCount[d] = __kmp_affinity_sysfs_count(procs, num_avail, domField[d]);
+      if (domCount[d] == nPkgs) {
+        domHeldBy[d] = sysfsPkgId;
+      } else if (domCount[d] == nCores) {
+        domHeldBy[d] = sysfsCoreId;
+      } else {
+        domHeldBy[d] = domField[d];
+      }
+    }
+    // Insertion sort by the number of domains; on a tie the NUMA domain goes
+    // before the cache, and the last level cache before the tile.
+    int pos = d;
+    while (pos > 0 && domCount[order[pos - 1]] > domCount[d]) {
+      order[pos] = order[pos - 1];
+      pos--;
+    }
+    order[pos] = d;
+  }
+
+  // Lay out the levels, outermost first. The package level is always in the
+  // map, the core level if a package or domain has more than one core, and
+  // the thread level if a core has more than one thread.
+  int fields[6];
+  int depth = 0;
+  *coreLevel = -1;
+  *threadLevel = -1;
+  *pkgLevel = depth;
+  fields[depth++] = sysfsPkgId;
+  int outer = sysfsPkgId;
+  int outerCount = nPkgs;
+  for (int rank = 0; rank < nDoms; rank++) {
+    int d = order[rank];
+    if (domHeldBy[d] != domField[d]) {
+      continue;
+    }
+    if (!__kmp_affinity_sysfs_nested(procs, num_avail, domField[d], outer)) {
+      domHeldBy[d] = -1;
+    } else if (domCount[d] == outerCount) {
+      domHeldBy[d] = outer;
+    } else {
+      fields[depth++] = domField[d];
+      outer = domField[d];
+      outerCount = domCount[d];
+    }
+  }
+  if (nCores > outerCount) {
+    *coreLevel = depth;
+    fields[depth++] = sysfsCoreId;
+  }
+  if (num_avail > nCores) {
+    *threadLevel = depth;
+    fields[depth++] = sysfsThreadId;
+  }
+  int *domLevel[nDoms] = {&__kmp_affinity_numa_level, &__kmp_affinity_llc_level,
+                          &__kmp_affinity_tile_level};
+  for (int d = 0; d < nDoms; d++) {
+    for (int level = 0; level < depth; level++) {
+      if (fields[level] == domHeldBy[d]) {
+        *domLevel[d] = level;
+      }
+    }
+  }
+
+  // Construct the data structure that is to be returned, sorted by physical
+  // location.
+  AddrUnsPair *map =
+      (AddrUnsPair *)__kmp_allocate(sizeof(AddrUnsPair) * num_avail);
+  for (int p = 0; p < num_avail; p++) {
+    Address addr(depth);
+    for (int level = 0; level < depth; level++) {
+      addr.labels[level] = procs[p][fields[level]];
+    }
+    map[p] = AddrUnsPair(addr, procs[p][sysfsOsId]);
+  }
+  qsort(map, num_avail, sizeof(*map), __kmp_affinity_cmp_Address_labels);
+
+  nPackages = nPkgs;
+  __kmp_ncores = nCores;
+  nCoresPerPkg = 1;
+  __kmp_nThreadsPerCore = 1;
+  for (int p = 0; p < num_avail; p++) {
+    if ((int)procs[p][sysfsThreadId] + 1 > __kmp_nThreadsPerCore) {
+      __kmp_nThreadsPerCore = procs[p][sysfsThreadId] + 1;
+    }
+    if (procs[p][sysfsThreadId] == 0) {
+      int cores = 0;
+      for (int q = 0; q < num_avail; q++) {
+        if (procs[q][sysfsPkgId] == procs[p][sysfsPkgId] &&
+            procs[q][sysfsThreadId] == 0) {
+          cores++;
+        }
+      }
+      if (cores > nCoresPerPkg) {
+        nCoresPerPkg = cores;
+      }
+    }
+  }
+  *retval = map;
+  return depth;
+}
+
+// Build the affinity map from /sys/devices/system/cpu and
+// /sys/devices/system/node. Unlike the x2APIC / legacy APIC methods this does
+// not need to bind the calling thread to each proc in turn, and besides
+// packages, cores and threads it models the NUMA domains and last level caches
+// that lie within a package.
+static int __kmp_affinity_create_sysfs_map(AddrUnsPair **address2os,
+                                           kmp_i18n_id_t *const msg_id) {
+  *address2os = NULL;
+  *msg_id = kmp_i18n_null;
+  __kmp_affinity_numa_level = -1;
+  __kmp_affinity_llc_level = -1;
+  __kmp_affinity_tile_level = -1;
+
+  // The records are built for the procs in the full mask, so this method
+  // only makes sense if we are affinity capable.
+  if (!KMP_AFFINITY_CAPABLE()) {
+    *msg_id = kmp_i18n_str_NoSysfsTopology;
+    return -1;
+  }
+
+  SysfsProcInfo *procs =
+      (SysfsProcInfo *)__kmp_allocate(__kmp_avail_proc * sizeof(SysfsProcInfo));
+  char path[256];
+  unsigned maxOsId = 0;
+  int num_avail = 0;
+  unsigned i;
+  KMP_CPU_SET_ITERATE(i, __kmp_affin_fullMask) {
+    if (!KMP_CPU_ISSET(i, __kmp_affin_fullMask)) {
+      continue;
+    }
+    KMP_ASSERT(num_avail < __kmp_avail_proc);
+    unsigned *proc = procs[num_avail];
+    int pkg, core;
+    KMP_SNPRINTF(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/topology/physical_package_id",
+                 i);
+    if (__kmp_read_from_file(path, "%d", &pkg) != 1) {
+      __kmp_free(procs);
+      *msg_id = kmp_i18n_str_NoSysfsTopology;
+      return -1;
+    }
+    KMP_SNPRINTF(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/topology/core_id", i);
+    if (__kmp_read_from_file(path, "%d", &core) != 1) {
+      __kmp_free(procs);
+      *msg_id = kmp_i18n_str_NoSysfsTopology;
+      return -1;
+    }
+    // Some architectures report -1 when the id is unknown
+    proc[sysfsOsId] = i;
+    proc[sysfsPkgId] = pkg < 0 ? 0 : pkg;
+    proc[sysfsCoreId] = core < 0 ? 0 : core;
+
+    KMP_SNPRINTF(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list",
+                 i);
+    int coreKey = __kmp_affinity_sysfs_read_list(path, NULL, 0, 0);
+    proc[sysfsCoreKey] = coreKey < 0 ? UINT_MAX : coreKey;
+
+    __kmp_affinity_sysfs_read_caches(proc);
+    if (i > maxOsId) {
+      maxOsId = i;
+    }
+    num_avail++;
+  }
+  KMP_ASSERT(num_avail == __kmp_avail_proc);
+
+  __kmp_affinity_sysfs_read_nodes(procs, num_avail, maxOsId);
+
+  for (int p = 0; p < num_avail; p++) {
+    unsigned *proc = procs[p];
+    // Without a sibling list, the core is the one with the same ids
+    if (proc[sysfsCoreKey] == UINT_MAX) {
+      proc[sysfsCoreKey] = proc[sysfsOsId];
+      for (int q = 0; q < p; q++) {
+        if (procs[q][sysfsPkgId] == proc[sysfsPkgId] &&
+            procs[q][sysfsCoreId] == proc[sysfsCoreId]) {
+          proc[sysfsCoreKey] = procs[q][sysfsCoreKey];
+          break;
+        }
+      }
+    }
+  }
+
+  // core_id is only unique within a die on some machines. If two cores in a
+  // package share it, label the cores by their key instead.
+  bool coreIdsUnique = true;
+  for (int p = 1; p < num_avail && coreIdsUnique; p++) {
+    for (int q = 0; q < p; q++) {
+      if (procs[q][sysfsPkgId] == procs[p][sysfsPkgId] &&
+          procs[q][sysfsCoreId] == procs[p][sysfsCoreId] &&
+          procs[q][sysfsCoreKey] != procs[p][sysfsCoreKey]) {
+        coreIdsUnique = false;
+        break;
+      }
+    }
+  }
+  // Number the threads of each core in OS proc order
+  for (int p = 0; p < num_avail; p++) {
+    unsigned *proc = procs[p];
+    if (!coreIdsUnique) {
+      proc[sysfsCoreId] = proc[sysfsCoreKey];
+    }
+    proc[sysfsThreadId] = 0;
+    for (int q = 0; q < num_avail; q++) {
+      if (procs[q][sysfsCoreKey] == proc[sysfsCoreKey] &&
+          procs[q][sysfsOsId] < proc[sysfsOsId]) {
+        proc[sysfsThreadId]++;
+      }
+    }
+  }
+
+  if (!__kmp_affinity_sysfs_nested(procs, num_avail, sysfsCoreKey,
+                                   sysfsPkgId)) {
+    __kmp_free(procs);
+    *msg_id = kmp_i18n_str_PhysicalIDsNotUnique;
+    return -1;
+  }
+  int pkgLevel, coreLevel, threadLevel;
+  AddrUnsPair *retval;
+  int depth = __kmp_affinity_sysfs_layout(procs, num_avail, &retval, &pkgLevel,
+                                          &coreLevel, &threadLevel);
+  __kmp_free(procs);
+
+  return __kmp_affinity_publish_map(address2os, retval, num_avail, depth,
+                                    pkgLevel, coreLevel, threadLevel);
+}
+
+// Maps built by the other topology methods only have packages, cores and
+// threads. Lay them out again with the NUMA domains, last level caches and L2
+// tiles that sysfs reports, as the sysfs method would, so that numa_domains,
+// ll_caches and tiles places work whichever method built the map. Returns the
+// new depth; the map is left alone if sysfs models none of these domains.
+static int __kmp_affinity_sysfs_add_domains(AddrUnsPair **address2os,
+                                            int depth) {
+  int pkgLevel = __kmp_affinity_pkg_level;
+  int coreLevel = __kmp_affinity_core_level;
+  int threadLevel = __kmp_affinity_thread_level;
+  if (pkgLevel != 0) {
+    return depth;
+  }
+  // The innermost level a core is known by: the package if it has one core
+  int coreOf = coreLevel;
+  if (coreOf < 0) {
+    coreOf = threadLevel >= 0 ? threadLevel - 1 : depth - 1;
+  }
+
+  AddrUnsPair *map = *address2os;
+  int num_avail = __kmp_avail_proc;
+  SysfsProcInfo *procs =
+      (SysfsProcInfo *)__kmp_allocate(num_avail * sizeof(SysfsProcInfo));
+  unsigned maxOsId = 0;
+  for (int p = 0; p < num_avail; p++) {
+    unsigned *proc = procs[p];
+    proc[sysfsOsId] = map[p].second;
+    proc[sysfsPkgId] = map[p].first.labels[pkgLevel];
+    // A core is known by the first proc of the map on it
+    proc[sysfsCoreKey] = proc[sysfsOsId];
+    for (int q = 0; q < p; q++) {
+      int level;
+      for (level = 0; level <= coreOf; level++) {
+        if (map[q].first.labels[level] != map[p].first.labels[level]) {
+          break;
+        }
+      }
+      if (level > coreOf) {
+        proc[sysfsCoreKey] = procs[q][sysfsCoreKey];
+        break;
+      }
+    }
+    proc[sysfsCoreId] = proc[sysfsCoreKey];
+    __kmp_affinity_sysfs_read_caches(proc);
+    if (proc[sysfsOsId] > maxOsId) {
+      maxOsId = proc[sysfsOsId];
+    }
+  }
+  __kmp_affinity_sysfs_read_nodes(procs, num_avail, maxOsId);
+  for (int p = 0; p < num_avail; p++) {
+    procs[p][sysfsThreadId] = 0;
+    for (int q = 0; q < num_avail; q++) {
+      if (procs[q][sysfsCoreKey] == procs[p][sysfsCoreKey] &&
+          procs[q][sysfsOsId] < procs[p][sysfsOsId]) {
+        procs[p][sysfsThreadId]++;
+      }
+    }
+  }
+
+  AddrUnsPair *retval;
+  __kmp_affinity_numa_level = -1;
+  __kmp_affinity_llc_level = -1;
+  __kmp_affinity_tile_level = -1;
+  int newDepth = __kmp_affinity_sysfs_layout(
+      procs, num_avail, &retval, &pkgLevel, &coreLevel, &threadLevel);
+  __kmp_free(procs);
+  if (__kmp_affinity_numa_level < 0 && __kmp_affinity_llc_level < 0 &&
+      __kmp_affinity_tile_level < 0) {
+    __kmp_free(retval);
+    return depth;
+  }
+  __kmp_free(map);
+  *address2os = retval;
+  __kmp_affinity_pkg_level = pkgLevel;
+  __kmp_affinity_core_level = coreLevel;
+  __kmp_affinity_thread_level = threadLevel;
+  if (__kmp_pu_os_idx != NULL) {
+    for (int p = 0; p < num_avail; p++) {
+      __kmp_pu_os_idx[p] = retval[p].second;
+      if (__kmp_pu_pkg != NULL) {
+        __kmp_pu_pkg[p] = retval[p].first.labels[pkgLevel];
+      }
+    }
+  }
+  return newDepth;
+}
+
+#endif /* KMP_OS_LINUX */
+
 // Create and return a table of affinity masks, indexed by OS thread ID.
 // This routine handles OR'ing together all the affinity masks of threads
 // that are sufficiently close, if granularity > fine.
@@ -3698,6 +4658,10 @@ _exit:
     __kmp_free(__kmp_pu_os_idx);
     __kmp_pu_os_idx = NULL;
   }
+  if (__kmp_pu_pkg != NULL) {
+    __kmp_free(__kmp_pu_pkg);
+    __kmp_pu_pkg = NULL;
+  }
 }
 
 // This function figures out the deepest level at which there is at least one
@@ -3779,9 +4743,104 @@ static AddrUnsPair *address2os = NULL;
 static int *procarr = NULL;
 static int __kmp_aff_depth = 0;
 
+#if KMP_OS_LINUX
+// With KMP_CGROUP_RECHECK, the cpuset of the process's cgroup when the places
+// were last built, and the settings that __kmp_aux_affinity_initialize() adapts
+// to the machine, as they were before, so that the places can be rebuilt.
+static kmp_affin_mask_t *__kmp_affinity_cgroup_mask = NULL;
+static int __kmp_affinity_env_compact;
+static int __kmp_affinity_env_offset;
+static int __kmp_affinity_env_gran_levels;
+
+static bool __kmp_affinity_masks_equal(kmp_affin_mask_t *a,
+                                       kmp_affin_mask_t *b) {
+  int i;
+  KMP_CPU_SET_ITERATE(i, a) {
+    if (!KMP_CPU_ISSET(i, b)) {
+      return false;
+    }
+  }
+  KMP_CPU_SET_ITERATE(i, b) {
+    if (!KMP_CPU_ISSET(i, a)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Read the procs of the process's cpuset cgroup into mask.
+static bool __kmp_affinity_read_cgroup_cpuset(kmp_affin_mask_t *mask) {
+  char path[1100];
+  if (!__kmp_get_cgroup_cpuset_file(path, sizeof(path))) {
+    return false;
+  }
+  int max = mask->end() > 0 ? mask->end() : __kmp_xproc;
+  unsigned *ids = (unsigned *)__kmp_allocate(max * sizeof(unsigned));
+  bool ok = __kmp_affinity_sysfs_read_list(path, ids, 1, max) >= 0;
+  KMP_CPU_ZERO(mask);
+  for (int i = 0; i < max; i++) {
+    if (ids[i]) {
+      KMP_CPU_SET(i, mask);
+    }
+  }
+  __kmp_free(ids);
+  return ok;
+}
+#endif /* KMP_OS_LINUX */
+
+// Allocate __kmp_affinity_proc_pkg for OS procs up to max_os_id, with the
+// package of every proc unknown.
+static void __kmp_affinity_alloc_proc_pkg(int max_os_id) {
+  __kmp_affinity_num_proc_pkg = max_os_id + 1;
+  __kmp_affinity_proc_pkg =
+      (int *)__kmp_allocate(__kmp_affinity_num_proc_pkg * sizeof(int));
+  for (int i = 0; i < __kmp_affinity_num_proc_pkg; i++) {
+    __kmp_affinity_proc_pkg[i] = -1;
+  }
+}
+
+// Without places no machine map is kept, but the topology method left the
+// package of every proc in __kmp_pu_pkg. Keep it in __kmp_affinity_proc_pkg,
+// the packages numbered from 0 in the order of their labels as in the map, so
+// that package-aware code can still place the threads by the proc they run on.
+static void __kmp_affinity_map_procs_to_pkgs(void) {
+  int i, j, max_os_id = 0;
+  int *labels;
+  if (__kmp_pu_os_idx == NULL || __kmp_pu_pkg == NULL) {
+    return;
+  }
+  // Sorted distinct package labels
+  labels = (int *)__kmp_allocate(__kmp_avail_proc * sizeof(int));
+  __kmp_affinity_num_pkgs = 0;
+  for (i = 0; i < __kmp_avail_proc; i++) {
+    int pkg = __kmp_pu_pkg[i];
+    for (j = 0; j < __kmp_affinity_num_pkgs && labels[j] < pkg; j++)
+      ;
+    if (j == __kmp_affinity_num_pkgs || labels[j] != pkg) {
+      memmove(&labels[j + 1], &labels[j],
+              (__kmp_affinity_num_pkgs - j) * sizeof(int));
+      labels[j] = pkg;
+      __kmp_affinity_num_pkgs++;
+    }
+    if (__kmp_pu_os_idx[i] > max_os_id) {
+      max_os_id = __kmp_pu_os_idx[i];
+    }
+  }
+  __kmp_affinity_alloc_proc_pkg(max_os_id);
+  for (i = 0; i < __kmp_avail_proc; i++) {
+    for (j = 0; labels[j] != __kmp_pu_pkg[i]; j++)
+      ;
+    __kmp_affinity_proc_pkg[__kmp_pu_os_idx[i]] = j;
+  }
+  __kmp_free(labels);
+  KA_TRACE(10, ("__kmp_affinity_map_procs_to_pkgs: %d procs on %d packages\n",
+                __kmp_avail_proc, __kmp_affinity_num_pkgs));
+}
+
 #define KMP_EXIT_AFF_NONE                                                      \
   KMP_ASSERT(__kmp_affinity_type == affinity_none);                            \
   KMP_ASSERT(address2os == NULL);                                              \
+  __kmp_affinity_map_procs_to_pkgs();                                          \
   __kmp_apply_thread_places(NULL, 0);                                          \
   return;
 
@@ -3810,7 +4869,48 @@ static int __kmp_affinity_cmp_Address_child_num(const void *a, const void *b) {
   return 0;
 }
 
-static void __kmp_aux_affinity_initialize(void) {
+// Records the package of every place in __kmp_affinity_place_pkg, so that
+// package-aware code (e.g. the cohort locks) can find the package of a thread
+// from its current place. A place is attributed to the package of its first
+// OS proc. The package of every OS proc goes to __kmp_affinity_proc_pkg, for
+// threads that are not bound to a place.
+static void __kmp_affinity_map_places_to_pkgs(void) {
+  int i, max_os_id = 0;
+  unsigned j;
+  __kmp_affinity_num_pkgs = 0;
+  for (i = 0; i < __kmp_avail_proc; i++) {
+    int pkg = address2os[i].first.childNums[0];
+    if (pkg >= __kmp_affinity_num_pkgs) {
+      __kmp_affinity_num_pkgs = pkg + 1;
+    }
+    if ((int)address2os[i].second > max_os_id) {
+      max_os_id = address2os[i].second;
+    }
+  }
+  __kmp_affinity_alloc_proc_pkg(max_os_id);
+  for (i = 0; i < __kmp_avail_proc; i++) {
+    __kmp_affinity_proc_pkg[address2os[i].second] =
+        address2os[i].first.childNums[0];
+  }
+  __kmp_affinity_place_pkg =
+      (int *)__kmp_allocate(__kmp_affinity_num_masks * sizeof(int));
+  for (j = 0; j < __kmp_affinity_num_masks; j++) {
+    kmp_affin_mask_t *mask = KMP_CPU_INDEX(__kmp_affinity_masks, j);
+    int osId = mask->begin();
+    for (i = 0; i < __kmp_avail_proc; i++) {
+      if ((int)address2os[i].second == osId) {
+        __kmp_affinity_place_pkg[j] = address2os[i].first.childNums[0];
+        break;
+      }
+    }
+  }
+  KA_TRACE(10, ("__kmp_affinity_map_places_to_pkgs: %u places on %d packages\n",
+                __kmp_affinity_num_masks, __kmp_affinity_num_pkgs));
+}
+
+// If fullMask is not NULL, it is used as the "full" mask instead of the one
+// derived from the system.
+static void __kmp_aux_affinity_initialize(kmp_affin_mask_t *fullMask) {
   if (__kmp_affinity_masks != NULL) {
     KMP_ASSERT(__kmp_affin_fullMask != NULL);
     return;
@@ -3824,8 +4924,12 @@ static void __kmp_aux_affinity_initialize(void) {
     KMP_CPU_ALLOC(__kmp_affin_fullMask);
   }
   if (KMP_AFFINITY_CAPABLE()) {
-    if (__kmp_affinity_respect_mask) {
-      __kmp_get_system_affinity(__kmp_affin_fullMask, TRUE);
+    if (fullMask != NULL || __kmp_affinity_respect_mask) {
+      if (fullMask != NULL) {
+        KMP_CPU_COPY(__kmp_affin_fullMask, fullMask);
+      } else {
+        __kmp_get_system_affinity(__kmp_affin_fullMask, TRUE);
+      }
 
       // Count the number of available processors.
       unsigned i;
@@ -3837,6 +4941,7 @@ static void __kmp_aux_affinity_initialize(void) {
         __kmp_avail_proc++;
       }
       if (__kmp_avail_proc > __kmp_xproc) {
+        KMP_AFF_REBUILD_GIVE_UP();
         if (__kmp_affinity_verbose ||
             (__kmp_affinity_warnings &&
              (__kmp_affinity_type != affinity_none))) {
@@ -3854,6 +4959,10 @@ static void __kmp_aux_affinity_initialize(void) {
 
   int depth = -1;
   kmp_i18n_id_t msg_id = kmp_i18n_null;
+  int granLevels = __kmp_affinity_gran_levels;
+  __kmp_affinity_pkg_level = -1;
+  __kmp_affinity_core_level = -1;
+  __kmp_affinity_thread_level = -1;
 
   // For backward compatibility, setting KMP_CPUINFO_FILE =>
   // KMP_TOPOLOGY_METHOD=cpuinfo
@@ -3862,6 +4971,23 @@ static void __kmp_aux_affinity_initialize(void) {
     __kmp_affinity_top_method = affinity_top_method_cpuinfo;
   }
 
+#if KMP_OS_LINUX
+  // A map saved by an earlier process on the same machine saves the probing,
+  // whichever method built it.
+  bool cacheable = __kmp_affinity_topology_cacheable();
+  bool cached = false;
+  if (cacheable) {
+    depth = __kmp_affinity_load_topology_cache(&address2os);
+    if (depth == 0) {
+      KMP_EXIT_AFF_NONE;
+    }
+    cached = (depth > 0);
+  }
+
+  if (cached) {
+    KMP_DEBUG_ASSERT(address2os != NULL);
+  } else
+#endif /* KMP_OS_LINUX */
   if (__kmp_affinity_top_method == affinity_top_method_all) {
     // In the default code path, errors are not fatal - we just try using
     // another method. We only emit a warning message if affinity is on, or the
@@ -3891,7 +5017,12 @@ static void __kmp_aux_affinity_initialize(void) {
 
     if (depth < 0) {
       if (__kmp_affinity_verbose) {
-        KMP_INFORM(AffInfoStr, "KMP_AFFINITY", KMP_I18N_STR(Decodingx2APIC));
+        if (msg_id != kmp_i18n_null) {
+          KMP_INFORM(AffInfoStrStr, "KMP_AFFINITY",
+                     __kmp_i18n_catgets(msg_id), KMP_I18N_STR(Decodingx2APIC));
+        } else {
+          KMP_INFORM(AffInfoStr, "KMP_AFFINITY", KMP_I18N_STR(Decodingx2APIC));
+        }
       }
 
       file_name = NULL;
@@ -3924,6 +5055,26 @@ static void __kmp_aux_affinity_initialize(void) {
 
 #if KMP_OS_LINUX
 
+    // sysfs goes after the APIC methods, which the default keeps on x86, but
+    // before /proc/cpuinfo, which lacks the cache and NUMA levels
+    if (depth < 0) {
+      if (__kmp_affinity_verbose) {
+        if (msg_id != kmp_i18n_null) {
+          KMP_INFORM(AffInfoStrStr, "KMP_AFFINITY", __kmp_i18n_catgets(msg_id),
+                     KMP_I18N_STR(DecodingSysfs));
+        } else {
+          KMP_INFORM(AffInfoStr, "KMP_AFFINITY", KMP_I18N_STR(DecodingSysfs));
+        }
+      }
+
+      file_name = NULL;
+      line = 0;
+      depth = __kmp_affinity_create_sysfs_map(&address2os, &msg_id);
+      if (depth == 0) {
+        KMP_EXIT_AFF_NONE;
+      }
+    }
+
     if (depth < 0) {
       if (__kmp_affinity_verbose) {
         if (msg_id != kmp_i18n_null) {
@@ -4003,6 +5154,7 @@ static void __kmp_aux_affinity_initialize(void) {
     }
     if (depth < 0) {
       KMP_ASSERT(msg_id != kmp_i18n_null);
+      KMP_AFF_REBUILD_GIVE_UP();
       KMP_FATAL(MsgExiting, __kmp_i18n_catgets(msg_id));
     }
   } else if (__kmp_affinity_top_method == affinity_top_method_apicid) {
@@ -4016,6 +5168,7 @@ static void __kmp_aux_affinity_initialize(void) {
     }
     if (depth < 0) {
       KMP_ASSERT(msg_id != kmp_i18n_null);
+      KMP_AFF_REBUILD_GIVE_UP();
       KMP_FATAL(MsgExiting, __kmp_i18n_catgets(msg_id));
     }
   }
@@ -4037,6 +5190,7 @@ static void __kmp_aux_affinity_initialize(void) {
     FILE *f = fopen(filename, "r");
     if (f == NULL) {
       int code = errno;
+      KMP_AFF_REBUILD_GIVE_UP();
       if (__kmp_cpuinfo_file != NULL) {
         __kmp_msg(kmp_ms_fatal, KMP_MSG(CantOpenFileForReading, filename),
                   KMP_ERR(code), KMP_HNT(NameComesFrom_CPUINFO_FILE),
@@ -4051,6 +5205,7 @@ static void __kmp_aux_affinity_initialize(void) {
     fclose(f);
     if (depth < 0) {
       KMP_ASSERT(msg_id != kmp_i18n_null);
+      KMP_AFF_REBUILD_GIVE_UP();
       if (line > 0) {
         KMP_FATAL(FileLineMsgExiting, filename, line,
                   __kmp_i18n_catgets(msg_id));
@@ -4064,6 +5219,26 @@ static void __kmp_aux_affinity_initialize(void) {
     }
   }
 
+#if KMP_OS_LINUX
+
+  else if (__kmp_affinity_top_method == affinity_top_method_sysfs) {
+    if (__kmp_affinity_verbose) {
+      KMP_INFORM(AffInfoStr, "KMP_AFFINITY", KMP_I18N_STR(DecodingSysfs));
+    }
+
+    depth = __kmp_affinity_create_sysfs_map(&address2os, &msg_id);
+    if (depth == 0) {
+      KMP_EXIT_AFF_NONE;
+    }
+    if (depth < 0) {
+      KMP_ASSERT(msg_id != kmp_i18n_null);
+      KMP_AFF_REBUILD_GIVE_UP();
+      KMP_FATAL(MsgExiting, __kmp_i18n_catgets(msg_id));
+    }
+  }
+
+#endif /* KMP_OS_LINUX */
+
 #if KMP_GROUP_AFFINITY
 
   else if (__kmp_affinity_top_method == affinity_top_method_group) {
@@ -4075,6 +5250,7 @@ static void __kmp_aux_affinity_initialize(void) {
     KMP_ASSERT(depth != 0);
     if (depth < 0) {
       KMP_ASSERT(msg_id != kmp_i18n_null);
+      KMP_AFF_REBUILD_GIVE_UP();
       KMP_FATAL(MsgExiting, __kmp_i18n_catgets(msg_id));
     }
   }
@@ -4109,6 +5285,7 @@ static void __kmp_aux_affinity_initialize(void) {
 #endif // KMP_USE_HWLOC
 
   if (address2os == NULL) {
+    KMP_AFF_REBUILD_GIVE_UP();
     if (KMP_AFFINITY_CAPABLE() &&
         (__kmp_affinity_verbose ||
          (__kmp_affinity_warnings && (__kmp_affinity_type != affinity_none)))) {
@@ -4119,6 +5296,51 @@ static void __kmp_aux_affinity_initialize(void) {
     return;
   }
 
+#if KMP_OS_LINUX
+  // Only the sysfs method models the NUMA domains and caches; add them to the
+  // maps of the other methods.
+  if (!cached && __kmp_hws_requested == 0 && __kmp_cpuinfo_file == NULL &&
+      __kmp_affinity_numa_level < 0 && __kmp_affinity_llc_level < 0 &&
+      __kmp_affinity_tile_level < 0) {
+    int newDepth = __kmp_affinity_sysfs_add_domains(&address2os, depth);
+    if (__kmp_affinity_numa_level >= 0 || __kmp_affinity_llc_level >= 0 ||
+        __kmp_affinity_tile_level >= 0) {
+      depth = newDepth;
+      if (granLevels < 0) {
+        __kmp_affinity_set_gran_levels(depth, __kmp_affinity_pkg_level,
+                                       __kmp_affinity_thread_level);
+      }
+      if (__kmp_affinity_verbose) {
+        __kmp_affinity_print_topology(
+            address2os, __kmp_avail_proc, depth, __kmp_affinity_pkg_level,
+            __kmp_affinity_core_level, __kmp_affinity_thread_level);
+      }
+    }
+  }
+  if (cacheable && !cached && !__kmp_affinity_rebuilding) {
+    __kmp_affinity_save_topology_cache(address2os, depth);
+  }
+#endif
+
+  // A place type the map does not model falls back to packages
+  int granDomLevel = 0;
+  const char *granDomName = NULL;
+  if (__kmp_affinity_gran == affinity_gran_tile) {
+    granDomLevel = __kmp_affinity_tile_level;
+    granDomName = "tiles";
+  } else if (__kmp_affinity_gran == affinity_gran_llc) {
+    granDomLevel = __kmp_affinity_llc_level;
+    granDomName = "ll_caches";
+  } else if (__kmp_affinity_gran == affinity_gran_numa) {
+    granDomLevel = __kmp_affinity_numa_level;
+    granDomName = "numa_domains";
+  }
+  if (granDomLevel < 0 && !__kmp_affinity_rebuilding &&
+      (__kmp_affinity_verbose ||
+       (__kmp_affinity_warnings && (__kmp_affinity_type != affinity_none)))) {
+    KMP_WARNING(AffGranNotModeled, "KMP_AFFINITY", granDomName);
+  }
+
   __kmp_apply_thread_places(&address2os, depth);
 
   // Create the table of masks, indexed by thread Id.
@@ -4308,6 +5530,9 @@ static void __kmp_aux_affinity_initialize(void) {
   }
 
   KMP_CPU_FREE_ARRAY(osId2Mask, maxIndex + 1);
+  if (__kmp_affinity_num_masks > 0) {
+    __kmp_affinity_map_places_to_pkgs();
+  }
   machine_hierarchy.init(address2os, __kmp_avail_proc);
 }
 #undef KMP_EXIT_AFF_NONE
@@ -4328,12 +5553,210 @@ void __kmp_affinity_initialize(void) {
   if (disabled) {
     __kmp_affinity_type = affinity_none;
   }
-  __kmp_aux_affinity_initialize();
+#if KMP_OS_LINUX
+  if (__kmp_cgroup_recheck_interval > 0 && KMP_AFFINITY_CAPABLE() &&
+      __kmp_affinity_cgroup_mask == NULL) {
+    __kmp_affinity_env_compact = __kmp_affinity_compact;
+    __kmp_affinity_env_offset = __kmp_affinity_offset;
+    __kmp_affinity_env_gran_levels = __kmp_affinity_gran_levels;
+    KMP_CPU_ALLOC(__kmp_affinity_cgroup_mask);
+    if (!__kmp_affinity_read_cgroup_cpuset(__kmp_affinity_cgroup_mask)) {
+      KMP_CPU_FREE(__kmp_affinity_cgroup_mask);
+      __kmp_affinity_cgroup_mask = NULL;
+    }
+  }
+#endif
+  __kmp_aux_affinity_initialize(NULL);
   if (disabled) {
     __kmp_affinity_type = affinity_disabled;
   }
 }
 
+#if KMP_OS_LINUX
+// The places and the machine map built by __kmp_aux_affinity_initialize(), set
+// aside while they are rebuilt.
+typedef struct kmp_affinity_places {
+  kmp_affin_mask_t *fullMask;
+  kmp_affin_mask_t *masks;
+  unsigned num_masks;
+  int *place_pkg;
+  int num_pkgs;
+  int *proc_pkg;
+  int num_proc_pkg;
+  int numa_level, llc_level, tile_level;
+  AddrUnsPair *address2os;
+  int *procarr;
+  int *pu_os_idx;
+  int *pu_pkg;
+  int depth;
+  enum affinity_type type;
+  int compact, offset, gran_levels;
+  int avail_proc, ncores, npackages, ncores_per_pkg, nthreads_per_core;
+} kmp_affinity_places_t;
+
+template <typename T> static inline void __kmp_affinity_swap(T &a, T &b) {
+  T tmp = a;
+  a = b;
+  b = tmp;
+}
+
+// Exchange the places and the machine map with those in places.
+static void __kmp_affinity_swap_places(kmp_affinity_places_t *places) {
+  __kmp_affinity_swap(__kmp_affin_fullMask, places->fullMask);
+  __kmp_affinity_swap(__kmp_affinity_masks, places->masks);
+  __kmp_affinity_swap(__kmp_affinity_num_masks, places->num_masks);
+  __kmp_affinity_swap(__kmp_affinity_place_pkg, places->place_pkg);
+  __kmp_affinity_swap(__kmp_affinity_num_pkgs, places->num_pkgs);
+  __kmp_affinity_swap(__kmp_affinity_proc_pkg, places->proc_pkg);
+  __kmp_affinity_swap(__kmp_affinity_num_proc_pkg, places->num_proc_pkg);
+  __kmp_affinity_swap(__kmp_affinity_numa_level, places->numa_level);
+  __kmp_affinity_swap(__kmp_affinity_llc_level, places->llc_level);
+  __kmp_affinity_swap(__kmp_affinity_tile_level, places->tile_level);
+  __kmp_affinity_swap(address2os, places->address2os);
+  __kmp_affinity_swap(procarr, places->procarr);
+  __kmp_affinity_swap(__kmp_pu_os_idx, places->pu_os_idx);
+  __kmp_affinity_swap(__kmp_pu_pkg, places->pu_pkg);
+  __kmp_affinity_swap(__kmp_aff_depth, places->depth);
+  __kmp_affinity_swap(__kmp_affinity_type, places->type);
+  __kmp_affinity_swap(__kmp_affinity_compact, places->compact);
+  __kmp_affinity_swap(__kmp_affinity_offset, places->offset);
+  __kmp_affinity_swap(__kmp_affinity_gran_levels, places->gran_levels);
+  __kmp_affinity_swap(__kmp_avail_proc, places->avail_proc);
+  __kmp_affinity_swap(__kmp_ncores, places->ncores);
+  __kmp_affinity_swap(nPackages, places->npackages);
+  __kmp_affinity_swap(nCoresPerPkg, places->ncores_per_pkg);
+  __kmp_affinity_swap(__kmp_nThreadsPerCore, places->nthreads_per_core);
+}
+
+static void __kmp_affinity_free_places(kmp_affinity_places_t *places) {
+  if (places->masks != NULL) {
+    KMP_CPU_FREE_ARRAY(places->masks, places->num_masks);
+  }
+  if (places->fullMask != NULL) {
+    KMP_CPU_FREE(places->fullMask);
+  }
+  if (places->place_pkg != NULL) {
+    __kmp_free(places->place_pkg);
+  }
+  if (places->proc_pkg != NULL) {
+    __kmp_free(places->proc_pkg);
+  }
+  if (places->address2os != NULL) {
+    __kmp_free(places->address2os);
+  }
+  if (places->procarr != NULL) {
+    __kmp_free(places->procarr);
+  }
+  if (places->pu_os_idx != NULL) {
+    __kmp_free(places->pu_os_idx);
+  }
+  if (places->pu_pkg != NULL) {
+    __kmp_free(places->pu_pkg);
+  }
+}
+
+// Build the places and the machine map again for the procs in fullMask,
+// starting from the settings as they were before the first call of
+// __kmp_aux_affinity_initialize(). The old ones are kept if the new build
+// fails, or yields no places where there were some, as an explicit place list
+// that no longer intersects the procs does. A process that does not bind its
+// threads, because affinity failed to initialize or after a fork, keeps not
+// binding them. Returns TRUE if the places were replaced.
+static int __kmp_affinity_rebuild(kmp_affin_mask_t *fullMask) {
+  kmp_affinity_places_t places;
+  places.fullMask = NULL;
+  places.masks = NULL;
+  places.num_masks = 0;
+  places.place_pkg = NULL;
+  places.num_pkgs = 0;
+  places.proc_pkg = NULL;
+  places.num_proc_pkg = 0;
+  places.numa_level = places.llc_level = places.tile_level = -1;
+  places.address2os = NULL;
+  places.procarr = NULL;
+  places.pu_os_idx = NULL;
+  places.pu_pkg = NULL;
+  places.depth = 0;
+  places.type = __kmp_affinity_type;
+  places.compact = __kmp_affinity_env_compact;
+  places.offset = __kmp_affinity_env_offset;
+  places.gran_levels = __kmp_affinity_env_gran_levels;
+  places.avail_proc = __kmp_avail_proc;
+  places.ncores = places.npackages = places.ncores_per_pkg = 0;
+  places.nthreads_per_core = 0;
+  __kmp_affinity_swap_places(&places);
+
+  __kmp_affinity_rebuilding = true;
+  __kmp_affinity_rebuild_failed = false;
+  __kmp_aux_affinity_initialize(fullMask);
+  __kmp_affinity_rebuilding = false;
+
+  int rebuilt = TRUE;
+  if (__kmp_affinity_rebuild_failed ||
+      (__kmp_affinity_num_masks == 0 && places.num_masks > 0)) {
+    if (__kmp_affinity_verbose || __kmp_affinity_warnings) {
+      KMP_WARNING(AffCgroupPlacesKept, "KMP_AFFINITY");
+    }
+    __kmp_affinity_swap_places(&places);
+    rebuilt = FALSE;
+  }
+  __kmp_affinity_free_places(&places);
+  return rebuilt;
+}
+
+// Read the cpuset of the process's cgroup. Returns it if it differs from the
+// one the places were built for, NULL otherwise. This reads files, and takes
+// no lock.
+kmp_affin_mask_t *__kmp_affinity_cgroup_read(void) {
+  if (__kmp_affinity_cgroup_mask == NULL || !KMP_AFFINITY_CAPABLE()) {
+    return NULL;
+  }
+  kmp_affin_mask_t *cpuset;
+  KMP_CPU_ALLOC(cpuset);
+  if (!__kmp_affinity_read_cgroup_cpuset(cpuset) ||
+      cpuset->begin() == cpuset->end() ||
+      __kmp_affinity_masks_equal(cpuset, __kmp_affinity_cgroup_mask)) {
+    KMP_CPU_FREE(cpuset);
+    return NULL;
+  }
+  return cpuset;
+}
+
+// Rebuild the places for a cpuset from __kmp_affinity_cgroup_read(), and free
+// it. A process that had the whole cpuset gets the whole new one; otherwise it
+// keeps those of its procs that are still allowed. The caller makes sure that
+// no other thread uses the places meanwhile, and rebinds the threads. Returns
+// TRUE if the places were rebuilt.
+int __kmp_affinity_cgroup_update(kmp_affin_mask_t *cpuset) {
+  if (__kmp_affinity_masks_equal(cpuset, __kmp_affinity_cgroup_mask)) {
+    KMP_CPU_FREE(cpuset); // another root thread got here first
+    return FALSE;
+  }
+  kmp_affin_mask_t *fullMask;
+  KMP_CPU_ALLOC(fullMask);
+  KMP_CPU_COPY(fullMask, cpuset);
+  if (!__kmp_affinity_masks_equal(__kmp_affin_fullMask,
+                                  __kmp_affinity_cgroup_mask)) {
+    KMP_CPU_COPY(fullMask, __kmp_affin_fullMask);
+    KMP_CPU_AND(fullMask, cpuset);
+    if (fullMask->begin() == fullMask->end()) {
+      KMP_CPU_COPY(fullMask, cpuset);
+    }
+  }
+  // Also if the places are kept, so as not to try again until it changes
+  KMP_CPU_COPY(__kmp_affinity_cgroup_mask, cpuset);
+  if (__kmp_affinity_verbose) {
+    char buf[KMP_AFFIN_MASK_PRINT_LEN];
+    __kmp_affinity_print_mask(buf, KMP_AFFIN_MASK_PRINT_LEN, fullMask);
+    KMP_INFORM(AffCgroupCpusetChanged, "KMP_AFFINITY", buf);
+  }
+  int rebuilt = __kmp_affinity_rebuild(fullMask);
+  KMP_CPU_FREE(fullMask);
+  KMP_CPU_FREE(cpuset);
+  return rebuilt;
+}
+#endif /* KMP_OS_LINUX */
+
 void __kmp_affinity_uninitialize(void) {
   if (__kmp_affinity_masks != NULL) {
     KMP_CPU_FREE_ARRAY(__kmp_affinity_masks, __kmp_affinity_num_masks);
@@ -4344,6 +5767,22 @@ void __kmp_affinity_uninitialize(void) {
     __kmp_affin_fullMask = NULL;
   }
   __kmp_affinity_num_masks = 0;
+  if (__kmp_affinity_place_pkg != NULL) {
+    __kmp_free(__kmp_affinity_place_pkg);
+    __kmp_affinity_place_pkg = NULL;
+  }
+  __kmp_affinity_num_pkgs = 0;
+  if (__kmp_affinity_proc_pkg != NULL) {
+    __kmp_free(__kmp_affinity_proc_pkg);
+    __kmp_affinity_proc_pkg = NULL;
+  }
+  __kmp_affinity_num_proc_pkg = 0;
+  __kmp_affinity_numa_level = -1;
+  __kmp_affinity_llc_level = -1;
+  __kmp_affinity_tile_level = -1;
+  __kmp_affinity_pkg_level = -1;
+  __kmp_affinity_core_level = -1;
+  __kmp_affinity_thread_level = -1;
   __kmp_affinity_type = affinity_default;
 #if OMP_40_ENABLED
   __kmp_affinity_num_places = 0;
@@ -4360,6 +5799,12 @@ void __kmp_affinity_uninitialize(void) {
     __kmp_free(procarr);
     procarr = NULL;
   }
+#if KMP_OS_LINUX
+  if (__kmp_affinity_cgroup_mask != NULL) {
+    KMP_CPU_FREE(__kmp_affinity_cgroup_mask);
+    __kmp_affinity_cgroup_mask = NULL;
+  }
+#endif
 #if KMP_USE_HWLOC
   if (__kmp_hwloc_topology != NULL) {
     hwloc_topology_destroy(__kmp_hwloc_topology);
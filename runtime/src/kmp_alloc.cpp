@@ -17,6 +17,91 @@
 #include "kmp_io.h"
 #include "kmp_wrapper_malloc.h"
 
+#if KMP_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* Map page-backed memory for worker stacks and bget pool expansions. With
+   KMP_HUGE_PAGES the memory is backed by explicit (hugetlbfs) or transparent
+   huge pages; explicit pages fall back to transparent ones, and those to
+   normal pages, when the system cannot provide them. KMP_PREFAULT_PAGES
+   faults the pages in, or locks them, up front. With guard set, an
+   inaccessible page is mapped below the memory, except for explicit huge
+   pages which cannot be protected one small page at a time. Returns the
+   memory, *base and *len describe the whole mapping for __kmp_unmap_pages(),
+   or NULL if nothing could be mapped. */
+void *__kmp_map_pages(size_t size, int guard, void **base, size_t *len) {
+#if KMP_OS_UNIX
+  size_t page = (size_t)getpagesize();
+  size_t align = __kmp_huge_pages == huge_pages_off ? page : KMP_HUGE_PAGE_SIZE;
+  size_t gsize = guard ? page : 0;
+  size_t total;
+  char *ptr;
+  char *mem;
+
+  size = (size + align - 1) & ~(align - 1);
+#ifdef MAP_HUGETLB
+  if (__kmp_huge_pages == huge_pages_explicit) {
+    ptr = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      *base = mem = ptr;
+      *len = size;
+      goto prefault;
+    }
+    KA_TRACE(10, ("__kmp_map_pages: no explicit huge pages for %lu bytes, "
+                  "errno %d\n",
+                  (unsigned long)size, errno));
+  }
+#endif
+  // Map more than needed and trim, so that the memory starts on an align
+  // boundary right above the guard page
+  total = gsize + size + align - page;
+  ptr = (char *)mmap(NULL, total, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    return NULL;
+  mem = (char *)(((kmp_uintptr_t)ptr + gsize + align - 1) &
+                 ~(kmp_uintptr_t)(align - 1));
+  if (mem - gsize > ptr)
+    munmap(ptr, mem - gsize - ptr);
+  if (mem + size < ptr + total)
+    munmap(mem + size, ptr + total - (mem + size));
+  *base = mem - gsize;
+  *len = gsize + size;
+  if (guard)
+    mprotect(mem - gsize, gsize, PROT_NONE);
+#ifdef MADV_HUGEPAGE
+  if (__kmp_huge_pages != huge_pages_off)
+    madvise(mem, size, MADV_HUGEPAGE);
+#endif
+
+prefault:
+  // Locking faults the pages in; if the lock limit is too low, touch them
+  if (__kmp_prefault_pages == prefault_mlock && mlock(mem, size) == 0)
+    return mem;
+  if (__kmp_prefault_pages != prefault_off) {
+    size_t off;
+    for (off = 0; off < size; off += page)
+      mem[off] = 0;
+  }
+  return mem;
+#else
+  return NULL;
+#endif
+}
+
+void __kmp_unmap_pages(void *base, size_t len) {
+#if KMP_OS_UNIX
+  munmap(base, len); // also unlocks the pages
+#endif
+}
+
 // Disable bget when it is not used
 #if KMP_USE_BGET
 
@@ -1210,13 +1295,57 @@ static int bpoolv(kmp_info_t *th, void *buf) {
 
 #endif /* KMP_DEBUG */
 
+// Pool expansions mapped by __kmp_map_pages() start with the description of
+// their mapping; base is NULL for blocks from malloc() after a failed mapping
+typedef struct kmp_bget_map {
+  void *base;
+  size_t len;
+} kmp_bget_map_t;
+
+static void *__kmp_bget_map(size_t size) {
+  kmp_bget_map_t map;
+  kmp_bget_map_t *ptr = (kmp_bget_map_t *)__kmp_map_pages(
+      size + sizeof(kmp_bget_map_t), FALSE, &map.base, &map.len);
+  if (ptr == NULL) {
+    ptr = (kmp_bget_map_t *)malloc(size + sizeof(kmp_bget_map_t));
+    if (ptr == NULL)
+      return NULL;
+    map.base = NULL;
+  }
+  *ptr = map;
+  return ptr + 1;
+}
+
+static void __kmp_bget_unmap(void *buf) {
+  kmp_bget_map_t *ptr = (kmp_bget_map_t *)buf - 1;
+  if (ptr->base != NULL)
+    __kmp_unmap_pages(ptr->base, ptr->len);
+  else
+    free(ptr);
+}
+
+// Set the pool expansion functions and increment of the thread's bget pool.
+static void __kmp_bget_set_pool(kmp_info_t *th, size_t incr) {
+  if (KMP_MAP_PAGES()) {
+    // Make expansions fill whole huge pages
+    if (__kmp_huge_pages != huge_pages_off)
+      incr = ((incr + sizeof(kmp_bget_map_t) + KMP_HUGE_PAGE_SIZE - 1) &
+              ~(size_t)(KMP_HUGE_PAGE_SIZE - 1)) -
+             sizeof(kmp_bget_map_t);
+    bectl(th, (bget_compact_t)0, __kmp_bget_map, __kmp_bget_unmap,
+          (bufsize)incr);
+  } else {
+    bectl(th, (bget_compact_t)0, (bget_acquire_t)malloc, (bget_release_t)free,
+          (bufsize)incr);
+  }
+}
+
 void __kmp_initialize_bget(kmp_info_t *th) {
   KMP_DEBUG_ASSERT(SizeQuant >= sizeof(void *) && (th != 0));
 
   set_thr_data(th);
 
-  bectl(th, (bget_compact_t)0, (bget_acquire_t)malloc, (bget_release_t)free,
-        (bufsize)__kmp_malloc_pool_incr);
+  __kmp_bget_set_pool(th, __kmp_malloc_pool_incr);
 }
 
 void __kmp_finalize_bget(kmp_info_t *th) {
@@ -1262,8 +1391,7 @@ void __kmp_finalize_bget(kmp_info_t *th) {
 }
 
 void kmpc_set_poolsize(size_t size) {
-  bectl(__kmp_get_thread(), (bget_compact_t)0, (bget_acquire_t)malloc,
-        (bget_release_t)free, (bufsize)size);
+  __kmp_bget_set_pool(__kmp_get_thread(), size);
 }
 
 size_t kmpc_get_poolsize(void) {
@@ -1441,6 +1569,335 @@ void ___kmp_thread_free(kmp_info_t *th, void *ptr KMP_SRC_LOC_DECL) {
   KE_TRACE(30, ("<- __kmp_thread_free()\n"));
 }
 
+#if OMP_50_ENABLED
+/* OpenMP 5.0 memory management support */
+#if KMP_OS_UNIX
+#include <dlfcn.h>
+#endif
+
+// High-bandwidth and interleaved memory come from the memkind library, which
+// is loaded on demand so that the runtime does not depend on it.
+static const char *kmp_mk_lib_name;
+static void *h_memkind;
+static void *(*kmp_mk_alloc)(void *k, size_t sz);
+static void (*kmp_mk_free)(void *kind, void *ptr);
+static int (*kmp_mk_check)(void *kind);
+static void **mk_default;
+static void **mk_interleave;
+static void **mk_hbw;
+static void **mk_hbw_interleave;
+static void **mk_hbw_preferred;
+static void **mk_hbw_preferred_interleave;
+
+#if KMP_OS_UNIX
+static void **__kmp_mk_get_kind(const char *name) {
+  void **kind = (void **)dlsym(h_memkind, name);
+  // A kind is usable only if the hardware and the OS provide that memory
+  if (kind != NULL && kmp_mk_check(*kind) != 0)
+    kind = NULL;
+  return kind;
+}
+#endif
+
+void __kmp_init_memkind() {
+#if KMP_OS_UNIX && KMP_DYNAMIC_LIB
+  kmp_mk_lib_name = "libmemkind.so";
+  h_memkind = dlopen(kmp_mk_lib_name, RTLD_LAZY);
+  if (h_memkind) {
+    *(void **)(&kmp_mk_check) = dlsym(h_memkind, "memkind_check_available");
+    *(void **)(&kmp_mk_alloc) = dlsym(h_memkind, "memkind_malloc");
+    *(void **)(&kmp_mk_free) = dlsym(h_memkind, "memkind_free");
+    mk_default = (void **)dlsym(h_memkind, "MEMKIND_DEFAULT");
+    if (kmp_mk_check && kmp_mk_alloc && kmp_mk_free && mk_default &&
+        !kmp_mk_check(*mk_default)) {
+      mk_interleave = __kmp_mk_get_kind("MEMKIND_INTERLEAVE");
+      mk_hbw = __kmp_mk_get_kind("MEMKIND_HBW");
+      mk_hbw_interleave = __kmp_mk_get_kind("MEMKIND_HBW_INTERLEAVE");
+      mk_hbw_preferred = __kmp_mk_get_kind("MEMKIND_HBW_PREFERRED");
+      mk_hbw_preferred_interleave =
+          __kmp_mk_get_kind("MEMKIND_HBW_PREFERRED_INTERLEAVE");
+      KE_TRACE(25, ("__kmp_init_memkind: memkind library initialized\n"));
+      return;
+    }
+    dlclose(h_memkind); // failure
+    h_memkind = NULL;
+  }
+#endif
+  kmp_mk_lib_name = "";
+  kmp_mk_check = NULL;
+  kmp_mk_alloc = NULL;
+  kmp_mk_free = NULL;
+  mk_default = NULL;
+  mk_interleave = NULL;
+  mk_hbw = NULL;
+  mk_hbw_interleave = NULL;
+  mk_hbw_preferred = NULL;
+  mk_hbw_preferred_interleave = NULL;
+}
+
+void __kmp_fini_memkind() {
+#if KMP_OS_UNIX && KMP_DYNAMIC_LIB
+  if (h_memkind) {
+    KE_TRACE(25, ("__kmp_fini_memkind: finalize memkind library\n"));
+    dlclose(h_memkind);
+    h_memkind = NULL;
+  }
+  kmp_mk_check = NULL;
+  kmp_mk_alloc = NULL;
+  kmp_mk_free = NULL;
+  mk_default = NULL;
+  mk_interleave = NULL;
+  mk_hbw = NULL;
+  mk_hbw_interleave = NULL;
+  mk_hbw_preferred = NULL;
+  mk_hbw_preferred_interleave = NULL;
+#endif
+}
+
+omp_allocator_handle_t __kmpc_init_allocator(int gtid, omp_memspace_handle_t ms,
+                                             int ntraits,
+                                             const omp_alloctrait_t traits[]) {
+  int i;
+  kmp_allocator_t *al;
+
+  if ((kmp_uintptr_t)ms > (kmp_uintptr_t)omp_low_lat_mem_space)
+    return omp_null_allocator; // not a memory space known to the runtime
+  al = (kmp_allocator_t *)__kmp_allocate(sizeof(kmp_allocator_t)); // zeroed
+  al->memspace = ms;
+  al->alignment = 1;
+  al->fb = omp_atv_default_mem_fb;
+  al->access = omp_atv_all;
+  al->partition = omp_atv_environment;
+  for (i = 0; i < ntraits; ++i) {
+    omp_uintptr_t value = traits[i].value;
+    switch (traits[i].key) {
+    case omp_atk_sync_hint:
+      break; // all allocators are thread-safe
+    case omp_atk_alignment:
+      if (value == 0 || (value & (value - 1)) != 0)
+        goto invalid;
+      al->alignment = value;
+      break;
+    case omp_atk_access:
+      if (value < omp_atv_all || value > omp_atv_cgroup)
+        goto invalid;
+      al->access = (omp_alloctrait_value_t)value;
+      break;
+    case omp_atk_pool_size:
+      al->pool_size = value;
+      break;
+    case omp_atk_fallback:
+      if (value < omp_atv_default_mem_fb || value > omp_atv_allocator_fb)
+        goto invalid;
+      al->fb = (omp_alloctrait_value_t)value;
+      break;
+    case omp_atk_fb_data:
+      al->fb_data = (omp_allocator_handle_t)value;
+      break;
+    case omp_atk_pinned:
+      al->pinned = (value != omp_atv_false && value != omp_atv_default);
+      break;
+    case omp_atk_partition:
+      if (value < omp_atv_environment || value > omp_atv_interleaved)
+        goto invalid;
+      al->partition = (omp_alloctrait_value_t)value;
+      break;
+    default:
+      goto invalid;
+    }
+  }
+  if (al->fb == omp_atv_allocator_fb && al->fb_data == omp_null_allocator)
+    goto invalid;
+  if (al->fb != omp_atv_allocator_fb)
+    al->fb_data = omp_null_allocator;
+
+  if (ms == omp_high_bw_mem_space) {
+    // Without high-bandwidth memory the allocator cannot be created
+    al->memkind = al->partition == omp_atv_interleaved && mk_hbw_interleave
+                      ? mk_hbw_interleave
+                      : mk_hbw;
+    if (al->memkind == NULL)
+      goto invalid;
+  } else if (al->partition == omp_atv_interleaved) {
+    al->memkind = mk_interleave; // NULL means no partitioning
+  }
+  KE_TRACE(25, ("__kmpc_init_allocator: T#%d allocator %p memspace %d\n", gtid,
+                al, (int)ms));
+  return (omp_allocator_handle_t)(kmp_uintptr_t)al;
+
+invalid:
+  __kmp_free(al);
+  return omp_null_allocator;
+}
+
+void __kmpc_destroy_allocator(int gtid, omp_allocator_handle_t allocator) {
+  if (!KMP_IS_PREDEFINED_ALLOCATOR(allocator)) {
+    KE_TRACE(25, ("__kmpc_destroy_allocator: T#%d allocator %p\n", gtid,
+                  (void *)allocator));
+    __kmp_free((void *)allocator);
+  }
+}
+
+void __kmpc_set_default_allocator(int gtid, omp_allocator_handle_t allocator) {
+  if (allocator == omp_null_allocator)
+    allocator = omp_default_mem_alloc;
+  __kmp_threads[gtid]->th.th_def_allocator = allocator;
+}
+
+omp_allocator_handle_t __kmpc_get_default_allocator(int gtid) {
+  return __kmp_threads[gtid]->th.th_def_allocator;
+}
+
+// Where a block handed out by __kmpc_alloc came from
+enum kmp_mem_source { kmp_mem_bget, kmp_mem_mmap, kmp_mem_memkind };
+
+typedef struct kmp_mem_desc { // Memory block descriptor
+  void *ptr_alloc; // Pointer returned by the underlying allocator
+  size_t size_a; // Size of the allocated block (size + descriptor + alignment)
+  kmp_allocator_t *allocator; // Allocator to charge, NULL if predefined
+  void **memkind; // memkind kind for kmp_mem_memkind blocks
+  int source; // kmp_mem_source
+} kmp_mem_desc_t;
+
+// Maps blocks of at least __kmp_alloc_mmap_threshold bytes, and pinned blocks,
+// directly from the OS. Huge blocks are backed by transparent huge pages.
+static void *__kmp_alloc_mmap(size_t size, int pinned) {
+#if KMP_OS_UNIX
+  void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    return NULL;
+#ifdef MADV_HUGEPAGE
+  if (size >= KMP_HUGE_PAGE_SIZE)
+    madvise(ptr, size, MADV_HUGEPAGE);
+#endif
+  if (pinned && mlock(ptr, size) != 0) {
+    munmap(ptr, size);
+    return NULL;
+  }
+  return ptr;
+#else
+  return NULL;
+#endif
+}
+
+void *__kmpc_alloc(int gtid, size_t size, omp_allocator_handle_t allocator) {
+  kmp_info_t *th = __kmp_threads[gtid];
+  kmp_allocator_t *al = NULL;
+  kmp_mem_desc_t desc;
+  kmp_uintptr_t addr; // address returned by the underlying allocator
+  kmp_uintptr_t addr_align; // address returned to the caller
+  size_t align = sizeof(void *); // minimal alignment
+  size_t sz_desc = sizeof(kmp_mem_desc_t);
+  int pinned = 0;
+
+  KE_TRACE(25, ("__kmpc_alloc: T#%d (%d, %p)\n", gtid, (int)size,
+                (void *)allocator));
+  if (allocator == omp_null_allocator)
+    allocator = th->th.th_def_allocator;
+  if (!KMP_IS_PREDEFINED_ALLOCATOR(allocator)) {
+    al = (kmp_allocator_t *)allocator;
+    if (al->alignment > align)
+      align = al->alignment;
+    pinned = al->pinned;
+  }
+
+  desc.size_a = size + sz_desc + align;
+  desc.allocator = al;
+  desc.memkind = NULL;
+  desc.ptr_alloc = NULL;
+
+  if (al != NULL && al->pool_size > 0) {
+    // Reserve space in the pool first, give it back if it does not fit
+    kmp_uint64 used = KMP_TEST_THEN_ADD64((volatile kmp_int64 *)&al->pool_used,
+                                          desc.size_a);
+    if (used + desc.size_a > al->pool_size) {
+      KMP_TEST_THEN_ADD64((volatile kmp_int64 *)&al->pool_used,
+                          -(kmp_int64)desc.size_a);
+      desc.size_a = 0; // pool exhausted
+    }
+  }
+
+  if (desc.size_a == 0) {
+    // go to the fallback
+  } else if (al != NULL ? al->memkind != NULL
+                        : allocator == omp_high_bw_mem_alloc &&
+                              mk_hbw_preferred != NULL) {
+    desc.memkind = al != NULL ? al->memkind : mk_hbw_preferred;
+    desc.source = kmp_mem_memkind;
+    desc.ptr_alloc = kmp_mk_alloc(*desc.memkind, desc.size_a);
+  } else if (pinned || (__kmp_alloc_mmap_threshold > 0 &&
+                        desc.size_a >= __kmp_alloc_mmap_threshold)) {
+    desc.source = kmp_mem_mmap;
+    desc.ptr_alloc = __kmp_alloc_mmap(desc.size_a, pinned);
+  } else {
+    // Thread-local bget pool of the calling thread; frees from other threads
+    // are queued back to it
+    desc.source = kmp_mem_bget;
+    desc.ptr_alloc = __kmp_thread_malloc(th, desc.size_a);
+  }
+
+  if (desc.ptr_alloc == NULL) {
+    if (al == NULL)
+      return NULL; // predefined allocators return NULL on failure
+    if (desc.size_a != 0 && al->pool_size > 0)
+      KMP_TEST_THEN_ADD64((volatile kmp_int64 *)&al->pool_used,
+                          -(kmp_int64)desc.size_a);
+    switch (al->fb) {
+    case omp_atv_default_mem_fb:
+      // Do not retry the same memory for allocators that only differ from the
+      // default allocator in their traits
+      if (al->memspace == omp_default_mem_space && al->memkind == NULL &&
+          !al->pinned && al->pool_size == 0)
+        return NULL;
+      return __kmpc_alloc(gtid, size, omp_default_mem_alloc);
+    case omp_atv_abort_fb:
+      KMP_FATAL(OutOfHeapMemory);
+      break;
+    case omp_atv_allocator_fb:
+      return __kmpc_alloc(gtid, size, al->fb_data);
+    default: // omp_atv_null_fb
+      return NULL;
+    }
+  }
+
+  addr = (kmp_uintptr_t)desc.ptr_alloc;
+  addr_align = (addr + sz_desc + align - 1) & ~(align - 1);
+  *((kmp_mem_desc_t *)(addr_align - sz_desc)) = desc;
+  KE_TRACE(25, ("__kmpc_alloc returns %p, T#%d\n", (void *)addr_align, gtid));
+  return (void *)addr_align;
+}
+
+void __kmpc_free(int gtid, void *ptr, omp_allocator_handle_t allocator) {
+  kmp_mem_desc_t desc;
+
+  KE_TRACE(25, ("__kmpc_free: T#%d free(%p,%p)\n", gtid, ptr,
+                (void *)allocator));
+  if (ptr == NULL)
+    return;
+  // The descriptor knows the allocator that served the block, which may be a
+  // fallback of the one given here
+  desc = *((kmp_mem_desc_t *)((kmp_uintptr_t)ptr - sizeof(kmp_mem_desc_t)));
+  switch (desc.source) {
+  case kmp_mem_memkind:
+    kmp_mk_free(*desc.memkind, desc.ptr_alloc);
+    break;
+  case kmp_mem_mmap:
+#if KMP_OS_UNIX
+    munmap(desc.ptr_alloc, desc.size_a); // also unlocks pinned pages
+#endif
+    break;
+  default:
+    __kmp_thread_free(__kmp_threads[gtid], desc.ptr_alloc);
+  }
+  if (desc.allocator != NULL && desc.allocator->pool_size > 0)
+    KMP_TEST_THEN_ADD64((volatile kmp_int64 *)&desc.allocator->pool_used,
+                        -(kmp_int64)desc.size_a);
+  KE_TRACE(10, ("__kmpc_free: T#%d freed %p (%p)\n", gtid, desc.ptr_alloc,
+                (void *)allocator));
+}
+#endif // OMP_50_ENABLED
+
 /* If LEAK_MEMORY is defined, __kmp_free() will *not* free memory. It causes
    memory leaks, but it may be useful for debugging memory corruptions, used
    freed pointers, etc. */
@@ -1649,70 +2106,45 @@ void ___kmp_free(void *ptr KMP_SRC_LOC_DECL) {
 // Always use 128 bytes for determining buckets for caching memory blocks
 #define DCACHE_LINE 128
 
-void *___kmp_fast_allocate(kmp_info_t *this_thr, size_t size KMP_SRC_LOC_DECL) {
-  void *ptr;
-  int num_lines;
-  int idx;
-  int index;
-  void *alloc_ptr;
-  size_t alloc_size;
-  kmp_mem_descr_t *descr;
-
-  KE_TRACE(25, ("-> __kmp_fast_allocate( T#%d, %d ) called from %s:%d\n",
-                __kmp_gtid_from_thread(this_thr), (int)size KMP_SRC_LOC_PARM));
-
-  num_lines = (size + DCACHE_LINE - 1) / DCACHE_LINE;
-  idx = num_lines - 1;
-  KMP_DEBUG_ASSERT(idx >= 0);
-  if (idx < 2) {
-    index = 0; // idx is [ 0, 1 ], use first free list
-    num_lines = 2; // 1, 2 cache lines or less than cache line
-  } else if ((idx >>= 2) == 0) {
-    index = 1; // idx is [ 2, 3 ], use second free list
-    num_lines = 4; // 3, 4 cache lines
-  } else if ((idx >>= 2) == 0) {
-    index = 2; // idx is [ 4, 15 ], use third free list
-    num_lines = 16; // 5, 6, ..., 16 cache lines
-  } else if ((idx >>= 2) == 0) {
-    index = 3; // idx is [ 16, 63 ], use fourth free list
-    num_lines = 64; // 17, 18, ..., 64 cache lines
-  } else {
-    goto alloc_call; // 65 or more cache lines ( > 8KB ), don't use free lists
-  }
-
-  ptr = this_thr->th.th_free_lists[index].th_free_list_self;
+// Pop a block from the thread's free list, or return NULL if it is empty.
+static void *__kmp_free_list_pop(kmp_info_t *this_thr, int index) {
+  kmp_free_list_t *list = &this_thr->th.th_free_lists[index];
+  void *ptr = list->th_free_list_self;
   if (ptr != NULL) {
     // pop the head of no-sync free list
-    this_thr->th.th_free_lists[index].th_free_list_self = *((void **)ptr);
+    list->th_free_list_self = *((void **)ptr);
     KMP_DEBUG_ASSERT(
         this_thr ==
         ((kmp_mem_descr_t *)((kmp_uintptr_t)ptr - sizeof(kmp_mem_descr_t)))
             ->ptr_aligned);
-    goto end;
+    return ptr;
   };
-  ptr = TCR_SYNC_PTR(this_thr->th.th_free_lists[index].th_free_list_sync);
+  ptr = TCR_SYNC_PTR(list->th_free_list_sync);
   if (ptr != NULL) {
     // no-sync free list is empty, use sync free list (filled in by other
     // threads only)
     // pop the head of the sync free list, push NULL instead
-    while (!KMP_COMPARE_AND_STORE_PTR(
-        &this_thr->th.th_free_lists[index].th_free_list_sync, ptr, nullptr)) {
+    while (!KMP_COMPARE_AND_STORE_PTR(&list->th_free_list_sync, ptr, nullptr)) {
       KMP_CPU_PAUSE();
-      ptr = TCR_SYNC_PTR(this_thr->th.th_free_lists[index].th_free_list_sync);
+      ptr = TCR_SYNC_PTR(list->th_free_list_sync);
     }
     // push the rest of chain into no-sync free list (can be NULL if there was
     // the only block)
-    this_thr->th.th_free_lists[index].th_free_list_self = *((void **)ptr);
+    list->th_free_list_self = *((void **)ptr);
     KMP_DEBUG_ASSERT(
         this_thr ==
         ((kmp_mem_descr_t *)((kmp_uintptr_t)ptr - sizeof(kmp_mem_descr_t)))
             ->ptr_aligned);
-    goto end;
   }
+  return ptr;
+}
 
-alloc_call:
-  // haven't found block in the free lists, thus allocate it
-  size = num_lines * DCACHE_LINE;
+// Allocate a cache-aligned block of size bytes from the thread's bget pool.
+static void *__kmp_free_list_block_alloc(kmp_info_t *this_thr, size_t size) {
+  void *ptr;
+  void *alloc_ptr;
+  size_t alloc_size;
+  kmp_mem_descr_t *descr;
 
   alloc_size = size + sizeof(kmp_mem_descr_t) + DCACHE_LINE;
   KE_TRACE(25, ("__kmp_fast_allocate: T#%d Calling __kmp_thread_malloc with "
@@ -1732,57 +2164,28 @@ alloc_call:
   // (it is already saved in bget buffer,
   // but we may want to use another allocator in future)
   descr->size_aligned = size;
-
-end:
-  KE_TRACE(25, ("<- __kmp_fast_allocate( T#%d ) returns %p\n",
-                __kmp_gtid_from_thread(this_thr), ptr));
   return ptr;
-} // func __kmp_fast_allocate
+}
 
-// Free fast memory and place it on the thread's free list if it is of
-// the correct size.
-void ___kmp_fast_free(kmp_info_t *this_thr, void *ptr KMP_SRC_LOC_DECL) {
-  kmp_mem_descr_t *descr;
+// Push a block to the free list of the given index: own blocks go to the
+// no-sync list, blocks of other threads are batched in the "other" list and
+// returned to the owner's sync list KMP_FREE_LIST_LIMIT at a time.
+static void __kmp_free_list_push(kmp_info_t *this_thr, void *ptr, int index) {
+  kmp_mem_descr_t *descr =
+      (kmp_mem_descr_t *)(((kmp_uintptr_t)ptr) - sizeof(kmp_mem_descr_t));
+  kmp_free_list_t *list = &this_thr->th.th_free_lists[index];
   kmp_info_t *alloc_thr;
-  size_t size;
-  size_t idx;
-  int index;
-
-  KE_TRACE(25, ("-> __kmp_fast_free( T#%d, %p ) called from %s:%d\n",
-                __kmp_gtid_from_thread(this_thr), ptr KMP_SRC_LOC_PARM));
-  KMP_ASSERT(ptr != NULL);
-
-  descr = (kmp_mem_descr_t *)(((kmp_uintptr_t)ptr) - sizeof(kmp_mem_descr_t));
-
-  KE_TRACE(26, ("   __kmp_fast_free:     size_aligned=%d\n",
-                (int)descr->size_aligned));
-
-  size = descr->size_aligned; // 2, 4, 16, 64, 65, 66, ... cache lines
-
-  idx = DCACHE_LINE * 2; // 2 cache lines is minimal size of block
-  if (idx == size) {
-    index = 0; // 2 cache lines
-  } else if ((idx <<= 1) == size) {
-    index = 1; // 4 cache lines
-  } else if ((idx <<= 2) == size) {
-    index = 2; // 16 cache lines
-  } else if ((idx <<= 2) == size) {
-    index = 3; // 64 cache lines
-  } else {
-    KMP_DEBUG_ASSERT(size > DCACHE_LINE * 64);
-    goto free_call; // 65 or more cache lines ( > 8KB )
-  }
 
   alloc_thr = (kmp_info_t *)descr->ptr_aligned; // get thread owning the block
   if (alloc_thr == this_thr) {
     // push block to self no-sync free list, linking previous head (LIFO)
-    *((void **)ptr) = this_thr->th.th_free_lists[index].th_free_list_self;
-    this_thr->th.th_free_lists[index].th_free_list_self = ptr;
+    *((void **)ptr) = list->th_free_list_self;
+    list->th_free_list_self = ptr;
   } else {
-    void *head = this_thr->th.th_free_lists[index].th_free_list_other;
+    void *head = list->th_free_list_other;
     if (head == NULL) {
       // Create new free list
-      this_thr->th.th_free_lists[index].th_free_list_other = ptr;
+      list->th_free_list_other = ptr;
       *((void **)ptr) = NULL; // mark the tail of the list
       descr->size_allocated = (size_t)1; // head of the list keeps its length
     } else {
@@ -1797,7 +2200,7 @@ void ___kmp_fast_free(kmp_info_t *this_thr, void *ptr KMP_SRC_LOC_DECL) {
         // we can add current task to "other" list, no sync needed
         *((void **)ptr) = head;
         descr->size_allocated = q_sz;
-        this_thr->th.th_free_lists[index].th_free_list_other = ptr;
+        list->th_free_list_other = ptr;
       } else {
         // either queue blocks owner is changing or size limit exceeded
         // return old queue to allocating thread (q_th) synchroneously,
@@ -1805,6 +2208,7 @@ void ___kmp_fast_free(kmp_info_t *this_thr, void *ptr KMP_SRC_LOC_DECL) {
         void *old_ptr;
         void *tail = head;
         void *next = *((void **)head);
+        kmp_free_list_t *q_list;
         while (next != NULL) {
           KMP_DEBUG_ASSERT(
               // queue size should decrease by 1 each step through the list
@@ -1817,26 +2221,471 @@ void ___kmp_fast_free(kmp_info_t *this_thr, void *ptr KMP_SRC_LOC_DECL) {
           next = *((void **)next);
         }
         KMP_DEBUG_ASSERT(q_th != NULL);
+        q_list = &q_th->th.th_free_lists[index];
         // push block to owner's sync free list
-        old_ptr = TCR_PTR(q_th->th.th_free_lists[index].th_free_list_sync);
+        old_ptr = TCR_PTR(q_list->th_free_list_sync);
         /* the next pointer must be set before setting free_list to ptr to avoid
            exposing a broken list to other threads, even for an instant. */
         *((void **)tail) = old_ptr;
 
-        while (!KMP_COMPARE_AND_STORE_PTR(
-            &q_th->th.th_free_lists[index].th_free_list_sync, old_ptr, head)) {
+        while (!KMP_COMPARE_AND_STORE_PTR(&q_list->th_free_list_sync, old_ptr,
+                                          head)) {
           KMP_CPU_PAUSE();
-          old_ptr = TCR_PTR(q_th->th.th_free_lists[index].th_free_list_sync);
+          old_ptr = TCR_PTR(q_list->th_free_list_sync);
           *((void **)tail) = old_ptr;
         }
 
         // start new list of not-selt tasks
-        this_thr->th.th_free_lists[index].th_free_list_other = ptr;
+        list->th_free_list_other = ptr;
         *((void **)ptr) = NULL;
         descr->size_allocated = (size_t)1; // head of queue keeps its length
       }
     }
   }
+}
+
+// The slab engine carves the fast memory of each thread out of KMP_SLAB_SIZE
+// slabs, one size class per slab. Slabs are aligned on their size, so the slab
+// of an object is found by masking its address and objects carry no header.
+// Objects freed by other threads are batched per size class and handed back
+// to the owner KMP_FREE_LIST_LIMIT at a time, with a single CAS, or when the
+// freeing thread reaches a barrier. The owner takes them back when its slabs
+// of that class run out of free objects. Empty slabs are kept in a small
+// per-thread reserve, the others are returned to the system. Blocks larger
+// than the biggest size class come straight from malloc, behind a small
+// header that tags them as such.
+//
+// The slabs and the remote lists of a thread hang off an owner record that
+// outlives the thread. When the thread is reaped, its remote lists are closed
+// and its slabs still holding objects are orphaned; the objects freed later
+// go back to those slabs directly under __kmp_slab_orphan_lock, and the last
+// one frees the slab, and with the last slab the owner record.
+#define KMP_SLAB_SIZE (64 * 1024)
+#define KMP_SLAB_LARGE (-1)
+#define KMP_SLAB_RESERVE 4
+#define KMP_SLAB_CLOSED ((void *)1) // remote list of a reaped owner
+
+typedef struct kmp_slab_owner {
+  void *volatile remote[KMP_SLAB_CLASSES]; // objects freed by other threads
+  struct kmp_slab *slabs; // all slabs of the owner
+  kmp_int32 num_orphans; // slabs still holding objects once orphaned
+} kmp_slab_owner_t;
+
+static kmp_bootstrap_lock_t __kmp_slab_orphan_lock =
+    KMP_BOOTSTRAP_LOCK_INITIALIZER(__kmp_slab_orphan_lock);
+
+typedef struct kmp_slab {
+  kmp_slab_owner_t *owner; // owner of the thread allocating from the slab
+  struct kmp_slab *next; // neighbours in a partial or reserve list
+  struct kmp_slab *prev;
+  struct kmp_slab *all_next; // neighbours in the list of the owner's slabs
+  struct kmp_slab *all_prev;
+  void *free; // objects given back to the slab
+  char *bump; // start of the part of the slab never handed out
+  kmp_int32 cls; // size class
+  kmp_int32 obj_size;
+  kmp_int32 num_objs;
+  kmp_int32 num_used; // objects handed out
+} kmp_slab_t;
+
+#define KMP_SLAB_HEADER                                                        \
+  ((sizeof(kmp_slab_t) + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1))
+#define KMP_SLAB_OF(ptr)                                                       \
+  ((kmp_slab_t *)((kmp_uintptr_t)(ptr) & ~(kmp_uintptr_t)(KMP_SLAB_SIZE - 1)))
+
+// Objects of 64 bytes or more are multiples of 64 bytes, so they never share
+// a cache line with their neighbours
+static const kmp_int32 __kmp_slab_class_size[KMP_SLAB_CLASSES] = {
+    16,  32,  64,  128, 192, 256, 320,  384,  448,  512,  576,  640,  704,
+    768, 832, 896, 960, 1024, 1280, 1536, 1792, 2048, 2560, 3072, 3584, 4096};
+
+static inline int __kmp_slab_class(size_t size) {
+  if (size <= 32)
+    return size <= 16 ? 0 : 1;
+  if (size <= 1024)
+    return 1 + (int)((size + 63) >> 6);
+  if (size <= 2048)
+    return 17 + (int)((size - 1024 + 255) >> 8);
+  if (size <= 4096)
+    return 21 + (int)((size - 2048 + 511) >> 9);
+  return KMP_SLAB_LARGE;
+}
+
+// Header in front of a large block. The tag is derived from the address of
+// the block, so the word in front of a slab object (the slab header or the
+// end of the previous object) is not mistaken for it.
+typedef struct kmp_slab_large {
+  void *base; // pointer returned by malloc
+  kmp_uintptr_t tag;
+} kmp_slab_large_t;
+
+#define KMP_SLAB_LARGE_TAG(ptr)                                                \
+  ((kmp_uintptr_t)(ptr) ^ (kmp_uintptr_t)0x5a5a5a5a5a5a5a5aULL)
+#define KMP_SLAB_LARGE_OF(ptr)                                                 \
+  ((kmp_slab_large_t *)((char *)(ptr) - sizeof(kmp_slab_large_t)))
+
+static kmp_slab_t *__kmp_slab_map(size_t size) {
+  void *ptr;
+#if KMP_OS_WINDOWS
+  ptr = _aligned_malloc(size, KMP_SLAB_SIZE);
+#else
+  if (posix_memalign(&ptr, KMP_SLAB_SIZE, size) != 0)
+    ptr = NULL;
+#endif
+  if (ptr == NULL)
+    KMP_FATAL(MemoryAllocFailed);
+  return (kmp_slab_t *)ptr;
+}
+
+static void __kmp_slab_unmap(kmp_slab_t *slab) {
+#if KMP_OS_WINDOWS
+  _aligned_free(slab);
+#else
+  free(slab);
+#endif
+}
+
+static inline void __kmp_slab_link(kmp_slab_t **head, kmp_slab_t *slab) {
+  slab->prev = NULL;
+  slab->next = *head;
+  if (*head != NULL)
+    (*head)->prev = slab;
+  *head = slab;
+}
+
+static inline void __kmp_slab_unlink(kmp_slab_t **head, kmp_slab_t *slab) {
+  if (slab->prev != NULL)
+    slab->prev->next = slab->next;
+  else
+    *head = slab->next;
+  if (slab->next != NULL)
+    slab->next->prev = slab->prev;
+}
+
+// Start a new slab of the given class, reusing a reserved empty slab if any.
+static kmp_slab_t *__kmp_slab_new(kmp_info_t *th, int cls) {
+  kmp_slab_owner_t *owner = th->th.th_slab_owner;
+  kmp_slab_t *slab = th->th.th_slab_reserve;
+  if (slab != NULL) {
+    __kmp_slab_unlink(&th->th.th_slab_reserve, slab);
+    th->th.th_slab_reserve_size--;
+  } else {
+    if (owner == NULL) {
+      owner = (kmp_slab_owner_t *)__kmp_allocate(sizeof(kmp_slab_owner_t));
+      th->th.th_slab_owner = owner;
+    }
+    slab = __kmp_slab_map(KMP_SLAB_SIZE);
+    slab->owner = owner;
+    slab->all_prev = NULL;
+    slab->all_next = owner->slabs;
+    if (owner->slabs != NULL)
+      owner->slabs->all_prev = slab;
+    owner->slabs = slab;
+  }
+  KE_TRACE(25, ("__kmp_slab_new: T#%d slab %p class %d\n",
+                __kmp_gtid_from_thread(th), slab, cls));
+  slab->cls = cls;
+  slab->obj_size = __kmp_slab_class_size[cls];
+  slab->num_objs = (kmp_int32)((KMP_SLAB_SIZE - KMP_SLAB_HEADER) /
+                               __kmp_slab_class_size[cls]);
+  slab->num_used = 0;
+  slab->free = NULL;
+  slab->bump = (char *)slab + KMP_SLAB_HEADER;
+  __kmp_slab_link(&th->th.th_slab_classes[cls].sc_partial, slab);
+  return slab;
+}
+
+// Move an empty slab to the reserve, or give it back to the system if the
+// reserve is full.
+static void __kmp_slab_retire(kmp_info_t *th, kmp_slab_t *slab) {
+  __kmp_slab_unlink(&th->th.th_slab_classes[slab->cls].sc_partial, slab);
+  if (th->th.th_slab_reserve_size < KMP_SLAB_RESERVE) {
+    __kmp_slab_link(&th->th.th_slab_reserve, slab);
+    th->th.th_slab_reserve_size++;
+    return;
+  }
+  KE_TRACE(25, ("__kmp_slab_retire: T#%d releases slab %p\n",
+                __kmp_gtid_from_thread(th), slab));
+  if (slab->all_prev != NULL)
+    slab->all_prev->all_next = slab->all_next;
+  else
+    th->th.th_slab_owner->slabs = slab->all_next;
+  if (slab->all_next != NULL)
+    slab->all_next->all_prev = slab->all_prev;
+  __kmp_slab_unmap(slab);
+}
+
+// Give an object back to a slab owned by the calling thread.
+static void __kmp_slab_put(kmp_info_t *th, kmp_slab_t *slab, void *ptr) {
+  kmp_slab_class_t *sc = &th->th.th_slab_classes[slab->cls];
+  KMP_DEBUG_ASSERT(slab->owner == th->th.th_slab_owner && slab->num_used > 0);
+  *((void **)ptr) = slab->free;
+  slab->free = ptr;
+  if (slab->num_used-- == slab->num_objs) {
+    __kmp_slab_link(&sc->sc_partial, slab); // the slab was full
+  } else if (slab->num_used == 0 && slab != sc->sc_partial) {
+    // keep the current slab to avoid cycling it through the reserve
+    __kmp_slab_retire(th, slab);
+  }
+}
+
+// Take back the objects of the given class freed by other threads, and replace
+// the remote list with next.
+static void __kmp_slab_drain(kmp_info_t *th, int cls, void *next) {
+  kmp_slab_owner_t *owner = th->th.th_slab_owner;
+  void *ptr;
+  if (owner == NULL)
+    return;
+  ptr = TCR_SYNC_PTR(owner->remote[cls]);
+  if (ptr == next)
+    return;
+  while (!KMP_COMPARE_AND_STORE_PTR(&owner->remote[cls], ptr, next)) {
+    KMP_CPU_PAUSE();
+    ptr = TCR_SYNC_PTR(owner->remote[cls]);
+  }
+  while (ptr != NULL) {
+    next = *((void **)ptr);
+    __kmp_slab_put(th, KMP_SLAB_OF(ptr), ptr);
+    ptr = next;
+  }
+}
+
+// Give objects back to the orphaned slabs of a reaped thread. The last object
+// of a slab frees the slab, and the last slab of an owner frees its record.
+static void __kmp_slab_put_orphans(void *ptr) {
+  __kmp_acquire_bootstrap_lock(&__kmp_slab_orphan_lock);
+  while (ptr != NULL) {
+    void *next = *((void **)ptr);
+    kmp_slab_t *slab = KMP_SLAB_OF(ptr);
+    if (--slab->num_used == 0) {
+      kmp_slab_owner_t *owner = slab->owner;
+      KE_TRACE(25, ("__kmp_slab_put_orphans: releases slab %p\n", slab));
+      __kmp_slab_unmap(slab);
+      if (--owner->num_orphans == 0)
+        __kmp_free(owner);
+    }
+    ptr = next;
+  }
+  __kmp_release_bootstrap_lock(&__kmp_slab_orphan_lock);
+}
+
+// Return the batch of another thread's objects to their owner.
+static void __kmp_slab_flush(kmp_slab_class_t *sc, int cls) {
+  void *volatile *remote = &sc->sc_batch_owner->remote[cls];
+  void *old_ptr = TCR_PTR(*remote);
+  for (;;) {
+    if (old_ptr == KMP_SLAB_CLOSED) {
+      *((void **)sc->sc_batch_tail) = NULL;
+      __kmp_slab_put_orphans(sc->sc_batch);
+      break;
+    }
+    *((void **)sc->sc_batch_tail) = old_ptr;
+    if (KMP_COMPARE_AND_STORE_PTR(remote, old_ptr, sc->sc_batch))
+      break;
+    KMP_CPU_PAUSE();
+    old_ptr = TCR_PTR(*remote);
+  }
+  sc->sc_batch = NULL;
+}
+
+// Return all batches of other threads' objects to their owners.
+static void __kmp_slab_flush_all(kmp_info_t *th) {
+  int cls;
+  for (cls = 0; cls < KMP_SLAB_CLASSES; ++cls) {
+    kmp_slab_class_t *sc = &th->th.th_slab_classes[cls];
+    if (sc->sc_batch != NULL)
+      __kmp_slab_flush(sc, cls);
+  }
+}
+
+// Release the slabs of a thread being reaped: close its remote lists, give
+// the empty slabs back to the system and orphan the others.
+static void __kmp_slab_release(kmp_info_t *th) {
+  kmp_slab_owner_t *owner = th->th.th_slab_owner;
+  kmp_slab_t *slab;
+  int cls;
+
+  __kmp_slab_flush_all(th);
+  if (owner != NULL) {
+    __kmp_acquire_bootstrap_lock(&__kmp_slab_orphan_lock);
+    for (cls = 0; cls < KMP_SLAB_CLASSES; ++cls)
+      __kmp_slab_drain(th, cls, KMP_SLAB_CLOSED);
+    slab = owner->slabs;
+    while (slab != NULL) {
+      kmp_slab_t *next = slab->all_next;
+      if (slab->num_used == 0)
+        __kmp_slab_unmap(slab);
+      else
+        owner->num_orphans++;
+      slab = next;
+    }
+    KE_TRACE(10, ("__kmp_slab_release: T#%d orphans %d slabs\n",
+                  __kmp_gtid_from_thread(th), owner->num_orphans));
+    owner->slabs = NULL;
+    if (owner->num_orphans == 0)
+      __kmp_free(owner);
+    __kmp_release_bootstrap_lock(&__kmp_slab_orphan_lock);
+  }
+  memset(th->th.th_slab_classes, 0,
+         KMP_SLAB_CLASSES * sizeof(kmp_slab_class_t));
+  th->th.th_slab_owner = NULL;
+  th->th.th_slab_reserve = NULL;
+  th->th.th_slab_reserve_size = 0;
+}
+
+static void *__kmp_slab_allocate(kmp_info_t *th, size_t size) {
+  int cls = __kmp_slab_class(size);
+  kmp_slab_class_t *sc;
+  kmp_slab_t *slab;
+  void *ptr;
+
+  if (cls == KMP_SLAB_LARGE) {
+    // cache line aligned, like the objects of the bigger size classes
+    void *base = malloc(size + sizeof(kmp_slab_large_t) + CACHE_LINE - 1);
+    if (base == NULL)
+      KMP_FATAL(MemoryAllocFailed);
+    ptr = (void *)(((kmp_uintptr_t)base + sizeof(kmp_slab_large_t) +
+                    CACHE_LINE - 1) &
+                   ~(kmp_uintptr_t)(CACHE_LINE - 1));
+    KMP_SLAB_LARGE_OF(ptr)->base = base;
+    KMP_SLAB_LARGE_OF(ptr)->tag = KMP_SLAB_LARGE_TAG(ptr);
+    return ptr;
+  }
+  sc = &th->th.th_slab_classes[cls];
+  slab = sc->sc_partial;
+  if (slab == NULL) {
+    __kmp_slab_drain(th, cls, NULL);
+    slab = sc->sc_partial;
+    if (slab == NULL)
+      slab = __kmp_slab_new(th, cls);
+  }
+  ptr = slab->free;
+  if (ptr != NULL) {
+    slab->free = *((void **)ptr);
+  } else {
+    // no free objects left, so the uncarved part is not empty
+    ptr = slab->bump;
+    slab->bump += slab->obj_size;
+  }
+  if (++slab->num_used == slab->num_objs)
+    __kmp_slab_unlink(&sc->sc_partial, slab); // full slabs are on no list
+  return ptr;
+}
+
+static void __kmp_slab_free(kmp_info_t *th, void *ptr) {
+  kmp_slab_t *slab;
+  kmp_slab_class_t *sc;
+
+  if (KMP_SLAB_LARGE_OF(ptr)->tag == KMP_SLAB_LARGE_TAG(ptr)) {
+    free(KMP_SLAB_LARGE_OF(ptr)->base);
+    return;
+  }
+  slab = KMP_SLAB_OF(ptr);
+  if (slab->owner == th->th.th_slab_owner) {
+    __kmp_slab_put(th, slab, ptr);
+    return;
+  }
+  sc = &th->th.th_slab_classes[slab->cls];
+  if (sc->sc_batch != NULL && (sc->sc_batch_owner != slab->owner ||
+                               sc->sc_batch_count >= KMP_FREE_LIST_LIMIT))
+    __kmp_slab_flush(sc, slab->cls);
+  *((void **)ptr) = sc->sc_batch;
+  if (sc->sc_batch == NULL) {
+    sc->sc_batch_tail = ptr;
+    sc->sc_batch_owner = slab->owner;
+    sc->sc_batch_count = 0;
+  }
+  sc->sc_batch = ptr;
+  sc->sc_batch_count++;
+}
+
+void *___kmp_fast_allocate(kmp_info_t *this_thr, size_t size KMP_SRC_LOC_DECL) {
+  void *ptr;
+  int num_lines;
+  int idx;
+  int index;
+
+  KE_TRACE(25, ("-> __kmp_fast_allocate( T#%d, %d ) called from %s:%d\n",
+                __kmp_gtid_from_thread(this_thr), (int)size KMP_SRC_LOC_PARM));
+
+  if (__kmp_fast_mem_engine == fast_mem_slab) {
+    ptr = __kmp_slab_allocate(this_thr, size);
+    goto end;
+  }
+
+  num_lines = (size + DCACHE_LINE - 1) / DCACHE_LINE;
+  idx = num_lines - 1;
+  KMP_DEBUG_ASSERT(idx >= 0);
+  if (idx < 2) {
+    index = 0; // idx is [ 0, 1 ], use first free list
+    num_lines = 2; // 1, 2 cache lines or less than cache line
+  } else if ((idx >>= 2) == 0) {
+    index = 1; // idx is [ 2, 3 ], use second free list
+    num_lines = 4; // 3, 4 cache lines
+  } else if ((idx >>= 2) == 0) {
+    index = 2; // idx is [ 4, 15 ], use third free list
+    num_lines = 16; // 5, 6, ..., 16 cache lines
+  } else if ((idx >>= 2) == 0) {
+    index = 3; // idx is [ 16, 63 ], use fourth free list
+    num_lines = 64; // 17, 18, ..., 64 cache lines
+  } else {
+    goto alloc_call; // 65 or more cache lines ( > 8KB ), don't use free lists
+  }
+
+  ptr = __kmp_free_list_pop(this_thr, index);
+  if (ptr != NULL)
+    goto end;
+
+alloc_call:
+  // haven't found block in the free lists, thus allocate it
+  size = num_lines * DCACHE_LINE;
+  ptr = __kmp_free_list_block_alloc(this_thr, size);
+
+end:
+  KE_TRACE(25, ("<- __kmp_fast_allocate( T#%d ) returns %p\n",
+                __kmp_gtid_from_thread(this_thr), ptr));
+  return ptr;
+} // func __kmp_fast_allocate
+
+// Free fast memory and place it on the thread's free list if it is of
+// the correct size.
+void ___kmp_fast_free(kmp_info_t *this_thr, void *ptr KMP_SRC_LOC_DECL) {
+  kmp_mem_descr_t *descr;
+  size_t size;
+  size_t idx;
+  int index;
+
+  KE_TRACE(25, ("-> __kmp_fast_free( T#%d, %p ) called from %s:%d\n",
+                __kmp_gtid_from_thread(this_thr), ptr KMP_SRC_LOC_PARM));
+  KMP_ASSERT(ptr != NULL);
+
+  if (__kmp_fast_mem_engine == fast_mem_slab) {
+    __kmp_slab_free(this_thr, ptr);
+    goto end;
+  }
+
+  descr = (kmp_mem_descr_t *)(((kmp_uintptr_t)ptr) - sizeof(kmp_mem_descr_t));
+
+  KE_TRACE(26, ("   __kmp_fast_free:     size_aligned=%d\n",
+                (int)descr->size_aligned));
+
+  size = descr->size_aligned; // 2, 4, 16, 64, 65, 66, ... cache lines
+
+  idx = DCACHE_LINE * 2; // 2 cache lines is minimal size of block
+  if (idx == size) {
+    index = 0; // 2 cache lines
+  } else if ((idx <<= 1) == size) {
+    index = 1; // 4 cache lines
+  } else if ((idx <<= 2) == size) {
+    index = 2; // 16 cache lines
+  } else if ((idx <<= 2) == size) {
+    index = 3; // 64 cache lines
+  } else {
+    KMP_DEBUG_ASSERT(size > DCACHE_LINE * 64);
+    goto free_call; // 65 or more cache lines ( > 8KB )
+  }
+
+  __kmp_free_list_push(this_thr, ptr, index);
   goto end;
 
 free_call:
@@ -1850,12 +2699,25 @@ end:
 
 } // func __kmp_fast_free
 
+// Hand the objects of other threads' slabs freed by this thread back to their
+// owners now, rather than at the next remote free of the same size class.
+// Called at barriers, so that no batch is stranded while the thread is idle.
+void __kmp_flush_fast_memory(kmp_info_t *this_thr) {
+  if (__kmp_fast_mem_engine == fast_mem_slab)
+    __kmp_slab_flush_all(this_thr);
+}
+
 // Initialize the thread free lists related to fast memory
 // Only do this when a thread is initially created.
 void __kmp_initialize_fast_memory(kmp_info_t *this_thr) {
   KE_TRACE(10, ("__kmp_initialize_fast_memory: Called from th %p\n", this_thr));
 
   memset(this_thr->th.th_free_lists, 0, NUM_LISTS * sizeof(kmp_free_list_t));
+  memset(this_thr->th.th_slab_classes, 0,
+         KMP_SLAB_CLASSES * sizeof(kmp_slab_class_t));
+  this_thr->th.th_slab_owner = NULL;
+  this_thr->th.th_slab_reserve = NULL;
+  this_thr->th.th_slab_reserve_size = 0;
 }
 
 // Free the memory in the thread free lists related to fast memory
@@ -1869,6 +2731,8 @@ void __kmp_free_fast_memory(kmp_info_t *th) {
   KE_TRACE(
       5, ("__kmp_free_fast_memory: Called T#%d\n", __kmp_gtid_from_thread(th)));
 
+  __kmp_slab_release(th);
+
   __kmp_bget_dequeue(th); // Release any queued buffers
 
   // Dig through free lists and extract all allocated blocks
@@ -1234,6 +1234,9 @@ int __kmp_barrier(enum barrier_type bt, int gtid, int is_split,
 
   KA_TRACE(15, ("__kmp_barrier: T#%d(%d:%d) has arrived\n", gtid,
                 __kmp_team_from_gtid(gtid)->t.t_id, __kmp_tid_from_gtid(gtid)));
+#if USE_FAST_MEMORY
+  __kmp_flush_fast_memory(this_thr);
+#endif
 
   ANNOTATE_BARRIER_BEGIN(&team->t.t_bar);
 #if OMPT_SUPPORT
@@ -1594,6 +1597,9 @@ void __kmp_join_barrier(int gtid) {
   KMP_DEBUG_ASSERT(this_thr == team->t.t_threads[tid]);
   KA_TRACE(10, ("__kmp_join_barrier: T#%d(%d:%d) arrived at join barrier\n",
                 gtid, team_id, tid));
+#if USE_FAST_MEMORY
+  __kmp_flush_fast_memory(this_thr);
+#endif
 
   ANNOTATE_BARRIER_BEGIN(&team->t.t_bar);
 #if OMPT_SUPPORT
@@ -1794,6 +1800,11 @@ void __kmp_fork_barrier(int gtid, int tid) {
 
   KA_TRACE(10, ("__kmp_fork_barrier: T#%d(%d:%d) has arrived\n", gtid,
                 (team != NULL) ? team->t.t_id : -1, tid));
+#if USE_FAST_MEMORY
+  // Workers go idle here; hand back what tasks freed in the join barrier
+  if (!KMP_MASTER_TID(tid))
+    __kmp_flush_fast_memory(this_thr);
+#endif
 
   // th_team pointer only valid for master thread here
   if (KMP_MASTER_TID(tid)) {
@@ -1931,9 +1942,20 @@ void __kmp_fork_barrier(int gtid, int tid) {
   if (proc_bind == proc_bind_intel) {
 #endif
 #if KMP_AFFINITY_SUPPORTED
+#if KMP_OS_LINUX && OMP_40_ENABLED
+    // The places were rebuilt after a cgroup change
+    if (this_thr->th.th_current_place == KMP_PLACE_UNDEFINED &&
+        KMP_AFFINITY_CAPABLE()) {
+      __kmp_affinity_set_init_mask(gtid, FALSE);
+      __kmp_move_thread_local(this_thr);
+    }
+#endif
     // Call dynamic affinity settings
     if (__kmp_affinity_type == affinity_balanced && team->t.t_size_changed) {
       __kmp_balanced_affinity(tid, team->t.t_nproc);
+#if KMP_OS_LINUX
+      __kmp_move_thread_local(this_thr);
+#endif
     }
 #endif // KMP_AFFINITY_SUPPORTED
 #if OMP_40_ENABLED && KMP_AFFINITY_SUPPORTED
@@ -1944,6 +1966,9 @@ void __kmp_fork_barrier(int gtid, int tid) {
                      this_thr->th.th_current_place));
     } else {
       __kmp_affinity_set_place(gtid);
+#if KMP_OS_LINUX
+      __kmp_move_thread_local(this_thr);
+#endif
     }
   }
 #endif
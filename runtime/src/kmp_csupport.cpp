@@ -1077,6 +1077,7 @@ void __kmpc_critical(ident_t *loc, kmp_int32 global_tid,
   // TODO: add THR_OVHD_STATE
 
   KMP_CHECK_USER_LOCK_INIT();
+  kmp_uint64 prof_start = KMP_LOCK_PROFILE_START(global_tid);
 
   if ((__kmp_user_lock_kind == lk_tas) &&
       (sizeof(lck->tas.lk.poll) <= OMP_CRITICAL_SIZE)) {
@@ -1106,6 +1107,7 @@ void __kmpc_critical(ident_t *loc, kmp_int32 global_tid,
   // Value of 'crit' should be good for using as a critical_id of the critical
   // section directive.
   __kmp_acquire_user_lock_with_checks(lck, global_tid);
+  KMP_LOCK_PROFILE_ACQUIRED(crit, loc, kmp_lock_profile_critical, prof_start);
 
 #if USE_ITT_BUILD
   __kmp_itt_critical_acquired(lck);
@@ -1139,6 +1141,8 @@ static __forceinline kmp_dyna_lockseq_t __kmp_map_hint_to_lock(uintptr_t hint) {
     return KMP_CPUINFO_RTM ? KMP_TSX_LOCK(rtm) : __kmp_user_lock_seq;
   if (hint & kmp_lock_hint_adaptive)
     return KMP_CPUINFO_RTM ? KMP_TSX_LOCK(adaptive) : __kmp_user_lock_seq;
+  if (hint & kmp_lock_hint_cohort)
+    return lockseq_cohort;
 
   // Rule out conflicting hints first by returning the default lock
   if ((hint & omp_lock_hint_contended) && (hint & omp_lock_hint_uncontended))
@@ -1155,9 +1159,10 @@ static __forceinline kmp_dyna_lockseq_t __kmp_map_hint_to_lock(uintptr_t hint) {
   if ((hint & omp_lock_hint_uncontended) && !(hint & omp_lock_hint_speculative))
     return lockseq_tas;
 
-  // HLE lock for speculation
+  // Elide the lock with RTM where available, as the rtm lock stops speculating
+  // by itself when it does not pay off; HLE otherwise
   if (hint & omp_lock_hint_speculative)
-    return KMP_TSX_LOCK(hle);
+    return KMP_CPUINFO_RTM ? KMP_TSX_LOCK(rtm) : KMP_TSX_LOCK(hle);
 
   return __kmp_user_lock_seq;
 }
@@ -1182,6 +1187,7 @@ void __kmpc_critical_with_hint(ident_t *loc, kmp_int32 global_tid,
 
   KC_TRACE(10, ("__kmpc_critical: called T#%d\n", global_tid));
 
+  kmp_uint64 prof_start = KMP_LOCK_PROFILE_START(global_tid);
   kmp_dyna_lock_t *lk = (kmp_dyna_lock_t *)crit;
   // Check if it is initialized.
   if (*lk == 0) {
@@ -1206,11 +1212,12 @@ void __kmpc_critical_with_hint(ident_t *loc, kmp_int32 global_tid,
     __kmp_itt_critical_acquiring(lck);
 #endif
 #if KMP_USE_INLINED_TAS
-    if (__kmp_user_lock_seq == lockseq_tas && !__kmp_env_consistency_check) {
+    if (KMP_EXTRACT_D_TAG(lk) == locktag_tas && !__kmp_env_consistency_check) {
       KMP_ACQUIRE_TAS_LOCK(lck, global_tid);
     } else
 #elif KMP_USE_INLINED_FUTEX
-    if (__kmp_user_lock_seq == lockseq_futex && !__kmp_env_consistency_check) {
+    if (KMP_EXTRACT_D_TAG(lk) == locktag_futex &&
+        !__kmp_env_consistency_check) {
       KMP_ACQUIRE_FUTEX_LOCK(lck, global_tid);
     } else
 #endif
@@ -1229,6 +1236,7 @@ void __kmpc_critical_with_hint(ident_t *loc, kmp_int32 global_tid,
 #endif
     KMP_I_LOCK_FUNC(ilk, set)(lck, global_tid);
   }
+  KMP_LOCK_PROFILE_ACQUIRED(crit, loc, kmp_lock_profile_critical, prof_start);
 
 #if USE_ITT_BUILD
   __kmp_itt_critical_acquired(lck);
@@ -1256,7 +1264,10 @@ void __kmpc_end_critical(ident_t *loc, kmp_int32 global_tid,
   KC_TRACE(10, ("__kmpc_end_critical: called T#%d\n", global_tid));
 
 #if KMP_USE_DYNAMIC_LOCK
-  if (KMP_IS_D_LOCK(__kmp_user_lock_seq)) {
+  // A hint may have given this critical section a different kind of lock than
+  // the default one, so look at the lock itself.
+  int locktag = KMP_EXTRACT_D_TAG(crit);
+  if (locktag) {
     lck = (kmp_user_lock_p)crit;
     KMP_ASSERT(lck != NULL);
     if (__kmp_env_consistency_check) {
@@ -1266,11 +1277,11 @@ void __kmpc_end_critical(ident_t *loc, kmp_int32 global_tid,
     __kmp_itt_critical_releasing(lck);
 #endif
 #if KMP_USE_INLINED_TAS
-    if (__kmp_user_lock_seq == lockseq_tas && !__kmp_env_consistency_check) {
+    if (locktag == locktag_tas && !__kmp_env_consistency_check) {
       KMP_RELEASE_TAS_LOCK(lck, global_tid);
     } else
 #elif KMP_USE_INLINED_FUTEX
-    if (__kmp_user_lock_seq == lockseq_futex && !__kmp_env_consistency_check) {
+    if (locktag == locktag_futex && !__kmp_env_consistency_check) {
       KMP_RELEASE_FUTEX_LOCK(lck, global_tid);
     } else
 #endif
@@ -1331,6 +1342,204 @@ void __kmpc_end_critical(ident_t *loc, kmp_int32 global_tid,
   KA_TRACE(15, ("__kmpc_end_critical: done T#%d\n", global_tid));
 }
 
+// Delegated critical sections (flat combining).
+// Each critical section entered through __kmpc_critical_delegate gets a
+// publication record per thread. A thread publishes its body in its record,
+// then either waits for another thread to run it, or becomes the combiner:
+// the combiner takes the critical section's lock and runs every published
+// body, its own included, so that the protected data stays in its cache.
+// Holding the lock keeps delegated bodies mutually exclusive with plain
+// __kmpc_critical entries of the same critical section.
+
+#define KMP_DELEGATE_HASH 256 // must be a power of 2
+#define KMP_DELEGATE_PASSES 3 // scans per combining round, to bound latency
+
+typedef struct KMP_ALIGN_CACHE kmp_delegate_record {
+  void (*volatile body)(void *); // published body, NULL once it has run
+  void *data;
+} kmp_delegate_record_t;
+
+typedef struct kmp_critical_delegate {
+  kmp_critical_name *crit;
+  struct kmp_critical_delegate *next; // hash chain
+  kmp_int32 num_records; // capacity of records, in gtids
+  kmp_delegate_record_t *records;
+  KMP_ALIGN_CACHE volatile kmp_int32 combining; // a thread is combining
+  volatile kmp_int32 num_used; // records in use are below this gtid
+} kmp_critical_delegate_t;
+
+static kmp_critical_delegate_t *volatile
+    __kmp_delegate_table[KMP_DELEGATE_HASH];
+static kmp_bootstrap_lock_t __kmp_delegate_lock =
+    KMP_BOOTSTRAP_LOCK_INITIALIZER(__kmp_delegate_lock);
+
+static kmp_critical_delegate_t *
+__kmp_find_critical_delegate(kmp_critical_name *crit) {
+  kmp_uint32 h =
+      (kmp_uint32)(((kmp_uintptr_t)crit) >> 5) & (KMP_DELEGATE_HASH - 1);
+  kmp_critical_delegate_t *d;
+
+  for (d = (kmp_critical_delegate_t *)TCR_PTR(__kmp_delegate_table[h]);
+       d != NULL; d = d->next) {
+    if (d->crit == crit)
+      return d;
+  }
+
+  __kmp_acquire_bootstrap_lock(&__kmp_delegate_lock);
+  for (d = __kmp_delegate_table[h]; d != NULL; d = d->next) {
+    if (d->crit == crit)
+      break;
+  }
+  if (d == NULL) {
+    d = (kmp_critical_delegate_t *)__kmp_allocate(
+        sizeof(kmp_critical_delegate_t));
+    d->crit = crit;
+    d->num_records = __kmp_threads_capacity;
+    d->records = (kmp_delegate_record_t *)__kmp_allocate(
+        d->num_records * sizeof(kmp_delegate_record_t));
+    d->next = __kmp_delegate_table[h];
+    KMP_MB();
+    TCW_PTR(__kmp_delegate_table[h], d);
+  }
+  __kmp_release_bootstrap_lock(&__kmp_delegate_lock);
+  return d;
+}
+
+// Runs the published bodies with the critical section's lock held.
+static void __kmp_combine_critical(ident_t *loc, kmp_int32 gtid,
+                                   kmp_critical_name *crit,
+                                   kmp_critical_delegate_t *d) {
+  int pass, found;
+
+  __kmpc_critical(loc, gtid, crit);
+  for (pass = 0; pass < KMP_DELEGATE_PASSES; pass++) {
+    kmp_int32 i, n = TCR_4(d->num_used);
+    found = 0;
+    for (i = 0; i < n; i++) {
+      kmp_delegate_record_t *r = &d->records[i];
+      void (*body)(void *) = r->body;
+      if (body != NULL) {
+        KMP_MB(); // read data after body
+        body(r->data);
+        KMP_MB();
+        TCW_PTR(r->body, NULL);
+        if (i != gtid)
+          KMP_COUNT_BLOCK(OMP_CRITICAL_delegated);
+        found++;
+      }
+    }
+    if (found == 0)
+      break;
+  }
+  __kmpc_end_critical(loc, gtid, crit);
+}
+
+/*!
+@ingroup SYNCHRONIZATION
+@param loc  source location information.
+@param global_tid  global thread number.
+@param crit identity of the critical section.
+@param body outlined body of the critical section.
+@param data argument for body, typically the addresses of the shared variables
+it uses.
+
+Execute body under a `critical` construct, possibly on another thread of the
+process. This suits short bodies that only update shared data: the thread that
+holds the critical section runs the bodies of the threads waiting for it, so
+the data does not move between their caches. The body must not depend on the
+thread that runs it. Delegation is turned off with KMP_CRITICAL_DELEGATE=false,
+and the body then runs in an ordinary critical section.
+*/
+void __kmpc_critical_delegate(ident_t *loc, kmp_int32 global_tid,
+                              kmp_critical_name *crit, void (*body)(void *),
+                              void *data) {
+  kmp_critical_delegate_t *d;
+  kmp_delegate_record_t *r;
+  kmp_int32 used;
+
+  KC_TRACE(10, ("__kmpc_critical_delegate: called T#%d\n", global_tid));
+
+  // Run the body in place if it cannot be delegated. This includes the
+  // consistency checks, which need every thread to enter the construct.
+  if (!__kmp_critical_delegate || __kmp_env_consistency_check ||
+      (d = __kmp_find_critical_delegate(crit))->num_records <= global_tid) {
+    __kmpc_critical(loc, global_tid, crit);
+    body(data);
+    __kmpc_end_critical(loc, global_tid, crit);
+    return;
+  }
+
+  while ((used = TCR_4(d->num_used)) <= global_tid &&
+         !KMP_COMPARE_AND_STORE_ACQ32(&d->num_used, used, global_tid + 1))
+    ;
+
+  r = &d->records[global_tid];
+  r->data = data;
+  KMP_MB();
+  TCW_PTR(r->body, body);
+
+  kmp_uint32 spins;
+#if KMP_USE_MONITOR
+  kmp_uint32 hibernate = 0;
+#else
+  kmp_uint64 hibernate = 0;
+  kmp_uint32 polls = 0;
+#endif
+  KMP_INIT_YIELD(spins);
+  while (TCR_PTR(r->body) != NULL) {
+    if (TCR_4(d->combining) == 0 &&
+        KMP_COMPARE_AND_STORE_ACQ32(&d->combining, 0, 1)) {
+      __kmp_combine_critical(loc, global_tid, crit, d);
+      TCW_4(d->combining, 0);
+      // Our own record was published before we started, so it has run.
+      break;
+    }
+    if (TCR_4(__kmp_nth) >
+        (__kmp_avail_proc ? __kmp_avail_proc : __kmp_xproc)) {
+      KMP_YIELD(TRUE);
+    } else {
+      KMP_YIELD_SPIN(spins);
+    }
+
+    if (__kmp_dflt_blocktime == KMP_MAX_BLOCKTIME)
+      continue;
+#if KMP_USE_MONITOR
+    if (hibernate == 0)
+      hibernate = TCR_4(__kmp_global.g.g_time.dt.t_value) +
+                  __kmp_threads[global_tid]->th.th_team_bt_intervals + 1;
+    if (TCR_4(__kmp_global.g.g_time.dt.t_value) < hibernate)
+      continue;
+#else
+    if (hibernate == 0)
+      hibernate = KMP_NOW() + KMP_BLOCKTIME_INTERVAL();
+    if (KMP_BLOCKING(hibernate, polls++))
+      continue;
+#endif
+    // Past the blocktime, stop polling the record and wait for the lock like a
+    // plain entry, which sleeps if the lock kind does. Whoever gets the lock
+    // runs the published bodies, so ours has run once we hold it.
+    __kmp_combine_critical(loc, global_tid, crit, d);
+    break;
+  }
+  KMP_MB();
+
+  KA_TRACE(15, ("__kmpc_critical_delegate: done T#%d\n", global_tid));
+}
+
+void __kmp_cleanup_critical_delegates(void) {
+  int i;
+  for (i = 0; i < KMP_DELEGATE_HASH; i++) {
+    kmp_critical_delegate_t *d = __kmp_delegate_table[i];
+    while (d != NULL) {
+      kmp_critical_delegate_t *next = d->next;
+      __kmp_free(d->records);
+      __kmp_free(d);
+      d = next;
+    }
+    __kmp_delegate_table[i] = NULL;
+  }
+}
+
 /*!
 @ingroup SYNCHRONIZATION
 @param loc source location information
@@ -1611,6 +1820,16 @@ void kmpc_set_disp_num_buffers(int arg) {
     __kmp_dispatch_num_buffers = arg;
 }
 
+#if OMP_50_ENABLED
+void *omp_alloc(size_t size, omp_allocator_handle_t allocator) {
+  return __kmpc_alloc(__kmp_entry_gtid(), size, allocator);
+}
+
+void omp_free(void *ptr, omp_allocator_handle_t allocator) {
+  __kmpc_free(__kmp_entry_gtid(), ptr, allocator);
+}
+#endif
+
 int kmpc_set_affinity_mask_proc(int proc, void **mask) {
 #if defined(KMP_STUB) || !KMP_AFFINITY_SUPPORTED
   return -1;
@@ -1779,6 +1998,14 @@ __kmp_init_nest_lock_with_hint(ident_t *loc, void **lock,
 #endif
   switch (seq) {
   case lockseq_tas:
+    if (KMP_USE_INLINED_NESTED_TAS && !__kmp_env_consistency_check) {
+      // Direct tas lock word followed by the depth, see __kmpc_set_nest_lock
+      __kmp_init_nested_tas_lock((kmp_tas_lock_t *)lock);
+#if USE_ITT_BUILD
+      __kmp_itt_lock_creating((kmp_user_lock_p)lock, NULL);
+#endif
+      return;
+    }
     seq = lockseq_nested_tas;
     break;
 #if KMP_USE_FUTEX
@@ -1999,6 +2226,13 @@ void __kmpc_destroy_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 void __kmpc_destroy_nest_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 #if KMP_USE_DYNAMIC_LOCK
 
+  if (KMP_EXTRACT_D_TAG(user_lock) == locktag_tas) { // inlined nested tas
+#if USE_ITT_BUILD
+    __kmp_itt_lock_destroyed((kmp_user_lock_p)user_lock);
+#endif
+    __kmp_destroy_nested_tas_lock((kmp_tas_lock_t *)user_lock);
+    return;
+  }
 #if USE_ITT_BUILD
   kmp_indirect_lock_t *ilk = KMP_LOOKUP_I_LOCK(user_lock);
   __kmp_itt_lock_destroyed(ilk->lock);
@@ -2060,6 +2294,7 @@ void __kmpc_set_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
   KMP_COUNT_BLOCK(OMP_set_lock);
 #if KMP_USE_DYNAMIC_LOCK
   int tag = KMP_EXTRACT_D_TAG(user_lock);
+  kmp_uint64 prof_start = KMP_LOCK_PROFILE_START(gtid);
 #if USE_ITT_BUILD
   __kmp_itt_lock_acquiring(
       (kmp_user_lock_p)
@@ -2077,6 +2312,8 @@ void __kmpc_set_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
   {
     __kmp_direct_set[tag]((kmp_dyna_lock_t *)user_lock, gtid);
   }
+  KMP_LOCK_PROFILE_ACQUIRED(user_lock, loc, kmp_lock_profile_lock,
+                              prof_start);
 #if USE_ITT_BUILD
   __kmp_itt_lock_acquired((kmp_user_lock_p)user_lock);
 #endif
@@ -2084,6 +2321,7 @@ void __kmpc_set_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 #else // KMP_USE_DYNAMIC_LOCK
 
   kmp_user_lock_p lck;
+  kmp_uint64 prof_start = KMP_LOCK_PROFILE_START(gtid);
 
   if ((__kmp_user_lock_kind == lk_tas) &&
       (sizeof(lck->tas.lk.poll) <= OMP_LOCK_T_SIZE)) {
@@ -2104,6 +2342,8 @@ void __kmpc_set_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 #endif /* USE_ITT_BUILD */
 
   ACQUIRE_LOCK(lck, gtid);
+  KMP_LOCK_PROFILE_ACQUIRED(user_lock, loc, kmp_lock_profile_lock,
+                              prof_start);
 
 #if USE_ITT_BUILD
   __kmp_itt_lock_acquired(lck);
@@ -2120,11 +2360,49 @@ void __kmpc_set_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 
 void __kmpc_set_nest_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 #if KMP_USE_DYNAMIC_LOCK
+#if KMP_USE_INLINED_TAS
+  // Nest locks carry a direct lock tag only when they are inlined nested tas
+  // locks (see __kmp_init_nest_lock_with_hint).
+  if (KMP_EXTRACT_D_TAG(user_lock) == locktag_tas) {
+    kmp_tas_lock_t *l = (kmp_tas_lock_t *)user_lock;
+    if (l->lk.poll == KMP_LOCK_BUSY(gtid + 1, tas)) {
+      l->lk.depth_locked += 1;
+#if OMPT_SUPPORT && OMPT_TRACE
+      if (ompt_enabled &&
+          ompt_callbacks.ompt_callback(ompt_event_acquired_nest_lock_next))
+        ompt_callbacks.ompt_callback(ompt_event_acquired_nest_lock_next)(
+            (uint64_t)user_lock);
+#endif
+      return;
+    }
+    kmp_uint64 prof_start = KMP_LOCK_PROFILE_START(gtid);
+#if USE_ITT_BUILD
+    __kmp_itt_lock_acquiring((kmp_user_lock_p)user_lock);
+#endif
+    KMP_ACQUIRE_TAS_LOCK(user_lock, gtid);
+    l->lk.depth_locked = 1;
+    KMP_LOCK_PROFILE_ACQUIRED(user_lock, loc, kmp_lock_profile_nest_lock,
+                                prof_start);
+#if USE_ITT_BUILD
+    __kmp_itt_lock_acquired((kmp_user_lock_p)user_lock);
+#endif
+#if OMPT_SUPPORT && OMPT_TRACE
+    if (ompt_enabled &&
+        ompt_callbacks.ompt_callback(ompt_event_acquired_nest_lock_first))
+      ompt_callbacks.ompt_callback(ompt_event_acquired_nest_lock_first)(
+          (uint64_t)user_lock);
+#endif
+    return;
+  }
+#endif // KMP_USE_INLINED_TAS
+  kmp_uint64 prof_start = KMP_LOCK_PROFILE_START(gtid);
 
 #if USE_ITT_BUILD
   __kmp_itt_lock_acquiring((kmp_user_lock_p)user_lock);
 #endif
   KMP_D_LOCK_FUNC(user_lock, set)((kmp_dyna_lock_t *)user_lock, gtid);
+  KMP_LOCK_PROFILE_ACQUIRED(user_lock, loc, kmp_lock_profile_nest_lock,
+                              prof_start);
 #if USE_ITT_BUILD
   __kmp_itt_lock_acquired((kmp_user_lock_p)user_lock);
 #endif
@@ -2138,6 +2416,7 @@ void __kmpc_set_nest_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 #else // KMP_USE_DYNAMIC_LOCK
   int acquire_status;
   kmp_user_lock_p lck;
+  kmp_uint64 prof_start = KMP_LOCK_PROFILE_START(gtid);
 
   if ((__kmp_user_lock_kind == lk_tas) &&
       (sizeof(lck->tas.lk.poll) + sizeof(lck->tas.lk.depth_locked) <=
@@ -2160,6 +2439,8 @@ void __kmpc_set_nest_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 #endif /* USE_ITT_BUILD */
 
   ACQUIRE_NESTED_LOCK(lck, gtid, &acquire_status);
+  KMP_LOCK_PROFILE_ACQUIRED(user_lock, loc, kmp_lock_profile_nest_lock,
+                              prof_start);
 
 #if USE_ITT_BUILD
   __kmp_itt_lock_acquired(lck);
@@ -2253,6 +2534,32 @@ void __kmpc_unset_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 void __kmpc_unset_nest_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 #if KMP_USE_DYNAMIC_LOCK
 
+#if KMP_USE_INLINED_TAS
+  if (KMP_EXTRACT_D_TAG(user_lock) == locktag_tas) { // inlined nested tas
+    kmp_tas_lock_t *l = (kmp_tas_lock_t *)user_lock;
+#if USE_ITT_BUILD
+    __kmp_itt_lock_releasing((kmp_user_lock_p)user_lock);
+#endif
+    // gtid is unused here, omp_unset_nest_lock passes KMP_GTID_UNKNOWN
+    if (--(l->lk.depth_locked) == 0) {
+      KMP_RELEASE_TAS_LOCK(user_lock, gtid);
+#if OMPT_SUPPORT && OMPT_BLAME
+      if (ompt_enabled &&
+          ompt_callbacks.ompt_callback(ompt_event_release_nest_lock_last))
+        ompt_callbacks.ompt_callback(ompt_event_release_nest_lock_last)(
+            (uint64_t)user_lock);
+#endif
+    } else {
+#if OMPT_SUPPORT && OMPT_BLAME
+      if (ompt_enabled &&
+          ompt_callbacks.ompt_callback(ompt_event_release_nest_lock_prev))
+        ompt_callbacks.ompt_callback(ompt_event_release_nest_lock_prev)(
+            (uint64_t)user_lock);
+#endif
+    }
+    return;
+  }
+#endif // KMP_USE_INLINED_TAS
 #if USE_ITT_BUILD
   __kmp_itt_lock_releasing((kmp_user_lock_p)user_lock);
 #endif
@@ -2394,6 +2701,26 @@ int __kmpc_test_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 int __kmpc_test_nest_lock(ident_t *loc, kmp_int32 gtid, void **user_lock) {
 #if KMP_USE_DYNAMIC_LOCK
   int rc;
+#if KMP_USE_INLINED_TAS
+  if (KMP_EXTRACT_D_TAG(user_lock) == locktag_tas) { // inlined nested tas
+    kmp_tas_lock_t *l = (kmp_tas_lock_t *)user_lock;
+    if (l->lk.poll == KMP_LOCK_BUSY(gtid + 1, tas))
+      return ++(l->lk.depth_locked);
+#if USE_ITT_BUILD
+    __kmp_itt_lock_acquiring((kmp_user_lock_p)user_lock);
+#endif
+    KMP_TEST_TAS_LOCK(user_lock, gtid, rc);
+    if (rc) {
+      l->lk.depth_locked = 1;
+#if USE_ITT_BUILD
+      __kmp_itt_lock_acquired((kmp_user_lock_p)user_lock);
+    } else {
+      __kmp_itt_lock_cancelled((kmp_user_lock_p)user_lock);
+#endif
+    }
+    return rc;
+  }
+#endif // KMP_USE_INLINED_TAS
 #if USE_ITT_BUILD
   __kmp_itt_lock_acquiring((kmp_user_lock_p)user_lock);
 #endif
@@ -3013,7 +3340,7 @@ e.g. for(i=2;i<9;i+=2) lo=2, up=8, st=2.
 void __kmpc_doacross_init(ident_t *loc, int gtid, int num_dims,
                           struct kmp_dim *dims) {
   int j, idx;
-  kmp_int64 last, trace_count;
+  kmp_int64 last, trace_count, window;
   kmp_info_t *th = __kmp_threads[gtid];
   kmp_team_t *team = th->th.th_team;
   kmp_uint32 *flags;
@@ -3038,8 +3365,10 @@ void __kmpc_doacross_init(ident_t *loc, int gtid, int num_dims,
 
   // Save bounds info into allocated private buffer
   KMP_DEBUG_ASSERT(pr_buf->th_doacross_info == NULL);
+  // The extra trailing element keeps the size of the sliding window of flag
+  // words (0 if the dense bit-vector is used).
   pr_buf->th_doacross_info = (kmp_int64 *)__kmp_thread_malloc(
-      th, sizeof(kmp_int64) * (4 * num_dims + 1));
+      th, sizeof(kmp_int64) * (4 * num_dims + 2));
   KMP_DEBUG_ASSERT(pr_buf->th_doacross_info != NULL);
   pr_buf->th_doacross_info[0] =
       (kmp_int64)num_dims; // first element is number of dimensions
@@ -3088,6 +3417,26 @@ void __kmpc_doacross_init(ident_t *loc, int gtid, int num_dims,
   }
   KMP_DEBUG_ASSERT(trace_count > 0);
 
+  // Choose the representation of the iteration flags. The dense bit-vector
+  // needs one bit per iteration of the collapsed nest, which is prohibitive for
+  // huge iteration spaces. As sinks always refer to lexicographically earlier
+  // iterations, only a window of flag words around the wavefront is needed;
+  // it is sized to hold a couple of outer iterations per thread.
+  window = 0;
+  if ((kmp_uint64)trace_count / 8 + 8 > __kmp_doacross_dense_limit) {
+    kmp_int64 inner = 1; // iterations per outer loop iteration
+    for (j = 1; j < num_dims; ++j)
+      inner *= pr_buf->th_doacross_info[4 * j + 1];
+    kmp_int64 need = (2 * th->th.th_team_nproc * inner) / 32 + 2;
+    window = KMP_MIN_DOACROSS_WINDOW;
+    while (window < need)
+      window <<= 1;
+    if ((kmp_uint64)window * sizeof(kmp_uint64) >=
+        (kmp_uint64)trace_count / 8 + 8)
+      window = 0; // window would not be smaller than the dense vector
+  }
+  pr_buf->th_doacross_info[4 * num_dims + 1] = window;
+
   // Check if shared buffer is not occupied by other loop (idx -
   // __kmp_dispatch_num_buffers)
   if (idx != sh_buf->doacross_buf_idx) {
@@ -3101,8 +3450,13 @@ void __kmpc_doacross_init(ident_t *loc, int gtid, int num_dims,
       (kmp_int64 *)&sh_buf->doacross_flags, NULL, (kmp_int64)1);
   if (flags == NULL) {
     // we are the first thread, allocate the array of flags
-    kmp_int64 size =
-        trace_count / 8 + 8; // in bytes, use single bit per iteration
+    kmp_int64 size;
+    if (window) { // window of 64-bit slots: generation << 32 | 32 flags,
+      // followed by the pointer to the dense fallback vector
+      size = (window + 1) * sizeof(kmp_uint64);
+    } else {
+      size = trace_count / 8 + 8; // in bytes, use single bit per iteration
+    }
     sh_buf->doacross_flags = (kmp_uint32 *)__kmp_thread_calloc(th, size, 1);
   } else if ((kmp_int64)flags == 1) {
     // initialization is still in progress, need to wait
@@ -3118,10 +3472,89 @@ void __kmpc_doacross_init(ident_t *loc, int gtid, int num_dims,
   KA_TRACE(20, ("__kmpc_doacross_init() exit: T#%d\n", gtid));
 }
 
+// Pause between polls of doacross flags: spin while within the blocktime
+// interval, then give the processor away on every poll so that threads stalled
+// behind a slow wavefront do not starve the threads they are waiting for.
+static inline void __kmp_doacross_pause(kmp_uint32 *spins, kmp_uint64 *goal,
+                                        kmp_uint32 *polls) {
+  if (__kmp_dflt_blocktime == KMP_MAX_BLOCKTIME) {
+    KMP_YIELD_SPIN(*spins);
+    return;
+  }
+  if (TCR_4(__kmp_nth) <= __kmp_avail_proc) {
+#if KMP_USE_MONITOR
+    KMP_YIELD_SPIN(*spins);
+    return;
+#else
+    if (*goal == 0)
+      *goal = KMP_NOW() + KMP_BLOCKTIME_INTERVAL();
+    if (KMP_BLOCKING(*goal, (*polls)++)) {
+      KMP_YIELD_SPIN(*spins);
+      return;
+    }
+#endif
+  }
+  KMP_YIELD(TRUE);
+}
+
+// How long a post waits on a window slot that does not move before it gives up
+// on the window. Besides a skipped post, a slot is held back by a thread that
+// owes it a post but does not get the processor; waiters past the blocktime
+// yield it to that thread, so allow a few blocktimes for it to run.
+static inline kmp_uint64 __kmp_doacross_stall_nsec() {
+  kmp_uint64 stall = KMP_DOACROSS_WINDOW_STALL;
+  if (__kmp_dflt_blocktime != KMP_MAX_BLOCKTIME) {
+    kmp_uint64 blocktimes =
+        (kmp_uint64)__kmp_dflt_blocktime * 4 *
+        (KMP_NSEC_PER_SEC / KMP_BLOCKTIME_MULTIPLIER);
+    if (blocktimes > stall)
+      stall = blocktimes;
+  }
+  return stall;
+}
+
+// A post into the window has to wait until every iteration of the previous
+// generation of its slot has been posted. An iteration may legally skip its
+// depend(source) though, and that wait would then never end; the posts which
+// waited too long go to a dense bit-vector instead, allocated on first use
+// and kept in the word behind the window.
+static volatile kmp_uint32 *__kmp_doacross_dense(kmp_info_t *th,
+                                                 kmp_disp_t *pr_buf,
+                                                 kmp_int64 window,
+                                                 bool allocate) {
+  volatile kmp_int64 *ptr =
+      (volatile kmp_int64 *)pr_buf->th_doacross_flags + window;
+  kmp_int64 dense = *ptr;
+  if (dense > 1 || !allocate)
+    return dense > 1 ? (volatile kmp_uint32 *)dense : NULL;
+  if (KMP_COMPARE_AND_STORE_ACQ64(ptr, 0, 1)) {
+    // same trip count as in __kmpc_doacross_init
+    kmp_int64 *info = pr_buf->th_doacross_info;
+    kmp_int64 num_dims = info[0], trace_count, j;
+    if (info[4] > 0)
+      trace_count = (kmp_uint64)(info[3] - info[2]) / info[4] + 1;
+    else
+      trace_count = (kmp_uint64)(info[2] - info[3]) / (-info[4]) + 1;
+    for (j = 1; j < num_dims; ++j)
+      trace_count *= info[4 * j + 1];
+    KA_TRACE(20, ("__kmp_doacross_dense: T#%d falls back to dense flags\n",
+                  __kmp_gtid_from_thread(th)));
+    dense = (kmp_int64)__kmp_thread_calloc(th, trace_count / 8 + 8, 1);
+    KMP_MB();
+    *ptr = dense;
+    return (volatile kmp_uint32 *)dense;
+  }
+  while ((dense = *ptr) == 1)
+    KMP_YIELD(TRUE);
+  return (volatile kmp_uint32 *)dense;
+}
+
 void __kmpc_doacross_wait(ident_t *loc, int gtid, long long *vec) {
   kmp_int32 shft, num_dims, i;
-  kmp_uint32 flag;
+  kmp_uint32 flag, spins, polls = 0;
+  kmp_uint64 goal = 0;
   kmp_int64 iter_number; // iteration number of "collapsed" loop nest
+  kmp_int64 window; // number of slots in the flags window, 0 if dense
   kmp_info_t *th = __kmp_threads[gtid];
   kmp_team_t *team = th->th.th_team;
   kmp_disp_t *pr_buf;
@@ -3202,8 +3635,29 @@ void __kmpc_doacross_wait(ident_t *loc, int gtid, long long *vec) {
   shft = iter_number % 32; // use 32-bit granularity
   iter_number >>= 5; // divided by 32
   flag = 1 << shft;
-  while ((flag & pr_buf->th_doacross_flags[iter_number]) == 0) {
-    KMP_YIELD(TRUE);
+  KMP_INIT_YIELD(spins);
+  window = pr_buf->th_doacross_info[4 * num_dims + 1];
+  if (window) {
+    // The slot keeps the word's generation in the upper half; a newer
+    // generation means every iteration of our word has already been posted.
+    volatile kmp_uint64 *slot =
+        (volatile kmp_uint64 *)pr_buf->th_doacross_flags +
+        (iter_number & (window - 1));
+    kmp_uint64 gen = (kmp_uint64)iter_number / window;
+    for (;;) {
+      kmp_uint64 val = *slot;
+      volatile kmp_uint32 *dense;
+      if ((val >> 32) > gen || ((val >> 32) == gen && (val & flag)))
+        break;
+      dense = __kmp_doacross_dense(th, pr_buf, window, false);
+      if (dense && (dense[iter_number] & flag))
+        break; // posted after the fallback
+      __kmp_doacross_pause(&spins, &goal, &polls);
+    }
+  } else {
+    while ((flag & pr_buf->th_doacross_flags[iter_number]) == 0) {
+      __kmp_doacross_pause(&spins, &goal, &polls);
+    }
   }
   KA_TRACE(20,
            ("__kmpc_doacross_wait() exit: T#%d wait for iter %lld completed\n",
@@ -3214,6 +3668,7 @@ void __kmpc_doacross_post(ident_t *loc, int gtid, long long *vec) {
   kmp_int32 shft, num_dims, i;
   kmp_uint32 flag;
   kmp_int64 iter_number; // iteration number of "collapsed" loop nest
+  kmp_int64 window; // number of slots in the flags window, 0 if dense
   kmp_info_t *th = __kmp_threads[gtid];
   kmp_team_t *team = th->th.th_team;
   kmp_disp_t *pr_buf;
@@ -3257,7 +3712,54 @@ void __kmpc_doacross_post(ident_t *loc, int gtid, long long *vec) {
   shft = iter_number % 32; // use 32-bit granularity
   iter_number >>= 5; // divided by 32
   flag = 1 << shft;
-  if ((flag & pr_buf->th_doacross_flags[iter_number]) == 0)
+  window = pr_buf->th_doacross_info[4 * num_dims + 1];
+  if (window) {
+    // The word can only be posted once all words of the previous generation
+    // mapped to the same slot are complete. Those iterations precede ours, so
+    // they cannot depend on us and the wait makes progress unless one of them
+    // skips its post; if the slot does not move on for a while, the post goes
+    // to the dense vector instead. Any post into the slot restarts that wait,
+    // so only a slot nobody posts to triggers it. The post completing a word
+    // retires it by moving the slot to the next generation.
+    volatile kmp_uint64 *slot =
+        (volatile kmp_uint64 *)pr_buf->th_doacross_flags +
+        (iter_number & (window - 1));
+    kmp_uint64 gen = (kmp_uint64)iter_number / window;
+    kmp_uint32 spins, polls = 0;
+    kmp_uint64 goal = 0, stall = 0, stalled_val = 0;
+    KMP_INIT_YIELD(spins);
+    for (;;) {
+      kmp_uint64 val = *slot, new_val;
+      if ((val >> 32) != gen) {
+        volatile kmp_uint32 *dense =
+            __kmp_doacross_dense(th, pr_buf, window, false);
+        KMP_DEBUG_ASSERT((val >> 32) < gen);
+        if (dense == NULL) {
+          kmp_uint64 now = __kmp_now_nsec();
+          if (stall == 0 || val != stalled_val) {
+            stall = now + __kmp_doacross_stall_nsec();
+            stalled_val = val;
+          } else if (now > stall)
+            dense = __kmp_doacross_dense(th, pr_buf, window, true);
+        }
+        if (dense) {
+          if ((flag & dense[iter_number]) == 0)
+            KMP_TEST_THEN_OR32(&dense[iter_number], flag);
+          break;
+        }
+        __kmp_doacross_pause(&spins, &goal, &polls);
+        continue;
+      }
+      if (val & flag)
+        break; // already posted
+      new_val = val | flag;
+      if ((kmp_uint32)new_val == 0xFFFFFFFF)
+        new_val = (gen + 1) << 32;
+      if (KMP_COMPARE_AND_STORE_ACQ64((volatile kmp_int64 *)slot,
+                                      (kmp_int64)val, (kmp_int64)new_val))
+        break;
+    }
+  } else if ((flag & pr_buf->th_doacross_flags[iter_number]) == 0)
     KMP_TEST_THEN_OR32(&pr_buf->th_doacross_flags[iter_number], flag);
   KA_TRACE(20, ("__kmpc_doacross_post() exit: T#%d iter %lld posted\n", gtid,
                 (iter_number << 5) + shft));
@@ -3284,6 +3786,14 @@ void __kmpc_doacross_fini(ident_t *loc, int gtid) {
                      (kmp_int64)&sh_buf->doacross_num_done);
     KMP_DEBUG_ASSERT(num_done == (kmp_int64)sh_buf->doacross_num_done);
     KMP_DEBUG_ASSERT(idx == sh_buf->doacross_buf_idx);
+    kmp_int64 num_dims = pr_buf->th_doacross_info[0];
+    kmp_int64 window = pr_buf->th_doacross_info[4 * num_dims + 1];
+    if (window) {
+      volatile kmp_uint32 *dense =
+          __kmp_doacross_dense(th, pr_buf, window, false);
+      if (dense)
+        __kmp_thread_free(th, CCAST(kmp_uint32 *, dense));
+    }
     __kmp_thread_free(th, CCAST(kmp_uint32 *, sh_buf->doacross_flags));
     sh_buf->doacross_flags = NULL;
     sh_buf->doacross_num_done = 0;
@@ -126,6 +126,9 @@ template <typename T> struct KMP_ALIGN_CACHE dispatch_private_info_template {
   kmp_uint32 nomerge; /* don't merge iters if serialized */
   kmp_uint32 type_size;
   enum cons_type pushed_ws;
+#if KMP_STATIC_STEAL_ENABLED
+  kmp_lock_t *steal_lock; // lock used for chunk stealing (8-byte variable)
+#endif
 };
 
 // replaces dispatch_shared_info{32,64} structures and
@@ -148,6 +151,10 @@ template <typename UT> struct dispatch_shared_info_template {
     dispatch_shared_info64_t s64;
   } u;
   volatile kmp_uint32 buffer_index;
+  kmp_uint32 buffer_flags;
+  kmp_uint32 buffer_skip;
+  dispatch_shared_info *buffer_next;
+  dispatch_private_info *buffer_private;
 #if OMP_45_ENABLED
   volatile kmp_int32 doacross_buf_idx; // teamwise index
   kmp_uint32 *doacross_flags; // array of iteration flags (0/1)
@@ -471,6 +478,108 @@ static void __kmp_dispatch_dxo(int *gtid_ref, int *cid_ref, ident_t *loc_ref) {
   KD_TRACE(100, ("__kmp_dispatch_dxo: T#%d returned\n", gtid));
 }
 
+// Returns the shared buffer for the loop with number idx in the team. The ring
+// slot idx % __kmp_dispatch_num_buffers is used when it is free. Otherwise a
+// thread that ran ahead of the team would have to wait for the slow threads to
+// finish the loop occupying the slot; instead the loop is diverted to an
+// overflow buffer chained off the slot. All threads of the team must agree on
+// the buffer, so the decision is taken under t_disp_lock and the ring slot is
+// flagged so that its release, also under the lock, skips the diverted loops.
+// The index itself is never flagged, as it counts loops without bound. An
+// overflow buffer
+// comes with its own private buffers for the threads, so that a thread never
+// reuses a private buffer other threads may still steal from.
+static dispatch_shared_info_t *
+__kmp_dispatch_get_buffer(int gtid, kmp_team_t *team, kmp_uint32 idx) {
+  dispatch_shared_info_t *sh =
+      &team->t.t_disp_buffer[idx % __kmp_dispatch_num_buffers];
+  dispatch_shared_info_t *buf, *free_buf = NULL;
+
+  if (TCR_4(sh->buffer_index) == idx)
+    return sh; // fast path: the ring slot is ours
+  KMP_COUNT_BLOCK(OMP_FOR_buffer_stall);
+  if (!__kmp_dispatch_grow_buffers) {
+    KD_TRACE(100, ("__kmp_dispatch_get_buffer: T#%d before wait: idx:%d "
+                   "sh->buffer_index:%d\n",
+                   gtid, idx, sh->buffer_index));
+    __kmp_wait_yield<kmp_uint32>(&sh->buffer_index, idx,
+                                 __kmp_eq<kmp_uint32> USE_ITT_BUILD_ARG(NULL));
+    return sh;
+  }
+
+  __kmp_acquire_lock(&team->t.t_disp_lock, gtid);
+  // Look for the decision taken by another thread first
+  for (buf = sh->buffer_next; buf != NULL; buf = buf->buffer_next) {
+    if (buf->buffer_flags & KMP_DISP_BUFFER_FREE) {
+      if (free_buf == NULL)
+        free_buf = buf;
+    } else if (buf->buffer_index == idx) {
+      __kmp_release_lock(&team->t.t_disp_lock, gtid);
+      return buf;
+    }
+  }
+  // The slot is released under the lock, so it stays busy with the older loop
+  if (sh->buffer_index == idx) {
+    __kmp_release_lock(&team->t.t_disp_lock, gtid);
+    return sh;
+  }
+  sh->buffer_flags |= KMP_DISP_BUFFER_DIVERTED;
+  if (free_buf == NULL) {
+    KMP_COUNT_BLOCK(OMP_FOR_buffer_overflow);
+    free_buf = (dispatch_shared_info_t *)__kmp_allocate(
+        sizeof(dispatch_shared_info_t));
+    free_buf->buffer_private = (dispatch_private_info_t *)__kmp_allocate(
+        sizeof(dispatch_private_info_t) * team->t.t_max_nproc);
+    free_buf->buffer_next = sh->buffer_next;
+    sh->buffer_next = free_buf;
+  }
+  free_buf->buffer_index = idx;
+  free_buf->buffer_flags = 0;
+  sh->buffer_skip = idx + __kmp_dispatch_num_buffers;
+  KD_TRACE(100, ("__kmp_dispatch_get_buffer: T#%d loop %d diverted to %p\n",
+                 gtid, idx, free_buf));
+  __kmp_release_lock(&team->t.t_disp_lock, gtid);
+  return free_buf;
+}
+
+// Releases the shared buffer of a finished loop for reuse, called by the last
+// thread to finish the loop. Overflow buffers are reclaimed lazily: they are
+// marked free and picked up by the next diverted loop of the same slot.
+static void __kmp_dispatch_release_buffer(int gtid, kmp_team_t *team,
+                                          dispatch_shared_info_t *sh) {
+  if (!__kmp_dispatch_grow_buffers) {
+    KMP_MB();
+    sh->buffer_index += __kmp_dispatch_num_buffers;
+  } else {
+    __kmp_acquire_lock(&team->t.t_disp_lock, gtid);
+    if (sh < team->t.t_disp_buffer ||
+        sh >= team->t.t_disp_buffer + __kmp_dispatch_num_buffers) {
+      sh->buffer_flags = KMP_DISP_BUFFER_FREE;
+    } else if (sh->buffer_flags & KMP_DISP_BUFFER_DIVERTED) {
+      // Loops were diverted meanwhile; resume with the first one after them
+      sh->buffer_flags &= ~KMP_DISP_BUFFER_DIVERTED;
+      TCW_4(sh->buffer_index, sh->buffer_skip);
+    } else {
+      TCW_4(sh->buffer_index, sh->buffer_index + __kmp_dispatch_num_buffers);
+    }
+    __kmp_release_lock(&team->t.t_disp_lock, gtid);
+  }
+  KD_TRACE(100, ("__kmp_dispatch_release_buffer: T#%d change buffer_index:%d\n",
+                 gtid, sh->buffer_index));
+}
+
+// Returns the private buffer of thread tid for the loop using shared buffer sh.
+// Private buffers are tied to the shared buffer, so they are not reused before
+// every thread of the team has finished the loop.
+static dispatch_private_info_t *
+__kmp_dispatch_private_buffer(kmp_team_t *team, dispatch_shared_info_t *sh,
+                              int tid) {
+  if (sh >= team->t.t_disp_buffer &&
+      sh < team->t.t_disp_buffer + __kmp_dispatch_num_buffers)
+    return &team->t.t_dispatch[tid].th_disp_buffer[sh - team->t.t_disp_buffer];
+  return &sh->buffer_private[tid];
+}
+
 // Computes and returns x to the power of y, where y must a non-negative integer
 template <typename UT>
 static __forceinline long double __kmp_pow(long double x, UT y) {
@@ -586,12 +695,22 @@ __kmp_dispatch_init(ident_t *loc, int gtid, enum sched_type schedule, T lb,
 
     my_buffer_index = th->th.th_dispatch->th_disp_index++;
 
+    /* The name of this buffer should be my_buffer_index when it's free to use
+     * it */
+    sh = reinterpret_cast<dispatch_shared_info_template<UT> volatile *>(
+        __kmp_dispatch_get_buffer(gtid, team, my_buffer_index));
+    KMP_MB(); /* is this necessary? */
+    KD_TRACE(100, ("__kmp_dispatch_init: T#%d after wait: my_buffer_index:%d "
+                   "sh->buffer_index:%d\n",
+                   gtid, my_buffer_index, sh->buffer_index));
+
     /* What happens when number of threads changes, need to resize buffer? */
     pr = reinterpret_cast<dispatch_private_info_template<T> *>(
-        &th->th.th_dispatch
-             ->th_disp_buffer[my_buffer_index % __kmp_dispatch_num_buffers]);
-    sh = reinterpret_cast<dispatch_shared_info_template<UT> volatile *>(
-        &team->t.t_disp_buffer[my_buffer_index % __kmp_dispatch_num_buffers]);
+        __kmp_dispatch_private_buffer(
+            team,
+            CCAST(dispatch_shared_info_t *,
+                  (volatile dispatch_shared_info_t *)sh),
+            th->th.th_info.ds.ds_tid));
   }
 
 #if (KMP_STATIC_STEAL_ENABLED)
@@ -825,12 +944,11 @@ __kmp_dispatch_init(ident_t *loc, int gtid, enum sched_type schedule, T lb,
         // AC: TODO: check if 16-byte CAS available and use it to
         // improve performance (probably wait for explicit request
         // before spending time on this).
-        // For now use dynamically allocated per-thread lock,
+        // For now use dynamically allocated per-private-buffer lock,
         // free memory in __kmp_dispatch_next when status==0.
-        KMP_DEBUG_ASSERT(th->th.th_dispatch->th_steal_lock == NULL);
-        th->th.th_dispatch->th_steal_lock =
-            (kmp_lock_t *)__kmp_allocate(sizeof(kmp_lock_t));
-        __kmp_init_lock(th->th.th_dispatch->th_steal_lock);
+        KMP_DEBUG_ASSERT(pr->steal_lock == NULL);
+        pr->steal_lock = (kmp_lock_t *)__kmp_allocate(sizeof(kmp_lock_t));
+        __kmp_init_lock(pr->steal_lock);
       }
       break;
     } else {
@@ -1146,21 +1264,6 @@ __kmp_dispatch_init(ident_t *loc, int gtid, enum sched_type schedule, T lb,
   } // switch
   pr->schedule = schedule;
   if (active) {
-    /* The name of this buffer should be my_buffer_index when it's free to use
-     * it */
-
-    KD_TRACE(100, ("__kmp_dispatch_init: T#%d before wait: my_buffer_index:%d "
-                   "sh->buffer_index:%d\n",
-                   gtid, my_buffer_index, sh->buffer_index));
-    __kmp_wait_yield<kmp_uint32>(&sh->buffer_index, my_buffer_index,
-                                 __kmp_eq<kmp_uint32> USE_ITT_BUILD_ARG(NULL));
-    // Note: KMP_WAIT_YIELD() cannot be used there: buffer index and
-    // my_buffer_index are *always* 32-bit integers.
-    KMP_MB(); /* is this necessary? */
-    KD_TRACE(100, ("__kmp_dispatch_init: T#%d after wait: my_buffer_index:%d "
-                   "sh->buffer_index:%d\n",
-                   gtid, my_buffer_index, sh->buffer_index));
-
     th->th.th_dispatch->th_dispatch_pr_current = (dispatch_private_info_t *)pr;
     th->th.th_dispatch->th_dispatch_sh_current =
         CCAST(dispatch_shared_info_t *, (volatile dispatch_shared_info_t *)sh);
@@ -1588,7 +1691,7 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
         if (traits_t<T>::type_size > 4) {
           // use lock for 8-byte and CAS for 4-byte induction
           // variable. TODO (optional): check and use 16-byte CAS
-          kmp_lock_t *lck = th->th.th_dispatch->th_steal_lock;
+          kmp_lock_t *lck = pr->steal_lock;
           KMP_DEBUG_ASSERT(lck != NULL);
           if (pr->u.p.count < (UT)pr->u.p.ub) {
             __kmp_acquire_lock(lck, gtid);
@@ -1600,7 +1703,6 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
             status = 0; // no own chunks
           }
           if (!status) { // try to steal
-            kmp_info_t **other_threads = team->t.t_threads;
             int while_limit = nproc; // nproc attempts to find a victim
             int while_index = 0;
             // TODO: algorithm of searching for a victim
@@ -1611,19 +1713,18 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
               T oldVictimIdx = victimIdx ? victimIdx - 1 : nproc - 1;
               dispatch_private_info_template<T> *victim =
                   reinterpret_cast<dispatch_private_info_template<T> *>(
-                      other_threads[victimIdx]
-                          ->th.th_dispatch->th_dispatch_pr_current);
-              while ((victim == NULL || victim == pr ||
+                      __kmp_dispatch_private_buffer(
+                          team, (dispatch_shared_info_t *)sh, victimIdx));
+              while ((victim == pr ||
                       (*(volatile T *)&victim->u.p.static_steal_counter !=
                        *(volatile T *)&pr->u.p.static_steal_counter)) &&
                      oldVictimIdx != victimIdx) {
                 victimIdx = (victimIdx + 1) % nproc;
                 victim = reinterpret_cast<dispatch_private_info_template<T> *>(
-                    other_threads[victimIdx]
-                        ->th.th_dispatch->th_dispatch_pr_current);
+                    __kmp_dispatch_private_buffer(
+                        team, (dispatch_shared_info_t *)sh, victimIdx));
               };
-              if (!victim ||
-                  (*(volatile T *)&victim->u.p.static_steal_counter !=
+              if ((*(volatile T *)&victim->u.p.static_steal_counter !=
                    *(volatile T *)&pr->u.p.static_steal_counter)) {
                 continue; // try once more (nproc attempts in total)
                 // no victim is ready yet to participate in stealing
@@ -1634,7 +1735,7 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
                 continue; // not enough chunks to steal, goto next victim
               }
 
-              lck = other_threads[victimIdx]->th.th_dispatch->th_steal_lock;
+              lck = victim->steal_lock;
               KMP_ASSERT(lck != NULL);
               __kmp_acquire_lock(lck, gtid);
               limit = victim->u.p.ub; // keep initial ub
@@ -1662,10 +1763,10 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
               status = 1;
               while_index = 0;
               // now update own count and ub with stolen range but init chunk
-              __kmp_acquire_lock(th->th.th_dispatch->th_steal_lock, gtid);
+              __kmp_acquire_lock(pr->steal_lock, gtid);
               pr->u.p.count = init + 1;
               pr->u.p.ub = limit;
-              __kmp_release_lock(th->th.th_dispatch->th_steal_lock, gtid);
+              __kmp_release_lock(pr->steal_lock, gtid);
             } // while (search for victim)
           } // if (try to find victim and steal)
         } else {
@@ -1699,7 +1800,6 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
           }
 
           if (!status) {
-            kmp_info_t **other_threads = team->t.t_threads;
             int while_limit = nproc; // nproc attempts to find a victim
             int while_index = 0;
 
@@ -1712,19 +1812,18 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
               T oldVictimIdx = victimIdx ? victimIdx - 1 : nproc - 1;
               dispatch_private_info_template<T> *victim =
                   reinterpret_cast<dispatch_private_info_template<T> *>(
-                      other_threads[victimIdx]
-                          ->th.th_dispatch->th_dispatch_pr_current);
-              while ((victim == NULL || victim == pr ||
+                      __kmp_dispatch_private_buffer(
+                          team, (dispatch_shared_info_t *)sh, victimIdx));
+              while ((victim == pr ||
                       (*(volatile T *)&victim->u.p.static_steal_counter !=
                        *(volatile T *)&pr->u.p.static_steal_counter)) &&
                      oldVictimIdx != victimIdx) {
                 victimIdx = (victimIdx + 1) % nproc;
                 victim = reinterpret_cast<dispatch_private_info_template<T> *>(
-                    other_threads[victimIdx]
-                        ->th.th_dispatch->th_dispatch_pr_current);
+                    __kmp_dispatch_private_buffer(
+                        team, (dispatch_shared_info_t *)sh, victimIdx));
               };
-              if (!victim ||
-                  (*(volatile T *)&victim->u.p.static_steal_counter !=
+              if ((*(volatile T *)&victim->u.p.static_steal_counter !=
                    *(volatile T *)&pr->u.p.static_steal_counter)) {
                 continue; // try once more (nproc attempts in total)
                 // no victim is ready yet to participate in stealing
@@ -2317,14 +2416,15 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
         if (pr->schedule == kmp_sch_static_steal &&
             traits_t<T>::type_size > 4) {
           int i;
-          kmp_info_t **other_threads = team->t.t_threads;
           // loop complete, safe to destroy locks used for stealing
           for (i = 0; i < th->th.th_team_nproc; ++i) {
-            kmp_lock_t *lck = other_threads[i]->th.th_dispatch->th_steal_lock;
+            dispatch_private_info_t *buf = __kmp_dispatch_private_buffer(
+                team, (dispatch_shared_info_t *)sh, i);
+            kmp_lock_t *lck = buf->steal_lock;
             KMP_ASSERT(lck != NULL);
             __kmp_destroy_lock(lck);
             __kmp_free(lck);
-            other_threads[i]->th.th_dispatch->th_steal_lock = NULL;
+            buf->steal_lock = NULL;
           }
         }
 #endif
@@ -2342,9 +2442,9 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
 
         KMP_MB(); /* Flush all pending memory write invalidates.  */
 
-        sh->buffer_index += __kmp_dispatch_num_buffers;
-        KD_TRACE(100, ("__kmp_dispatch_next: T#%d change buffer_index:%d\n",
-                       gtid, sh->buffer_index));
+        __kmp_dispatch_release_buffer(
+            gtid, team, CCAST(dispatch_shared_info_t *,
+                              (volatile dispatch_shared_info_t *)sh));
 
         KMP_MB(); /* Flush all pending memory write invalidates.  */
 
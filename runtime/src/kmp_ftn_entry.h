@@ -975,6 +975,13 @@ void FTN_STDCALL xexpand(FTN_UNSET_NEST_LOCK)(void **user_lock) {
   }; // if
   (*((int *)user_lock))--;
 #else
+#if KMP_USE_DYNAMIC_LOCK && KMP_USE_INLINED_TAS
+  // Only the owner releases an inlined nested tas lock, which needs no gtid
+  if (KMP_EXTRACT_D_TAG(user_lock) == locktag_tas) {
+    __kmpc_unset_nest_lock(NULL, KMP_GTID_UNKNOWN, user_lock);
+    return;
+  }
+#endif
   __kmpc_unset_nest_lock(NULL, __kmp_entry_gtid(), user_lock);
 #endif
 }
@@ -1075,6 +1082,53 @@ void FTN_STDCALL FTN_SET_WARNINGS_OFF(void) {
 #endif
 }
 
+void FTN_STDCALL FTN_DUMP_LOCK_PROFILE(void) {
+#ifndef KMP_STUB
+  __kmp_lock_profile_dump();
+#endif
+}
+
+/* reader-writer locks */
+void FTN_STDCALL FTN_RWLOCK_INIT(void **user_lock) {
+#ifdef KMP_STUB
+  *((kmp_stub_lock_t *)user_lock) = UNLOCKED;
+#else
+  __kmp_init_rw_lock(user_lock, NULL, __kmp_entry_gtid());
+#endif
+}
+
+void FTN_STDCALL FTN_RWLOCK_DESTROY(void **user_lock) {
+#ifdef KMP_STUB
+  *((kmp_stub_lock_t *)user_lock) = UNINIT;
+#else
+  __kmp_destroy_rw_lock(user_lock, __kmp_entry_gtid());
+#endif
+}
+
+void FTN_STDCALL FTN_RWLOCK_RDLOCK(void **user_lock) {
+#ifdef KMP_STUB
+  *((kmp_stub_lock_t *)user_lock) = LOCKED;
+#else
+  __kmp_acquire_rw_lock_read(user_lock, __kmp_entry_gtid());
+#endif
+}
+
+void FTN_STDCALL FTN_RWLOCK_WRLOCK(void **user_lock) {
+#ifdef KMP_STUB
+  *((kmp_stub_lock_t *)user_lock) = LOCKED;
+#else
+  __kmp_acquire_rw_lock_write(user_lock, __kmp_entry_gtid());
+#endif
+}
+
+void FTN_STDCALL FTN_RWLOCK_UNLOCK(void **user_lock) {
+#ifdef KMP_STUB
+  *((kmp_stub_lock_t *)user_lock) = UNLOCKED;
+#else
+  __kmp_release_rw_lock(user_lock, __kmp_entry_gtid());
+#endif
+}
+
 void FTN_STDCALL FTN_SET_DEFAULTS(char const *str
 #ifndef PASS_ARGS_BY_VALUE
                                   ,
@@ -1130,6 +1184,41 @@ int FTN_STDCALL FTN_GET_MAX_TASK_PRIORITY(void) {
 }
 #endif
 
+#if OMP_50_ENABLED
+/* OpenMP 5.0 memory management */
+omp_allocator_handle_t FTN_STDCALL
+FTN_INIT_ALLOCATOR(omp_memspace_handle_t KMP_DEREF m, int KMP_DEREF ntraits,
+                   const omp_alloctrait_t traits[]) {
+#ifdef KMP_STUB
+  return omp_null_allocator;
+#else
+  return __kmpc_init_allocator(__kmp_entry_gtid(), KMP_DEREF m,
+                               KMP_DEREF ntraits, traits);
+#endif
+}
+
+void FTN_STDCALL FTN_DESTROY_ALLOCATOR(omp_allocator_handle_t KMP_DEREF al) {
+#ifndef KMP_STUB
+  __kmpc_destroy_allocator(__kmp_entry_gtid(), KMP_DEREF al);
+#endif
+}
+
+void FTN_STDCALL
+FTN_SET_DEFAULT_ALLOCATOR(omp_allocator_handle_t KMP_DEREF al) {
+#ifndef KMP_STUB
+  __kmpc_set_default_allocator(__kmp_entry_gtid(), KMP_DEREF al);
+#endif
+}
+
+omp_allocator_handle_t FTN_STDCALL FTN_GET_DEFAULT_ALLOCATOR(void) {
+#ifdef KMP_STUB
+  return omp_default_mem_alloc;
+#else
+  return __kmpc_get_default_allocator(__kmp_entry_gtid());
+#endif
+}
+#endif // OMP_50_ENABLED
+
 // GCC compatibility (versioned symbols)
 #ifdef KMP_USE_VERSION_SYMBOLS
 
@@ -97,6 +97,12 @@
 
 #define FTN_SET_WARNINGS_ON kmp_set_warnings_on
 #define FTN_SET_WARNINGS_OFF kmp_set_warnings_off
+#define FTN_DUMP_LOCK_PROFILE kmp_dump_lock_profile
+#define FTN_RWLOCK_INIT kmp_rwlock_init
+#define FTN_RWLOCK_DESTROY kmp_rwlock_destroy
+#define FTN_RWLOCK_RDLOCK kmp_rwlock_rdlock
+#define FTN_RWLOCK_WRLOCK kmp_rwlock_wrlock
+#define FTN_RWLOCK_UNLOCK kmp_rwlock_unlock
 
 #define FTN_GET_WTIME omp_get_wtime
 #define FTN_GET_WTICK omp_get_wtick
@@ -135,6 +141,13 @@
 #endif
 #endif
 
+#if OMP_50_ENABLED
+#define FTN_INIT_ALLOCATOR omp_init_allocator
+#define FTN_DESTROY_ALLOCATOR omp_destroy_allocator
+#define FTN_SET_DEFAULT_ALLOCATOR omp_set_default_allocator
+#define FTN_GET_DEFAULT_ALLOCATOR omp_get_default_allocator
+#endif
+
 #endif /* KMP_FTN_PLAIN */
 
 /* ------------------------------------------------------------------------ */
@@ -215,6 +228,12 @@
 
 #define FTN_SET_WARNINGS_ON kmp_set_warnings_on_
 #define FTN_SET_WARNINGS_OFF kmp_set_warnings_off_
+#define FTN_DUMP_LOCK_PROFILE kmp_dump_lock_profile_
+#define FTN_RWLOCK_INIT kmp_rwlock_init_
+#define FTN_RWLOCK_DESTROY kmp_rwlock_destroy_
+#define FTN_RWLOCK_RDLOCK kmp_rwlock_rdlock_
+#define FTN_RWLOCK_WRLOCK kmp_rwlock_wrlock_
+#define FTN_RWLOCK_UNLOCK kmp_rwlock_unlock_
 
 #define FTN_GET_WTIME omp_get_wtime_
 #define FTN_GET_WTICK omp_get_wtick_
@@ -254,6 +273,13 @@
 #endif
 #endif
 
+#if OMP_50_ENABLED
+#define FTN_INIT_ALLOCATOR omp_init_allocator_
+#define FTN_DESTROY_ALLOCATOR omp_destroy_allocator_
+#define FTN_SET_DEFAULT_ALLOCATOR omp_set_default_allocator_
+#define FTN_GET_DEFAULT_ALLOCATOR omp_get_default_allocator_
+#endif
+
 #endif /* KMP_FTN_APPEND */
 
 /* ------------------------------------------------------------------------ */
@@ -334,6 +360,12 @@
 
 #define FTN_SET_WARNINGS_ON KMP_SET_WARNINGS_ON
 #define FTN_SET_WARNINGS_OFF KMP_SET_WARNINGS_OFF
+#define FTN_DUMP_LOCK_PROFILE KMP_DUMP_LOCK_PROFILE
+#define FTN_RWLOCK_INIT KMP_RWLOCK_INIT
+#define FTN_RWLOCK_DESTROY KMP_RWLOCK_DESTROY
+#define FTN_RWLOCK_RDLOCK KMP_RWLOCK_RDLOCK
+#define FTN_RWLOCK_WRLOCK KMP_RWLOCK_WRLOCK
+#define FTN_RWLOCK_UNLOCK KMP_RWLOCK_UNLOCK
 
 #define FTN_GET_WTIME OMP_GET_WTIME
 #define FTN_GET_WTICK OMP_GET_WTICK
@@ -373,6 +405,13 @@
 #endif
 #endif
 
+#if OMP_50_ENABLED
+#define FTN_INIT_ALLOCATOR OMP_INIT_ALLOCATOR
+#define FTN_DESTROY_ALLOCATOR OMP_DESTROY_ALLOCATOR
+#define FTN_SET_DEFAULT_ALLOCATOR OMP_SET_DEFAULT_ALLOCATOR
+#define FTN_GET_DEFAULT_ALLOCATOR OMP_GET_DEFAULT_ALLOCATOR
+#endif
+
 #endif /* KMP_FTN_UPPER */
 
 /* ------------------------------------------------------------------------ */
@@ -453,6 +492,12 @@
 
 #define FTN_SET_WARNINGS_ON KMP_SET_WARNINGS_ON_
 #define FTN_SET_WARNINGS_OFF KMP_SET_WARNINGS_OFF_
+#define FTN_DUMP_LOCK_PROFILE KMP_DUMP_LOCK_PROFILE_
+#define FTN_RWLOCK_INIT KMP_RWLOCK_INIT_
+#define FTN_RWLOCK_DESTROY KMP_RWLOCK_DESTROY_
+#define FTN_RWLOCK_RDLOCK KMP_RWLOCK_RDLOCK_
+#define FTN_RWLOCK_WRLOCK KMP_RWLOCK_WRLOCK_
+#define FTN_RWLOCK_UNLOCK KMP_RWLOCK_UNLOCK_
 
 #define FTN_GET_WTIME OMP_GET_WTIME_
 #define FTN_GET_WTICK OMP_GET_WTICK_
@@ -492,6 +537,13 @@
 #endif
 #endif
 
+#if OMP_50_ENABLED
+#define FTN_INIT_ALLOCATOR OMP_INIT_ALLOCATOR_
+#define FTN_DESTROY_ALLOCATOR OMP_DESTROY_ALLOCATOR_
+#define FTN_SET_DEFAULT_ALLOCATOR OMP_SET_DEFAULT_ALLOCATOR_
+#define FTN_GET_DEFAULT_ALLOCATOR OMP_GET_DEFAULT_ALLOCATOR_
+#endif
+
 #endif /* KMP_FTN_UAPPEND */
 
 /* -------------------------- GOMP API NAMES ------------------------ */
@@ -75,6 +75,14 @@ size_t __kmp_stkoffset = KMP_DEFAULT_STKOFFSET;
 int __kmp_stkpadding = KMP_MIN_STKPADDING;
 
 size_t __kmp_malloc_pool_incr = KMP_DEFAULT_MALLOC_POOL_INCR;
+enum fast_mem_engine __kmp_fast_mem_engine = fast_mem_slab;
+int __kmp_numa_local_threads = TRUE; /* KMP_NUMA_LOCAL_THREADS */
+enum huge_pages_type __kmp_huge_pages = huge_pages_off;
+enum prefault_type __kmp_prefault_pages = prefault_off;
+#if OMP_50_ENABLED
+omp_allocator_handle_t __kmp_def_allocator = omp_default_mem_alloc;
+size_t __kmp_alloc_mmap_threshold = KMP_DEFAULT_ALLOC_MMAP_THRESHOLD;
+#endif
 
 // Barrier method defaults, settings, and strings.
 // branch factor = 2^branch_bits (only relevant for tree & hyper barrier types)
@@ -138,10 +146,18 @@ int __kmp_max_nth = 0;
 int __kmp_threads_capacity = 0;
 int __kmp_dflt_team_nth = 0;
 int __kmp_dflt_team_nth_ub = 0;
+#if KMP_OS_LINUX
+int __kmp_cgroup_quota = TRUE;
+int __kmp_cgroup_cpu_limit = 0;
+int __kmp_cgroup_recheck_interval = 0;
+volatile kmp_uint64 __kmp_cgroup_next_check = 0;
+char const *__kmp_cgroup_path = NULL;
+#endif
 int __kmp_tp_capacity = 0;
 int __kmp_tp_cached = 0;
 int __kmp_dflt_nested = FALSE;
 int __kmp_dispatch_num_buffers = KMP_DFLT_DISP_NUM_BUFF;
+int __kmp_dispatch_grow_buffers = TRUE;
 int __kmp_dflt_max_active_levels =
     KMP_MAX_ACTIVE_LEVELS_LIMIT; /* max_active_levels limit */
 #if KMP_NESTED_HOT_TEAMS
@@ -185,6 +201,9 @@ int __kmp_adjust_gtid_mode = TRUE;
 #ifdef KMP_TDATA_GTID
 #if KMP_OS_WINDOWS
 __declspec(thread) int __kmp_gtid = KMP_GTID_DNE;
+#elif KMP_OS_LINUX && KMP_USE_INITIAL_EXEC_TLS
+__thread int __kmp_gtid __attribute__((tls_model("initial-exec"))) =
+    KMP_GTID_DNE;
 #else
 __thread int __kmp_gtid = KMP_GTID_DNE;
 #endif /* KMP_OS_WINDOWS - workaround because Intel(R) Many Integrated Core    \
@@ -192,6 +211,7 @@ __thread int __kmp_gtid = KMP_GTID_DNE;
 #endif /* KMP_TDATA_GTID */
 int __kmp_tls_gtid_min = INT_MAX;
 int __kmp_foreign_tp = TRUE;
+size_t __kmp_tp_lazy_size = 0;
 #if KMP_ARCH_X86 || KMP_ARCH_X86_64
 int __kmp_inherit_fp_control = TRUE;
 kmp_int16 __kmp_init_x87_fpu_control_word = 0;
@@ -207,7 +227,7 @@ kmp_nested_nthreads_t __kmp_nested_nth = {NULL, 0, 0};
 #if KMP_USE_ADAPTIVE_LOCKS
 
 kmp_adaptive_backoff_params_t __kmp_adaptive_backoff_params = {
-    1, 1024}; // TODO: tune it!
+    1, 1024, 64, 50}; // TODO: tune it!
 
 #if KMP_DEBUG_ADAPTIVE_LOCKS
 char *__kmp_speculative_statsfile = "-";
@@ -276,8 +296,13 @@ int __kmp_affinity_respect_mask = affinity_respect_mask_default;
 char *__kmp_affinity_proclist = NULL;
 kmp_affin_mask_t *__kmp_affinity_masks = NULL;
 unsigned __kmp_affinity_num_masks = 0;
+int *__kmp_affinity_place_pkg = NULL;
+int __kmp_affinity_num_pkgs = 0;
+int *__kmp_affinity_proc_pkg = NULL;
+int __kmp_affinity_num_proc_pkg = 0;
 
 char const *__kmp_cpuinfo_file = NULL;
+char const *__kmp_topology_cache_file = NULL;
 
 #endif /* KMP_AFFINITY_SUPPORTED */
 
@@ -302,6 +327,8 @@ kmp_tasking_mode_t __kmp_tasking_mode = tskm_task_teams;
 #if OMP_45_ENABLED
 kmp_int32 __kmp_max_task_priority = 0;
 kmp_uint64 __kmp_taskloop_min_tasks = 0;
+int __kmp_taskloop_lazy_split = FALSE;
+size_t __kmp_doacross_dense_limit = KMP_DFLT_DOACROSS_DENSE_LIMIT;
 #endif
 
 /* This check ensures that the compiler is passing the correct data type for the
@@ -380,6 +407,7 @@ int __kmp_env_stksize = FALSE; /* KMP_STACKSIZE specified? */
 int __kmp_env_blocktime = FALSE; /* KMP_BLOCKTIME specified? */
 int __kmp_env_checks = FALSE; /* KMP_CHECKS specified?    */
 int __kmp_env_consistency_check = FALSE; /* KMP_CONSISTENCY_CHECK specified? */
+int __kmp_critical_delegate = TRUE; /* KMP_CRITICAL_DELEGATE */
 
 kmp_uint32 __kmp_yield_init = KMP_INIT_WAIT;
 kmp_uint32 __kmp_yield_next = KMP_NEXT_WAIT;
@@ -15,6 +15,7 @@
 
 #include "kmp.h"
 #include "kmp_atomic.h"
+#include "kmp_stats.h"
 
 #if OMPT_SUPPORT
 #include "ompt-specific.h"
@@ -831,6 +832,53 @@ PARALLEL_LOOP_START(xexpand(KMP_API_NAME_GOMP_PARALLEL_LOOP_RUNTIME_START),
 
 // Tasking constructs
 
+// Run an included task (generated inside a final task) directly on the
+// encountering thread, without allocating a task descriptor. Every task it
+// generates is included in turn and completes before GOMP_task returns, and
+// dependences are not computed in final tasks, so it never needs to be the
+// parent of anything that outlives it. The task keeps its own ICVs: the
+// current task's ICVs are saved and restored around the call, unless it is
+// mergeable and so shares the data environment of the generating task.
+static void __kmp_GOMP_task_inline(int gtid, kmp_taskdata_t *current_task,
+                                   void (*func)(void *), void *data,
+                                   void (*copy_func)(void *, void *),
+                                   long arg_size, long arg_align,
+                                   bool merged) {
+  kmp_internal_control_t icvs;
+
+  KA_TRACE(20, ("GOMP_task: T#%d running %s task inline\n", gtid,
+                merged ? "merged" : "included"));
+
+#if OMP_40_ENABLED
+  if (__kmp_omp_cancellation) {
+    kmp_taskgroup_t *taskgroup = current_task->td_taskgroup;
+    if ((taskgroup && taskgroup->cancel_request) ||
+        __kmp_threads[gtid]->th.th_team->t.t_cancel_request ==
+            cancel_parallel) {
+      KMP_COUNT_BLOCK(TASK_cancelled);
+      return;
+    }
+  }
+#endif
+  KMP_COUNT_BLOCK(TASK_inlined);
+
+  if (!merged)
+    copy_icvs(&icvs, &current_task->td_icvs);
+  if (copy_func) {
+    // firstprivate copies live on the stack for the duration of the task
+    char *buf = (char *)KMP_ALLOCA(arg_size + arg_align - 1);
+    char *arg = buf;
+    if (arg_align > 0)
+      arg = (char *)((((size_t)buf) + arg_align - 1) / arg_align * arg_align);
+    (*copy_func)(arg, data);
+    func(arg);
+  } else {
+    func(data);
+  }
+  if (!merged)
+    copy_icvs(&current_task->td_icvs, &icvs);
+}
+
 void xexpand(KMP_API_NAME_GOMP_TASK)(void (*func)(void *), void *data,
                                      void (*copy_func)(void *, void *),
                                      long arg_size, long arg_align,
@@ -858,6 +906,23 @@ void xexpand(KMP_API_NAME_GOMP_TASK)(void (*func)(void *), void *data,
   input_flags->native = 1;
   // __kmp_task_alloc() sets up all other flags
 
+  // Tasks generated in a final task are included and need no descriptor
+  // unless they have dependences or a tool is watching task events. Merged
+  // (undeferred mergeable) tasks in a non-final task still get one: they may
+  // generate deferred tasks, and a taskwait, taskgroup or depend clause in
+  // their body must only see those.
+  kmp_taskdata_t *current_task = __kmp_threads[gtid]->th.th_current_task;
+  if (current_task->td_flags.final && !(gomp_flags & 8)
+#if OMPT_SUPPORT
+      && !ompt_enabled
+#endif
+      ) {
+    __kmp_GOMP_task_inline(gtid, current_task, func, data, copy_func,
+                           arg_size, arg_align, (gomp_flags & 4) != 0);
+    KA_TRACE(20, ("GOMP_task exit: T#%d\n", gtid));
+    return;
+  }
+
   if (!if_cond) {
     arg_size = 0;
   }
@@ -122,6 +122,13 @@ __kmp_inline void __kmp_itt_critical_acquired(kmp_user_lock_p lock);
 __kmp_inline void __kmp_itt_critical_releasing(kmp_user_lock_p lock);
 __kmp_inline void __kmp_itt_critical_destroyed(kmp_user_lock_p lock);
 
+// --- Reader-writer lock reporting ---
+__kmp_inline void __kmp_itt_rwlock_creating(void *lock, const ident_t *loc);
+__kmp_inline void __kmp_itt_rwlock_acquiring(void *lock);
+__kmp_inline void __kmp_itt_rwlock_acquired(void *lock);
+__kmp_inline void __kmp_itt_rwlock_releasing(void *lock);
+__kmp_inline void __kmp_itt_rwlock_destroyed(void *lock);
+
 // --- Single reporting ---
 __kmp_inline void __kmp_itt_single_start(int gtid);
 __kmp_inline void __kmp_itt_single_end(int gtid);
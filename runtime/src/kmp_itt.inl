@@ -861,6 +861,37 @@ void __kmp_itt_critical_destroyed(kmp_user_lock_p lock) {
   ___kmp_itt_lock_fini(lock, "OMP Critical");
 } // __kmp_itt_critical_destroyed
 
+/* Reader-writer lock reporting.
+   Readers and writers report through the same object, in the same order as for
+   locks. The runtime lock itself is the object. */
+void __kmp_itt_rwlock_creating(void *lock, const ident_t *loc) {
+#if USE_ITT_NOTIFY
+  if (__itt_sync_create_ptr) {
+    char const *src = (loc == NULL ? NULL : loc->psource);
+    KMP_ITT_DEBUG_LOCK();
+    __itt_sync_create(lock, "OMP RW Lock", src, 0);
+    KMP_ITT_DEBUG_PRINT("[rwl ini] scre( %p, \"OMP RW Lock\", \"%s\", 0 )\n",
+                        lock, src);
+  }
+#endif
+} // __kmp_itt_rwlock_creating
+
+void __kmp_itt_rwlock_acquiring(void *lock) {
+  __itt_sync_prepare(lock);
+} // __kmp_itt_rwlock_acquiring
+
+void __kmp_itt_rwlock_acquired(void *lock) {
+  __itt_sync_acquired(lock);
+} // __kmp_itt_rwlock_acquired
+
+void __kmp_itt_rwlock_releasing(void *lock) {
+  __itt_sync_releasing(lock);
+} // __kmp_itt_rwlock_releasing
+
+void __kmp_itt_rwlock_destroyed(void *lock) {
+  ___kmp_itt_lock_fini((kmp_user_lock_p)lock, "OMP RW Lock");
+} // __kmp_itt_rwlock_destroyed
+
 /* Single reporting. */
 
 void __kmp_itt_single_start(int gtid) {
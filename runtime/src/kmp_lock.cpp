@@ -21,9 +21,14 @@
 #include "kmp_io.h"
 #include "kmp_itt.h"
 #include "kmp_lock.h"
+#include "kmp_stats.h"
 
 #include "tsan_annotations.h"
 
+#if KMP_OS_LINUX
+#include <sched.h>
+#endif
+
 #if KMP_USE_FUTEX
 #include <sys/syscall.h>
 #include <unistd.h>
@@ -1762,9 +1767,17 @@ static void __kmp_set_queuing_lock_flags(kmp_queuing_lock_t *lck,
 #include <immintrin.h>
 #define SOFT_ABORT_MASK (_XABORT_RETRY | _XABORT_CONFLICT | _XABORT_EXPLICIT)
 
+static __inline int __kmp_xbegin() { return _xbegin(); }
+static __inline void __kmp_xend() { _xend(); }
+#define __kmp_xabort(ARG) _xabort(ARG)
+
 #else
 
-// Values from the status register after failed speculation.
+// Values from the status register after failed speculation. In stats builds
+// kmp_stats.h has already brought in the compiler's RTM header, which defines
+// the same values; its intrinsics need -mrtm though, so the instructions below
+// are emitted by hand.
+#ifndef _XBEGIN_STARTED
 #define _XBEGIN_STARTED (~0u)
 #define _XABORT_EXPLICIT (1 << 0)
 #define _XABORT_RETRY (1 << 1)
@@ -1773,6 +1786,7 @@ static void __kmp_set_queuing_lock_flags(kmp_queuing_lock_t *lck,
 #define _XABORT_DEBUG (1 << 4)
 #define _XABORT_NESTED (1 << 5)
 #define _XABORT_CODE(x) ((unsigned char)(((x) >> 24) & 0xFF))
+#endif
 
 // Aborts for which it's worth trying again immediately
 #define SOFT_ABORT_MASK (_XABORT_RETRY | _XABORT_CONFLICT | _XABORT_EXPLICIT)
@@ -1784,7 +1798,7 @@ static void __kmp_set_queuing_lock_flags(kmp_queuing_lock_t *lck,
 /*A version of XBegin which returns -1 on speculation, and the value of EAX on
   an abort. This is the same definition as the compiler intrinsic that will be
   supported at some point. */
-static __inline int _xbegin() {
+static __inline int __kmp_xbegin() {
   int res = -1;
 
 #if KMP_OS_WINDOWS
@@ -1832,7 +1846,7 @@ static __inline int _xbegin() {
 }
 
 /* Transaction end */
-static __inline void _xend() {
+static __inline void __kmp_xend() {
 #if KMP_OS_WINDOWS
   __asm {
         _emit 0x0f
@@ -1849,9 +1863,9 @@ static __inline void _xend() {
    assembly code. */
 // clang-format off
 #if KMP_OS_WINDOWS
-#define _xabort(ARG) _asm _emit 0xc6 _asm _emit 0xf8 _asm _emit ARG
+#define __kmp_xabort(ARG) _asm _emit 0xc6 _asm _emit 0xf8 _asm _emit ARG
 #else
-#define _xabort(ARG)                                                           \
+#define __kmp_xabort(ARG)                                                      \
   __asm__ volatile(".byte 0xC6; .byte 0xF8; .byte " STRINGIZE(ARG):::"memory");
 #endif
 // clang-format on
@@ -2034,12 +2048,91 @@ static inline bool __kmp_is_unlocked_queuing_lock(kmp_queuing_lock_t *lck) {
   return res;
 }
 
+// Speculation learning, shared by the adaptive and rtm locks. Each lock
+// measures the success rate of its speculative attempts over windows of
+// __kmp_adaptive_backoff_params.window attempts; after a window below
+// min_success percent it stops speculating for a number of acquisitions that
+// doubles with every further bad window. The counters are updated outside of
+// transactions and kept off the lock word's cache line, so updating them does
+// not abort other speculating threads.
+static void __kmp_init_spec_learning(kmp_adaptive_lock_info_t *info) {
+  std::atomic_store_explicit(&info->spec_attempts, 0U,
+                             std::memory_order_relaxed);
+  std::atomic_store_explicit(&info->spec_successes, 0U,
+                             std::memory_order_relaxed);
+  std::atomic_store_explicit(&info->spec_skip, 0U, std::memory_order_relaxed);
+  info->spec_disable = KMP_SPEC_MIN_DISABLE;
+}
+
+// Check whether the lock is in a window with speculation disabled, and count
+// the acquisition against that window if it is. A plain load and store rather
+// than a decrement, so racing threads cannot wrap the count around.
+static __inline int __kmp_spec_enabled(kmp_adaptive_lock_info_t *info) {
+  kmp_uint32 skip =
+      std::atomic_load_explicit(&info->spec_skip, std::memory_order_relaxed);
+  if (skip == 0)
+    return 1;
+  std::atomic_store_explicit(&info->spec_skip, skip - 1,
+                             std::memory_order_relaxed);
+  return 0;
+}
+
+// Record the outcome of a speculative attempt: status is _XBEGIN_STARTED for a
+// committed transaction, and the abort status otherwise. The thread whose
+// attempt fills the window judges it and starts the next one.
+static void __kmp_spec_record(kmp_adaptive_lock_info_t *info,
+                              kmp_uint32 status) {
+  kmp_uint32 attempts;
+  kmp_uint32 successes;
+
+  if (status == _XBEGIN_STARTED) {
+    KMP_COUNT_BLOCK(LOCK_spec_success);
+    std::atomic_fetch_add_explicit(&info->spec_successes, 1U,
+                                   std::memory_order_relaxed);
+  } else if (status & _XABORT_CONFLICT) {
+    KMP_COUNT_BLOCK(LOCK_spec_abort_conflict);
+  } else if (status & _XABORT_CAPACITY) {
+    KMP_COUNT_BLOCK(LOCK_spec_abort_capacity);
+  } else if (status & _XABORT_EXPLICIT) {
+    // Raised by the runtime itself when it finds the lock held.
+    KMP_COUNT_BLOCK(LOCK_spec_abort_explicit);
+  } else {
+    KMP_COUNT_BLOCK(LOCK_spec_abort_other);
+  }
+
+  attempts = std::atomic_fetch_add_explicit(&info->spec_attempts, 1U,
+                                            std::memory_order_relaxed) +
+             1;
+  if (attempts != __kmp_adaptive_backoff_params.window) {
+    return;
+  }
+  successes = std::atomic_load_explicit(&info->spec_successes,
+                                        std::memory_order_relaxed);
+  if (successes * 100 < attempts * __kmp_adaptive_backoff_params.min_success) {
+    KMP_COUNT_BLOCK(LOCK_spec_disable);
+    KA_TRACE(1000, ("__kmp_spec_record: %u of %u speculations succeeded, "
+                    "disabling speculation for %u acquisitions\n",
+                    successes, attempts, info->spec_disable));
+    std::atomic_store_explicit(&info->spec_skip, info->spec_disable,
+                               std::memory_order_relaxed);
+    if (info->spec_disable < KMP_SPEC_MAX_DISABLE)
+      info->spec_disable <<= 1;
+  } else {
+    info->spec_disable = KMP_SPEC_MIN_DISABLE;
+  }
+  std::atomic_store_explicit(&info->spec_successes, 0U,
+                             std::memory_order_relaxed);
+  std::atomic_store_explicit(&info->spec_attempts, 0U,
+                             std::memory_order_relaxed);
+}
+
 // Functions for manipulating the badness
 static __inline void
 __kmp_update_badness_after_success(kmp_adaptive_lock_t *lck) {
   // Reset the badness to zero so we eagerly try to speculate again
   lck->lk.adaptive.badness = 0;
   KMP_INC_STAT(lck, successfulSpeculations);
+  __kmp_spec_record(&lck->lk.adaptive, _XBEGIN_STARTED);
 }
 
 // Create a bit mask with one more set bit.
@@ -2057,7 +2150,7 @@ static __inline int __kmp_should_speculate(kmp_adaptive_lock_t *lck,
                                            kmp_int32 gtid) {
   kmp_uint32 badness = lck->lk.adaptive.badness;
   kmp_uint32 attempts = lck->lk.adaptive.acquire_attempts;
-  int res = (attempts & badness) == 0;
+  int res = (attempts & badness) == 0 && __kmp_spec_enabled(&lck->lk.adaptive);
   return res;
 }
 
@@ -2072,7 +2165,7 @@ static int __kmp_test_adaptive_lock_only(kmp_adaptive_lock_t *lck,
   // total number of times we started speculation since all speculations must
   // end one of those ways.
   do {
-    kmp_uint32 status = _xbegin();
+    kmp_uint32 status = __kmp_xbegin();
     // Switch this in to disable actual speculation but exercise at least some
     // of the rest of the code. Useful for debugging...
     // kmp_uint32 status = _XABORT_NESTED;
@@ -2085,12 +2178,13 @@ static int __kmp_test_adaptive_lock_only(kmp_adaptive_lock_t *lck,
       if (!__kmp_is_unlocked_queuing_lock(GET_QLK_PTR(lck))) {
         // Lock is now visibly acquired, so someone beat us to it. Abort the
         // transaction so we'll restart from _xbegin with the failure status.
-        _xabort(0x01);
+        __kmp_xabort(0x01);
         KMP_ASSERT2(0, "should not get here");
       }
       return 1; // Lock has been acquired (speculatively)
     } else {
       // We have aborted, update the statistics
+      __kmp_spec_record(&lck->lk.adaptive, status);
       if (status & SOFT_ABORT_MASK) {
         KMP_INC_STAT(lck, softFailedSpeculations);
         // and loop round to retry.
@@ -2210,7 +2304,7 @@ static int __kmp_release_adaptive_lock(kmp_adaptive_lock_t *lck,
           lck))) { // If the lock doesn't look claimed we must be speculating.
     // (Or the user's code is buggy and they're releasing without locking;
     // if we had XTEST we'd be able to check that case...)
-    _xend(); // Exit speculation
+    __kmp_xend(); // Exit speculation
     __kmp_update_badness_after_success(lck);
   } else { // Since the lock *is* visibly locked we're not speculating,
     // so should use the underlying lock's release scheme.
@@ -2244,6 +2338,7 @@ static void __kmp_init_adaptive_lock(kmp_adaptive_lock_t *lck) {
   lck->lk.adaptive.max_soft_retries =
       __kmp_adaptive_backoff_params.max_soft_retries;
   lck->lk.adaptive.max_badness = __kmp_adaptive_backoff_params.max_badness;
+  __kmp_init_spec_learning(&lck->lk.adaptive);
 #if KMP_DEBUG_ADAPTIVE_LOCKS
   __kmp_zero_speculative_stats(&lck->lk.adaptive);
 #endif
@@ -2736,6 +2831,515 @@ static void __kmp_set_drdpa_lock_flags(kmp_drdpa_lock_t *lck,
   lck->lk.flags = flags;
 }
 
+#if KMP_USE_DYNAMIC_LOCK
+/* ------------------------------------------------------------------------ */
+/* cohort locks */
+
+// The package node a thread acquires the lock through: the package of its
+// place, or for a thread that is not bound to a place, that of the proc it
+// runs on. The latter is cached in the thread and looked up again every
+// KMP_COHORT_PKG_RECHECK acquisitions, as the thread may have moved since.
+static inline kmp_int32 __kmp_get_cohort_node(kmp_cohort_lock_t *lck,
+                                              kmp_int32 gtid) {
+#if KMP_AFFINITY_SUPPORTED
+  if (lck->lk.num_nodes > 1 && gtid >= 0) {
+    kmp_info_t *th = __kmp_threads[gtid];
+#if OMP_40_ENABLED
+    int place = th->th.th_current_place;
+    if (place >= 0 && (unsigned)place < __kmp_affinity_num_masks &&
+        __kmp_affinity_place_pkg != NULL) {
+      return __kmp_affinity_place_pkg[place] % lck->lk.num_nodes;
+    }
+#endif
+#if KMP_OS_LINUX
+    if (th->th.th_cohort_pkg_age-- == 0) {
+      int cpu = sched_getcpu();
+      th->th.th_cohort_pkg =
+          (cpu >= 0 && cpu < __kmp_affinity_num_proc_pkg)
+              ? __kmp_affinity_proc_pkg[cpu]
+              : -1;
+      th->th.th_cohort_pkg_age = KMP_COHORT_PKG_RECHECK;
+    }
+    if (th->th.th_cohort_pkg >= 0) {
+      return th->th.th_cohort_pkg % lck->lk.num_nodes;
+    }
+#endif
+  }
+#endif
+  return 0;
+}
+
+// Is a thread other than the holder waiting on the local lock?
+static inline bool __kmp_cohort_has_local_waiters(kmp_ticket_lock_t *lck) {
+  return std::atomic_load_explicit(&lck->lk.next_ticket,
+                                   std::memory_order_relaxed) -
+             std::atomic_load_explicit(&lck->lk.now_serving,
+                                       std::memory_order_relaxed) >
+         1;
+}
+
+static kmp_int32 __kmp_get_cohort_lock_owner(kmp_cohort_lock_t *lck) {
+  return TCR_4(lck->lk.owner_id) - 1;
+}
+
+int __kmp_acquire_cohort_lock(kmp_cohort_lock_t *lck, kmp_int32 gtid) {
+  kmp_int32 node = __kmp_get_cohort_node(lck, gtid);
+  kmp_cohort_lock_node_t *n = &lck->lk.nodes[node];
+
+  __kmp_acquire_ticket_lock(&n->local, gtid);
+  if (!n->global_owned) {
+    __kmp_acquire_ticket_lock(&lck->lk.global, gtid);
+    n->global_owned = TRUE;
+  }
+  lck->lk.owner_node = node;
+  KA_TRACE(1000, ("__kmp_acquire_cohort_lock: T#%d acquired lock %p through "
+                  "node %d\n",
+                  gtid, lck, node));
+  return KMP_LOCK_ACQUIRED_FIRST;
+}
+
+static int __kmp_acquire_cohort_lock_with_checks(kmp_cohort_lock_t *lck,
+                                                 kmp_int32 gtid) {
+  char const *const func = "omp_set_lock";
+  if (lck->lk.initialized != lck) {
+    KMP_FATAL(LockIsUninitialized, func);
+  }
+  if ((gtid >= 0) && (__kmp_get_cohort_lock_owner(lck) == gtid)) {
+    KMP_FATAL(LockIsAlreadyOwned, func);
+  }
+
+  __kmp_acquire_cohort_lock(lck, gtid);
+
+  lck->lk.owner_id = gtid + 1;
+  return KMP_LOCK_ACQUIRED_FIRST;
+}
+
+int __kmp_test_cohort_lock(kmp_cohort_lock_t *lck, kmp_int32 gtid) {
+  kmp_int32 node = __kmp_get_cohort_node(lck, gtid);
+  kmp_cohort_lock_node_t *n = &lck->lk.nodes[node];
+
+  if (!__kmp_test_ticket_lock(&n->local, gtid)) {
+    return FALSE;
+  }
+  if (!n->global_owned) {
+    if (!__kmp_test_ticket_lock(&lck->lk.global, gtid)) {
+      __kmp_release_ticket_lock(&n->local, gtid);
+      return FALSE;
+    }
+    n->global_owned = TRUE;
+  }
+  lck->lk.owner_node = node;
+  return TRUE;
+}
+
+static int __kmp_test_cohort_lock_with_checks(kmp_cohort_lock_t *lck,
+                                              kmp_int32 gtid) {
+  char const *const func = "omp_test_lock";
+  if (lck->lk.initialized != lck) {
+    KMP_FATAL(LockIsUninitialized, func);
+  }
+
+  int retval = __kmp_test_cohort_lock(lck, gtid);
+
+  if (retval) {
+    lck->lk.owner_id = gtid + 1;
+  }
+  return retval;
+}
+
+int __kmp_release_cohort_lock(kmp_cohort_lock_t *lck, kmp_int32 gtid) {
+  kmp_cohort_lock_node_t *n = &lck->lk.nodes[lck->lk.owner_node];
+
+  // Keep the global lock within the package while it has waiters, but only
+  // for a bounded number of handoffs so the other packages are not starved.
+  if (n->handoffs < KMP_COHORT_MAX_HANDOFFS &&
+      __kmp_cohort_has_local_waiters(&n->local)) {
+    n->handoffs++;
+  } else {
+    n->handoffs = 0;
+    n->global_owned = FALSE;
+    __kmp_release_ticket_lock(&lck->lk.global, gtid);
+  }
+  KA_TRACE(1000, ("__kmp_release_cohort_lock: T#%d released lock %p, global "
+                  "lock %s\n",
+                  gtid, lck, n->global_owned ? "handed off" : "released"));
+  __kmp_release_ticket_lock(&n->local, gtid);
+  return KMP_LOCK_RELEASED;
+}
+
+static int __kmp_release_cohort_lock_with_checks(kmp_cohort_lock_t *lck,
+                                                 kmp_int32 gtid) {
+  char const *const func = "omp_unset_lock";
+  if (lck->lk.initialized != lck) {
+    KMP_FATAL(LockIsUninitialized, func);
+  }
+  if (__kmp_get_cohort_lock_owner(lck) == -1) {
+    KMP_FATAL(LockUnsettingFree, func);
+  }
+  if ((gtid >= 0) && (__kmp_get_cohort_lock_owner(lck) >= 0) &&
+      (__kmp_get_cohort_lock_owner(lck) != gtid)) {
+    KMP_FATAL(LockUnsettingSetByAnother, func);
+  }
+  lck->lk.owner_id = 0;
+  return __kmp_release_cohort_lock(lck, gtid);
+}
+
+void __kmp_init_cohort_lock(kmp_cohort_lock_t *lck) {
+  kmp_uint32 num_nodes = 1;
+  kmp_uint32 i;
+
+#if KMP_AFFINITY_SUPPORTED
+  // The package map is built with the affinity masks, or without them from
+  // the procs alone.
+  if (!TCR_4(__kmp_init_middle)) {
+    __kmp_middle_initialize();
+  }
+  if (__kmp_affinity_num_pkgs > 1) {
+    num_nodes = __kmp_affinity_num_pkgs;
+  }
+#endif
+  lck->lk.location = NULL;
+  lck->lk.nodes = (kmp_cohort_lock_node_t *)__kmp_allocate(
+      num_nodes * sizeof(kmp_cohort_lock_node_t));
+  for (i = 0; i < num_nodes; i++) {
+    __kmp_init_ticket_lock(&lck->lk.nodes[i].local);
+    lck->lk.nodes[i].global_owned = FALSE;
+    lck->lk.nodes[i].handoffs = 0;
+  }
+  lck->lk.num_nodes = num_nodes;
+  __kmp_init_ticket_lock(&lck->lk.global);
+  lck->lk.owner_id = 0;
+  lck->lk.owner_node = 0;
+  lck->lk.flags = 0;
+  lck->lk.initialized = lck;
+
+  KA_TRACE(1000, ("__kmp_init_cohort_lock: lock %p initialized with %u "
+                  "nodes\n",
+                  lck, num_nodes));
+}
+
+void __kmp_destroy_cohort_lock(kmp_cohort_lock_t *lck) {
+  kmp_uint32 i;
+  lck->lk.initialized = NULL;
+  lck->lk.location = NULL;
+  if (lck->lk.nodes != NULL) {
+    for (i = 0; i < lck->lk.num_nodes; i++) {
+      __kmp_destroy_ticket_lock(&lck->lk.nodes[i].local);
+    }
+    __kmp_free(lck->lk.nodes);
+    lck->lk.nodes = NULL;
+  }
+  lck->lk.num_nodes = 0;
+  __kmp_destroy_ticket_lock(&lck->lk.global);
+  lck->lk.owner_id = 0;
+}
+
+static const ident_t *__kmp_get_cohort_lock_location(kmp_cohort_lock_t *lck) {
+  return lck->lk.location;
+}
+
+static void __kmp_set_cohort_lock_location(kmp_cohort_lock_t *lck,
+                                           const ident_t *loc) {
+  lck->lk.location = loc;
+}
+
+static kmp_lock_flags_t __kmp_get_cohort_lock_flags(kmp_cohort_lock_t *lck) {
+  return lck->lk.flags;
+}
+
+static void __kmp_set_cohort_lock_flags(kmp_cohort_lock_t *lck,
+                                        kmp_lock_flags_t flags) {
+  lck->lk.flags = flags;
+}
+
+/* ------------------------------------------------------------------------ */
+/* morphing locks */
+
+static kmp_int32 __kmp_get_morph_lock_owner(kmp_morph_lock_t *lck) {
+  return TCR_4(lck->lk.owner_id) - 1;
+}
+
+#define KMP_MORPH_LOCK_OVERSUBSCRIBED()                                        \
+  (TCR_4(__kmp_nth) > (__kmp_avail_proc ? __kmp_avail_proc : __kmp_xproc))
+
+// Takes the poll word, spinning for a while and then sleeping until it is
+// released. Returns the number of times the thread slept.
+static kmp_uint32 __kmp_morph_lock_take_poll(kmp_morph_lock_t *lck,
+                                             kmp_int32 gtid) {
+  kmp_int32 gtid_code = (gtid + 1) << 1;
+  kmp_uint32 spins = KMP_MORPH_LOCK_SPINS;
+  kmp_uint32 sleeps = 0;
+  kmp_int32 poll_val;
+
+  while ((poll_val = KMP_COMPARE_AND_STORE_RET32(&lck->lk.poll, 0,
+                                                 gtid_code)) != 0) {
+    if (spins > 0) {
+      spins--;
+      KMP_CPU_PAUSE();
+      KMP_YIELD(KMP_MORPH_LOCK_OVERSUBSCRIBED());
+      continue;
+    }
+#if KMP_USE_FUTEX
+    // Same protocol as the futex lock: bit 0 asks the owner for a wakeup, and
+    // a thread that slept keeps it set since other sleepers may remain.
+    if (!(poll_val & 1)) {
+      if (!KMP_COMPARE_AND_STORE_REL32(&lck->lk.poll, poll_val,
+                                       poll_val | 1)) {
+        continue;
+      }
+      poll_val |= 1;
+    }
+    if (syscall(__NR_futex, &lck->lk.poll, FUTEX_WAIT, poll_val, NULL, NULL,
+                0) != 0) {
+      continue;
+    }
+    KMP_COUNT_BLOCK(LOCK_morph_sleep);
+    sleeps++;
+    gtid_code |= 1;
+#else
+    KMP_YIELD(TRUE);
+#endif
+  }
+  return sleeps;
+}
+
+// Waits until now_serving reaches my_ticket. Returns the number of times the
+// thread slept.
+static kmp_uint32 __kmp_morph_lock_wait_turn(kmp_morph_lock_t *lck,
+                                             kmp_int32 my_ticket) {
+  kmp_uint32 spins = KMP_MORPH_LOCK_SPINS;
+  kmp_uint32 sleeps = 0;
+  kmp_int32 serving;
+
+  while ((serving = TCR_4(lck->lk.now_serving)) != my_ticket) {
+    if (spins > 0) {
+      spins--;
+      KMP_CPU_PAUSE();
+      KMP_YIELD(KMP_MORPH_LOCK_OVERSUBSCRIBED());
+      continue;
+    }
+#if KMP_USE_FUTEX
+    KMP_TEST_THEN_INC32(&lck->lk.sleepers);
+    if (syscall(__NR_futex, &lck->lk.now_serving, FUTEX_WAIT, serving, NULL,
+                NULL, 0) == 0) {
+      KMP_COUNT_BLOCK(LOCK_morph_sleep);
+      sleeps++;
+    }
+    KMP_TEST_THEN_DEC32(&lck->lk.sleepers);
+#else
+    KMP_YIELD(TRUE);
+#endif
+  }
+  KMP_MB();
+  return sleeps;
+}
+
+// Lets the next queued thread compete for the poll word.
+static void __kmp_morph_lock_next_turn(kmp_morph_lock_t *lck) {
+  KMP_TEST_THEN_INC32(&lck->lk.now_serving);
+#if KMP_USE_FUTEX
+  if (TCR_4(lck->lk.sleepers) > 0) {
+    // Sleepers wait for different tickets, so wake them all.
+    syscall(__NR_futex, &lck->lk.now_serving, FUTEX_WAKE, KMP_INT_MAX, NULL,
+            NULL, 0);
+  }
+#endif
+}
+
+// Accounts an acquisition and switches the mode at the end of a window.
+// Called by the new lock holder.
+static void __kmp_morph_lock_acquired(kmp_morph_lock_t *lck, kmp_int32 gtid,
+                                      int contended, kmp_uint32 sleeps) {
+  lck->lk.acquires++;
+  lck->lk.sleeps += sleeps;
+  lck->lk.window_acquires++;
+  if (contended) {
+    lck->lk.contended++;
+    lck->lk.window_contended++;
+  }
+  if (lck->lk.window_acquires < KMP_MORPH_LOCK_WINDOW)
+    return;
+
+  if (lck->lk.mode == KMP_MORPH_LOCK_TAS &&
+      lck->lk.window_contended >= KMP_MORPH_LOCK_INFLATE) {
+    TCW_4(lck->lk.mode, KMP_MORPH_LOCK_QUEUE);
+    lck->lk.inflations++;
+    KMP_COUNT_BLOCK(LOCK_morph_inflate);
+    KA_TRACE(1000, ("__kmp_morph_lock_acquired: T#%d inflated lock %p (%u of "
+                    "%u contended)\n",
+                    gtid, lck, lck->lk.window_contended,
+                    lck->lk.window_acquires));
+  } else if (lck->lk.mode == KMP_MORPH_LOCK_QUEUE &&
+             lck->lk.window_contended <= KMP_MORPH_LOCK_DEFLATE) {
+    TCW_4(lck->lk.mode, KMP_MORPH_LOCK_TAS);
+    lck->lk.deflations++;
+    KMP_COUNT_BLOCK(LOCK_morph_deflate);
+    KA_TRACE(1000, ("__kmp_morph_lock_acquired: T#%d deflated lock %p (%u of "
+                    "%u contended)\n",
+                    gtid, lck, lck->lk.window_contended,
+                    lck->lk.window_acquires));
+  }
+  lck->lk.window_acquires = 0;
+  lck->lk.window_contended = 0;
+}
+
+int __kmp_acquire_morph_lock(kmp_morph_lock_t *lck, kmp_int32 gtid) {
+  kmp_uint32 sleeps = 0;
+  int contended = 0;
+
+  if (TCR_4(lck->lk.mode) == KMP_MORPH_LOCK_TAS) {
+    if (TCR_4(lck->lk.poll) == 0 &&
+        KMP_COMPARE_AND_STORE_ACQ32(&lck->lk.poll, 0, (gtid + 1) << 1)) {
+      __kmp_morph_lock_acquired(lck, gtid, 0, 0);
+      return KMP_LOCK_ACQUIRED_FIRST;
+    }
+    contended = 1;
+  }
+  if (TCR_4(lck->lk.mode) == KMP_MORPH_LOCK_QUEUE) {
+    kmp_int32 my_ticket = KMP_TEST_THEN_INC32(&lck->lk.next_ticket);
+    if (TCR_4(lck->lk.now_serving) != my_ticket || TCR_4(lck->lk.poll) != 0)
+      contended = 1;
+    sleeps += __kmp_morph_lock_wait_turn(lck, my_ticket);
+    sleeps += __kmp_morph_lock_take_poll(lck, gtid);
+    __kmp_morph_lock_next_turn(lck);
+  } else {
+    sleeps += __kmp_morph_lock_take_poll(lck, gtid);
+  }
+  __kmp_morph_lock_acquired(lck, gtid, contended, sleeps);
+  return KMP_LOCK_ACQUIRED_FIRST;
+}
+
+static int __kmp_acquire_morph_lock_with_checks(kmp_morph_lock_t *lck,
+                                                kmp_int32 gtid) {
+  char const *const func = "omp_set_lock";
+  if (lck->lk.initialized != lck) {
+    KMP_FATAL(LockIsUninitialized, func);
+  }
+  if ((gtid >= 0) && (__kmp_get_morph_lock_owner(lck) == gtid)) {
+    KMP_FATAL(LockIsAlreadyOwned, func);
+  }
+
+  __kmp_acquire_morph_lock(lck, gtid);
+
+  lck->lk.owner_id = gtid + 1;
+  return KMP_LOCK_ACQUIRED_FIRST;
+}
+
+int __kmp_test_morph_lock(kmp_morph_lock_t *lck, kmp_int32 gtid) {
+  if (TCR_4(lck->lk.poll) == 0 &&
+      KMP_COMPARE_AND_STORE_ACQ32(&lck->lk.poll, 0, (gtid + 1) << 1)) {
+    __kmp_morph_lock_acquired(lck, gtid, 0, 0);
+    return TRUE;
+  }
+  return FALSE;
+}
+
+static int __kmp_test_morph_lock_with_checks(kmp_morph_lock_t *lck,
+                                             kmp_int32 gtid) {
+  char const *const func = "omp_test_lock";
+  if (lck->lk.initialized != lck) {
+    KMP_FATAL(LockIsUninitialized, func);
+  }
+
+  int retval = __kmp_test_morph_lock(lck, gtid);
+
+  if (retval) {
+    lck->lk.owner_id = gtid + 1;
+  }
+  return retval;
+}
+
+int __kmp_release_morph_lock(kmp_morph_lock_t *lck, kmp_int32 gtid) {
+  KMP_MB(); /* Flush all pending memory write invalidates.  */
+
+  kmp_int32 poll_val = KMP_XCHG_FIXED32(&lck->lk.poll, 0);
+#if KMP_USE_FUTEX
+  if (poll_val & 1) {
+    syscall(__NR_futex, &lck->lk.poll, FUTEX_WAKE, 1, NULL, NULL, 0);
+  }
+#endif
+  KA_TRACE(1000, ("__kmp_release_morph_lock: T#%d released lock %p, poll_val "
+                  "= 0x%x\n",
+                  gtid, lck, poll_val));
+
+  KMP_YIELD(KMP_MORPH_LOCK_OVERSUBSCRIBED());
+  return KMP_LOCK_RELEASED;
+}
+
+static int __kmp_release_morph_lock_with_checks(kmp_morph_lock_t *lck,
+                                                kmp_int32 gtid) {
+  char const *const func = "omp_unset_lock";
+  if (lck->lk.initialized != lck) {
+    KMP_FATAL(LockIsUninitialized, func);
+  }
+  if (__kmp_get_morph_lock_owner(lck) == -1) {
+    KMP_FATAL(LockUnsettingFree, func);
+  }
+  if ((gtid >= 0) && (__kmp_get_morph_lock_owner(lck) >= 0) &&
+      (__kmp_get_morph_lock_owner(lck) != gtid)) {
+    KMP_FATAL(LockUnsettingSetByAnother, func);
+  }
+  lck->lk.owner_id = 0;
+  return __kmp_release_morph_lock(lck, gtid);
+}
+
+void __kmp_init_morph_lock(kmp_morph_lock_t *lck) {
+  lck->lk.poll = 0;
+  lck->lk.mode = KMP_MORPH_LOCK_TAS;
+  lck->lk.next_ticket = 0;
+  lck->lk.now_serving = 0;
+  lck->lk.sleepers = 0;
+  lck->lk.location = NULL;
+  lck->lk.flags = 0;
+  lck->lk.owner_id = 0;
+  lck->lk.window_acquires = 0;
+  lck->lk.window_contended = 0;
+  lck->lk.acquires = 0;
+  lck->lk.contended = 0;
+  lck->lk.sleeps = 0;
+  lck->lk.inflations = 0;
+  lck->lk.deflations = 0;
+  lck->lk.initialized = lck;
+
+  KA_TRACE(1000, ("__kmp_init_morph_lock: lock %p initialized\n", lck));
+}
+
+void __kmp_destroy_morph_lock(kmp_morph_lock_t *lck) {
+  KA_TRACE(1000, ("__kmp_destroy_morph_lock: lock %p: %llu acquires, %llu "
+                  "contended, %llu sleeps, %u inflations, %u deflations\n",
+                  lck, lck->lk.acquires, lck->lk.contended, lck->lk.sleeps,
+                  lck->lk.inflations, lck->lk.deflations));
+#if KMP_STATS_ENABLED
+  if (__kmp_stats_thread_ptr != NULL && lck->lk.acquires > 0) {
+    KMP_COUNT_VALUE(LOCK_morph_acquires, lck->lk.acquires);
+    KMP_COUNT_VALUE(LOCK_morph_contended, lck->lk.contended);
+  }
+#endif
+  lck->lk.initialized = NULL;
+  lck->lk.location = NULL;
+  lck->lk.poll = 0;
+  lck->lk.owner_id = 0;
+}
+
+static const ident_t *__kmp_get_morph_lock_location(kmp_morph_lock_t *lck) {
+  return lck->lk.location;
+}
+
+static void __kmp_set_morph_lock_location(kmp_morph_lock_t *lck,
+                                          const ident_t *loc) {
+  lck->lk.location = loc;
+}
+
+static kmp_lock_flags_t __kmp_get_morph_lock_flags(kmp_morph_lock_t *lck) {
+  return lck->lk.flags;
+}
+
+static void __kmp_set_morph_lock_flags(kmp_morph_lock_t *lck,
+                                       kmp_lock_flags_t flags) {
+  lck->lk.flags = flags;
+}
+#endif // KMP_USE_DYNAMIC_LOCK
+
 // Time stamp counter
 #if KMP_ARCH_X86 || KMP_ARCH_X86_64
 #define __kmp_tsc() __kmp_hardware_timestamp()
@@ -2772,6 +3376,361 @@ void __kmp_spin_backoff(kmp_backoff_t *boff) {
   boff->step = (boff->step << 1 | 1) & (boff->max_backoff - 1);
 }
 
+/* ------------------------------------------------------------------------ */
+/* lock profiling */
+
+#define KMP_LOCK_PROFILE_HASH 1024 // must be a power of 2
+#define KMP_LOCK_PROFILE_BUCKETS 32 // log2 wait time histogram
+
+typedef struct kmp_lock_profile_entry {
+  void *lock;
+  ident_t const *loc;
+  kmp_lock_profile_kind_t kind;
+  volatile kmp_int64 samples;
+  volatile kmp_int64 wait_total;
+  volatile kmp_int64 wait_max;
+  volatile kmp_int64 hist[KMP_LOCK_PROFILE_BUCKETS]; // by floor(log2(wait))
+  struct kmp_lock_profile_entry *volatile next;
+} kmp_lock_profile_entry_t;
+
+int __kmp_lock_profile_period = 0;
+
+// Entries are only added, at the head of their chain, until cleanup, so the
+// chains can be searched without the lock.
+static kmp_lock_profile_entry_t *volatile
+    __kmp_lock_profile_table[KMP_LOCK_PROFILE_HASH];
+static kmp_bootstrap_lock_t __kmp_lock_profile_lock =
+    KMP_BOOTSTRAP_LOCK_INITIALIZER(__kmp_lock_profile_lock);
+static kmp_int32 __kmp_lock_profile_entries = 0;
+
+// The call site that last acquired a lock, in a slot picked by the lock's
+// address. A lock is only acquired again once its holder released it, so the
+// slot names the holder a waiter waited for, unless another lock that maps to
+// the same slot is acquired at the same time. Each slot has a cache line of
+// its own, and is only written when its holder changes, so that acquiring
+// one lock does not invalidate the slots of the locks next to it.
+typedef struct KMP_ALIGN_CACHE kmp_lock_profile_holder {
+  void *volatile lock;
+  ident_t const *volatile loc;
+} kmp_lock_profile_holder_t;
+
+static kmp_lock_profile_holder_t
+    __kmp_lock_profile_holders[KMP_LOCK_PROFILE_HASH];
+KMP_BUILD_ASSERT(sizeof(kmp_lock_profile_holder_t) == CACHE_LINE);
+
+kmp_uint64 __kmp_lock_profile_sample(kmp_int32 gtid) {
+  if (gtid < 0)
+    return 0;
+  kmp_info_t *th = __kmp_threads[gtid];
+  if (++th->th.th_lock_prof_count < (kmp_uint32)__kmp_lock_profile_period)
+    return 0;
+  th->th.th_lock_prof_count = 0;
+  return __kmp_tsc() | 1;
+}
+
+static kmp_lock_profile_entry_t *
+__kmp_lock_profile_find(void *lock, ident_t const *loc,
+                        kmp_lock_profile_kind_t kind) {
+  kmp_uint32 h = (kmp_uint32)((((kmp_uintptr_t)lock) >> 3) ^
+                              (((kmp_uintptr_t)loc) >> 3)) &
+                 (KMP_LOCK_PROFILE_HASH - 1);
+  kmp_lock_profile_entry_t *e;
+
+  for (e = (kmp_lock_profile_entry_t *)TCR_PTR(__kmp_lock_profile_table[h]);
+       e != NULL; e = e->next) {
+    if (e->lock == lock && e->loc == loc)
+      return e;
+  }
+
+  __kmp_acquire_bootstrap_lock(&__kmp_lock_profile_lock);
+  for (e = __kmp_lock_profile_table[h]; e != NULL; e = e->next) {
+    if (e->lock == lock && e->loc == loc)
+      break;
+  }
+  if (e == NULL) {
+    e = (kmp_lock_profile_entry_t *)__kmp_allocate(
+        sizeof(kmp_lock_profile_entry_t));
+    e->lock = lock;
+    e->loc = loc;
+    e->kind = kind;
+    e->next = __kmp_lock_profile_table[h];
+    KMP_MB();
+    TCW_PTR(__kmp_lock_profile_table[h], e);
+    __kmp_lock_profile_entries++;
+  }
+  __kmp_release_bootstrap_lock(&__kmp_lock_profile_lock);
+  return e;
+}
+
+// Notes that call site loc now holds lock. If the acquisition was sampled,
+// i.e. start is not 0, its wait is accounted to the call site that held the
+// lock before, or to loc if that is unknown.
+void __kmp_lock_profile_acquired(void *lock, ident_t const *loc,
+                                 kmp_lock_profile_kind_t kind,
+                                 kmp_uint64 start) {
+  kmp_lock_profile_holder_t *slot =
+      &__kmp_lock_profile_holders[(((kmp_uintptr_t)lock) >> 3) &
+                                  (KMP_LOCK_PROFILE_HASH - 1)];
+  ident_t const *holder = NULL;
+
+  if (start != 0 && TCR_PTR(slot->lock) == lock) {
+    holder = (ident_t const *)TCR_PTR(slot->loc);
+    if (TCR_PTR(slot->lock) != lock)
+      holder = NULL;
+  }
+  if (TCR_PTR(slot->lock) != lock || TCR_PTR(slot->loc) != loc) {
+    TCW_PTR(slot->lock, NULL);
+    TCW_PTR(slot->loc, loc);
+    TCW_PTR(slot->lock, lock);
+  }
+  if (start == 0)
+    return;
+
+  kmp_int64 wait = (kmp_int64)(__kmp_tsc() - start);
+  kmp_lock_profile_entry_t *e =
+      __kmp_lock_profile_find(lock, holder ? holder : loc, kind);
+  int bucket = 0;
+  kmp_int64 max;
+
+  if (wait < 0)
+    wait = 0;
+  while (bucket < KMP_LOCK_PROFILE_BUCKETS - 1 && (wait >> (bucket + 1)) != 0)
+    bucket++;
+  KMP_TEST_THEN_INC64(&e->samples);
+  KMP_TEST_THEN_ADD64(&e->wait_total, wait);
+  KMP_TEST_THEN_INC64(&e->hist[bucket]);
+  while (wait > (max = TCR_8(e->wait_max)) &&
+         !KMP_COMPARE_AND_STORE_ACQ64(&e->wait_max, max, wait))
+    ;
+}
+
+static int __kmp_lock_profile_cmp(const void *a, const void *b) {
+  kmp_int64 wa = (*(kmp_lock_profile_entry_t *const *)a)->wait_total;
+  kmp_int64 wb = (*(kmp_lock_profile_entry_t *const *)b)->wait_total;
+  return wa > wb ? -1 : wa < wb ? 1 : 0;
+}
+
+// Prints the profile, the locks with the longest total wait first.
+void __kmp_lock_profile_dump(void) {
+  static const char *kinds[] = {"lock", "nest_lock", "critical"};
+  kmp_lock_profile_entry_t **entries;
+  kmp_int32 n = 0, i, b;
+
+  if (__kmp_lock_profile_period == 0)
+    return;
+
+  __kmp_acquire_bootstrap_lock(&__kmp_lock_profile_lock);
+  entries = (kmp_lock_profile_entry_t **)__kmp_allocate(
+      (__kmp_lock_profile_entries + 1) * sizeof(kmp_lock_profile_entry_t *));
+  for (i = 0; i < KMP_LOCK_PROFILE_HASH; i++) {
+    kmp_lock_profile_entry_t *e;
+    for (e = __kmp_lock_profile_table[i]; e != NULL; e = e->next)
+      entries[n++] = e;
+  }
+  __kmp_release_bootstrap_lock(&__kmp_lock_profile_lock);
+  qsort(entries, n, sizeof(*entries), __kmp_lock_profile_cmp);
+
+  kmp_str_buf_t buf;
+  __kmp_str_buf_init(&buf);
+  __kmp_str_buf_print(
+      &buf, "Lock profile: 1 in %d acquisitions sampled, wait times in ticks\n",
+      __kmp_lock_profile_period);
+  __kmp_str_buf_print(&buf, "%-10s %-18s %10s %14s %12s %12s  %s\n", "kind",
+                      "lock", "samples", "acquisitions", "mean wait",
+                      "max wait", "holder call site");
+  for (i = 0; i < n; i++) {
+    kmp_lock_profile_entry_t *e = entries[i];
+    __kmp_str_buf_print(
+        &buf, "%-10s %-18p %10lld %14lld %12lld %12lld  %s\n", kinds[e->kind],
+        e->lock, (long long)e->samples,
+        (long long)e->samples * __kmp_lock_profile_period,
+        (long long)(e->samples ? e->wait_total / e->samples : 0),
+        (long long)e->wait_max,
+        (e->loc && e->loc->psource) ? e->loc->psource : "unknown");
+    __kmp_str_buf_print(&buf, "%-10s wait histogram (log2 ticks: samples):",
+                        "");
+    for (b = 0; b < KMP_LOCK_PROFILE_BUCKETS; b++) {
+      if (e->hist[b])
+        __kmp_str_buf_print(&buf, " %d:%lld", b, (long long)e->hist[b]);
+    }
+    __kmp_str_buf_print(&buf, "\n");
+  }
+  __kmp_printf("%s", buf.str);
+  __kmp_str_buf_free(&buf);
+  __kmp_free(entries);
+}
+
+void __kmp_cleanup_lock_profile(void) {
+  kmp_int32 i;
+
+  if (__kmp_lock_profile_entries == 0)
+    return;
+  __kmp_lock_profile_dump();
+  for (i = 0; i < KMP_LOCK_PROFILE_HASH; i++) {
+    kmp_lock_profile_entry_t *e = __kmp_lock_profile_table[i];
+    while (e != NULL) {
+      kmp_lock_profile_entry_t *next = e->next;
+      __kmp_free(e);
+      e = next;
+    }
+    __kmp_lock_profile_table[i] = NULL;
+  }
+  __kmp_lock_profile_entries = 0;
+}
+
+/* ------------------------------------------------------------------------ */
+/* reader-writer locks */
+
+static kmp_rw_lock_t *__kmp_lookup_rw_lock(void **user_lock, char const *func) {
+  kmp_rw_lock_t *lck = *(kmp_rw_lock_t **)user_lock;
+
+  if (__kmp_env_consistency_check &&
+      (lck == NULL || lck->initialized != lck)) {
+    KMP_FATAL(LockIsUninitialized, func);
+  }
+  return lck;
+}
+
+void __kmp_init_rw_lock(void **user_lock, ident_t const *loc, kmp_int32 gtid) {
+  kmp_rw_lock_t *lck =
+      (kmp_rw_lock_t *)__kmp_allocate(sizeof(kmp_rw_lock_t));
+  kmp_uint32 slots = 1;
+
+  while (slots < (kmp_uint32)__kmp_xproc && slots < KMP_RW_LOCK_MAX_SLOTS)
+    slots <<= 1;
+  lck->num_slots = slots;
+  lck->slots =
+      (kmp_rw_lock_slot_t *)__kmp_allocate(slots * sizeof(kmp_rw_lock_slot_t));
+  lck->location = loc;
+  __kmp_init_ticket_lock(&lck->writers);
+  lck->writer = 0;
+  lck->initialized = lck;
+  *(kmp_rw_lock_t **)user_lock = lck;
+
+#if USE_ITT_BUILD
+  __kmp_itt_rwlock_creating(lck, loc);
+#endif
+#if OMPT_SUPPORT && OMPT_TRACE
+  if (ompt_enabled && ompt_callbacks.ompt_callback(ompt_event_init_lock)) {
+    ompt_callbacks.ompt_callback(ompt_event_init_lock)((uint64_t)lck);
+  }
+#endif
+  KA_TRACE(1000, ("__kmp_init_rw_lock: T#%d lock %p, %u slots\n", gtid, lck,
+                  slots));
+}
+
+void __kmp_destroy_rw_lock(void **user_lock, kmp_int32 gtid) {
+  char const *const func = "kmp_rwlock_destroy";
+  kmp_rw_lock_t *lck = __kmp_lookup_rw_lock(user_lock, func);
+  kmp_uint32 i;
+
+  if (__kmp_env_consistency_check) {
+    if (lck->writer != 0)
+      KMP_FATAL(LockStillOwned, func);
+    for (i = 0; i < lck->num_slots; i++) {
+      if (lck->slots[i].readers != 0)
+        KMP_FATAL(LockStillOwned, func);
+    }
+  }
+#if OMPT_SUPPORT && OMPT_TRACE
+  if (ompt_enabled && ompt_callbacks.ompt_callback(ompt_event_destroy_lock)) {
+    ompt_callbacks.ompt_callback(ompt_event_destroy_lock)((uint64_t)lck);
+  }
+#endif
+#if USE_ITT_BUILD
+  __kmp_itt_rwlock_destroyed(lck);
+#endif
+  __kmp_destroy_ticket_lock(&lck->writers);
+  lck->initialized = NULL;
+  __kmp_free(lck->slots);
+  __kmp_free(lck);
+  *(kmp_rw_lock_t **)user_lock = NULL;
+}
+
+void __kmp_acquire_rw_lock_read(void **user_lock, kmp_int32 gtid) {
+  kmp_rw_lock_t *lck = __kmp_lookup_rw_lock(user_lock, "kmp_rwlock_rdlock");
+  kmp_rw_lock_slot_t *slot = &lck->slots[gtid & (lck->num_slots - 1)];
+
+  if (__kmp_env_consistency_check && TCR_4(lck->writer) == (kmp_uint32)gtid + 1)
+    KMP_FATAL(LockIsAlreadyOwned, "kmp_rwlock_rdlock");
+
+#if USE_ITT_BUILD
+  __kmp_itt_rwlock_acquiring(lck);
+#endif
+  for (;;) {
+    if (TCR_4(lck->writer) == 0) {
+      // The increment is a full fence, so either the writer sees our count or
+      // we see its flag.
+      KMP_TEST_THEN_INC32(&slot->readers);
+      if (TCR_4(lck->writer) == 0)
+        break;
+      KMP_TEST_THEN_DEC32(&slot->readers);
+    }
+    KMP_WAIT_YIELD(&lck->writer, 0, __kmp_eq_4, lck);
+  }
+#if USE_ITT_BUILD
+  __kmp_itt_rwlock_acquired(lck);
+#endif
+#if OMPT_SUPPORT && OMPT_TRACE
+  if (ompt_enabled && ompt_callbacks.ompt_callback(ompt_event_acquired_lock)) {
+    ompt_callbacks.ompt_callback(ompt_event_acquired_lock)((uint64_t)lck);
+  }
+#endif
+}
+
+void __kmp_acquire_rw_lock_write(void **user_lock, kmp_int32 gtid) {
+  kmp_rw_lock_t *lck = __kmp_lookup_rw_lock(user_lock, "kmp_rwlock_wrlock");
+  kmp_uint32 i;
+
+  if (__kmp_env_consistency_check && TCR_4(lck->writer) == (kmp_uint32)gtid + 1)
+    KMP_FATAL(LockIsAlreadyOwned, "kmp_rwlock_wrlock");
+
+#if USE_ITT_BUILD
+  __kmp_itt_rwlock_acquiring(lck);
+#endif
+  __kmp_acquire_ticket_lock(&lck->writers, gtid);
+  TCW_4(lck->writer, gtid + 1);
+  KMP_MB();
+  for (i = 0; i < lck->num_slots; i++) {
+    KMP_WAIT_YIELD((volatile kmp_uint32 *)&lck->slots[i].readers, 0,
+                   __kmp_eq_4, lck);
+  }
+#if USE_ITT_BUILD
+  __kmp_itt_rwlock_acquired(lck);
+#endif
+#if OMPT_SUPPORT && OMPT_TRACE
+  if (ompt_enabled && ompt_callbacks.ompt_callback(ompt_event_acquired_lock)) {
+    ompt_callbacks.ompt_callback(ompt_event_acquired_lock)((uint64_t)lck);
+  }
+#endif
+}
+
+// Releases the write lock if the caller holds it, and its read lock otherwise.
+void __kmp_release_rw_lock(void **user_lock, kmp_int32 gtid) {
+  kmp_rw_lock_t *lck = __kmp_lookup_rw_lock(user_lock, "kmp_rwlock_unlock");
+  kmp_rw_lock_slot_t *slot = &lck->slots[gtid & (lck->num_slots - 1)];
+  int writing = (TCR_4(lck->writer) == (kmp_uint32)gtid + 1);
+
+  if (__kmp_env_consistency_check && !writing && TCR_4(slot->readers) == 0)
+    KMP_FATAL(LockUnsettingFree, "kmp_rwlock_unlock");
+
+#if USE_ITT_BUILD
+  __kmp_itt_rwlock_releasing(lck);
+#endif
+  if (writing) {
+    KMP_MB();
+    TCW_4(lck->writer, 0);
+    __kmp_release_ticket_lock(&lck->writers, gtid);
+  } else {
+    KMP_TEST_THEN_DEC32(&slot->readers);
+  }
+#if OMPT_SUPPORT && OMPT_TRACE
+  if (ompt_enabled && ompt_callbacks.ompt_callback(ompt_event_release_lock)) {
+    ompt_callbacks.ompt_callback(ompt_event_release_lock)((uint64_t)lck);
+  }
+#endif
+}
+
 #if KMP_USE_DYNAMIC_LOCK
 
 // Direct lock initializers. It simply writes a tag to the low 8 bits of the
@@ -2838,71 +3797,87 @@ static int __kmp_test_hle_lock_with_checks(kmp_dyna_lock_t *lck,
   return __kmp_test_hle_lock(lck, gtid); // TODO: add checks
 }
 
-static void __kmp_init_rtm_lock(kmp_queuing_lock_t *lck) {
-  __kmp_init_queuing_lock(lck);
+// The rtm lock is a queuing lock elided with RTM. It keeps the adaptive lock's
+// layout so that it can learn when to stop speculating, but does not use the
+// adaptive lock's badness backoff.
+static void __kmp_init_rtm_lock(kmp_adaptive_lock_t *lck) {
+  __kmp_init_queuing_lock(GET_QLK_PTR(lck));
+  __kmp_init_spec_learning(&lck->lk.adaptive);
 }
 
-static void __kmp_destroy_rtm_lock(kmp_queuing_lock_t *lck) {
-  __kmp_destroy_queuing_lock(lck);
+static void __kmp_destroy_rtm_lock(kmp_adaptive_lock_t *lck) {
+  __kmp_destroy_queuing_lock(GET_QLK_PTR(lck));
 }
 
-static void __kmp_acquire_rtm_lock(kmp_queuing_lock_t *lck, kmp_int32 gtid) {
-  unsigned retries = 3, status;
-  do {
-    status = _xbegin();
-    if (status == _XBEGIN_STARTED) {
-      if (__kmp_is_unlocked_queuing_lock(lck))
-        return;
-      _xabort(0xff);
-    }
-    if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == 0xff) {
-      // Wait until lock becomes free
-      while (!__kmp_is_unlocked_queuing_lock(lck))
-        __kmp_yield(TRUE);
-    } else if (!(status & _XABORT_RETRY))
-      break;
-  } while (retries--);
+static void __kmp_acquire_rtm_lock(kmp_adaptive_lock_t *lck, kmp_int32 gtid) {
+  kmp_queuing_lock_t *qlk = GET_QLK_PTR(lck);
+  if (__kmp_spec_enabled(&lck->lk.adaptive)) {
+    unsigned retries = 3, status;
+    do {
+      status = __kmp_xbegin();
+      if (status == _XBEGIN_STARTED) {
+        if (__kmp_is_unlocked_queuing_lock(qlk))
+          return;
+        __kmp_xabort(0xff);
+      }
+      __kmp_spec_record(&lck->lk.adaptive, status);
+      if ((status & _XABORT_EXPLICIT) && _XABORT_CODE(status) == 0xff) {
+        // Wait until lock becomes free
+        while (!__kmp_is_unlocked_queuing_lock(qlk))
+          __kmp_yield(TRUE);
+      } else if (!(status & _XABORT_RETRY))
+        break;
+    } while (retries--);
+  }
 
   // Fall-back non-speculative lock (xchg)
-  __kmp_acquire_queuing_lock(lck, gtid);
+  __kmp_acquire_queuing_lock(qlk, gtid);
 }
 
-static void __kmp_acquire_rtm_lock_with_checks(kmp_queuing_lock_t *lck,
+static void __kmp_acquire_rtm_lock_with_checks(kmp_adaptive_lock_t *lck,
                                                kmp_int32 gtid) {
   __kmp_acquire_rtm_lock(lck, gtid);
 }
 
-static int __kmp_release_rtm_lock(kmp_queuing_lock_t *lck, kmp_int32 gtid) {
-  if (__kmp_is_unlocked_queuing_lock(lck)) {
+static int __kmp_release_rtm_lock(kmp_adaptive_lock_t *lck, kmp_int32 gtid) {
+  kmp_queuing_lock_t *qlk = GET_QLK_PTR(lck);
+  if (__kmp_is_unlocked_queuing_lock(qlk)) {
     // Releasing from speculation
-    _xend();
+    __kmp_xend();
+    __kmp_spec_record(&lck->lk.adaptive, _XBEGIN_STARTED);
   } else {
     // Releasing from a real lock
-    __kmp_release_queuing_lock(lck, gtid);
+    __kmp_release_queuing_lock(qlk, gtid);
   }
   return KMP_LOCK_RELEASED;
 }
 
-static int __kmp_release_rtm_lock_with_checks(kmp_queuing_lock_t *lck,
+static int __kmp_release_rtm_lock_with_checks(kmp_adaptive_lock_t *lck,
                                               kmp_int32 gtid) {
   return __kmp_release_rtm_lock(lck, gtid);
 }
 
-static int __kmp_test_rtm_lock(kmp_queuing_lock_t *lck, kmp_int32 gtid) {
-  unsigned retries = 3, status;
-  do {
-    status = _xbegin();
-    if (status == _XBEGIN_STARTED && __kmp_is_unlocked_queuing_lock(lck)) {
-      return 1;
-    }
-    if (!(status & _XABORT_RETRY))
-      break;
-  } while (retries--);
+static int __kmp_test_rtm_lock(kmp_adaptive_lock_t *lck, kmp_int32 gtid) {
+  kmp_queuing_lock_t *qlk = GET_QLK_PTR(lck);
+  if (__kmp_spec_enabled(&lck->lk.adaptive)) {
+    unsigned retries = 3, status;
+    do {
+      status = __kmp_xbegin();
+      if (status == _XBEGIN_STARTED) {
+        if (__kmp_is_unlocked_queuing_lock(qlk))
+          return 1;
+        __kmp_xabort(0xff);
+      }
+      __kmp_spec_record(&lck->lk.adaptive, status);
+      if (!(status & _XABORT_RETRY))
+        break;
+    } while (retries--);
+  }
 
-  return (__kmp_is_unlocked_queuing_lock(lck)) ? 1 : 0;
+  return __kmp_test_queuing_lock(qlk, gtid);
 }
 
-static int __kmp_test_rtm_lock_with_checks(kmp_queuing_lock_t *lck,
+static int __kmp_test_rtm_lock_with_checks(kmp_adaptive_lock_t *lck,
                                            kmp_int32 gtid) {
   return __kmp_test_rtm_lock(lck, gtid);
 }
@@ -3031,58 +4006,153 @@ const ident_t *(*__kmp_indirect_get_location[KMP_NUM_I_LOCKS])(
 kmp_lock_flags_t (*__kmp_indirect_get_flags[KMP_NUM_I_LOCKS])(
     kmp_user_lock_p) = {0};
 
-// Use different lock pools for different lock types.
-static kmp_indirect_lock_t *__kmp_indirect_lock_pool[KMP_NUM_I_LOCKS] = {0};
+// A chunk of the indirect lock table. The live count is the number of its
+// locks that are in use or cached by a thread, plus one while a thread still
+// hands out indices from the chunk; the chunk is freed when it drops to zero.
+typedef struct kmp_indirect_lock_chunk {
+  kmp_indirect_lock_t locks[KMP_I_LOCK_CHUNK];
+  volatile kmp_int32 live;
+} kmp_indirect_lock_chunk_t;
+
+// Superseded lock tables; readers may still hold them, so they are only freed
+// at cleanup.
+typedef struct kmp_indirect_lock_retired {
+  kmp_indirect_lock_t **table;
+  struct kmp_indirect_lock_retired *next;
+} kmp_indirect_lock_retired_t;
+
+// Protects growth of the lock table and the list of reusable rows.
+static kmp_bootstrap_lock_t __kmp_i_lock_table_lock =
+    KMP_BOOTSTRAP_LOCK_INITIALIZER(__kmp_i_lock_table_lock);
+static kmp_indirect_lock_retired_t *__kmp_i_lock_retired = NULL;
+static kmp_lock_index_t *__kmp_i_lock_free_rows = NULL;
+static kmp_lock_index_t __kmp_i_lock_num_free_rows = 0;
+static kmp_lock_index_t __kmp_i_lock_max_free_rows = 0;
+
+// Gives the thread a fresh chunk of the lock table to allocate indices from.
+// Rows of reclaimed chunks are reused before the table is extended; the table
+// only holds chunk pointers, so growing it never moves a lock.
+static void __kmp_get_indirect_lock_chunk(kmp_info_t *thr) {
+  kmp_indirect_lock_chunk_t *chunk;
+  kmp_lock_index_t row;
+
+  chunk = (kmp_indirect_lock_chunk_t *)__kmp_allocate(
+      sizeof(kmp_indirect_lock_chunk_t));
+  chunk->live = 1; // reference held by the allocating thread
+
+  __kmp_acquire_bootstrap_lock(&__kmp_i_lock_table_lock);
+  if (__kmp_i_lock_num_free_rows > 0) {
+    row = __kmp_i_lock_free_rows[--__kmp_i_lock_num_free_rows];
+  } else {
+    row = __kmp_i_lock_table.next / KMP_I_LOCK_CHUNK;
+    if (__kmp_i_lock_table.next == __kmp_i_lock_table.size) {
+      // Double up the space for block pointers
+      kmp_lock_index_t rows = __kmp_i_lock_table.size / KMP_I_LOCK_CHUNK;
+      kmp_indirect_lock_t **table = (kmp_indirect_lock_t **)__kmp_allocate(
+          2 * rows * sizeof(kmp_indirect_lock_t *));
+      kmp_indirect_lock_retired_t *retired =
+          (kmp_indirect_lock_retired_t *)__kmp_allocate(
+              sizeof(kmp_indirect_lock_retired_t));
+      KMP_MEMCPY(table, __kmp_i_lock_table.table,
+                 rows * sizeof(kmp_indirect_lock_t *));
+      retired->table = __kmp_i_lock_table.table;
+      retired->next = __kmp_i_lock_retired;
+      __kmp_i_lock_retired = retired;
+      KMP_MB();
+      TCW_PTR(__kmp_i_lock_table.table, table);
+      __kmp_i_lock_table.size = 2 * rows * KMP_I_LOCK_CHUNK;
+    }
+    __kmp_i_lock_table.next += KMP_I_LOCK_CHUNK;
+  }
+  KMP_MB();
+  TCW_PTR(__kmp_i_lock_table.table[row], (kmp_indirect_lock_t *)chunk);
+  __kmp_release_bootstrap_lock(&__kmp_i_lock_table_lock);
+
+  thr->th.th_i_lock_next = row * KMP_I_LOCK_CHUNK;
+  thr->th.th_i_lock_end = thr->th.th_i_lock_next + KMP_I_LOCK_CHUNK;
+  KA_TRACE(20, ("__kmp_get_indirect_lock_chunk: T#%d got row %u\n",
+                __kmp_gtid_from_thread(thr), row));
+}
+
+// Drops a reference to the chunk holding index idx and frees the chunk when
+// none of its locks is left.
+static void __kmp_unref_indirect_lock_chunk(kmp_lock_index_t idx) {
+  kmp_lock_index_t row = idx / KMP_I_LOCK_CHUNK;
+  kmp_indirect_lock_chunk_t *chunk =
+      (kmp_indirect_lock_chunk_t *)__kmp_i_lock_table.table[row];
+
+  if (KMP_TEST_THEN_DEC32(&chunk->live) != 1)
+    return;
+
+  KA_TRACE(20, ("__kmp_unref_indirect_lock_chunk: freeing row %u\n", row));
+  __kmp_acquire_bootstrap_lock(&__kmp_i_lock_table_lock);
+  __kmp_i_lock_table.table[row] = NULL;
+  if (__kmp_i_lock_num_free_rows == __kmp_i_lock_max_free_rows) {
+    kmp_lock_index_t *rows;
+    __kmp_i_lock_max_free_rows =
+        __kmp_i_lock_max_free_rows ? 2 * __kmp_i_lock_max_free_rows : 16;
+    rows = (kmp_lock_index_t *)__kmp_allocate(__kmp_i_lock_max_free_rows *
+                                              sizeof(kmp_lock_index_t));
+    if (__kmp_i_lock_free_rows != NULL) {
+      KMP_MEMCPY(rows, __kmp_i_lock_free_rows,
+                 __kmp_i_lock_num_free_rows * sizeof(kmp_lock_index_t));
+      __kmp_free(__kmp_i_lock_free_rows);
+    }
+    __kmp_i_lock_free_rows = rows;
+  }
+  __kmp_i_lock_free_rows[__kmp_i_lock_num_free_rows++] = row;
+  __kmp_release_bootstrap_lock(&__kmp_i_lock_table_lock);
+
+  __kmp_free(chunk);
+}
+
+// Returns a destroyed indirect lock to its chunk.
+static void __kmp_release_indirect_lock(kmp_indirect_lock_t *lck) {
+  __kmp_free(lck->lock);
+  lck->lock = NULL;
+  __kmp_unref_indirect_lock_chunk(lck->index & ~KMP_I_LOCK_CACHED);
+}
 
 // User lock allocator for dynamically dispatched indirect locks. Every entry of
 // the indirect lock table holds the address and type of the allocated indrect
-// lock (kmp_indirect_lock_t), and the size of the table doubles when it is
-// full. A destroyed indirect lock object is returned to the reusable pool of
-// locks, unique to each lock type.
+// lock (kmp_indirect_lock_t). A thread reuses the locks it destroyed, kept in a
+// cache unique to each lock type, and otherwise takes the next index of the
+// table chunk it owns, so neither path needs a global lock.
 kmp_indirect_lock_t *__kmp_allocate_indirect_lock(void **user_lock,
                                                   kmp_int32 gtid,
                                                   kmp_indirect_locktag_t tag) {
+  kmp_info_t *thr = __kmp_threads[gtid];
   kmp_indirect_lock_t *lck;
   kmp_lock_index_t idx;
 
-  __kmp_acquire_lock(&__kmp_global_lock, gtid);
-
-  if (__kmp_indirect_lock_pool[tag] != NULL) {
+  lck = thr->th.th_i_lock_cache[tag];
+  if (lck != NULL) {
     // Reuse the allocated and destroyed lock object
-    lck = __kmp_indirect_lock_pool[tag];
-    if (OMP_LOCK_T_SIZE < sizeof(void *))
-      idx = lck->lock->pool.index;
-    __kmp_indirect_lock_pool[tag] = (kmp_indirect_lock_t *)lck->lock->pool.next;
+    thr->th.th_i_lock_cache[tag] = (kmp_indirect_lock_t *)lck->lock->pool.next;
+    thr->th.th_i_lock_cache_size[tag]--;
+    lck->index &= ~KMP_I_LOCK_CACHED;
+    idx = lck->index;
     KA_TRACE(20, ("__kmp_allocate_indirect_lock: reusing an existing lock %p\n",
                   lck));
   } else {
-    idx = __kmp_i_lock_table.next;
-    // Check capacity and double the size if it is full
-    if (idx == __kmp_i_lock_table.size) {
-      // Double up the space for block pointers
-      int row = __kmp_i_lock_table.size / KMP_I_LOCK_CHUNK;
-      kmp_indirect_lock_t **old_table = __kmp_i_lock_table.table;
-      __kmp_i_lock_table.table = (kmp_indirect_lock_t **)__kmp_allocate(
-          2 * row * sizeof(kmp_indirect_lock_t *));
-      KMP_MEMCPY(__kmp_i_lock_table.table, old_table,
-                 row * sizeof(kmp_indirect_lock_t *));
-      __kmp_free(old_table);
-      // Allocate new objects in the new blocks
-      for (int i = row; i < 2 * row; ++i)
-        *(__kmp_i_lock_table.table + i) = (kmp_indirect_lock_t *)__kmp_allocate(
-            KMP_I_LOCK_CHUNK * sizeof(kmp_indirect_lock_t));
-      __kmp_i_lock_table.size = 2 * idx;
+    if (thr->th.th_i_lock_next == thr->th.th_i_lock_end) {
+      // The owned chunk is used up: drop the reference to it, get a new one
+      if (thr->th.th_i_lock_end != 0)
+        __kmp_unref_indirect_lock_chunk(thr->th.th_i_lock_end - 1);
+      __kmp_get_indirect_lock_chunk(thr);
     }
-    __kmp_i_lock_table.next++;
+    idx = thr->th.th_i_lock_next++;
+    KMP_TEST_THEN_INC32(
+        &((kmp_indirect_lock_chunk_t *)__kmp_i_lock_table.table[
+              idx / KMP_I_LOCK_CHUNK])->live);
     lck = KMP_GET_I_LOCK(idx);
+    lck->index = idx;
     // Allocate a new base lock object
     lck->lock = (kmp_user_lock_p)__kmp_allocate(__kmp_indirect_lock_size[tag]);
     KA_TRACE(20,
              ("__kmp_allocate_indirect_lock: allocated a new lock %p\n", lck));
   }
 
-  __kmp_release_lock(&__kmp_global_lock, gtid);
-
   lck->type = tag;
 
   if (OMP_LOCK_T_SIZE < sizeof(void *)) {
@@ -3095,6 +4165,24 @@ kmp_indirect_lock_t *__kmp_allocate_indirect_lock(void **user_lock,
   return lck;
 }
 
+void __kmp_free_indirect_lock_cache(kmp_info_t *th) {
+  int k;
+  for (k = 0; k < KMP_NUM_I_LOCKS; ++k) {
+    kmp_indirect_lock_t *l = th->th.th_i_lock_cache[k];
+    while (l != NULL) {
+      kmp_indirect_lock_t *ll = l;
+      l = (kmp_indirect_lock_t *)l->lock->pool.next;
+      __kmp_release_indirect_lock(ll);
+    }
+    th->th.th_i_lock_cache[k] = NULL;
+    th->th.th_i_lock_cache_size[k] = 0;
+  }
+  if (th->th.th_i_lock_end != 0) {
+    __kmp_unref_indirect_lock_chunk(th->th.th_i_lock_end - 1);
+    th->th.th_i_lock_next = th->th.th_i_lock_end = 0;
+  }
+}
+
 // User lock lookup for dynamically dispatched locks.
 static __forceinline kmp_indirect_lock_t *
 __kmp_lookup_indirect_lock(void **user_lock, const char *func) {
@@ -3105,7 +4193,8 @@ __kmp_lookup_indirect_lock(void **user_lock, const char *func) {
     }
     if (OMP_LOCK_T_SIZE < sizeof(void *)) {
       kmp_lock_index_t idx = KMP_EXTRACT_I_INDEX(user_lock);
-      if (idx >= __kmp_i_lock_table.size) {
+      if (idx >= __kmp_i_lock_table.size ||
+          __kmp_i_lock_table.table[idx / KMP_I_LOCK_CHUNK] == NULL) {
         KMP_FATAL(LockIsUninitialized, func);
       }
       lck = KMP_GET_I_LOCK(idx);
@@ -3153,17 +4242,17 @@ static void __kmp_destroy_indirect_lock(kmp_dyna_lock_t *lock) {
       __kmp_lookup_indirect_lock((void **)lock, "omp_destroy_lock");
   KMP_I_LOCK_FUNC(l, destroy)(l->lock);
   kmp_indirect_locktag_t tag = l->type;
-
-  __kmp_acquire_lock(&__kmp_global_lock, gtid);
-
-  // Use the base lock's space to keep the pool chain.
-  l->lock->pool.next = (kmp_user_lock_p)__kmp_indirect_lock_pool[tag];
-  if (OMP_LOCK_T_SIZE < sizeof(void *)) {
-    l->lock->pool.index = KMP_EXTRACT_I_INDEX(lock);
+  kmp_info_t *thr = __kmp_threads[gtid];
+
+  if (thr->th.th_i_lock_cache_size[tag] < KMP_I_LOCK_CACHE_LIMIT) {
+    // Use the base lock's space to keep the cache chain.
+    l->lock->pool.next = (kmp_user_lock_p)thr->th.th_i_lock_cache[tag];
+    l->index |= KMP_I_LOCK_CACHED;
+    thr->th.th_i_lock_cache[tag] = l;
+    thr->th.th_i_lock_cache_size[tag]++;
+  } else {
+    __kmp_release_indirect_lock(l);
   }
-  __kmp_indirect_lock_pool[tag] = l;
-
-  __kmp_release_lock(&__kmp_global_lock, gtid);
 }
 
 static void __kmp_set_indirect_lock(kmp_dyna_lock_t *lock, kmp_int32 gtid) {
@@ -3222,13 +4311,20 @@ kmp_int32 __kmp_get_user_lock_owner(kmp_user_lock_p lck, kmp_uint32 seq) {
   case lockseq_nested_queuing:
 #if KMP_USE_ADAPTIVE_LOCKS
   case lockseq_adaptive:
+#endif
+#if KMP_USE_TSX
+  case lockseq_rtm:
 #endif
     return __kmp_get_queuing_lock_owner((kmp_queuing_lock_t *)lck);
   case lockseq_drdpa:
   case lockseq_nested_drdpa:
     return __kmp_get_drdpa_lock_owner((kmp_drdpa_lock_t *)lck);
+  case lockseq_cohort:
+    return __kmp_get_cohort_lock_owner((kmp_cohort_lock_t *)lck);
+  case lockseq_morph:
+    return __kmp_get_morph_lock_owner((kmp_morph_lock_t *)lck);
   default:
-    return 0;
+    return -1; // Owner not tracked, e.g. hle
   }
 }
 
@@ -3260,8 +4356,6 @@ void __kmp_init_dynamic_user_locks() {
   __kmp_i_lock_table.size = KMP_I_LOCK_CHUNK;
   __kmp_i_lock_table.table =
       (kmp_indirect_lock_t **)__kmp_allocate(sizeof(kmp_indirect_lock_t *));
-  *(__kmp_i_lock_table.table) = (kmp_indirect_lock_t *)__kmp_allocate(
-      KMP_I_LOCK_CHUNK * sizeof(kmp_indirect_lock_t));
   __kmp_i_lock_table.next = 0;
 
   // Indirect lock size
@@ -3271,8 +4365,10 @@ void __kmp_init_dynamic_user_locks() {
   __kmp_indirect_lock_size[locktag_adaptive] = sizeof(kmp_adaptive_lock_t);
 #endif
   __kmp_indirect_lock_size[locktag_drdpa] = sizeof(kmp_drdpa_lock_t);
+  __kmp_indirect_lock_size[locktag_cohort] = sizeof(kmp_cohort_lock_t);
+  __kmp_indirect_lock_size[locktag_morph] = sizeof(kmp_morph_lock_t);
 #if KMP_USE_TSX
-  __kmp_indirect_lock_size[locktag_rtm] = sizeof(kmp_queuing_lock_t);
+  __kmp_indirect_lock_size[locktag_rtm] = sizeof(kmp_adaptive_lock_t);
 #endif
   __kmp_indirect_lock_size[locktag_nested_tas] = sizeof(kmp_tas_lock_t);
 #if KMP_USE_FUTEX
@@ -3295,12 +4391,16 @@ void __kmp_init_dynamic_user_locks() {
   {                                                                            \
     fill_jumps(table, expand, _);                                              \
     table[locktag_adaptive] = expand(queuing);                                 \
+    table[locktag_cohort] = expand(cohort);                                    \
+    table[locktag_morph] = expand(morph);                                      \
     fill_jumps(table, expand, _nested_);                                       \
   }
 #else
 #define fill_table(table, expand)                                              \
   {                                                                            \
     fill_jumps(table, expand, _);                                              \
+    table[locktag_cohort] = expand(cohort);                                    \
+    table[locktag_morph] = expand(morph);                                      \
     fill_jumps(table, expand, _nested_);                                       \
   }
 #endif // KMP_USE_ADAPTIVE_LOCKS
@@ -3330,37 +4430,40 @@ void __kmp_cleanup_indirect_user_locks() {
   kmp_lock_index_t i;
   int k;
 
-  // Clean up locks in the pools first (they were already destroyed before going
-  // into the pools).
-  for (k = 0; k < KMP_NUM_I_LOCKS; ++k) {
-    kmp_indirect_lock_t *l = __kmp_indirect_lock_pool[k];
-    while (l != NULL) {
-      kmp_indirect_lock_t *ll = l;
-      l = (kmp_indirect_lock_t *)l->lock->pool.next;
-      KA_TRACE(20, ("__kmp_cleanup_indirect_user_locks: freeing %p from pool\n",
-                    ll));
-      __kmp_free(ll->lock);
-      ll->lock = NULL;
-    }
-    __kmp_indirect_lock_pool[k] = NULL;
-  }
-  // Clean up the remaining undestroyed locks.
-  for (i = 0; i < __kmp_i_lock_table.next; i++) {
-    kmp_indirect_lock_t *l = KMP_GET_I_LOCK(i);
-    if (l->lock != NULL) {
-      // Locks not destroyed explicitly need to be destroyed here.
-      KMP_I_LOCK_FUNC(l, destroy)(l->lock);
+  // Clean up the locks left in the table. Cached locks were already destroyed
+  // before going into the caches, the rest need to be destroyed here.
+  for (i = 0; i < __kmp_i_lock_table.next / KMP_I_LOCK_CHUNK; i++) {
+    kmp_indirect_lock_t *chunk = __kmp_i_lock_table.table[i];
+    if (chunk == NULL)
+      continue;
+    for (k = 0; k < KMP_I_LOCK_CHUNK; k++) {
+      kmp_indirect_lock_t *l = &chunk[k];
+      if (l->lock == NULL)
+        continue;
+      if (!(l->index & KMP_I_LOCK_CACHED)) {
+        // Locks not destroyed explicitly need to be destroyed here.
+        KMP_I_LOCK_FUNC(l, destroy)(l->lock);
+      }
       KA_TRACE(
           20,
           ("__kmp_cleanup_indirect_user_locks: destroy/freeing %p from table\n",
            l));
       __kmp_free(l->lock);
     }
+    __kmp_free(chunk);
   }
   // Free the table
-  for (i = 0; i < __kmp_i_lock_table.size / KMP_I_LOCK_CHUNK; i++)
-    __kmp_free(__kmp_i_lock_table.table[i]);
   __kmp_free(__kmp_i_lock_table.table);
+  while (__kmp_i_lock_retired != NULL) {
+    kmp_indirect_lock_retired_t *r = __kmp_i_lock_retired;
+    __kmp_i_lock_retired = r->next;
+    __kmp_free(r->table);
+    __kmp_free(r);
+  }
+  if (__kmp_i_lock_free_rows != NULL)
+    __kmp_free(__kmp_i_lock_free_rows);
+  __kmp_i_lock_free_rows = NULL;
+  __kmp_i_lock_num_free_rows = __kmp_i_lock_max_free_rows = 0;
 
   __kmp_init_user_locks = FALSE;
 }
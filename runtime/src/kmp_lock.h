@@ -308,6 +308,11 @@ extern void __kmp_destroy_nested_ticket_lock(kmp_ticket_lock_t *lck);
 
 #if KMP_USE_ADAPTIVE_LOCKS
 
+// Bounds on the number of acquisitions for which a lock that speculates badly
+// stops speculating.
+#define KMP_SPEC_MIN_DISABLE 64
+#define KMP_SPEC_MAX_DISABLE (64 * 1024)
+
 struct kmp_adaptive_lock_info;
 
 typedef struct kmp_adaptive_lock_info kmp_adaptive_lock_info_t;
@@ -345,6 +350,18 @@ struct kmp_adaptive_lock_info {
   /* Parameters of the lock. */
   kmp_uint32 max_badness;
   kmp_uint32 max_soft_retries;
+  /* Speculation success rate over the current window of attempts. When it
+     falls too low, speculation is skipped for the next spec_skip acquisitions;
+     each further bad window doubles that, up to KMP_SPEC_MAX_DISABLE.
+     These are relaxed atomics, so concurrent outcomes are not lost to a race
+     on the counters. An outcome recorded while another thread closes the
+     window may still be dropped or counted in the wrong window, and racing
+     threads may count one skipped acquisition only once; either only nudges
+     the heuristic. */
+  std::atomic_uint spec_attempts;
+  std::atomic_uint spec_successes;
+  std::atomic_uint spec_skip;
+  kmp_uint32 spec_disable; // only written by the thread closing a window
 
 #if KMP_DEBUG_ADAPTIVE_LOCKS
   kmp_adaptive_lock_statistics_t volatile stats;
@@ -505,6 +522,128 @@ extern int __kmp_release_nested_drdpa_lock(kmp_drdpa_lock_t *lck,
 extern void __kmp_init_nested_drdpa_lock(kmp_drdpa_lock_t *lck);
 extern void __kmp_destroy_nested_drdpa_lock(kmp_drdpa_lock_t *lck);
 
+#if KMP_USE_DYNAMIC_LOCK
+// ----------------------------------------------------------------------------
+// Cohort locks.
+// A two-level lock for machines with several packages. Each package has its
+// own ticket lock, and a global ticket lock is held by whichever package owns
+// the cohort lock. A releasing thread that sees a waiter from its own package
+// passes the local lock on without releasing the global lock, up to
+// KMP_COHORT_MAX_HANDOFFS times in a row, so the protected data stays in one
+// package's caches while other packages still make progress.
+
+#define KMP_COHORT_MAX_HANDOFFS 64
+// A thread that is not bound to a place goes through the node of the package
+// it runs on, looked up again after this many acquisitions.
+#define KMP_COHORT_PKG_RECHECK 64
+
+typedef struct kmp_cohort_lock_node {
+  kmp_ticket_lock_t local; // serializes the threads of one package
+  // Only accessed by the holder of the local lock.
+  kmp_uint32 global_owned; // the global lock was passed down with the local
+  kmp_uint32 handoffs; // consecutive local handoffs
+} kmp_cohort_lock_node_t;
+
+struct kmp_base_cohort_lock {
+  volatile union kmp_cohort_lock
+      *initialized; // points to the lock union if in initialized state
+  ident_t const *location; // Source code location of omp_init_lock().
+  kmp_cohort_lock_node_t *nodes; // one node per package
+  kmp_uint32 num_nodes;
+  kmp_lock_flags_t flags; // lock specifics, e.g. critical section lock
+
+  kmp_ticket_lock_t global; // serializes the packages
+
+  KMP_ALIGN_CACHE
+  volatile kmp_int32 owner_id; // (gtid+1) of owning thread, 0 if unlocked
+  kmp_int32 owner_node; // package node the owner acquired through
+};
+
+typedef struct kmp_base_cohort_lock kmp_base_cohort_lock_t;
+
+union KMP_ALIGN_CACHE kmp_cohort_lock {
+  kmp_base_cohort_lock_t lk;
+  kmp_lock_pool_t pool;
+  double lk_align; // use worst case alignment
+  char lk_pad[KMP_PAD(kmp_base_cohort_lock_t, CACHE_LINE)];
+};
+
+typedef union kmp_cohort_lock kmp_cohort_lock_t;
+
+extern int __kmp_acquire_cohort_lock(kmp_cohort_lock_t *lck, kmp_int32 gtid);
+extern int __kmp_test_cohort_lock(kmp_cohort_lock_t *lck, kmp_int32 gtid);
+extern int __kmp_release_cohort_lock(kmp_cohort_lock_t *lck, kmp_int32 gtid);
+extern void __kmp_init_cohort_lock(kmp_cohort_lock_t *lck);
+extern void __kmp_destroy_cohort_lock(kmp_cohort_lock_t *lck);
+
+// ----------------------------------------------------------------------------
+// Morphing locks.
+// A lock that adapts to its own contention. It starts as a test-and-set lock.
+// When at least KMP_MORPH_LOCK_INFLATE of the last KMP_MORPH_LOCK_WINDOW
+// acquisitions found it busy, it inflates: new arrivals take a ticket in a
+// queue in front of the test-and-set word, so only the queue head competes for
+// it. When at most KMP_MORPH_LOCK_DEFLATE acquisitions in a window were
+// contended, it deflates again. Mutual exclusion always comes from the poll
+// word, so the mode is only a hint and may change while threads are waiting.
+// Waiters that spin for KMP_MORPH_LOCK_SPINS iterations without success sleep
+// on a futex where available.
+
+#define KMP_MORPH_LOCK_TAS 0
+#define KMP_MORPH_LOCK_QUEUE 1
+
+#define KMP_MORPH_LOCK_WINDOW 64
+#define KMP_MORPH_LOCK_INFLATE 16
+#define KMP_MORPH_LOCK_DEFLATE 2
+#define KMP_MORPH_LOCK_SPINS 4096
+
+struct kmp_base_morph_lock {
+  // Written on every acquire and release.
+  KMP_ALIGN_CACHE
+  volatile kmp_int32 poll; // 0 => unlocked; (gtid+1)<<1, bit 0 set if sleepers
+  volatile kmp_int32 mode; // KMP_MORPH_LOCK_TAS or KMP_MORPH_LOCK_QUEUE
+
+  // Ticket queue used while inflated.
+  KMP_ALIGN_CACHE
+  volatile kmp_int32 next_ticket;
+  KMP_ALIGN_CACHE
+  volatile kmp_int32 now_serving;
+  volatile kmp_int32 sleepers; // queued threads sleeping on now_serving
+
+  // Only written by the lock holder.
+  KMP_ALIGN_CACHE
+  volatile union kmp_morph_lock
+      *initialized; // points to the lock union if in initialized state
+  ident_t const *location; // Source code location of omp_init_lock().
+  kmp_lock_flags_t flags; // lock specifics, e.g. critical section lock
+  volatile kmp_int32 owner_id; // (gtid+1) of owning thread, 0 if unlocked
+  kmp_uint32 window_acquires; // acquisitions in the current window
+  kmp_uint32 window_contended; // contended acquisitions in the current window
+  // Per-lock statistics, reported to kmp_stats when the lock is destroyed.
+  kmp_uint64 acquires;
+  kmp_uint64 contended;
+  kmp_uint64 sleeps;
+  kmp_uint32 inflations;
+  kmp_uint32 deflations;
+};
+
+typedef struct kmp_base_morph_lock kmp_base_morph_lock_t;
+
+union KMP_ALIGN_CACHE kmp_morph_lock {
+  kmp_base_morph_lock_t lk;
+  kmp_lock_pool_t pool;
+  double lk_align; // use worst case alignment
+  char lk_pad[KMP_PAD(kmp_base_morph_lock_t, CACHE_LINE)];
+};
+
+typedef union kmp_morph_lock kmp_morph_lock_t;
+
+extern int __kmp_acquire_morph_lock(kmp_morph_lock_t *lck, kmp_int32 gtid);
+extern int __kmp_test_morph_lock(kmp_morph_lock_t *lck, kmp_int32 gtid);
+extern int __kmp_release_morph_lock(kmp_morph_lock_t *lck, kmp_int32 gtid);
+extern void __kmp_init_morph_lock(kmp_morph_lock_t *lck);
+extern void __kmp_destroy_morph_lock(kmp_morph_lock_t *lck);
+#endif // KMP_USE_DYNAMIC_LOCK
+
 // ============================================================================
 // Lock purposes.
 // ============================================================================
@@ -591,6 +730,10 @@ enum kmp_lock_kind {
   lk_ticket,
   lk_queuing,
   lk_drdpa,
+#if KMP_USE_DYNAMIC_LOCK
+  lk_cohort,
+  lk_morph,
+#endif
 #if KMP_USE_ADAPTIVE_LOCKS
   lk_adaptive
 #endif // KMP_USE_ADAPTIVE_LOCKS
@@ -608,6 +751,10 @@ union kmp_user_lock {
   kmp_ticket_lock_t ticket;
   kmp_queuing_lock_t queuing;
   kmp_drdpa_lock_t drdpa;
+#if KMP_USE_DYNAMIC_LOCK
+  kmp_cohort_lock_t cohort;
+  kmp_morph_lock_t morph;
+#endif
 #if KMP_USE_ADAPTIVE_LOCKS
   kmp_adaptive_lock_t adaptive;
 #endif // KMP_USE_ADAPTIVE_LOCKS
@@ -1056,37 +1203,49 @@ extern void __kmp_cleanup_user_locks();
 #define KMP_USE_INLINED_TAS                                                    \
   (KMP_OS_LINUX && (KMP_ARCH_X86 || KMP_ARCH_X86_64 || KMP_ARCH_ARM)) && 1
 #define KMP_USE_INLINED_FUTEX KMP_USE_FUTEX && 0
+// Nest locks of the tas kind are kept in the user's lock variable when it has
+// room for both the lock word and the depth, so that re-acquisition by the
+// owner needs no indirect lock lookup. Not a preprocessor condition.
+#if KMP_USE_INLINED_TAS
+#define KMP_USE_INLINED_NESTED_TAS                                             \
+  (sizeof(kmp_base_tas_lock_t) <= OMP_NEST_LOCK_T_SIZE)
+#else
+#define KMP_USE_INLINED_NESTED_TAS 0
+#endif
 
-// List of lock definitions; all nested locks are indirect locks.
+// List of lock definitions.
 // hle lock is xchg lock prefixed with XACQUIRE/XRELEASE.
-// All nested locks are indirect lock types.
+// Nested locks are indirect lock types; only tas nest locks can also live
+// directly in the user's lock variable (KMP_USE_INLINED_NESTED_TAS).
 #if KMP_USE_TSX
 #if KMP_USE_FUTEX
 #define KMP_FOREACH_D_LOCK(m, a) m(tas, a) m(futex, a) m(hle, a)
 #define KMP_FOREACH_I_LOCK(m, a)                                               \
   m(ticket, a) m(queuing, a) m(adaptive, a) m(drdpa, a) m(rtm, a)              \
-      m(nested_tas, a) m(nested_futex, a) m(nested_ticket, a)                  \
-          m(nested_queuing, a) m(nested_drdpa, a)
+      m(cohort, a) m(morph, a) m(nested_tas, a) m(nested_futex, a)             \
+          m(nested_ticket, a) m(nested_queuing, a) m(nested_drdpa, a)
 #else
 #define KMP_FOREACH_D_LOCK(m, a) m(tas, a) m(hle, a)
 #define KMP_FOREACH_I_LOCK(m, a)                                               \
   m(ticket, a) m(queuing, a) m(adaptive, a) m(drdpa, a) m(rtm, a)              \
-      m(nested_tas, a) m(nested_ticket, a) m(nested_queuing, a)                \
-          m(nested_drdpa, a)
+      m(cohort, a) m(morph, a) m(nested_tas, a) m(nested_ticket, a)            \
+          m(nested_queuing, a) m(nested_drdpa, a)
 #endif // KMP_USE_FUTEX
 #define KMP_LAST_D_LOCK lockseq_hle
 #else
 #if KMP_USE_FUTEX
 #define KMP_FOREACH_D_LOCK(m, a) m(tas, a) m(futex, a)
 #define KMP_FOREACH_I_LOCK(m, a)                                               \
-  m(ticket, a) m(queuing, a) m(drdpa, a) m(nested_tas, a) m(nested_futex, a)   \
-      m(nested_ticket, a) m(nested_queuing, a) m(nested_drdpa, a)
+  m(ticket, a) m(queuing, a) m(drdpa, a) m(cohort, a) m(morph, a)             \
+      m(nested_tas, a) m(nested_futex, a) m(nested_ticket, a)                  \
+          m(nested_queuing, a) m(nested_drdpa, a)
 #define KMP_LAST_D_LOCK lockseq_futex
 #else
 #define KMP_FOREACH_D_LOCK(m, a) m(tas, a)
 #define KMP_FOREACH_I_LOCK(m, a)                                               \
-  m(ticket, a) m(queuing, a) m(drdpa, a) m(nested_tas, a) m(nested_ticket, a)  \
-      m(nested_queuing, a) m(nested_drdpa, a)
+  m(ticket, a) m(queuing, a) m(drdpa, a) m(cohort, a) m(morph, a)             \
+      m(nested_tas, a) m(nested_ticket, a) m(nested_queuing, a)                \
+          m(nested_drdpa, a)
 #define KMP_LAST_D_LOCK lockseq_tas
 #endif // KMP_USE_FUTEX
 #endif // KMP_USE_TSX
@@ -1138,8 +1297,12 @@ typedef enum {
 typedef struct {
   kmp_user_lock_p lock;
   kmp_indirect_locktag_t type;
+  kmp_lock_index_t index; // position in the lock table, KMP_I_LOCK_CACHED is
+  // set while the destroyed lock sits in a thread's lock cache
 } kmp_indirect_lock_t;
 
+#define KMP_I_LOCK_CACHED (1U << 31)
+
 // Function tables for direct locks. Set/unset/test differentiate functions
 // with/without consistency checking.
 extern void (*__kmp_direct_init[])(kmp_dyna_lock_t *, kmp_dyna_lockseq_t);
@@ -1240,8 +1403,12 @@ extern kmp_lock_flags_t (*__kmp_indirect_get_flags[KMP_NUM_I_LOCKS])(
 
 #define KMP_I_LOCK_CHUNK                                                       \
   1024 // number of kmp_indirect_lock_t objects to be allocated together
+#define KMP_I_LOCK_CACHE_LIMIT                                                 \
+  256 // destroyed locks of one kind a thread keeps for reuse
 
-// Lock table for indirect locks.
+// Lock table for indirect locks. Each thread hands out the indices of a chunk
+// it owns without synchronization; a chunk is freed as soon as all of its
+// locks are destroyed, and its row is reused for the next chunk.
 typedef struct kmp_indirect_lock_table {
   kmp_indirect_lock_t **table; // blocks of indirect locks allocated
   kmp_lock_index_t size; // size of the indirect lock table
@@ -1289,6 +1456,72 @@ extern kmp_backoff_t __kmp_spin_backoff_params;
 // Backoff function
 extern void __kmp_spin_backoff(kmp_backoff_t *);
 
+// Lock profiling.
+// With KMP_LOCK_PROFILE=n, one in n acquisitions of user locks and critical
+// sections per thread is timed. Samples are kept per lock and the call site
+// that held the lock meanwhile, and the profile is printed at exit or by
+// kmp_dump_lock_profile().
+typedef enum kmp_lock_profile_kind {
+  kmp_lock_profile_lock,
+  kmp_lock_profile_nest_lock,
+  kmp_lock_profile_critical
+} kmp_lock_profile_kind_t;
+
+extern int __kmp_lock_profile_period;
+
+// Returns the start time of a sampled acquisition, 0 if it is not sampled.
+#define KMP_LOCK_PROFILE_START(gtid)                                           \
+  (__kmp_lock_profile_period ? __kmp_lock_profile_sample(gtid) : 0)
+
+// Every acquisition notes its call site as the holder, for the samples of the
+// threads that wait for it.
+#define KMP_LOCK_PROFILE_ACQUIRED(lock, loc, kind, start)                      \
+  (__kmp_lock_profile_period                                                   \
+       ? __kmp_lock_profile_acquired(lock, loc, kind, start)                   \
+       : (void)0)
+
+extern kmp_uint64 __kmp_lock_profile_sample(kmp_int32 gtid);
+extern void __kmp_lock_profile_acquired(void *lock, ident_t const *loc,
+                                        kmp_lock_profile_kind_t kind,
+                                        kmp_uint64 start);
+extern void __kmp_lock_profile_dump(void);
+extern void __kmp_cleanup_lock_profile(void);
+
+// ----------------------------------------------------------------------------
+// Reader-writer locks, behind the kmp_rwlock_* API.
+//
+// Readers announce themselves in one of num_slots counters, picked by gtid,
+// each on its own cache line, so that concurrent readers on different cores
+// do not write to the same line. Writers are serialized by a ticket lock,
+// then set writer and wait for every counter to drain. Readers that see a
+// writer back off and wait, so writers are not starved.
+
+#define KMP_RW_LOCK_MAX_SLOTS 64 // must be a power of 2
+
+typedef struct kmp_rw_lock_slot {
+  volatile kmp_int32 readers;
+  char pad[CACHE_LINE - sizeof(kmp_int32)];
+} kmp_rw_lock_slot_t;
+
+struct kmp_base_rw_lock {
+  KMP_ALIGN_CACHE volatile kmp_uint32 writer; // gtid+1 of the writer, 0 if
+  // none; read by every reader
+  KMP_ALIGN_CACHE struct kmp_base_rw_lock *initialized; // points to itself
+  ident_t const *location; // Source code location of the initialization
+  kmp_uint32 num_slots; // power of 2, at most KMP_RW_LOCK_MAX_SLOTS
+  kmp_rw_lock_slot_t *slots; // reader counters
+  kmp_ticket_lock_t writers; // serializes the writers
+};
+
+typedef struct kmp_base_rw_lock kmp_rw_lock_t;
+
+extern void __kmp_init_rw_lock(void **user_lock, ident_t const *loc,
+                               kmp_int32 gtid);
+extern void __kmp_destroy_rw_lock(void **user_lock, kmp_int32 gtid);
+extern void __kmp_acquire_rw_lock_read(void **user_lock, kmp_int32 gtid);
+extern void __kmp_acquire_rw_lock_write(void **user_lock, kmp_int32 gtid);
+extern void __kmp_release_rw_lock(void **user_lock, kmp_int32 gtid);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif // __cplusplus
@@ -98,6 +98,13 @@ static void __kmp_unregister_library(void); // called by __kmp_internal_end()
 static void __kmp_reap_thread(kmp_info_t *thread, int is_root);
 static kmp_info_t *__kmp_thread_pool_insert_pt = NULL;
 
+// Size of a worker's descriptor when it gets pages of its own: a multiple of
+// the __kmp_page_allocate() alignment
+#define KMP_INFO_PAGE_SIZE (8 * 1024)
+#define KMP_INFO_ALLOC_SIZE                                                    \
+  ((sizeof(kmp_info_t) + KMP_INFO_PAGE_SIZE - 1) &                             \
+   ~(size_t)(KMP_INFO_PAGE_SIZE - 1))
+
 /* Calculate the identifier of the current thread */
 /* fast (and somewhat portable) way to get unique identifier of executing
    thread. Returns KMP_GTID_DNE if we haven't been assigned a gtid. */
@@ -535,8 +542,16 @@ static void __kmp_print_team_storage_map(const char *header, kmp_team_t *team,
                                team_id);
 }
 
-static void __kmp_init_allocator() {}
-static void __kmp_fini_allocator() {}
+static void __kmp_init_allocator() {
+#if OMP_50_ENABLED
+  __kmp_init_memkind();
+#endif
+}
+static void __kmp_fini_allocator() {
+#if OMP_50_ENABLED
+  __kmp_fini_memkind();
+#endif
+}
 
 /* ------------------------------------------------------------------------ */
 
@@ -1404,6 +1419,18 @@ int __kmp_fork_call(ident_t *loc, int gtid,
     master_active = root->r.r_active;
     master_set_numthreads = master_th->th.th_set_nproc;
 
+#if KMP_OS_LINUX
+    // Pick up cgroup changes before the team is sized and placed
+    if (__kmp_cgroup_recheck_interval > 0 && !master_active &&
+        parent_team == root->r.r_root_team && KMP_UBER_GTID(gtid)
+#if OMP_40_ENABLED
+        && master_th->th.th_teams_microtask == NULL
+#endif
+        ) {
+      __kmp_cgroup_recheck(gtid);
+    }
+#endif
+
 #if OMPT_SUPPORT
     ompt_parallel_id_t ompt_parallel_id;
     ompt_task_id_t ompt_task_id;
@@ -2639,6 +2666,132 @@ void __kmp_set_num_threads(int new_nth, int gtid) {
   }
 }
 
+#if KMP_OS_LINUX
+// Whether __kmp_dflt_team_nth was derived from the available procs rather than
+// set by OMP_NUM_THREADS, so that a cgroup recheck may change it.
+static int __kmp_dflt_team_nth_auto = FALSE;
+
+// Cap a default number of threads derived from the available procs by the CPU
+// quota of the process's cgroup: more threads than that cannot run at once.
+static int __kmp_cgroup_cap_nth(int nth) {
+  if (__kmp_cgroup_cpu_limit > 0 && __kmp_cgroup_cpu_limit < nth) {
+    KA_TRACE(20, ("__kmp_cgroup_cap_nth: capping %d threads to the cgroup CPU "
+                  "quota (%d)\n",
+                  nth, __kmp_cgroup_cpu_limit));
+    nth = __kmp_cgroup_cpu_limit;
+  }
+  return nth;
+}
+
+/* Recheck the cgroup of the process at the start of an outermost parallel
+   region, at most once per __kmp_cgroup_recheck_interval msec. If its cpuset
+   has changed, rebuild the places; the threads move to their new places at the
+   next fork barrier. If the default number of threads changes with the procs
+   or the CPU quota, and the program did not set another one, the hot team is
+   resized to it. The cgroup files are read without holding a lock, and only
+   the results are published under __kmp_forkjoin_lock. */
+void __kmp_cgroup_recheck(int gtid) {
+  kmp_uint64 now = __kmp_now_nsec();
+  kmp_uint64 next = TCR_8(__kmp_cgroup_next_check);
+  if (now < next) {
+    return;
+  }
+  // The root thread that moves the next check on does this one
+  if (!KMP_COMPARE_AND_STORE_ACQ64(
+          (volatile kmp_int64 *)&__kmp_cgroup_next_check, (kmp_int64)next,
+          (kmp_int64)(now + (kmp_uint64)__kmp_cgroup_recheck_interval *
+                                (KMP_NSEC_PER_SEC / 1000)))) {
+    return;
+  }
+  KA_TRACE(10, ("__kmp_cgroup_recheck: T#%d rechecking\n", gtid));
+
+  kmp_info_t *thread = __kmp_threads[gtid];
+  int limit = __kmp_cgroup_quota ? __kmp_get_cgroup_cpu_limit() : 0;
+  int i;
+
+#if KMP_AFFINITY_SUPPORTED
+  kmp_affin_mask_t *cpuset = __kmp_affinity_cgroup_read();
+  if (cpuset != NULL) {
+    // New root threads register, and bind to the places, under the initz
+    // lock, so holding it keeps them away while the places are rebuilt. Other
+    // root threads may be using the places, so leave them alone then.
+    __kmp_acquire_bootstrap_lock(&__kmp_initz_lock);
+    int roots = 0;
+    __kmp_acquire_bootstrap_lock(&__kmp_forkjoin_lock);
+    for (i = 0; i < __kmp_threads_capacity; i++) {
+      if (__kmp_threads[i] != NULL && KMP_UBER_GTID(i)) {
+        roots++;
+      }
+    }
+    __kmp_release_bootstrap_lock(&__kmp_forkjoin_lock);
+    int rebuilt = FALSE;
+    if (roots == 1) {
+      rebuilt = __kmp_affinity_cgroup_update(cpuset);
+    } else {
+      KMP_CPU_FREE(cpuset);
+    }
+    if (rebuilt) {
+      __kmp_acquire_bootstrap_lock(&__kmp_forkjoin_lock);
+      for (i = 0; i < __kmp_threads_capacity; i++) {
+        kmp_info_t *th = __kmp_threads[i];
+        if (th == NULL) {
+          continue;
+        }
+#if OMP_40_ENABLED
+        if (i != gtid) {
+          th->th.th_current_place = KMP_PLACE_UNDEFINED;
+        }
+#endif
+        // Have the hot teams partition the new places at their next fork
+#if KMP_NESTED_HOT_TEAMS
+        if (th->th.th_hot_teams != NULL) {
+          for (int level = 0; level < __kmp_hot_teams_max_level; level++) {
+            if (th->th.th_hot_teams[level].hot_team != NULL) {
+              th->th.th_hot_teams[level].hot_team->t.t_size_changed = -1;
+            }
+          }
+        }
+#endif
+      }
+      thread->th.th_root->r.r_hot_team->t.t_size_changed = -1;
+      __kmp_affinity_set_init_mask(gtid, TRUE);
+      __kmp_release_bootstrap_lock(&__kmp_forkjoin_lock);
+    }
+    __kmp_release_bootstrap_lock(&__kmp_initz_lock);
+  }
+#endif /* KMP_AFFINITY_SUPPORTED */
+
+  __kmp_acquire_bootstrap_lock(&__kmp_forkjoin_lock);
+  int old_nth = __kmp_dflt_team_nth;
+  int new_nth = old_nth;
+  __kmp_cgroup_cpu_limit = limit;
+  if (__kmp_dflt_team_nth_auto) {
+#ifdef KMP_DFLT_NTH_CORES
+    new_nth = __kmp_cgroup_cap_nth(__kmp_ncores);
+#else
+    new_nth = __kmp_cgroup_cap_nth(__kmp_avail_proc);
+#endif
+    if (new_nth < KMP_MIN_NTH) {
+      new_nth = KMP_MIN_NTH;
+    }
+    if (new_nth > __kmp_dflt_team_nth_ub) {
+      new_nth = __kmp_dflt_team_nth_ub;
+    }
+    __kmp_dflt_team_nth = new_nth;
+  }
+  __kmp_release_bootstrap_lock(&__kmp_forkjoin_lock);
+
+  if (new_nth != old_nth) {
+    KA_TRACE(10, ("__kmp_cgroup_recheck: T#%d default number of threads "
+                  "%d -> %d\n",
+                  gtid, old_nth, new_nth));
+    if (thread->th.th_current_task->td_icvs.nproc == old_nth) {
+      __kmp_set_num_threads(new_nth, gtid);
+    }
+  }
+}
+#endif /* KMP_OS_LINUX */
+
 /* Changes max_active_levels */
 void __kmp_set_max_active_levels(int gtid, int max_active_levels) {
   kmp_info_t *thread;
@@ -3015,9 +3168,26 @@ static void __kmp_allocate_team_arrays(kmp_team_t *team, int max_nth) {
   }
 }
 
+// Frees the overflow dispatch buffers chained off the team's ring slots
+static void __kmp_free_disp_overflow(kmp_team_t *team) {
+  int i;
+  int num_disp_buff = team->t.t_max_nproc > 1 ? __kmp_dispatch_num_buffers : 2;
+  for (i = 0; i < num_disp_buff; ++i) {
+    dispatch_shared_info_t *buf = team->t.t_disp_buffer[i].buffer_next;
+    while (buf != NULL) {
+      dispatch_shared_info_t *next = buf->buffer_next;
+      __kmp_free(buf->buffer_private);
+      __kmp_free(buf);
+      buf = next;
+    }
+    team->t.t_disp_buffer[i].buffer_next = NULL;
+  }
+}
+
 static void __kmp_free_team_arrays(kmp_team_t *team) {
   /* Note: this does not free the threads in t_threads (__kmp_free_threads) */
   int i;
+  __kmp_free_disp_overflow(team);
   for (i = 0; i < team->t.t_max_nproc; ++i) {
     if (team->t.t_dispatch[i].th_disp_buffer != NULL) {
       __kmp_free(team->t.t_dispatch[i].th_disp_buffer);
@@ -3037,6 +3207,7 @@ static void __kmp_free_team_arrays(kmp_team_t *team) {
 static void __kmp_reallocate_team_arrays(kmp_team_t *team, int max_nth) {
   kmp_info_t **oldThreads = team->t.t_threads;
 
+  __kmp_free_disp_overflow(team);
   __kmp_free(team->t.t_disp_buffer);
   __kmp_free(team->t.t_dispatch);
   __kmp_free(team->t.t_implicit_task_taskdata);
@@ -3720,6 +3891,9 @@ int __kmp_register_root(int initial_thread) {
 #endif
     __kmp_init_random(root_thread); // Initialize random number generator
   }
+#if OMP_50_ENABLED
+  root_thread->th.th_def_allocator = __kmp_def_allocator;
+#endif
 
   /* setup the serial team held in reserve by the root thread */
   if (!root_thread->th.th_serial_team) {
@@ -4054,16 +4228,8 @@ static void __kmp_initialize_info(kmp_info_t *this_thr, kmp_team_t *team,
   this_thr->th.th_local.tv_data = 0;
 #endif
 
-  if (!this_thr->th.th_pri_common) {
-    this_thr->th.th_pri_common =
-        (struct common_table *)__kmp_allocate(sizeof(struct common_table));
-    if (__kmp_storage_map) {
-      __kmp_print_storage_map_gtid(
-          gtid, this_thr->th.th_pri_common, this_thr->th.th_pri_common + 1,
-          sizeof(struct common_table), "th_%d.th_pri_common\n", gtid);
-    }; // if
-    this_thr->th.th_pri_head = NULL;
-  }; // if
+  // th_pri_head and th_pri_slots start out zeroed and keep the threadprivate
+  // copies of a thread that is reused; th_pri_slots grows on demand.
 
   /* Initialize dynamic dispatch */
   {
@@ -4240,7 +4406,17 @@ kmp_info_t *__kmp_allocate_thread(kmp_root_t *root, kmp_team_t *team,
   }
 
   /* allocate space for it. */
-  new_thr = (kmp_info_t *)__kmp_allocate(sizeof(kmp_info_t));
+  if (__kmp_numa_local_threads) {
+    // Give the descriptor pages of its own, the worker moves them to its NUMA
+    // node once it is bound (see __kmp_launch_thread)
+    new_thr = (kmp_info_t *)__kmp_page_allocate(KMP_INFO_ALLOC_SIZE);
+#if KMP_OS_LINUX && KMP_AFFINITY_SUPPORTED
+    new_thr->th.th_numa_local = TRUE;
+    new_thr->th.th_numa_node = -1;
+#endif
+  } else {
+    new_thr = (kmp_info_t *)__kmp_allocate(sizeof(kmp_info_t));
+  }
 
   TCW_SYNC_PTR(__kmp_threads[new_gtid], new_thr);
 
@@ -4311,6 +4487,9 @@ kmp_info_t *__kmp_allocate_thread(kmp_root_t *root, kmp_team_t *team,
   TCW_4(new_thr->th.th_in_pool, FALSE);
   new_thr->th.th_active_in_pool = FALSE;
   TCW_4(new_thr->th.th_active, TRUE);
+#if OMP_50_ENABLED
+  new_thr->th.th_def_allocator = __kmp_def_allocator;
+#endif
 
   /* adjust the global counters */
   __kmp_all_nth++;
@@ -4414,6 +4593,7 @@ static void __kmp_initialize_team(kmp_team_t *team, int new_nproc,
 
   team->t.t_construct = 0;
   __kmp_init_lock(&team->t.t_single_lock);
+  __kmp_init_lock(&team->t.t_disp_lock);
 
   team->t.t_ordered.dt.t_value = 0;
   team->t.t_master_active = FALSE;
@@ -5453,6 +5633,20 @@ void __kmp_free_thread(kmp_info_t *this_th) {
 
 /* ------------------------------------------------------------------------ */
 
+#if KMP_OS_LINUX && KMP_AFFINITY_SUPPORTED
+// Move the descriptor of worker th to the NUMA node of the CPU it runs on, if
+// it has pages of its own and they are elsewhere. Called by the worker once it
+// is bound, and again whenever it is bound to another place, as a worker taken
+// from the pool may land on another node.
+void __kmp_move_thread_local(kmp_info_t *th) {
+  if (th->th.th_numa_local && KMP_AFFINITY_CAPABLE() &&
+      __kmp_affinity_type != affinity_none) {
+    th->th.th_numa_node =
+        __kmp_move_pages_local(th, KMP_INFO_ALLOC_SIZE, th->th.th_numa_node);
+  }
+}
+#endif
+
 void *__kmp_launch_thread(kmp_info_t *this_thr) {
   int gtid = this_thr->th.th_info.ds.ds_gtid;
   /*    void                 *stack_data;*/
@@ -5465,6 +5659,13 @@ void *__kmp_launch_thread(kmp_info_t *this_thr) {
     this_thr->th.th_cons = __kmp_allocate_cons_stack(gtid); // ATT: Memory leak?
   }
 
+#if KMP_OS_LINUX && KMP_AFFINITY_SUPPORTED
+  // The master allocated and initialized the descriptor, barrier state
+  // included, so its pages are on the master's node. The worker is bound by
+  // now, move them next to it.
+  __kmp_move_thread_local(this_thr);
+#endif
+
 #if OMPT_SUPPORT
   if (ompt_enabled) {
     this_thr->th.ompt_thread_info.state = ompt_state_overhead;
@@ -5719,6 +5920,10 @@ static void __kmp_reap_thread(kmp_info_t *thread, int is_root) {
   __kmp_free_fast_memory(thread);
 #endif /* USE_FAST_MEMORY */
 
+#if KMP_USE_DYNAMIC_LOCK
+  __kmp_free_indirect_lock_cache(thread);
+#endif
+
   __kmp_suspend_uninitialize_thread(thread);
 
   KMP_DEBUG_ASSERT(__kmp_threads[gtid] == thread);
@@ -5746,9 +5951,10 @@ static void __kmp_reap_thread(kmp_info_t *thread, int is_root) {
     }; // if
   }
 
-  if (thread->th.th_pri_common != NULL) {
-    __kmp_free(thread->th.th_pri_common);
-    thread->th.th_pri_common = NULL;
+  if (thread->th.th_pri_slots != NULL) {
+    __kmp_free(thread->th.th_pri_slots);
+    thread->th.th_pri_slots = NULL;
+    thread->th.th_pri_nslots = 0;
   }; // if
 
   if (thread->th.th_task_state_memo_stack != NULL) {
@@ -6634,6 +6840,12 @@ static void __kmp_do_middle_initialize(void) {
                   "__kmp_avail_proc(%d)\n",
                   __kmp_dflt_team_nth));
 #endif /* KMP_DFLT_NTH_CORES */
+#if KMP_OS_LINUX
+    __kmp_cgroup_cpu_limit =
+        __kmp_cgroup_quota ? __kmp_get_cgroup_cpu_limit() : 0;
+    __kmp_dflt_team_nth = __kmp_cgroup_cap_nth(__kmp_dflt_team_nth);
+    __kmp_dflt_team_nth_auto = TRUE;
+#endif
   }
 
   if (__kmp_dflt_team_nth < KMP_MIN_NTH) {
@@ -7019,13 +7231,20 @@ void __kmp_internal_fork(ident_t *id, int gtid, kmp_team_t *team) {
   if (team->t.t_max_nproc > 1) {
     int i;
     for (i = 0; i < __kmp_dispatch_num_buffers; ++i) {
+      dispatch_shared_info_t *buf;
       team->t.t_disp_buffer[i].buffer_index = i;
+      team->t.t_disp_buffer[i].buffer_flags = 0;
 #if OMP_45_ENABLED
       team->t.t_disp_buffer[i].doacross_buf_idx = i;
 #endif
+      // keep overflow buffers of previous regions for reuse
+      for (buf = team->t.t_disp_buffer[i].buffer_next; buf != NULL;
+           buf = buf->buffer_next)
+        buf->buffer_flags = KMP_DISP_BUFFER_FREE;
     }
   } else {
     team->t.t_disp_buffer[0].buffer_index = 0;
+    team->t.t_disp_buffer[0].buffer_flags = 0;
 #if OMP_45_ENABLED
     team->t.t_disp_buffer[0].doacross_buf_idx = 0;
 #endif
@@ -7236,12 +7455,18 @@ void __kmp_cleanup(void) {
   KMP_INTERNAL_FREE(CCAST(char *, __kmp_cpuinfo_file));
   __kmp_cpuinfo_file = NULL;
 #endif /* KMP_AFFINITY_SUPPORTED */
+#if KMP_OS_LINUX
+  KMP_INTERNAL_FREE(CCAST(char *, __kmp_cgroup_path));
+  __kmp_cgroup_path = NULL;
+#endif
 
 #if KMP_USE_ADAPTIVE_LOCKS
 #if KMP_DEBUG_ADAPTIVE_LOCKS
   __kmp_print_speculative_stats();
 #endif
 #endif
+  __kmp_cleanup_lock_profile();
+  __kmp_cleanup_critical_delegates();
   KMP_INTERNAL_FREE(__kmp_nested_nth.nth);
   __kmp_nested_nth.nth = NULL;
   __kmp_nested_nth.size = 0;
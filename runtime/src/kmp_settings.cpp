@@ -596,6 +596,50 @@ static void __kmp_stg_print_all_threads(kmp_str_buf_t *buffer, char const *name,
   __kmp_stg_print_int(buffer, name, __kmp_max_nth);
 } // __kmp_stg_print_all_threads
 
+#if KMP_OS_LINUX
+// -----------------------------------------------------------------------------
+// KMP_CGROUP_QUOTA, KMP_CGROUP_RECHECK, KMP_CGROUP_PATH
+
+static void __kmp_stg_parse_cgroup_quota(char const *name, char const *value,
+                                         void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_cgroup_quota);
+} // __kmp_stg_parse_cgroup_quota
+
+static void __kmp_stg_print_cgroup_quota(kmp_str_buf_t *buffer,
+                                         char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_cgroup_quota);
+} // __kmp_stg_print_cgroup_quota
+
+static void __kmp_stg_parse_cgroup_recheck(char const *name, char const *value,
+                                           void *data) {
+  __kmp_stg_parse_int(name, value, 0, INT_MAX, &__kmp_cgroup_recheck_interval);
+} // __kmp_stg_parse_cgroup_recheck
+
+static void __kmp_stg_print_cgroup_recheck(kmp_str_buf_t *buffer,
+                                           char const *name, void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_cgroup_recheck_interval);
+} // __kmp_stg_print_cgroup_recheck
+
+static void __kmp_stg_parse_cgroup_path(char const *name, char const *value,
+                                        void *data) {
+  __kmp_stg_parse_str(name, value, &__kmp_cgroup_path);
+} // __kmp_stg_parse_cgroup_path
+
+static void __kmp_stg_print_cgroup_path(kmp_str_buf_t *buffer,
+                                        char const *name, void *data) {
+  if (__kmp_env_format) {
+    KMP_STR_BUF_PRINT_NAME;
+  } else {
+    __kmp_str_buf_print(buffer, "   %s", name);
+  }
+  if (__kmp_cgroup_path) {
+    __kmp_str_buf_print(buffer, "='%s'\n", __kmp_cgroup_path);
+  } else {
+    __kmp_str_buf_print(buffer, ": %s\n", KMP_I18N_STR(NotDefined));
+  }
+} // __kmp_stg_print_cgroup_path
+#endif /* KMP_OS_LINUX */
+
 // -----------------------------------------------------------------------------
 // KMP_BLOCKTIME
 
@@ -1182,6 +1226,35 @@ static void __kmp_stg_print_taskloop_min_tasks(kmp_str_buf_t *buffer,
                                                char const *name, void *data) {
   __kmp_stg_print_int(buffer, name, __kmp_taskloop_min_tasks);
 } // __kmp_stg_print_taskloop_min_tasks
+
+// KMP_TASKLOOP_LAZY_SPLIT
+// split taskloop without schedule clause on demand rather than up front
+static void __kmp_stg_parse_taskloop_lazy_split(char const *name,
+                                                char const *value,
+                                                void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_taskloop_lazy_split);
+} // __kmp_stg_parse_taskloop_lazy_split
+
+static void __kmp_stg_print_taskloop_lazy_split(kmp_str_buf_t *buffer,
+                                                char const *name,
+                                                void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_taskloop_lazy_split);
+} // __kmp_stg_print_taskloop_lazy_split
+
+// KMP_DOACROSS_DENSE_LIMIT
+// size of the doacross flags vector above which the sliding window is used
+static void __kmp_stg_parse_doacross_dense_limit(char const *name,
+                                                 char const *value,
+                                                 void *data) {
+  __kmp_stg_parse_size(name, value, 0, KMP_MAX_DOACROSS_DENSE_LIMIT, NULL,
+                       &__kmp_doacross_dense_limit, 1);
+} // __kmp_stg_parse_doacross_dense_limit
+
+static void __kmp_stg_print_doacross_dense_limit(kmp_str_buf_t *buffer,
+                                                 char const *name,
+                                                 void *data) {
+  __kmp_stg_print_size(buffer, name, __kmp_doacross_dense_limit);
+} // __kmp_stg_print_doacross_dense_limit
 #endif // OMP_45_ENABLED
 
 // -----------------------------------------------------------------------------
@@ -1200,6 +1273,18 @@ static void __kmp_stg_print_disp_buffers(kmp_str_buf_t *buffer,
   __kmp_stg_print_int(buffer, name, __kmp_dispatch_num_buffers);
 } // __kmp_stg_print_disp_buffers
 
+// -----------------------------------------------------------------------------
+// KMP_DISP_GROW_BUFFERS
+static void __kmp_stg_parse_disp_grow_buffers(char const *name,
+                                              char const *value, void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_dispatch_grow_buffers);
+} // __kmp_stg_parse_disp_grow_buffers
+
+static void __kmp_stg_print_disp_grow_buffers(kmp_str_buf_t *buffer,
+                                              char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_dispatch_grow_buffers);
+} // __kmp_stg_print_disp_grow_buffers
+
 #if KMP_NESTED_HOT_TEAMS
 // -----------------------------------------------------------------------------
 // KMP_HOT_TEAMS_MAX_LEVEL, KMP_HOT_TEAMS_MODE
@@ -1565,6 +1650,33 @@ static void __kmp_stg_print_cpuinfo_file(kmp_str_buf_t *buffer,
 #endif
 } //__kmp_stg_print_cpuinfo_file
 
+// -----------------------------------------------------------------------------
+// KMP_TOPOLOGY_CACHE
+
+static void __kmp_stg_parse_topology_cache(char const *name, char const *value,
+                                           void *data) {
+#if KMP_AFFINITY_SUPPORTED
+  __kmp_stg_parse_str(name, value, &__kmp_topology_cache_file);
+  K_DIAG(1, ("__kmp_topology_cache_file == %s\n", __kmp_topology_cache_file));
+#endif
+} // __kmp_stg_parse_topology_cache
+
+static void __kmp_stg_print_topology_cache(kmp_str_buf_t *buffer,
+                                           char const *name, void *data) {
+#if KMP_AFFINITY_SUPPORTED
+  if (__kmp_env_format) {
+    KMP_STR_BUF_PRINT_NAME;
+  } else {
+    __kmp_str_buf_print(buffer, "   %s", name);
+  }
+  if (__kmp_topology_cache_file) {
+    __kmp_str_buf_print(buffer, "='%s'\n", __kmp_topology_cache_file);
+  } else {
+    __kmp_str_buf_print(buffer, ": %s\n", KMP_I18N_STR(NotDefined));
+  }
+#endif
+} // __kmp_stg_print_topology_cache
+
 // -----------------------------------------------------------------------------
 // KMP_FORCE_REDUCTION, KMP_DETERMINISTIC_REDUCTION
 
@@ -1681,6 +1793,20 @@ static void __kmp_stg_print_foreign_threads_threadprivate(kmp_str_buf_t *buffer,
   __kmp_stg_print_bool(buffer, name, __kmp_foreign_tp);
 } // __kmp_stg_print_foreign_threads_threadprivate
 
+// -----------------------------------------------------------------------------
+// KMP_LAZY_THREADPRIVATE
+
+static void __kmp_stg_parse_lazy_threadprivate(char const *name,
+                                               char const *value, void *data) {
+  __kmp_stg_parse_size(name, value, 0, KMP_MAX_MALLOC_POOL_INCR, NULL,
+                       &__kmp_tp_lazy_size, 1);
+} // __kmp_stg_parse_lazy_threadprivate
+
+static void __kmp_stg_print_lazy_threadprivate(kmp_str_buf_t *buffer,
+                                               char const *name, void *data) {
+  __kmp_stg_print_size(buffer, name, __kmp_tp_lazy_size);
+} // __kmp_stg_print_lazy_threadprivate
+
 // -----------------------------------------------------------------------------
 // KMP_AFFINITY, GOMP_CPU_AFFINITY, KMP_TOPOLOGY_METHOD
 
@@ -2060,6 +2186,15 @@ static void __kmp_parse_affinity_env(char const *name, char const *value,
       } else if (__kmp_match_str("core", buf, CCAST(const char **, &next))) {
         set_gran(affinity_gran_core, -1);
         buf = next;
+      } else if (__kmp_match_str("tile", buf, CCAST(const char **, &next))) {
+        set_gran(affinity_gran_tile, -1);
+        buf = next;
+      } else if (__kmp_match_str("llc", buf, CCAST(const char **, &next))) {
+        set_gran(affinity_gran_llc, -1);
+        buf = next;
+      } else if (__kmp_match_str("numa", buf, CCAST(const char **, &next))) {
+        set_gran(affinity_gran_numa, -1);
+        buf = next;
       } else if (__kmp_match_str("package", buf, CCAST(const char **, &next))) {
         set_gran(affinity_gran_package, -1);
         buf = next;
@@ -2299,6 +2434,15 @@ static void __kmp_stg_print_affinity(kmp_str_buf_t *buffer, char const *name,
     case affinity_gran_core:
       __kmp_str_buf_print(buffer, "%s", "granularity=core,");
       break;
+    case affinity_gran_tile:
+      __kmp_str_buf_print(buffer, "%s", "granularity=tile,");
+      break;
+    case affinity_gran_llc:
+      __kmp_str_buf_print(buffer, "%s", "granularity=llc,");
+      break;
+    case affinity_gran_numa:
+      __kmp_str_buf_print(buffer, "%s", "granularity=numa,");
+      break;
     case affinity_gran_package:
       __kmp_str_buf_print(buffer, "%s", "granularity=package,");
       break;
@@ -2700,6 +2844,24 @@ static void __kmp_stg_parse_places(char const *name, char const *value,
     __kmp_affinity_gran = affinity_gran_core;
     __kmp_affinity_dups = FALSE;
     kind = "\"cores\"";
+  } else if (__kmp_match_str("tiles", scan, &next)) {
+    scan = next;
+    __kmp_affinity_type = affinity_compact;
+    __kmp_affinity_gran = affinity_gran_tile;
+    __kmp_affinity_dups = FALSE;
+    kind = "\"tiles\"";
+  } else if (__kmp_match_str("ll_caches", scan, &next)) {
+    scan = next;
+    __kmp_affinity_type = affinity_compact;
+    __kmp_affinity_gran = affinity_gran_llc;
+    __kmp_affinity_dups = FALSE;
+    kind = "\"ll_caches\"";
+  } else if (__kmp_match_str("numa_domains", scan, &next)) {
+    scan = next;
+    __kmp_affinity_type = affinity_compact;
+    __kmp_affinity_gran = affinity_gran_numa;
+    __kmp_affinity_dups = FALSE;
+    kind = "\"numa_domains\"";
   } else if (__kmp_match_str("sockets", scan, &next)) {
     scan = next;
     __kmp_affinity_type = affinity_compact;
@@ -2797,6 +2959,24 @@ static void __kmp_stg_print_places(kmp_str_buf_t *buffer, char const *name,
       } else {
         __kmp_str_buf_print(buffer, "='cores'\n");
       }
+    } else if (__kmp_affinity_gran == affinity_gran_tile) {
+      if (num > 0) {
+        __kmp_str_buf_print(buffer, "='tiles(%d)'\n", num);
+      } else {
+        __kmp_str_buf_print(buffer, "='tiles'\n");
+      }
+    } else if (__kmp_affinity_gran == affinity_gran_llc) {
+      if (num > 0) {
+        __kmp_str_buf_print(buffer, "='ll_caches(%d)'\n", num);
+      } else {
+        __kmp_str_buf_print(buffer, "='ll_caches'\n");
+      }
+    } else if (__kmp_affinity_gran == affinity_gran_numa) {
+      if (num > 0) {
+        __kmp_str_buf_print(buffer, "='numa_domains(%d)'\n", num);
+      } else {
+        __kmp_str_buf_print(buffer, "='numa_domains'\n");
+      }
     } else if (__kmp_affinity_gran == affinity_gran_package) {
       if (num > 0) {
         __kmp_str_buf_print(buffer, "='sockets(%d)'\n", num);
@@ -2903,6 +3083,12 @@ static void __kmp_stg_parse_topology_method(char const *name, char const *value,
            __kmp_str_match("cpuinfo", 5, value)) {
     __kmp_affinity_top_method = affinity_top_method_cpuinfo;
   }
+#if KMP_OS_LINUX
+  else if (__kmp_str_match("sysfs", 2, value) ||
+           __kmp_str_match("/sys/devices/system/cpu", 4, value)) {
+    __kmp_affinity_top_method = affinity_top_method_sysfs;
+  }
+#endif /* KMP_OS_LINUX */
 #if KMP_GROUP_AFFINITY
   else if (__kmp_str_match("group", 1, value)) {
     __kmp_affinity_top_method = affinity_top_method_group;
@@ -2955,6 +3141,12 @@ static void __kmp_stg_print_topology_method(kmp_str_buf_t *buffer,
     value = "cpuinfo";
     break;
 
+#if KMP_OS_LINUX
+  case affinity_top_method_sysfs:
+    value = "sysfs";
+    break;
+#endif /* KMP_OS_LINUX */
+
 #if KMP_GROUP_AFFINITY
   case affinity_top_method_group:
     value = "group";
@@ -3577,6 +3769,146 @@ static void __kmp_stg_print_malloc_pool_incr(kmp_str_buf_t *buffer,
 
 } // _kmp_stg_print_malloc_pool_incr
 
+// -----------------------------------------------------------------------------
+// KMP_FAST_MEMORY_ENGINE
+
+static void __kmp_stg_parse_fast_mem_engine(char const *name,
+                                            char const *value, void *data) {
+  if (TCR_4(__kmp_init_serial)) {
+    KMP_WARNING(EnvSerialWarn, name);
+    return;
+  } // blocks already allocated must be freed by the engine they came from
+  if (__kmp_str_match("slab", 1, value)) {
+    __kmp_fast_mem_engine = fast_mem_slab;
+  } else if (__kmp_str_match("bget", 1, value)) {
+    __kmp_fast_mem_engine = fast_mem_bget;
+  } else {
+    KMP_WARNING(StgInvalidValue, name, value);
+  }
+} // __kmp_stg_parse_fast_mem_engine
+
+static void __kmp_stg_print_fast_mem_engine(kmp_str_buf_t *buffer,
+                                            char const *name, void *data) {
+  __kmp_stg_print_str(buffer, name,
+                      __kmp_fast_mem_engine == fast_mem_slab ? "slab" : "bget");
+} // __kmp_stg_print_fast_mem_engine
+
+// -----------------------------------------------------------------------------
+// KMP_NUMA_LOCAL_THREADS
+
+static void __kmp_stg_parse_numa_local_threads(char const *name,
+                                               char const *value, void *data) {
+  if (TCR_4(__kmp_init_serial)) {
+    KMP_WARNING(EnvSerialWarn, name);
+    return;
+  } // thread descriptors already allocated must keep their layout
+  __kmp_stg_parse_bool(name, value, &__kmp_numa_local_threads);
+} // __kmp_stg_parse_numa_local_threads
+
+static void __kmp_stg_print_numa_local_threads(kmp_str_buf_t *buffer,
+                                               char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_numa_local_threads);
+} // __kmp_stg_print_numa_local_threads
+
+// -----------------------------------------------------------------------------
+// KMP_HUGE_PAGES
+
+static void __kmp_stg_parse_huge_pages(char const *name, char const *value,
+                                       void *data) {
+  if (TCR_4(__kmp_init_serial)) {
+    KMP_WARNING(EnvSerialWarn, name);
+    return;
+  } // pools must be released the way they were acquired
+  if (__kmp_str_match_false(value)) {
+    __kmp_huge_pages = huge_pages_off;
+  } else if (__kmp_str_match("transparent", 1, value) ||
+             __kmp_str_match_true(value)) {
+    __kmp_huge_pages = huge_pages_transparent;
+  } else if (__kmp_str_match("explicit", 1, value)) {
+    __kmp_huge_pages = huge_pages_explicit;
+  } else {
+    KMP_WARNING(StgInvalidValue, name, value);
+  }
+} // __kmp_stg_parse_huge_pages
+
+static void __kmp_stg_print_huge_pages(kmp_str_buf_t *buffer, char const *name,
+                                       void *data) {
+  static char const *names[] = {"false", "transparent", "explicit"};
+  __kmp_stg_print_str(buffer, name, names[__kmp_huge_pages]);
+} // __kmp_stg_print_huge_pages
+
+// -----------------------------------------------------------------------------
+// KMP_PREFAULT_PAGES
+
+static void __kmp_stg_parse_prefault_pages(char const *name, char const *value,
+                                           void *data) {
+  if (TCR_4(__kmp_init_serial)) {
+    KMP_WARNING(EnvSerialWarn, name);
+    return;
+  } // pools must be released the way they were acquired
+  if (__kmp_str_match_false(value)) {
+    __kmp_prefault_pages = prefault_off;
+  } else if (__kmp_str_match("touch", 1, value) ||
+             __kmp_str_match_true(value)) {
+    __kmp_prefault_pages = prefault_touch;
+  } else if (__kmp_str_match("mlock", 1, value)) {
+    __kmp_prefault_pages = prefault_mlock;
+  } else {
+    KMP_WARNING(StgInvalidValue, name, value);
+  }
+} // __kmp_stg_parse_prefault_pages
+
+static void __kmp_stg_print_prefault_pages(kmp_str_buf_t *buffer,
+                                           char const *name, void *data) {
+  static char const *names[] = {"false", "touch", "mlock"};
+  __kmp_stg_print_str(buffer, name, names[__kmp_prefault_pages]);
+} // __kmp_stg_print_prefault_pages
+
+#if OMP_50_ENABLED
+// -----------------------------------------------------------------------------
+// OMP_ALLOCATOR
+
+static char const *__kmp_allocator_names[] = {
+    NULL, // omp_null_allocator
+    "omp_default_mem_alloc", "omp_large_cap_mem_alloc", "omp_const_mem_alloc",
+    "omp_high_bw_mem_alloc", "omp_low_lat_mem_alloc",   "omp_cgroup_mem_alloc",
+    "omp_pteam_mem_alloc",   "omp_thread_mem_alloc"};
+
+static void __kmp_stg_parse_allocator(char const *name, char const *value,
+                                      void *data) {
+  int i;
+  for (i = omp_default_mem_alloc; i <= omp_thread_mem_alloc; ++i) {
+    if (__kmp_str_match(__kmp_allocator_names[i], 0, value)) {
+      __kmp_def_allocator = (omp_allocator_handle_t)i;
+      return;
+    }
+  }
+  KMP_WARNING(StgInvalidValue, name, value);
+} // __kmp_stg_parse_allocator
+
+static void __kmp_stg_print_allocator(kmp_str_buf_t *buffer, char const *name,
+                                      void *data) {
+  __kmp_stg_print_str(buffer, name,
+                      __kmp_allocator_names[(int)__kmp_def_allocator]);
+} // __kmp_stg_print_allocator
+
+// -----------------------------------------------------------------------------
+// KMP_ALLOC_MMAP_THRESHOLD
+
+static void __kmp_stg_parse_alloc_mmap_threshold(char const *name,
+                                                 char const *value,
+                                                 void *data) {
+  __kmp_stg_parse_size(name, value, 0, KMP_MAX_MALLOC_POOL_INCR, NULL,
+                       &__kmp_alloc_mmap_threshold, 1);
+} // __kmp_stg_parse_alloc_mmap_threshold
+
+static void __kmp_stg_print_alloc_mmap_threshold(kmp_str_buf_t *buffer,
+                                                 char const *name,
+                                                 void *data) {
+  __kmp_stg_print_size(buffer, name, __kmp_alloc_mmap_threshold);
+} // __kmp_stg_print_alloc_mmap_threshold
+#endif // OMP_50_ENABLED
+
 #ifdef KMP_DEBUG
 
 // -----------------------------------------------------------------------------
@@ -3717,6 +4049,32 @@ static void __kmp_stg_print_lock_block(kmp_str_buf_t *buffer, char const *name,
   __kmp_stg_print_int(buffer, name, __kmp_num_locks_in_block);
 } // __kmp_stg_print_lock_block
 
+// -----------------------------------------------------------------------------
+// KMP_LOCK_PROFILE
+
+static void __kmp_stg_parse_lock_profile(char const *name, char const *value,
+                                         void *data) {
+  __kmp_stg_parse_int(name, value, 0, KMP_INT_MAX, &__kmp_lock_profile_period);
+} // __kmp_stg_parse_lock_profile
+
+static void __kmp_stg_print_lock_profile(kmp_str_buf_t *buffer,
+                                         char const *name, void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_lock_profile_period);
+} // __kmp_stg_print_lock_profile
+
+// -----------------------------------------------------------------------------
+// KMP_CRITICAL_DELEGATE
+
+static void __kmp_stg_parse_critical_delegate(char const *name,
+                                              char const *value, void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_critical_delegate);
+} // __kmp_stg_parse_critical_delegate
+
+static void __kmp_stg_print_critical_delegate(kmp_str_buf_t *buffer,
+                                              char const *name, void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_critical_delegate);
+} // __kmp_stg_print_critical_delegate
+
 // -----------------------------------------------------------------------------
 // KMP_LOCK_KIND
 
@@ -3772,6 +4130,16 @@ static void __kmp_stg_parse_lock_kind(char const *name, char const *value,
     __kmp_user_lock_kind = lk_drdpa;
     KMP_STORE_LOCK_SEQ(drdpa);
   }
+#if KMP_USE_DYNAMIC_LOCK
+  else if (__kmp_str_match("cohort", 1, value)) {
+    __kmp_user_lock_kind = lk_cohort;
+    KMP_STORE_LOCK_SEQ(cohort);
+  }
+  else if (__kmp_str_match("morph", 1, value)) {
+    __kmp_user_lock_kind = lk_morph;
+    KMP_STORE_LOCK_SEQ(morph);
+  }
+#endif
 #if KMP_USE_ADAPTIVE_LOCKS
   else if (__kmp_str_match("adaptive", 1, value)) {
     if (__kmp_cpuinfo.rtm) { // ??? Is cpuinfo available here?
@@ -3844,6 +4212,14 @@ static void __kmp_stg_print_lock_kind(kmp_str_buf_t *buffer, char const *name,
   case lk_drdpa:
     value = "drdpa";
     break;
+#if KMP_USE_DYNAMIC_LOCK
+  case lk_cohort:
+    value = "cohort";
+    break;
+  case lk_morph:
+    value = "morph";
+    break;
+#endif
 #if KMP_USE_ADAPTIVE_LOCKS
   case lk_adaptive:
     value = "adaptive";
@@ -3958,11 +4334,14 @@ static void __kmp_stg_print_spin_backoff_params(kmp_str_buf_t *buffer,
 // KMP_ADAPTIVE_LOCK_PROPS, KMP_SPECULATIVE_STATSFILE
 
 // Parse out values for the tunable parameters from a string of the form
-// KMP_ADAPTIVE_LOCK_PROPS=max_soft_retries[,max_badness]
+// KMP_ADAPTIVE_LOCK_PROPS=
+//     max_soft_retries[,max_badness[,window[,min_success]]]
 static void __kmp_stg_parse_adaptive_lock_props(const char *name,
                                                 const char *value, void *data) {
   int max_retries = 0;
   int max_badness = 0;
+  int window = __kmp_adaptive_backoff_params.window;
+  int min_success = __kmp_adaptive_backoff_params.min_success;
 
   const char *next = value;
 
@@ -3979,9 +4358,9 @@ static void __kmp_stg_parse_adaptive_lock_props(const char *name,
     if (*next == '\0') {
       break;
     }
-    // Next character is not an integer or not a comma OR number of values > 2
+    // Next character is not an integer or not a comma OR number of values > 4
     // => end of list
-    if (((*next < '0' || *next > '9') && *next != ',') || total > 2) {
+    if (((*next < '0' || *next > '9') && *next != ',') || total > 4) {
       KMP_WARNING(EnvSyntaxError, name, value);
       return;
     }
@@ -4028,6 +4407,10 @@ static void __kmp_stg_parse_adaptive_lock_props(const char *name,
         max_retries = num;
       } else if (total == 2) {
         max_badness = num;
+      } else if (total == 3) {
+        window = num > 0 ? num : 1;
+      } else if (total == 4) {
+        min_success = num < 100 ? num : 100;
       }
     }
   }
@@ -4038,6 +4421,8 @@ static void __kmp_stg_parse_adaptive_lock_props(const char *name,
   }
   __kmp_adaptive_backoff_params.max_soft_retries = max_retries;
   __kmp_adaptive_backoff_params.max_badness = max_badness;
+  __kmp_adaptive_backoff_params.window = window;
+  __kmp_adaptive_backoff_params.min_success = min_success;
 }
 
 static void __kmp_stg_print_adaptive_lock_props(kmp_str_buf_t *buffer,
@@ -4047,9 +4432,11 @@ static void __kmp_stg_print_adaptive_lock_props(kmp_str_buf_t *buffer,
   } else {
     __kmp_str_buf_print(buffer, "   %s='", name);
   }
-  __kmp_str_buf_print(buffer, "%d,%d'\n",
+  __kmp_str_buf_print(buffer, "%d,%d,%d,%d'\n",
                       __kmp_adaptive_backoff_params.max_soft_retries,
-                      __kmp_adaptive_backoff_params.max_badness);
+                      __kmp_adaptive_backoff_params.max_badness,
+                      __kmp_adaptive_backoff_params.window,
+                      __kmp_adaptive_backoff_params.min_success);
 } // __kmp_stg_print_adaptive_lock_props
 
 #if KMP_DEBUG_ADAPTIVE_LOCKS
@@ -4340,6 +4727,14 @@ static kmp_setting_t __kmp_stg_table[] = {
      __kmp_stg_print_all_threads, NULL, 0, 0},
     {"KMP_BLOCKTIME", __kmp_stg_parse_blocktime, __kmp_stg_print_blocktime,
      NULL, 0, 0},
+#if KMP_OS_LINUX
+    {"KMP_CGROUP_QUOTA", __kmp_stg_parse_cgroup_quota,
+     __kmp_stg_print_cgroup_quota, NULL, 0, 0},
+    {"KMP_CGROUP_RECHECK", __kmp_stg_parse_cgroup_recheck,
+     __kmp_stg_print_cgroup_recheck, NULL, 0, 0},
+    {"KMP_CGROUP_PATH", __kmp_stg_parse_cgroup_path,
+     __kmp_stg_print_cgroup_path, NULL, 0, 0},
+#endif
     {"KMP_DUPLICATE_LIB_OK", __kmp_stg_parse_duplicate_lib_ok,
      __kmp_stg_print_duplicate_lib_ok, NULL, 0, 0},
     {"KMP_LIBRARY", __kmp_stg_parse_wait_policy, __kmp_stg_print_wait_policy,
@@ -4384,6 +4779,10 @@ static kmp_setting_t __kmp_stg_table[] = {
      __kmp_stg_print_max_task_priority, NULL, 0, 0},
     {"KMP_TASKLOOP_MIN_TASKS", __kmp_stg_parse_taskloop_min_tasks,
      __kmp_stg_print_taskloop_min_tasks, NULL, 0, 0},
+    {"KMP_TASKLOOP_LAZY_SPLIT", __kmp_stg_parse_taskloop_lazy_split,
+     __kmp_stg_print_taskloop_lazy_split, NULL, 0, 0},
+    {"KMP_DOACROSS_DENSE_LIMIT", __kmp_stg_parse_doacross_dense_limit,
+     __kmp_stg_print_doacross_dense_limit, NULL, 0, 0},
 #endif
     {"OMP_THREAD_LIMIT", __kmp_stg_parse_all_threads,
      __kmp_stg_print_all_threads, NULL, 0, 0},
@@ -4391,6 +4790,8 @@ static kmp_setting_t __kmp_stg_table[] = {
      __kmp_stg_print_wait_policy, NULL, 0, 0},
     {"KMP_DISP_NUM_BUFFERS", __kmp_stg_parse_disp_buffers,
      __kmp_stg_print_disp_buffers, NULL, 0, 0},
+    {"KMP_DISP_GROW_BUFFERS", __kmp_stg_parse_disp_grow_buffers,
+     __kmp_stg_print_disp_grow_buffers, NULL, 0, 0},
 #if KMP_NESTED_HOT_TEAMS
     {"KMP_HOT_TEAMS_MAX_LEVEL", __kmp_stg_parse_hot_teams_level,
      __kmp_stg_print_hot_teams_level, NULL, 0, 0},
@@ -4468,6 +4869,8 @@ static kmp_setting_t __kmp_stg_table[] = {
      __kmp_stg_print_abort_delay, NULL, 0, 0},
     {"KMP_CPUINFO_FILE", __kmp_stg_parse_cpuinfo_file,
      __kmp_stg_print_cpuinfo_file, NULL, 0, 0},
+    {"KMP_TOPOLOGY_CACHE", __kmp_stg_parse_topology_cache,
+     __kmp_stg_print_topology_cache, NULL, 0, 0},
     {"KMP_FORCE_REDUCTION", __kmp_stg_parse_force_reduction,
      __kmp_stg_print_force_reduction, NULL, 0, 0},
     {"KMP_DETERMINISTIC_REDUCTION", __kmp_stg_parse_force_reduction,
@@ -4479,6 +4882,8 @@ static kmp_setting_t __kmp_stg_table[] = {
     {"KMP_FOREIGN_THREADS_THREADPRIVATE",
      __kmp_stg_parse_foreign_threads_threadprivate,
      __kmp_stg_print_foreign_threads_threadprivate, NULL, 0, 0},
+    {"KMP_LAZY_THREADPRIVATE", __kmp_stg_parse_lazy_threadprivate,
+     __kmp_stg_print_lazy_threadprivate, NULL, 0, 0},
 
 #if KMP_AFFINITY_SUPPORTED
     {"KMP_AFFINITY", __kmp_stg_parse_affinity, __kmp_stg_print_affinity, NULL,
@@ -4527,6 +4932,20 @@ static kmp_setting_t __kmp_stg_table[] = {
 #endif /* USE_ITT_BUILD && USE_ITT_NOTIFY */
     {"KMP_MALLOC_POOL_INCR", __kmp_stg_parse_malloc_pool_incr,
      __kmp_stg_print_malloc_pool_incr, NULL, 0, 0},
+    {"KMP_FAST_MEMORY_ENGINE", __kmp_stg_parse_fast_mem_engine,
+     __kmp_stg_print_fast_mem_engine, NULL, 0, 0},
+    {"KMP_NUMA_LOCAL_THREADS", __kmp_stg_parse_numa_local_threads,
+     __kmp_stg_print_numa_local_threads, NULL, 0, 0},
+    {"KMP_HUGE_PAGES", __kmp_stg_parse_huge_pages, __kmp_stg_print_huge_pages,
+     NULL, 0, 0},
+    {"KMP_PREFAULT_PAGES", __kmp_stg_parse_prefault_pages,
+     __kmp_stg_print_prefault_pages, NULL, 0, 0},
+#if OMP_50_ENABLED
+    {"OMP_ALLOCATOR", __kmp_stg_parse_allocator, __kmp_stg_print_allocator,
+     NULL, 0, 0},
+    {"KMP_ALLOC_MMAP_THRESHOLD", __kmp_stg_parse_alloc_mmap_threshold,
+     __kmp_stg_print_alloc_mmap_threshold, NULL, 0, 0},
+#endif
     {"KMP_INIT_WAIT", __kmp_stg_parse_init_wait, __kmp_stg_print_init_wait,
      NULL, 0, 0},
     {"KMP_NEXT_WAIT", __kmp_stg_parse_next_wait, __kmp_stg_print_next_wait,
@@ -4547,6 +4966,10 @@ static kmp_setting_t __kmp_stg_table[] = {
      __kmp_stg_print_lock_block, NULL, 0, 0},
     {"KMP_LOCK_KIND", __kmp_stg_parse_lock_kind, __kmp_stg_print_lock_kind,
      NULL, 0, 0},
+    {"KMP_LOCK_PROFILE", __kmp_stg_parse_lock_profile,
+     __kmp_stg_print_lock_profile, NULL, 0, 0},
+    {"KMP_CRITICAL_DELEGATE", __kmp_stg_parse_critical_delegate,
+     __kmp_stg_print_critical_delegate, NULL, 0, 0},
     {"KMP_SPIN_BACKOFF_PARAMS", __kmp_stg_parse_spin_backoff_params,
      __kmp_stg_print_spin_backoff_params, NULL, 0, 0},
 #if KMP_USE_ADAPTIVE_LOCKS
@@ -5155,6 +5578,15 @@ void __kmp_env_initialize(char const *string) {
             case affinity_gran_core:
               str = "core";
               break;
+            case affinity_gran_tile:
+              str = "tile";
+              break;
+            case affinity_gran_llc:
+              str = "llc";
+              break;
+            case affinity_gran_numa:
+              str = "numa";
+              break;
             case affinity_gran_package:
               str = "package";
               break;
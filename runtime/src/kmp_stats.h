@@ -105,7 +105,20 @@ enum stats_state_e {
                                       macro(OMP_TASKLOOP, 0, arg)              \
                                           macro(TASK_executed, 0, arg)         \
                                               macro(TASK_cancelled, 0, arg)    \
-                                                  macro(TASK_stolen, 0, arg)
+                                                  macro(TASK_stolen, 0, arg)   \
+      macro(OMP_FOR_buffer_stall, 0, arg)                                      \
+      macro(OMP_FOR_buffer_overflow, 0, arg)                                   \
+      macro(TASK_inlined, 0, arg)                                              \
+      macro(LOCK_morph_inflate, 0, arg)                                        \
+      macro(LOCK_morph_deflate, 0, arg)                                        \
+      macro(LOCK_morph_sleep, 0, arg)                                          \
+      macro(LOCK_spec_success, 0, arg)                                         \
+      macro(LOCK_spec_abort_conflict, 0, arg)                                  \
+      macro(LOCK_spec_abort_capacity, 0, arg)                                  \
+      macro(LOCK_spec_abort_explicit, 0, arg)                                  \
+      macro(LOCK_spec_abort_other, 0, arg)                                     \
+      macro(LOCK_spec_disable, 0, arg)                                         \
+      macro(OMP_CRITICAL_delegated, 0, arg)
 // clang-format on
 
 /*!
@@ -160,6 +173,10 @@ enum stats_state_e {
            stats_flags_e::noUnits | stats_flags_e::noTotal, arg)               \
     macro (FOR_static_steal_chunks,                                            \
            stats_flags_e::noUnits | stats_flags_e::noTotal, arg)               \
+    macro (LOCK_morph_acquires,                                                \
+           stats_flags_e::noUnits | stats_flags_e::noTotal, arg)               \
+    macro (LOCK_morph_contended,                                               \
+           stats_flags_e::noUnits | stats_flags_e::noTotal, arg)               \
     KMP_FOREACH_DEVELOPER_TIMER(macro, arg)
 // clang-format on
 
@@ -198,6 +215,10 @@ enum stats_state_e {
 //                           Both adjust for any chunking, so if there were an
 //                           iteration count of 20 but a chunk size of 10, we'd
 //                           record 2.
+// LOCK_morph_acquires    -- Number of acquisitions of each destroyed morphing
+//                           lock
+// LOCK_morph_contended   -- Number of those acquisitions that found the lock
+//                           busy
 
 #if (KMP_DEVELOPER_STATS)
 // Timers which are of interest to runtime library developers, not end users.
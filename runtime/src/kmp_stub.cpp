@@ -17,9 +17,9 @@
 #include <limits.h>
 #include <stdlib.h>
 
+#include "omp.h" // Function renamings.
 #include "kmp.h" // KMP_DEFAULT_STKSIZE
 #include "kmp_stub.h"
-#include "omp.h" // Function renamings.
 
 #if KMP_OS_WINDOWS
 #include <windows.h>
@@ -171,6 +171,18 @@ void kmp_free(void *ptr) {
   free(ptr);
 }
 
+#if OMP_50_ENABLED
+/* OpenMP 5.0 memory management: every allocator maps to the system heap. */
+void *omp_alloc(size_t size, omp_allocator_handle_t allocator) {
+  i;
+  return malloc(size);
+}
+void omp_free(void *ptr, omp_allocator_handle_t allocator) {
+  i;
+  free(ptr);
+}
+#endif
+
 static int __kmps_blocktime = INT_MAX;
 
 void __kmps_set_blocktime(int arg) {
@@ -474,6 +474,26 @@ static void __kmp_task_start(kmp_int32 gtid, kmp_task_t *task,
   return;
 }
 
+// __kmp_task_is_light: an included task runs to completion on the encountering
+// thread before its generating task resumes, and nothing else waits for it.
+// Unless it is untied, a tool is watching task events or it took part in
+// dependences, it can start and finish without the general bookkeeping.
+static inline bool __kmp_task_is_light(kmp_taskdata_t *taskdata) {
+#ifdef BUILD_TIED_TASK_STACK
+  return false;
+#else
+  return taskdata->td_flags.included &&
+         taskdata->td_flags.tiedness == TASK_TIED
+#if OMPT_SUPPORT
+         && !ompt_enabled
+#endif
+#if OMP_40_ENABLED
+         && taskdata->td_dephash == NULL && taskdata->td_depnode == NULL
+#endif
+      ;
+#endif
+}
+
 // __kmpc_omp_task_begin_if0: report that a given serialized task has started
 // execution
 //
@@ -489,6 +509,20 @@ void __kmpc_omp_task_begin_if0(ident_t *loc_ref, kmp_int32 gtid,
                 "current_task=%p\n",
                 gtid, loc_ref, taskdata, current_task));
 
+  if (__kmp_task_is_light(taskdata)) {
+    KMP_COUNT_BLOCK(TASK_inlined);
+    taskdata->td_flags.task_serial = 1;
+    current_task->td_flags.executing = 0;
+    __kmp_threads[gtid]->th.th_current_task = taskdata;
+    KMP_DEBUG_ASSERT(taskdata->td_flags.started == 0);
+    taskdata->td_flags.started = 1;
+    taskdata->td_flags.executing = 1;
+    KA_TRACE(10, ("__kmpc_omp_task_begin_if0(exit): T#%d loc=%p task=%p "
+                  "included\n",
+                  gtid, loc_ref, taskdata));
+    return;
+  }
+
   if (taskdata->td_flags.tiedness == TASK_UNTIED) {
     // untied task needs to increment counter so that the task structure is not
     // freed prematurely
@@ -586,6 +620,7 @@ static void __kmp_free_task_and_ancestors(kmp_int32 gtid,
   // Now, go up the ancestor tree to see if any ancestors can now be freed.
   while (children == 0) {
     kmp_taskdata_t *parent_taskdata = taskdata->td_parent;
+    kmp_int32 included = taskdata->td_flags.included;
 
     KA_TRACE(20, ("__kmp_free_task_and_ancestors(enter): T#%d task %p complete "
                   "and freeing itself\n",
@@ -597,8 +632,10 @@ static void __kmp_free_task_and_ancestors(kmp_int32 gtid,
     taskdata = parent_taskdata;
 
     // Stop checking ancestors at implicit task instead of walking up ancestor
-    // tree to avoid premature deallocation of ancestors.
-    if (team_serial || taskdata->td_flags.tasktype == TASK_IMPLICIT)
+    // tree to avoid premature deallocation of ancestors. An included task
+    // holds no reference on its parent.
+    if (team_serial || included ||
+        taskdata->td_flags.tasktype == TASK_IMPLICIT)
       return;
 
     // Predecrement simulated by "- 1" calculation
@@ -677,8 +714,9 @@ static void __kmp_task_finish(kmp_int32 gtid, kmp_task_t *task,
   KMP_DEBUG_ASSERT(taskdata->td_flags.freed == 0);
 
   // Only need to keep track of count if team parallel and tasking not
-  // serialized
-  if (!(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser)) {
+  // serialized, and the parent counted the task
+  if (!(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser ||
+        taskdata->td_flags.included)) {
     // Predecrement simulated by "- 1" calculation
     children =
         KMP_TEST_THEN_DEC32(&taskdata->td_parent->td_incomplete_child_tasks) -
@@ -769,13 +807,39 @@ static void __kmp_task_finish(kmp_int32 gtid, kmp_task_t *task,
 // task: task thunk for the completed task.
 void __kmpc_omp_task_complete_if0(ident_t *loc_ref, kmp_int32 gtid,
                                   kmp_task_t *task) {
+  kmp_taskdata_t *taskdata = KMP_TASK_TO_TASKDATA(task);
   KA_TRACE(10, ("__kmpc_omp_task_complete_if0(enter): T#%d loc=%p task=%p\n",
-                gtid, loc_ref, KMP_TASK_TO_TASKDATA(task)));
+                gtid, loc_ref, taskdata));
+
+  if (__kmp_task_is_light(taskdata)) {
+    // no counters, taskgroup or dependences to release: resume the parent
+    kmp_info_t *thread = __kmp_threads[gtid];
+    kmp_taskdata_t *parent = taskdata->td_parent;
+    KMP_DEBUG_ASSERT(taskdata->td_flags.task_serial);
+    KMP_DEBUG_ASSERT(taskdata->td_flags.complete == 0);
+    KMP_DEBUG_ASSERT(taskdata->td_flags.executing == 1);
+    taskdata->td_flags.complete = 1;
+    taskdata->td_flags.executing = 0;
+#if OMP_40_ENABLED
+    if (taskdata->td_flags.destructors_thunk) {
+      kmp_routine_entry_t destr_thunk = task->data1.destructors;
+      KMP_ASSERT(destr_thunk);
+      destr_thunk(gtid, task);
+    }
+#endif // OMP_40_ENABLED
+    thread->th.th_current_task = parent;
+    __kmp_free_task_and_ancestors(gtid, taskdata, thread);
+    parent->td_flags.executing = 1;
+    KA_TRACE(10, ("__kmpc_omp_task_complete_if0(exit): T#%d loc=%p task=%p "
+                  "included\n",
+                  gtid, loc_ref, taskdata));
+    return;
+  }
   // this routine will provide task to resume
   __kmp_task_finish(gtid, task, NULL);
 
   KA_TRACE(10, ("__kmpc_omp_task_complete_if0(exit): T#%d loc=%p task=%p\n",
-                gtid, loc_ref, KMP_TASK_TO_TASKDATA(task)));
+                gtid, loc_ref, taskdata));
   return;
 }
 
@@ -997,6 +1061,13 @@ kmp_task_t *__kmp_task_alloc(ident_t *loc_ref, kmp_int32 gtid,
   // to align pointers in shared struct
   shareds_offset = sizeof(kmp_taskdata_t) + sizeof_kmp_task_t;
   shareds_offset = __kmp_round_up_to_val(shareds_offset, sizeof(void *));
+#if USE_FAST_MEMORY
+  // Blocks are cache line aligned; start shareds on their own line so that
+  // writes to the privates by the executing thread do not share a line with
+  // the shared variable pointers
+  if (sizeof_shareds > 0)
+    shareds_offset = __kmp_round_up_to_val(shareds_offset, CACHE_LINE);
+#endif
 
   // Allocate a kmp_taskdata_t block and a kmp_task_t block.
   KA_TRACE(30, ("__kmp_task_alloc: T#%d First malloc size: %ld\n", gtid,
@@ -1086,6 +1157,13 @@ kmp_task_t *__kmp_task_alloc(ident_t *loc_ref, kmp_int32 gtid,
   taskdata->td_flags.freed = 0;
 
   taskdata->td_flags.native = flags->native;
+  // A task generated in a final task completes before its parent resumes, so
+  // the parent and its taskgroup need not count it
+  taskdata->td_flags.included = parent_task->td_flags.final;
+#if OMP_45_ENABLED
+  if (flags->proxy == TASK_PROXY)
+    taskdata->td_flags.included = 0;
+#endif
 
   taskdata->td_incomplete_child_tasks = 0;
   taskdata->td_allocated_child_tasks = 1; // start at one because counts current
@@ -1101,9 +1179,11 @@ kmp_task_t *__kmp_task_alloc(ident_t *loc_ref, kmp_int32 gtid,
 // serialized or if it is a proxy task
 #if OMP_45_ENABLED
   if (flags->proxy == TASK_PROXY ||
-      !(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser))
+      !(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser ||
+        taskdata->td_flags.included))
 #else
-  if (!(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser))
+  if (!(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser ||
+        taskdata->td_flags.included))
 #endif
   {
     KMP_TEST_THEN_INC32(&parent_task->td_incomplete_child_tasks);
@@ -3241,10 +3321,12 @@ kmp_task_t *__kmp_task_dup_alloc(kmp_info_t *thread, kmp_task_t *task_src) {
   taskdata->td_taskgroup =
       parent_task
           ->td_taskgroup; // task inherits the taskgroup from the parent task
+  taskdata->td_flags.included = parent_task->td_flags.final;
 
   // Only need to keep track of child task counts if team parallel and tasking
-  // not serialized
-  if (!(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser)) {
+  // not serialized, and the task is not included in a final task
+  if (!(taskdata->td_flags.team_serial || taskdata->td_flags.tasking_ser ||
+        taskdata->td_flags.included)) {
     KMP_TEST_THEN_INC32(&parent_task->td_incomplete_child_tasks);
     if (parent_task->td_taskgroup)
       KMP_TEST_THEN_INC32(&parent_task->td_taskgroup->count);
@@ -3516,6 +3598,155 @@ void __kmp_taskloop_recur(ident_t *loc, int gtid, kmp_task_t *task,
   KA_TRACE(40, ("__kmpc_taskloop_recur(exit): T#%d\n", gtid));
 }
 
+void __kmp_taskloop_lazy(ident_t *, int, kmp_task_t *, kmp_uint64 *,
+                         kmp_uint64 *, kmp_int64, kmp_uint64, kmp_uint64,
+                         kmp_uint64, void *);
+
+// Execute part of the taskloop submitted as a lazily split task.
+int __kmp_taskloop_lazy_task(int gtid, void *ptask) {
+  __taskloop_params_t *p =
+      (__taskloop_params_t *)((kmp_task_t *)ptask)->shareds;
+  KA_TRACE(20, ("__kmp_taskloop_lazy_task: T#%d, task %p: tc %lld, grainsize"
+                " %lld, i=%lld,%lld(%d)\n",
+                gtid, KMP_TASK_TO_TASKDATA(p->task), p->tc, p->grainsize,
+                *p->lb, *p->ub, p->st));
+  __kmp_taskloop_lazy(NULL, gtid, p->task, p->lb, p->ub, p->st, p->ub_glob,
+                      p->grainsize, p->tc, p->task_dup);
+  KA_TRACE(40, ("__kmp_taskloop_lazy_task(exit): T#%d\n", gtid));
+  return 0;
+}
+
+// Check whether a lazily split taskloop range should give away half of its
+// iterations: this is the case when the thread's own deque is empty, i.e.
+// nothing is left there for other threads to steal (lazy binary splitting).
+static bool __kmp_taskloop_need_split(kmp_info_t *thread, kmp_int32 gtid) {
+  kmp_task_team_t *task_team = thread->th.th_task_team;
+  kmp_taskdata_t *current_task = thread->th.th_current_task;
+  kmp_thread_data_t *threads_data;
+
+  if (task_team == NULL || thread->th.th_team_nproc == 1 ||
+      current_task->td_flags.task_serial || current_task->td_flags.final)
+    return false;
+  threads_data = (kmp_thread_data_t *)TCR_PTR(task_team->tt.tt_threads_data);
+  if (threads_data == NULL)
+    return true; // tasking not enabled yet, nothing to steal for sure
+  return TCR_4(threads_data[__kmp_tid_from_gtid(gtid)].td.td_deque_ntasks) ==
+         0;
+}
+
+// __kmp_taskloop_lazy: Execute the taskloop range chunk by chunk, splitting
+// off half of the remaining iterations as a new task whenever other threads
+// may have run out of work. Chunks start at grainsize iterations and grow
+// while nobody asks for work, so that a range which is never stolen from
+// pays for few task descriptors.
+//
+// loc       Source location information
+// gtid      Global thread ID
+// task      Pattern task, exposes the loop iteration range
+// lb        Pointer to loop lower bound in task structure
+// ub        Pointer to loop upper bound in task structure
+// st        Loop stride
+// ub_glob   Global upper bound (used for lastprivate check)
+// grainsize Minimal number of loop iterations per chunk
+// tc        Iterations count
+// task_dup  Tasks duplication routine
+void __kmp_taskloop_lazy(ident_t *loc, int gtid, kmp_task_t *task,
+                         kmp_uint64 *lb, kmp_uint64 *ub, kmp_int64 st,
+                         kmp_uint64 ub_glob, kmp_uint64 grainsize,
+                         kmp_uint64 tc, void *task_dup) {
+  KMP_COUNT_BLOCK(OMP_TASKLOOP);
+  p_task_dup_t ptask_dup = (p_task_dup_t)task_dup;
+  kmp_uint64 lower = *lb;
+  kmp_uint64 remaining = tc;
+  kmp_uint64 chunk = grainsize;
+  kmp_info_t *thread = __kmp_threads[gtid];
+  kmp_taskdata_t *current_task = thread->th.th_current_task;
+  kmp_task_t *next_task;
+  size_t lower_offset =
+      (char *)lb - (char *)task; // remember offset of lb in the task structure
+  size_t upper_offset =
+      (char *)ub - (char *)task; // remember offset of ub in the task structure
+
+  KMP_DEBUG_ASSERT(tc > 0);
+  KMP_DEBUG_ASSERT(grainsize > 0);
+  KA_TRACE(20, ("__kmp_taskloop_lazy: T#%d: tc %lld, grainsize %lld, "
+                "i=%lld,%lld(%d)%lld, dup %p\n",
+                gtid, tc, grainsize, lower, *ub, st, ub_glob, task_dup));
+
+  while (remaining > 0) {
+    kmp_uint64 upper;
+    if (remaining >= 2 * grainsize &&
+        __kmp_taskloop_need_split(thread, gtid)) {
+      // give the 2nd half of the range away as a new lazy task
+      kmp_uint64 tc1 = remaining >> 1;
+      kmp_uint64 tc0 = remaining - tc1;
+      next_task = __kmp_task_dup_alloc(thread, task); // duplicate the task
+      *(kmp_uint64 *)((char *)next_task + lower_offset) = lower + st * tc0;
+      *(kmp_uint64 *)((char *)next_task + upper_offset) =
+          lower + st * (remaining - 1);
+      if (ptask_dup != NULL) // construct fistprivates, etc.
+        ptask_dup(next_task, task, 0);
+      kmp_task_t *new_task = __kmpc_omp_task_alloc(
+          loc, gtid, 1, 3 * sizeof(void *), sizeof(__taskloop_params_t),
+          &__kmp_taskloop_lazy_task);
+      __taskloop_params_t *p = (__taskloop_params_t *)new_task->shareds;
+      p->task = next_task;
+      p->lb = (kmp_uint64 *)((char *)next_task + lower_offset);
+      p->ub = (kmp_uint64 *)((char *)next_task + upper_offset);
+      p->task_dup = task_dup;
+      p->st = st;
+      p->ub_glob = ub_glob;
+      p->num_tasks = 0;
+      p->grainsize = grainsize;
+      p->extras = 0;
+      p->tc = tc1;
+      p->num_t_min = 0;
+      KA_TRACE(40, ("__kmp_taskloop_lazy: T#%d split off %lld iterations "
+                    "from %lld\n",
+                    gtid, tc1, lower + st * tc0));
+      __kmp_omp_task(gtid, new_task, true); // schedule new task
+      remaining = tc0;
+      chunk = grainsize; // somebody is hungry, keep chunks small
+      continue;
+    }
+    kmp_uint64 n = KMP_MIN(chunk, remaining);
+    kmp_int32 lastpriv = 0;
+    upper = lower + st * (n - 1);
+    if (n == remaining) {
+      // last chunk of the range, set lastprivate flag if needed
+      if (st == 1) { // most common case
+        if (upper == ub_glob)
+          lastpriv = 1;
+      } else if (st > 0) { // positive loop stride
+        if ((kmp_uint64)st > ub_glob - upper)
+          lastpriv = 1;
+      } else { // negative loop stride
+        if (upper - ub_glob < (kmp_uint64)(-st))
+          lastpriv = 1;
+      }
+    }
+    next_task = __kmp_task_dup_alloc(thread, task); // allocate new task
+    *(kmp_uint64 *)((char *)next_task + lower_offset) = lower;
+    *(kmp_uint64 *)((char *)next_task + upper_offset) = upper;
+    if (ptask_dup != NULL) // set lastprivate flag, construct fistprivates, etc.
+      ptask_dup(next_task, task, lastpriv);
+    KA_TRACE(40, ("__kmp_taskloop_lazy: T#%d; task %p: lower %lld, "
+                  "upper %lld\n",
+                  gtid, next_task, lower, upper));
+    // execute the chunk right away, it is never visible to other threads
+    KMP_TASK_TO_TASKDATA(next_task)->td_flags.task_serial = 1;
+    __kmp_invoke_task(gtid, next_task, current_task);
+    lower = upper + st;
+    remaining -= n;
+    if (chunk < KMP_TASKLOOP_LAZY_MAX_GROW * grainsize)
+      chunk <<= 1;
+  }
+  // free the pattern task and exit
+  __kmp_task_start(gtid, task, current_task); // make internal bookkeeping
+  // do not execute the pattern task, just do internal bookkeeping
+  __kmp_task_finish(gtid, task, current_task);
+}
+
 /*!
 @ingroup TASKING
 @param loc       Source location information
@@ -3620,6 +3851,15 @@ void __kmpc_taskloop(ident_t *loc, int gtid, kmp_task_t *task, int if_val,
     // always start serial tasks linearly
     __kmp_taskloop_linear(loc, gtid, task, lb, ub, st, ub_glob, num_tasks,
                           grainsize, extras, tc, task_dup);
+  } else if (__kmp_taskloop_lazy_split && sched == 0) {
+    // no clause restricts the tasks, split them off on demand only
+    grainsize = tc / (thread->th.th_team_nproc * KMP_TASKLOOP_LAZY_CHUNKS);
+    if (grainsize == 0)
+      grainsize = 1;
+    KA_TRACE(20, ("__kmpc_taskloop: T#%d, go lazy: tc %llu, grain %llu\n",
+                  gtid, tc, grainsize));
+    __kmp_taskloop_lazy(loc, gtid, task, lb, ub, st, ub_glob, grainsize, tc,
+                        task_dup);
   } else if (num_tasks > num_tasks_min) {
     KA_TRACE(20, ("__kmpc_taskloop: T#%d, go recursive: tc %llu, #tasks %llu"
                   "(%lld), grain %llu, extras %llu\n",
@@ -17,6 +17,12 @@
 #include "kmp_i18n.h"
 #include "kmp_itt.h"
 
+#if KMP_OS_LINUX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #define USE_CHECKS_COMMON
 
 #define KMP_INLINE_SUBR 1
@@ -29,30 +35,28 @@ struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
 
 struct shared_table __kmp_threadprivate_d_table;
 
+// Threadprivate variables get a slot number when they are first seen; every
+// thread keeps its copy of a variable at that index of th_pri_slots. Only the
+// owning thread touches its array, so lookups and growth take no lock.
+static kmp_int32 __kmp_threadprivate_nslots = 0;
+
 static
 #ifdef KMP_INLINE_SUBR
     __forceinline
 #endif
-    struct private_common *
-    __kmp_threadprivate_find_task_common(struct common_table *tbl, int gtid,
-                                         void *pc_addr)
-
-{
-  struct private_common *tn;
-
-#ifdef KMP_TASK_COMMON_DEBUG
-  KC_TRACE(10, ("__kmp_threadprivate_find_task_common: thread#%d, called with "
-                "address %p\n",
-                gtid, pc_addr));
-  dump_list();
-#endif
+    struct shared_common *
+    __kmp_find_shared_task_common(struct shared_table *tbl, int gtid,
+                                  void *pc_addr) {
+  struct shared_common *tn;
 
-  for (tn = tbl->data[KMP_HASH(pc_addr)]; tn; tn = tn->next) {
+  for (tn = (struct shared_common *)TCR_PTR(tbl->data[KMP_HASH(pc_addr)]); tn;
+       tn = tn->next) {
     if (tn->gbl_addr == pc_addr) {
 #ifdef KMP_TASK_COMMON_DEBUG
-      KC_TRACE(10, ("__kmp_threadprivate_find_task_common: thread#%d, found "
-                    "node %p on list\n",
-                    gtid, pc_addr));
+      KC_TRACE(
+          10,
+          ("__kmp_find_shared_task_common: thread#%d, found node %p on list\n",
+           gtid, pc_addr));
 #endif
       return tn;
     }
@@ -64,23 +68,73 @@ static
 #ifdef KMP_INLINE_SUBR
     __forceinline
 #endif
-    struct shared_common *
-    __kmp_find_shared_task_common(struct shared_table *tbl, int gtid,
-                                  void *pc_addr) {
-  struct shared_common *tn;
+    struct private_common *
+    __kmp_threadprivate_find_slot(kmp_info_t *th, int slot) {
+  return slot < th->th.th_pri_nslots ? th->th.th_pri_slots[slot] : 0;
+}
+
+static
+#ifdef KMP_INLINE_SUBR
+    __forceinline
+#endif
+    struct private_common *
+    __kmp_threadprivate_find_task_common(kmp_info_t *th, int gtid,
+                                         void *pc_addr)
+
+{
+  struct shared_common *d_tn;
 
-  for (tn = tbl->data[KMP_HASH(pc_addr)]; tn; tn = tn->next) {
-    if (tn->gbl_addr == pc_addr) {
 #ifdef KMP_TASK_COMMON_DEBUG
-      KC_TRACE(
-          10,
-          ("__kmp_find_shared_task_common: thread#%d, found node %p on list\n",
-           gtid, pc_addr));
+  KC_TRACE(10, ("__kmp_threadprivate_find_task_common: thread#%d, called with "
+                "address %p\n",
+                gtid, pc_addr));
+  dump_list();
 #endif
-      return tn;
-    }
+
+  d_tn = __kmp_find_shared_task_common(&__kmp_threadprivate_d_table, gtid,
+                                       pc_addr);
+  if (d_tn == 0)
+    return 0;
+  return __kmp_threadprivate_find_slot(th, d_tn->slot);
+}
+
+// Make room for the given slot in the thread's array of threadprivate copies.
+static void __kmp_threadprivate_grow_slots(kmp_info_t *th, int slot) {
+  struct private_common **slots;
+  int size = th->th.th_pri_nslots ? th->th.th_pri_nslots : 8;
+
+  while (size <= slot)
+    size *= 2;
+  slots = (struct private_common **)__kmp_allocate(
+      size * sizeof(struct private_common *));
+  if (th->th.th_pri_slots != NULL) {
+    KMP_MEMCPY(slots, th->th.th_pri_slots,
+               th->th.th_pri_nslots * sizeof(struct private_common *));
+    __kmp_free(th->th.th_pri_slots);
   }
-  return 0;
+  th->th.th_pri_slots = slots;
+  th->th.th_pri_nslots = size;
+}
+
+// Allocate the descriptor of a threadprivate variable and give it a slot.
+static struct shared_common *__kmp_threadprivate_new_common(void *pc_addr) {
+  struct shared_common *d_tn;
+
+  d_tn = (struct shared_common *)__kmp_allocate(sizeof(struct shared_common));
+  d_tn->gbl_addr = pc_addr;
+  d_tn->slot = KMP_TEST_THEN_INC32(&__kmp_threadprivate_nslots);
+  d_tn->lazy_fd = -1;
+  return d_tn;
+}
+
+// Publish the descriptor; the table is searched without a lock.
+static void __kmp_threadprivate_link_common(struct shared_common *d_tn) {
+  struct shared_common **lnk_tn =
+      &(__kmp_threadprivate_d_table.data[KMP_HASH(d_tn->gbl_addr)]);
+
+  d_tn->next = *lnk_tn;
+  KMP_MB();
+  TCW_PTR(*lnk_tn, d_tn);
 }
 
 // Create a template for the data initialized storage. Either the template is
@@ -113,22 +167,95 @@ static struct private_data *__kmp_init_common_data(void *pc_addr,
   return d;
 }
 
-// Initialize the data area from the template.
+// Initialize the data area from the template. The area comes from
+// __kmp_allocate(), so zero filled parts need not be written again.
 static void __kmp_copy_common_data(void *pc_addr, struct private_data *d) {
   char *addr = (char *)pc_addr;
-  int i, offset;
+  size_t offset;
+  int i;
 
   for (offset = 0; d != 0; d = d->next) {
     for (i = d->more; i > 0; --i) {
-      if (d->data == 0)
-        memset(&addr[offset], '\0', d->size);
-      else
+      if (d->data != 0)
         KMP_MEMCPY(&addr[offset], d->data, d->size);
       offset += d->size;
     }
   }
 }
 
+#if KMP_OS_LINUX
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 1U
+#endif
+
+// Put the initial image of a variable in a memory file that lazy copies map.
+static int __kmp_threadprivate_lazy_image(struct private_data *d) {
+  int fd = -1;
+  void *img;
+
+#ifdef SYS_memfd_create
+  fd = syscall(SYS_memfd_create, "omp_threadprivate", MFD_CLOEXEC);
+#endif
+  if (fd < 0)
+    return -2;
+  if (ftruncate(fd, d->size) == 0) {
+    img = mmap(NULL, d->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (img != MAP_FAILED) {
+      KMP_MEMCPY(img, d->data, d->size);
+      munmap(img, d->size);
+      return fd;
+    }
+  }
+  close(fd);
+  return -2;
+}
+
+// Map a copy of a plain data variable whose pages are shared with its initial
+// image until the thread writes them; copies of zero initialized variables
+// need no image. Returns NULL if the copy cannot be mapped, e.g. when the
+// template is not a single block.
+static void *__kmp_threadprivate_map_lazy(struct shared_common *d_tn,
+                                          int gtid) {
+  struct private_data *d = d_tn->pod_init;
+  void *addr;
+
+  if (d == 0 || d->next != 0 || d->more != 1 || d->size != d_tn->cmn_size)
+    return NULL;
+  if (d->data == 0) {
+    addr = mmap(NULL, d->size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  } else {
+    if (TCR_4(d_tn->lazy_fd) == -1) {
+      __kmp_acquire_lock(&__kmp_global_lock, gtid);
+      if (d_tn->lazy_fd == -1)
+        TCW_4(d_tn->lazy_fd, __kmp_threadprivate_lazy_image(d));
+      __kmp_release_lock(&__kmp_global_lock, gtid);
+    }
+    if (d_tn->lazy_fd < 0)
+      return NULL;
+    addr = mmap(NULL, d->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                d_tn->lazy_fd, 0);
+  }
+  if (addr == MAP_FAILED)
+    return NULL;
+  KC_TRACE(20, ("__kmp_threadprivate_map_lazy: T#%d mapped %p, %" KMP_SIZE_T_SPEC
+                " bytes\n",
+                gtid, addr, d->size));
+  return addr;
+}
+
+// Close the initial images of the variables in a hash chain that is dropped.
+// Copies that are mapped already stay valid.
+static void __kmp_threadprivate_close_lazy(struct shared_common *d_tn) {
+  for (; d_tn; d_tn = d_tn->next) {
+    if (d_tn->lazy_fd >= 0) {
+      close(d_tn->lazy_fd);
+      d_tn->lazy_fd = -1;
+    }
+  }
+}
+#endif /* KMP_OS_LINUX */
+
 /* we are called from __kmp_serial_initialize() with __kmp_initz_lock held. */
 void __kmp_common_initialize(void) {
   if (!TCR_4(__kmp_init_common)) {
@@ -144,16 +271,17 @@ void __kmp_common_initialize(void) {
     for (gtid = 0; gtid < __kmp_threads_capacity; gtid++)
       if (__kmp_root[gtid]) {
         KMP_DEBUG_ASSERT(__kmp_root[gtid]->r.r_uber_thread);
-        for (q = 0; q < KMP_HASH_TABLE_SIZE; ++q)
-          KMP_DEBUG_ASSERT(
-              !__kmp_root[gtid]->r.r_uber_thread->th.th_pri_common->data[q]);
-        /*                    __kmp_root[ gitd ]-> r.r_uber_thread ->
-         * th.th_pri_common -> data[ q ] = 0;*/
+        KMP_DEBUG_ASSERT(!__kmp_root[gtid]->r.r_uber_thread->th.th_pri_head);
       }
 #endif /* KMP_DEBUG */
 
-    for (q = 0; q < KMP_HASH_TABLE_SIZE; ++q)
+    for (q = 0; q < KMP_HASH_TABLE_SIZE; ++q) {
+#if KMP_OS_LINUX
+      // left over from before a shutdown or a fork
+      __kmp_threadprivate_close_lazy(__kmp_threadprivate_d_table.data[q]);
+#endif
       __kmp_threadprivate_d_table.data[q] = 0;
+    }
 
     TCW_4(__kmp_init_common, TRUE);
   }
@@ -184,9 +312,8 @@ void __kmp_common_destroy(void) {
               if (__kmp_threads[gtid]) {
                 if ((__kmp_foreign_tp) ? (!KMP_INITIAL_GTID(gtid))
                                        : (!KMP_UBER_GTID(gtid))) {
-                  tn = __kmp_threadprivate_find_task_common(
-                      __kmp_threads[gtid]->th.th_pri_common, gtid,
-                      d_tn->gbl_addr);
+                  tn = __kmp_threadprivate_find_slot(__kmp_threads[gtid],
+                                                     d_tn->slot);
                   if (tn) {
                     (*d_tn->dt.dtorv)(tn->par_addr, d_tn->vec_len);
                   }
@@ -203,9 +330,8 @@ void __kmp_common_destroy(void) {
               if (__kmp_threads[gtid]) {
                 if ((__kmp_foreign_tp) ? (!KMP_INITIAL_GTID(gtid))
                                        : (!KMP_UBER_GTID(gtid))) {
-                  tn = __kmp_threadprivate_find_task_common(
-                      __kmp_threads[gtid]->th.th_pri_common, gtid,
-                      d_tn->gbl_addr);
+                  tn = __kmp_threadprivate_find_slot(__kmp_threads[gtid],
+                                                     d_tn->slot);
                   if (tn) {
                     (*d_tn->dt.dtor)(tn->par_addr);
                   }
@@ -218,6 +344,9 @@ void __kmp_common_destroy(void) {
           }
         }
       }
+#if KMP_OS_LINUX
+      __kmp_threadprivate_close_lazy(__kmp_threadprivate_d_table.data[q]);
+#endif
       __kmp_threadprivate_d_table.data[q] = 0;
     }
   }
@@ -268,23 +397,20 @@ void __kmp_common_destroy_gtid(int gtid) {
 
 #ifdef KMP_TASK_COMMON_DEBUG
 static void dump_list(void) {
-  int p, q;
+  int p;
 
   for (p = 0; p < __kmp_all_nth; ++p) {
     if (!__kmp_threads[p])
       continue;
-    for (q = 0; q < KMP_HASH_TABLE_SIZE; ++q) {
-      if (__kmp_threads[p]->th.th_pri_common->data[q]) {
-        struct private_common *tn;
+    if (__kmp_threads[p]->th.th_pri_head) {
+      struct private_common *tn;
 
-        KC_TRACE(10, ("\tdump_list: gtid:%d addresses\n", p));
+      KC_TRACE(10, ("\tdump_list: gtid:%d addresses\n", p));
 
-        for (tn = __kmp_threads[p]->th.th_pri_common->data[q]; tn;
-             tn = tn->next) {
-          KC_TRACE(10,
-                   ("\tdump_list: THREADPRIVATE: Serial %p -> Parallel %p\n",
-                    tn->gbl_addr, tn->par_addr));
-        }
+      for (tn = __kmp_threads[p]->th.th_pri_head; tn; tn = tn->link) {
+        KC_TRACE(10,
+                 ("\tdump_list: THREADPRIVATE: Serial %p -> Parallel %p\n",
+                  tn->gbl_addr, tn->par_addr));
       }
     }
   }
@@ -294,7 +420,7 @@ static void dump_list(void) {
 // NOTE: this routine is to be called only from the serial part of the program.
 void kmp_threadprivate_insert_private_data(int gtid, void *pc_addr,
                                            void *data_addr, size_t pc_size) {
-  struct shared_common **lnk_tn, *d_tn;
+  struct shared_common *d_tn;
   KMP_DEBUG_ASSERT(__kmp_threads[gtid] &&
                    __kmp_threads[gtid]->th.th_root->r.r_active == 0);
 
@@ -302,9 +428,7 @@ void kmp_threadprivate_insert_private_data(int gtid, void *pc_addr,
                                        pc_addr);
 
   if (d_tn == 0) {
-    d_tn = (struct shared_common *)__kmp_allocate(sizeof(struct shared_common));
-
-    d_tn->gbl_addr = pc_addr;
+    d_tn = __kmp_threadprivate_new_common(pc_addr);
     d_tn->pod_init = __kmp_init_common_data(data_addr, pc_size);
     /*
             d_tn->obj_init = 0;  // AC: commented out because __kmp_allocate
@@ -318,12 +442,7 @@ void kmp_threadprivate_insert_private_data(int gtid, void *pc_addr,
     d_tn->cmn_size = pc_size;
 
     __kmp_acquire_lock(&__kmp_global_lock, gtid);
-
-    lnk_tn = &(__kmp_threadprivate_d_table.data[KMP_HASH(pc_addr)]);
-
-    d_tn->next = *lnk_tn;
-    *lnk_tn = d_tn;
-
+    __kmp_threadprivate_link_common(d_tn);
     __kmp_release_lock(&__kmp_global_lock, gtid);
   }
 }
@@ -331,8 +450,10 @@ void kmp_threadprivate_insert_private_data(int gtid, void *pc_addr,
 struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
                                                 void *data_addr,
                                                 size_t pc_size) {
-  struct private_common *tn, **tt;
+  kmp_info_t *th = __kmp_threads[gtid];
+  struct private_common *tn;
   struct shared_common *d_tn;
+  int lazy = FALSE;
 
   /* +++++++++ START OF CRITICAL SECTION +++++++++ */
   __kmp_acquire_lock(&__kmp_global_lock, gtid);
@@ -378,10 +499,7 @@ struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
       }
     }
   } else {
-    struct shared_common **lnk_tn;
-
-    d_tn = (struct shared_common *)__kmp_allocate(sizeof(struct shared_common));
-    d_tn->gbl_addr = pc_addr;
+    d_tn = __kmp_threadprivate_new_common(pc_addr);
     d_tn->cmn_size = pc_size;
     d_tn->pod_init = __kmp_init_common_data(data_addr, pc_size);
     /*
@@ -393,23 +511,31 @@ struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
             d_tn->is_vec = FALSE;
             d_tn->vec_len = 0L;
     */
-    lnk_tn = &(__kmp_threadprivate_d_table.data[KMP_HASH(pc_addr)]);
-
-    d_tn->next = *lnk_tn;
-    *lnk_tn = d_tn;
+    __kmp_threadprivate_link_common(d_tn);
   }
 
   tn->cmn_size = d_tn->cmn_size;
 
+  __kmp_release_lock(&__kmp_global_lock, gtid);
+/* +++++++++ END OF CRITICAL SECTION +++++++++ */
+
+  // Allocate and initialize the copy outside of the lock so that the workers
+  // of a team create large copies in parallel, each in its own memory.
   if ((__kmp_foreign_tp) ? (KMP_INITIAL_GTID(gtid)) : (KMP_UBER_GTID(gtid))) {
     tn->par_addr = (void *)pc_addr;
   } else {
-    tn->par_addr = (void *)__kmp_allocate(tn->cmn_size);
+#if KMP_OS_LINUX
+    // Large plain data copies are filled in as the thread writes them
+    if (__kmp_tp_lazy_size > 0 && tn->cmn_size >= __kmp_tp_lazy_size &&
+        d_tn->ct.ctor == 0 && d_tn->cct.cctor == 0) {
+      tn->par_addr = __kmp_threadprivate_map_lazy(d_tn, gtid);
+      lazy = (tn->par_addr != NULL);
+    }
+    if (!lazy)
+#endif
+      tn->par_addr = (void *)__kmp_allocate(tn->cmn_size);
   }
 
-  __kmp_release_lock(&__kmp_global_lock, gtid);
-/* +++++++++ END OF CRITICAL SECTION +++++++++ */
-
 #ifdef USE_CHECKS_COMMON
   if (pc_size > d_tn->cmn_size) {
     KC_TRACE(
@@ -420,18 +546,9 @@ struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
   }
 #endif /* USE_CHECKS_COMMON */
 
-  tt = &(__kmp_threads[gtid]->th.th_pri_common->data[KMP_HASH(pc_addr)]);
-
-#ifdef KMP_TASK_COMMON_DEBUG
-  if (*tt != 0) {
-    KC_TRACE(
-        10,
-        ("__kmp_threadprivate_insert: WARNING! thread#%d: collision on %p\n",
-         gtid, pc_addr));
-  }
-#endif
-  tn->next = *tt;
-  *tt = tn;
+  if (d_tn->slot >= th->th.th_pri_nslots)
+    __kmp_threadprivate_grow_slots(th, d_tn->slot);
+  th->th.th_pri_slots[d_tn->slot] = tn;
 
 #ifdef KMP_TASK_COMMON_DEBUG
   KC_TRACE(10,
@@ -442,11 +559,11 @@ struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
 
   /* Link the node into a simple list */
 
-  tn->link = __kmp_threads[gtid]->th.th_pri_head;
-  __kmp_threads[gtid]->th.th_pri_head = tn;
+  tn->link = th->th.th_pri_head;
+  th->th.th_pri_head = tn;
 
 #ifdef BUILD_TV
-  __kmp_tv_threadprivate_store(__kmp_threads[gtid], tn->gbl_addr, tn->par_addr);
+  __kmp_tv_threadprivate_store(th, tn->gbl_addr, tn->par_addr);
 #endif
 
   if ((__kmp_foreign_tp) ? (KMP_INITIAL_GTID(gtid)) : (KMP_UBER_GTID(gtid)))
@@ -467,7 +584,7 @@ struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
       (void)(*d_tn->ct.ctorv)(tn->par_addr, d_tn->vec_len);
     } else if (d_tn->cct.cctorv != 0) {
       (void)(*d_tn->cct.cctorv)(tn->par_addr, d_tn->obj_init, d_tn->vec_len);
-    } else if (tn->par_addr != tn->gbl_addr) {
+    } else if (tn->par_addr != tn->gbl_addr && !lazy) {
       __kmp_copy_common_data(tn->par_addr, d_tn->pod_init);
     }
   } else {
@@ -475,7 +592,7 @@ struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
       (void)(*d_tn->ct.ctor)(tn->par_addr);
     } else if (d_tn->cct.cctor != 0) {
       (void)(*d_tn->cct.cctor)(tn->par_addr, d_tn->obj_init);
-    } else if (tn->par_addr != tn->gbl_addr) {
+    } else if (tn->par_addr != tn->gbl_addr && !lazy) {
       __kmp_copy_common_data(tn->par_addr, d_tn->pod_init);
     }
   }
@@ -504,7 +621,7 @@ struct private_common *kmp_threadprivate_insert(int gtid, void *pc_addr,
 */
 void __kmpc_threadprivate_register(ident_t *loc, void *data, kmpc_ctor ctor,
                                    kmpc_cctor cctor, kmpc_dtor dtor) {
-  struct shared_common *d_tn, **lnk_tn;
+  struct shared_common *d_tn;
 
   KC_TRACE(10, ("__kmpc_threadprivate_register: called\n"));
 
@@ -517,8 +634,7 @@ void __kmpc_threadprivate_register(ident_t *loc, void *data, kmpc_ctor ctor,
   d_tn = __kmp_find_shared_task_common(&__kmp_threadprivate_d_table, -1, data);
 
   if (d_tn == 0) {
-    d_tn = (struct shared_common *)__kmp_allocate(sizeof(struct shared_common));
-    d_tn->gbl_addr = data;
+    d_tn = __kmp_threadprivate_new_common(data);
 
     d_tn->ct.ctor = ctor;
     d_tn->cct.cctor = cctor;
@@ -530,10 +646,7 @@ void __kmpc_threadprivate_register(ident_t *loc, void *data, kmpc_ctor ctor,
             d_tn->obj_init = 0;
             d_tn->pod_init = 0;
     */
-    lnk_tn = &(__kmp_threadprivate_d_table.data[KMP_HASH(data)]);
-
-    d_tn->next = *lnk_tn;
-    *lnk_tn = d_tn;
+    __kmp_threadprivate_link_common(d_tn);
   }
 }
 
@@ -564,8 +677,8 @@ void *__kmpc_threadprivate(ident_t *loc, kmp_int32 global_tid, void *data,
         50,
         ("__kmpc_threadprivate: T#%d try to find private data at address %p\n",
          global_tid, data));
-    tn = __kmp_threadprivate_find_task_common(
-        __kmp_threads[global_tid]->th.th_pri_common, global_tid, data);
+    tn = __kmp_threadprivate_find_task_common(__kmp_threads[global_tid],
+                                              global_tid, data);
 
     if (tn) {
       KC_TRACE(20, ("__kmpc_threadprivate: T#%d found data\n", global_tid));
@@ -615,12 +728,12 @@ __kmpc_threadprivate_cached(ident_t *loc,
                 global_tid, *cache, data, size));
 
   if (TCR_PTR(*cache) == 0) {
-    __kmp_acquire_lock(&__kmp_global_lock, global_tid);
+    // The cache is sized to __kmp_tp_capacity, which cannot change while
+    // __kmp_tp_cached_lock is held; the list of caches is kept under it too.
+    __kmp_acquire_bootstrap_lock(&__kmp_tp_cached_lock);
 
     if (TCR_PTR(*cache) == 0) {
-      __kmp_acquire_bootstrap_lock(&__kmp_tp_cached_lock);
       __kmp_tp_cached = 1;
-      __kmp_release_bootstrap_lock(&__kmp_tp_cached_lock);
       void **my_cache;
       KMP_ITT_IGNORE(
           my_cache = (void **)__kmp_allocate(
@@ -648,7 +761,7 @@ __kmpc_threadprivate_cached(ident_t *loc,
       KMP_MB();
     }
 
-    __kmp_release_lock(&__kmp_global_lock, global_tid);
+    __kmp_release_bootstrap_lock(&__kmp_tp_cached_lock);
   }
 
   void *ret;
@@ -678,7 +791,7 @@ void __kmpc_threadprivate_register_vec(ident_t *loc, void *data,
                                        kmpc_ctor_vec ctor, kmpc_cctor_vec cctor,
                                        kmpc_dtor_vec dtor,
                                        size_t vector_length) {
-  struct shared_common *d_tn, **lnk_tn;
+  struct shared_common *d_tn;
 
   KC_TRACE(10, ("__kmpc_threadprivate_register_vec: called\n"));
 
@@ -692,8 +805,7 @@ void __kmpc_threadprivate_register_vec(ident_t *loc, void *data,
       data); /* Only the global data table exists. */
 
   if (d_tn == 0) {
-    d_tn = (struct shared_common *)__kmp_allocate(sizeof(struct shared_common));
-    d_tn->gbl_addr = data;
+    d_tn = __kmp_threadprivate_new_common(data);
 
     d_tn->ct.ctorv = ctor;
     d_tn->cct.cctorv = cctor;
@@ -705,9 +817,6 @@ void __kmpc_threadprivate_register_vec(ident_t *loc, void *data,
        zeroes the memory
             d_tn->pod_init = 0;
     */
-    lnk_tn = &(__kmp_threadprivate_d_table.data[KMP_HASH(data)]);
-
-    d_tn->next = *lnk_tn;
-    *lnk_tn = d_tn;
+    __kmp_threadprivate_link_common(d_tn);
   }
 }
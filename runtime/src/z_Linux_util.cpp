@@ -849,6 +849,29 @@ void __kmp_create_worker(int gtid, kmp_info_t *th, size_t stack_size) {
     __kmp_msg(kmp_ms_fatal, KMP_MSG(CantSetWorkerStackSize, stack_size),
               KMP_ERR(status), KMP_HNT(ChangeWorkerStackSize), __kmp_msg_null);
   }; // if
+
+  // Back the stack with huge and/or prefaulted pages if requested; keep the
+  // pthread stack if they cannot be mapped
+  th->th.th_info.ds.ds_stack_map = NULL;
+  if (KMP_MAP_PAGES()) {
+    void *base;
+    size_t len;
+    char *stack = (char *)__kmp_map_pages(stack_size, TRUE, &base, &len);
+    if (stack != NULL) {
+      // the mapping is rounded up, the thread gets all of it
+      status = pthread_attr_setstack(&thread_attr, stack,
+                                     len - (stack - (char *)base));
+      if (status == 0) {
+        th->th.th_info.ds.ds_stack_map = base;
+        th->th.th_info.ds.ds_stack_map_size = len;
+        KA_TRACE(10, ("__kmp_create_worker: T#%d, stack mapped at %p, %lu "
+                      "bytes\n",
+                      gtid, stack, (unsigned long)len));
+      } else {
+        __kmp_unmap_pages(base, len);
+      }
+    }
+  }
 #endif /* _POSIX_THREAD_ATTR_STACKSIZE */
 
 #endif /* KMP_THREAD_ATTR */
@@ -1114,6 +1137,12 @@ void __kmp_reap_worker(kmp_info_t *th) {
   }
 #endif /* KMP_DEBUG */
 
+  if (th->th.th_info.ds.ds_stack_map != NULL) {
+    __kmp_unmap_pages(th->th.th_info.ds.ds_stack_map,
+                      th->th.th_info.ds.ds_stack_map_size);
+    th->th.th_info.ds.ds_stack_map = NULL;
+  }
+
   KA_TRACE(10, ("__kmp_reap_worker: done reaping T#%d\n",
                 th->th.th_info.ds.ds_gtid));
 
@@ -1318,6 +1347,12 @@ static void __kmp_atfork_child(void) {
   __kmp_all_nth = 0;
   TCW_4(__kmp_nth, 0);
 
+#if KMP_OS_LINUX
+  // The child may have been moved to another cgroup; look at it again at its
+  // first parallel region.
+  __kmp_cgroup_next_check = 0;
+#endif
+
   /* Must actually zero all the *cache arguments passed to __kmpc_threadprivate
      here so threadprivate doesn't use stale data */
   KA_TRACE(10, ("__kmp_atfork_child: checking cache address list %p\n",
@@ -1833,6 +1868,178 @@ int __kmp_read_from_file(char const *path, char const *format, ...) {
   return result;
 }
 
+#if KMP_OS_LINUX
+// Check whether a comma separated list, such as the controllers of a cgroup,
+// holds name.
+static int __kmp_cgroup_list_has(char const *list, char const *name) {
+  size_t len = KMP_STRLEN(name);
+  while (*list != '\0') {
+    char const *end = strchr(list, ',');
+    size_t item = end == NULL ? KMP_STRLEN(list) : (size_t)(end - list);
+    if (item == len && strncmp(list, name, len) == 0) {
+      return TRUE;
+    }
+    if (end == NULL) {
+      break;
+    }
+    list = end + 1;
+  }
+  return FALSE;
+}
+
+// Find the directory of the process's cgroup for a controller: the v1
+// hierarchy that has the controller if there is one, the v2 hierarchy
+// otherwise. The cgroup path from /proc/self/cgroup is taken relative to the
+// root of the hierarchy mount in /proc/self/mountinfo; if that directory is
+// not visible, as in containers without a cgroup namespace, the mount point is
+// used. KMP_CGROUP_PATH names the directory of all controllers instead.
+// Returns the length of the mount point, or 0 if there is no hierarchy.
+static size_t __kmp_cgroup_dir(char const *controller, char *dir,
+                               size_t size) {
+  char line[1024];
+  char path1[512] = "";
+  char path2[512] = "";
+  bool have1 = false, have2 = false;
+
+  if (__kmp_cgroup_path != NULL) {
+    KMP_SNPRINTF(dir, size, "%s", __kmp_cgroup_path);
+    return KMP_STRLEN(dir);
+  }
+
+  FILE *f = fopen("/proc/self/cgroup", "r");
+  if (f == NULL) {
+    return 0;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    // hierarchy-ID:controller-list:cgroup-path
+    char *controllers = strchr(line, ':');
+    char *path = controllers == NULL ? NULL : strchr(controllers + 1, ':');
+    if (path == NULL) {
+      continue;
+    }
+    *controllers++ = '\0';
+    *path++ = '\0';
+    path[strcspn(path, "\n")] = '\0';
+    if (strcmp(line, "0") == 0 && *controllers == '\0') {
+      KMP_STRNCPY_S(path2, sizeof(path2), path, sizeof(path2) - 1);
+      have2 = true;
+    } else if (__kmp_cgroup_list_has(controllers, controller)) {
+      KMP_STRNCPY_S(path1, sizeof(path1), path, sizeof(path1) - 1);
+      have1 = true;
+    }
+  }
+  fclose(f);
+  if (!have1 && !have2) {
+    return 0;
+  }
+
+  f = fopen("/proc/self/mountinfo", "r");
+  if (f == NULL) {
+    return 0;
+  }
+  char root[512], mount[512], type[32], options[512];
+  size_t mountLen = 0;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    // id parent major:minor root mount-point options ... - type source options
+    char const *tail = strstr(line, " - ");
+    if (tail == NULL ||
+        KMP_SSCANF(line, "%*s %*s %*s %511s %511s", root, mount) != 2 ||
+        KMP_SSCANF(tail, " - %31s %*s %511s", type, options) != 2) {
+      continue;
+    }
+    char const *path;
+    if (have1 && strcmp(type, "cgroup") == 0 &&
+        __kmp_cgroup_list_has(options, controller)) {
+      path = path1;
+    } else if (!have1 && have2 && strcmp(type, "cgroup2") == 0) {
+      path = path2;
+    } else {
+      continue;
+    }
+    size_t rootLen = KMP_STRLEN(root);
+    if (strcmp(root, "/") == 0) {
+      rootLen = 0;
+    } else if (strncmp(path, root, rootLen) != 0) {
+      path = "";
+      rootLen = 0;
+    }
+    KMP_SNPRINTF(dir, size, "%s%s", mount, path + rootLen);
+    mountLen = KMP_STRLEN(mount);
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+      dir[mountLen] = '\0';
+    } else {
+      closedir(d);
+    }
+    break;
+  }
+  fclose(f);
+  return mountLen;
+}
+
+// Return the CPU quota of the process's cgroup in procs, rounded up, or 0 if
+// it is unlimited or unknown. A quota set on an enclosing cgroup also applies,
+// so the smallest one on the way up to the root of the hierarchy counts.
+int __kmp_get_cgroup_cpu_limit(void) {
+  char dir[1024], path[1100];
+  size_t mountLen = __kmp_cgroup_dir("cpu", dir, sizeof(dir));
+  if (mountLen == 0) {
+    return 0;
+  }
+  int limit = 0;
+  for (;;) {
+    long quota = -1, period = 0;
+    char max[32];
+    KMP_SNPRINTF(path, sizeof(path), "%s/cpu.max", dir);
+    if (__kmp_read_from_file(path, "%31s %ld", max, &period) == 2) {
+      if (strcmp(max, "max") != 0) {
+        quota = strtol(max, NULL, 10);
+      }
+    } else {
+      KMP_SNPRINTF(path, sizeof(path), "%s/cpu.cfs_quota_us", dir);
+      if (__kmp_read_from_file(path, "%ld", &quota) == 1) {
+        KMP_SNPRINTF(path, sizeof(path), "%s/cpu.cfs_period_us", dir);
+        __kmp_read_from_file(path, "%ld", &period);
+      }
+    }
+    if (quota > 0 && period > 0) {
+      int procs = (int)((quota + period - 1) / period);
+      if (limit == 0 || procs < limit) {
+        limit = procs;
+      }
+    }
+    // Go up to the parent cgroup, stopping at the mount point
+    char *slash = strrchr(dir, '/');
+    if (KMP_STRLEN(dir) <= mountLen || slash == NULL ||
+        (size_t)(slash - dir) < mountLen) {
+      break;
+    }
+    *slash = '\0';
+  }
+  KA_TRACE(10, ("__kmp_get_cgroup_cpu_limit: %d procs\n", limit));
+  return limit;
+}
+
+// Find the file listing the procs of the process's cpuset cgroup.
+int __kmp_get_cgroup_cpuset_file(char *path, size_t size) {
+  char dir[1024];
+  if (__kmp_cgroup_dir("cpuset", dir, sizeof(dir)) == 0) {
+    return FALSE;
+  }
+  char const *names[] = {"cpuset.cpus.effective", "cpuset.effective_cpus",
+                         "cpuset.cpus"};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    KMP_SNPRINTF(path, size, "%s/%s", dir, names[i]);
+    FILE *f = fopen(path, "r");
+    if (f != NULL) {
+      fclose(f);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+#endif /* KMP_OS_LINUX */
+
 void __kmp_runtime_initialize(void) {
   int status;
   pthread_mutexattr_t mutex_attr;
@@ -1978,6 +2185,49 @@ void __kmp_initialize_system_tick() {
 }
 #endif
 
+#if KMP_OS_LINUX
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+
+/* Move the whole pages of [addr, addr + size) to the NUMA node of the CPU the
+   calling thread runs on, unless that is from_node, where they were moved
+   before. Failures (no NUMA support, no permission) leave the pages where they
+   are. Returns the node, or from_node if it is not known. */
+int __kmp_move_pages_local(void *addr, size_t size, int from_node) {
+#if defined(__NR_getcpu) && defined(__NR_move_pages)
+  size_t page = (size_t)getpagesize();
+  kmp_uintptr_t start = ((kmp_uintptr_t)addr + page - 1) & ~(page - 1);
+  kmp_uintptr_t end = ((kmp_uintptr_t)addr + size) & ~(page - 1);
+  unsigned cpu, node;
+  void **pages;
+  int *nodes;
+  int *status;
+  long count, i, rc;
+
+  if (end <= start || syscall(__NR_getcpu, &cpu, &node, NULL) != 0)
+    return from_node;
+  if ((int)node == from_node)
+    return from_node;
+  count = (long)((end - start) / page);
+  pages = (void **)KMP_ALLOCA(count * sizeof(void *));
+  nodes = (int *)KMP_ALLOCA(count * sizeof(int));
+  status = (int *)KMP_ALLOCA(count * sizeof(int));
+  for (i = 0; i < count; ++i) {
+    pages[i] = (void *)(start + i * page);
+    nodes[i] = (int)node;
+  }
+  rc = syscall(__NR_move_pages, 0, count, pages, nodes, status, MPOL_MF_MOVE);
+  // status[] holds the node of every page, or a negative errno
+  KA_TRACE(10, ("__kmp_move_pages_local: %ld pages at %p to node %u: %d\n",
+                count, pages[0], node, rc < 0 ? -errno : status[0]));
+  return (int)node;
+#else
+  return from_node;
+#endif
+}
+#endif // KMP_OS_LINUX
+
 /* Determine whether the given address is mapped into the current address
    space. */
 
@@ -0,0 +1,143 @@
+// RUN: %libomp-compile-and-run
+// RUN: env OMP_ALLOCATOR=omp_large_cap_mem_alloc %libomp-run
+// RUN: env KMP_ALLOC_MMAP_THRESHOLD=4096 %libomp-run
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+#define NPTRS 64
+
+int test_omp_alloc()
+{
+  int err = 0;
+  int i;
+  void *p, *q;
+  void *ptrs[NPTRS];
+  omp_allocator_handle_t al, fb;
+  omp_alloctrait_t traits[3];
+
+  // Predefined allocators
+  p = omp_alloc(100, omp_default_mem_alloc);
+  q = omp_alloc(100, omp_high_bw_mem_alloc);
+  if (p == NULL || q == NULL) {
+    printf("predefined allocation failed\n");
+    err++;
+  }
+  memset(p, 1, 100);
+  memset(q, 1, 100);
+  omp_free(p, omp_default_mem_alloc);
+  omp_free(q, omp_high_bw_mem_alloc);
+
+  // Alignment trait
+  traits[0].key = omp_atk_alignment;
+  traits[0].value = 4096;
+  al = omp_init_allocator(omp_default_mem_space, 1, traits);
+  if (al == omp_null_allocator) {
+    printf("omp_init_allocator failed\n");
+    return 0;
+  }
+  for (i = 0; i < NPTRS; i++) {
+    ptrs[i] = omp_alloc(i * 8 + 1, al);
+    if (ptrs[i] == NULL || ((uintptr_t)ptrs[i] & 4095) != 0) {
+      printf("bad aligned allocation %p\n", ptrs[i]);
+      err++;
+    }
+  }
+  for (i = 0; i < NPTRS; i++)
+    omp_free(ptrs[i], al);
+  omp_destroy_allocator(al);
+
+  // Invalid traits are rejected
+  traits[0].key = omp_atk_alignment;
+  traits[0].value = 48;
+  if (omp_init_allocator(omp_default_mem_space, 1, traits) !=
+      omp_null_allocator) {
+    printf("non power of two alignment accepted\n");
+    err++;
+  }
+
+  // Pool with a null fallback runs dry, and refills after a free
+  traits[0].key = omp_atk_pool_size;
+  traits[0].value = 16 * 1024;
+  traits[1].key = omp_atk_fallback;
+  traits[1].value = omp_atv_null_fb;
+  al = omp_init_allocator(omp_default_mem_space, 2, traits);
+  p = omp_alloc(8 * 1024, al);
+  q = omp_alloc(8 * 1024, al);
+  if (p == NULL || q != NULL) {
+    printf("pool limit not honored: %p %p\n", p, q);
+    err++;
+  }
+  omp_free(p, al);
+  p = omp_alloc(8 * 1024, al);
+  if (p == NULL) {
+    printf("pool not refilled after omp_free\n");
+    err++;
+  }
+  omp_free(p, al);
+  omp_free(q, al);
+
+  // Allocator fallback takes over when the pool is exhausted
+  traits[2].key = omp_atk_alignment;
+  traits[2].value = 64;
+  fb = omp_init_allocator(omp_default_mem_space, 1, &traits[2]);
+  traits[1].value = omp_atv_allocator_fb;
+  traits[2].key = omp_atk_fb_data;
+  traits[2].value = (omp_uintptr_t)fb;
+  omp_destroy_allocator(al);
+  al = omp_init_allocator(omp_default_mem_space, 3, traits);
+  p = omp_alloc(32 * 1024, al);
+  if (p == NULL || ((uintptr_t)p & 63) != 0) {
+    printf("allocator fallback failed: %p\n", p);
+    err++;
+  }
+  omp_free(p, al);
+  omp_destroy_allocator(al);
+  omp_destroy_allocator(fb);
+
+  // Large blocks are mapped from the OS
+  p = omp_alloc(4 * 1024 * 1024, omp_default_mem_alloc);
+  if (p == NULL) {
+    printf("large allocation failed\n");
+    err++;
+  } else {
+    memset(p, 1, 4 * 1024 * 1024);
+    omp_free(p, omp_default_mem_alloc);
+  }
+
+  // Default allocator is per thread, blocks may be freed by another thread
+  #pragma omp parallel num_threads(4) shared(err, ptrs)
+  {
+    int j;
+    int tid = omp_get_thread_num();
+    int nth = omp_get_num_threads();
+    omp_set_default_allocator(omp_low_lat_mem_alloc);
+    if (omp_get_default_allocator() != omp_low_lat_mem_alloc) {
+      #pragma omp atomic
+      err++;
+    }
+    for (j = tid; j < NPTRS; j += nth) {
+      ptrs[j] = omp_alloc(64 + j, omp_null_allocator);
+      memset(ptrs[j], j, 64 + j);
+    }
+    #pragma omp barrier
+    for (j = (tid + 1) % nth; j < NPTRS; j += nth)
+      omp_free(ptrs[j], omp_null_allocator);
+  }
+  return err == 0;
+}
+
+int main()
+{
+  int i;
+  int num_failed=0;
+
+  for(i = 0; i < REPETITIONS; i++) {
+    if(!test_omp_alloc()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,81 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_CRITICAL_DELEGATE=false %libomp-run
+// RUN: env KMP_CONSISTENCY_CHECK=all %libomp-run
+// RUN: env KMP_BLOCKTIME=0 %libomp-run
+/*
+  Critical section bodies run through __kmpc_critical_delegate may be executed
+  by another thread. Mix them with plain entries of the same critical section
+  to check that the two stay mutually exclusive.
+*/
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// ---------------------------------------------------------------------------
+// Definitions copied from OpenMP RTL
+typedef int kmp_critical_name[8];
+extern int __kmpc_global_thread_num(void *loc);
+extern void __kmpc_critical(void *loc, int gtid, kmp_critical_name *crit);
+extern void __kmpc_end_critical(void *loc, int gtid, kmp_critical_name *crit);
+extern void __kmpc_critical_delegate(void *loc, int gtid,
+                                     kmp_critical_name *crit,
+                                     void (*body)(void *), void *data);
+// ---------------------------------------------------------------------------
+
+#define ITERS 10000
+
+typedef struct {
+  long *sum;
+  long value;
+} add_args_t;
+
+static void add_body(void *data)
+{
+  add_args_t *args = (add_args_t *)data;
+  long s = *args->sum;
+  *args->sum = s + args->value;
+}
+
+int test_critical_delegate()
+{
+  kmp_critical_name crit = {0};
+  long sum = 0, known_sum;
+  int nthreads = 0;
+
+  #pragma omp parallel shared(sum, nthreads, crit)
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    int i;
+    #pragma omp single
+    nthreads = omp_get_num_threads();
+    for (i = 0; i < ITERS; i++) {
+      if (i % 10 == 0) {
+        __kmpc_critical(NULL, gtid, &crit);
+        sum += 2;
+        __kmpc_end_critical(NULL, gtid, &crit);
+      } else {
+        add_args_t args = {&sum, 1};
+        __kmpc_critical_delegate(NULL, gtid, &crit, add_body, &args);
+      }
+    }
+  }
+
+  known_sum = (long)nthreads * (ITERS / 10 * 2 + ITERS - ITERS / 10);
+  if (sum != known_sum) {
+    fprintf(stderr, "error: sum = %ld, expected %ld\n", sum, known_sum);
+    return 0;
+  }
+  return 1;
+}
+
+int main()
+{
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_critical_delegate()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,188 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_CGROUP_QUOTA=0 %libomp-run
+// RUN: env OMP_PLACES=cores OMP_PROC_BIND=spread %libomp-run
+// RUN: env OMP_PLACES=threads OMP_PROC_BIND=close %libomp-run
+// RUN: env KMP_CGROUP_RECHECK=600000 %libomp-run
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "omp_testsuite.h"
+
+// Point the runtime at a cgroup directory of our own with KMP_CGROUP_PATH and
+// change its CPU quota and cpuset between parallel regions. The team follows
+// the quota and the remaining procs, the places are rebuilt from the new
+// cpuset, and a forked child looks at the cgroup again in its first region.
+static char dir[] = "/tmp/kmp_cgroup.XXXXXX";
+static int procs[CPU_SETSIZE];
+static int nprocs;
+static int quota = 0;
+
+static void write_file(const char *name, const char *text) {
+  char path[256];
+  FILE *f;
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  f = fopen(path, "w");
+  if (f == NULL) {
+    perror(path);
+    exit(1);
+  }
+  fputs(text, f);
+  fclose(f);
+}
+
+static void write_quota(int limit) {
+  char text[64];
+  if (limit > 0)
+    snprintf(text, sizeof(text), "%d 100000\n", limit * 100000);
+  else
+    snprintf(text, sizeof(text), "max 100000\n");
+  write_file("cpu.max", text);
+}
+
+// Allow the first n procs of the process
+static void write_cpuset(int n) {
+  char text[CPU_SETSIZE * 8] = "";
+  int i, len = 0;
+  for (i = 0; i < n; i++)
+    len += snprintf(text + len, sizeof(text) - len, i ? ",%d" : "%d",
+                    procs[i]);
+  text[len] = '\n';
+  write_file("cpuset.cpus.effective", text);
+}
+
+// Run a region, which expects a team of nth threads whose places only hold
+// the first n procs of the process.
+static int check_region(int nth, int n, const char *what) {
+  int nplaces = omp_get_num_places();
+  int err = 0;
+  int sum = 0;
+  int size = 0;
+  int i, j, k;
+
+  #pragma omp parallel reduction(+:sum) shared(err)
+  {
+    int place = omp_get_place_num();
+    sum += omp_get_thread_num() + 1;
+    #pragma omp single
+    size = omp_get_num_threads();
+    if (getenv("OMP_PLACES") && (place < 0 || place >= omp_get_num_places())) {
+      #pragma omp atomic
+      err++;
+    }
+  }
+  if (size != nth || sum != size * (size + 1) / 2 ||
+      omp_get_max_threads() != nth) {
+    fprintf(stderr, "error: %s: %d threads (max %d) summed to %d, "
+            "expected %d\n", what, size, omp_get_max_threads(), sum, nth);
+    err++;
+  }
+  nplaces = omp_get_num_places();
+  for (i = 0; i < nplaces; i++) {
+    int m = omp_get_place_num_procs(i);
+    int *ids = (int *)malloc(sizeof(int) * (m > 0 ? m : 1));
+    omp_get_place_proc_ids(i, ids);
+    for (j = 0; j < m; j++) {
+      for (k = 0; k < n && procs[k] != ids[j]; k++)
+        ;
+      if (k == n) {
+        fprintf(stderr, "error: %s: place %d has proc %d\n", what, i, ids[j]);
+        err++;
+      }
+    }
+    free(ids);
+  }
+  return err;
+}
+
+// The team size the runtime should pick for n procs and a quota limit
+static int team_size(int n, int limit) {
+  if (limit > 0 && limit < n && !getenv("KMP_CGROUP_QUOTA"))
+    return limit;
+  return n;
+}
+
+int main() {
+  cpu_set_t mask;
+  int err = 0;
+  int n, i, status;
+  int rechecking;
+  pid_t pid;
+
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) != 0 ||
+      mkdtemp(dir) == NULL) {
+    perror("setup");
+    return 1;
+  }
+  for (i = 0; i < CPU_SETSIZE; i++)
+    if (CPU_ISSET(i, &mask))
+      procs[nprocs++] = i;
+
+  // The files must be there when the runtime starts up
+  write_quota(0);
+  write_cpuset(nprocs);
+  setenv("KMP_CGROUP_PATH", dir, 1);
+  // The team size is only picked from the procs and the quota by default
+  unsetenv("OMP_NUM_THREADS");
+  if (getenv("KMP_CGROUP_RECHECK") == NULL)
+    setenv("KMP_CGROUP_RECHECK", "1", 1);
+  rechecking = atoi(getenv("KMP_CGROUP_RECHECK")) < 1000;
+  n = nprocs;
+  err += check_region(team_size(n, 0), n, "start");
+
+  if (rechecking) {
+    // The hot team shrinks to the quota
+    quota = nprocs > 2 ? 2 : 1;
+    write_quota(quota);
+    usleep(20000);
+    err += check_region(team_size(n, quota), n, "quota");
+    err += check_region(team_size(n, quota), n, "quota again");
+
+    // and grows to the remaining procs when the quota is lifted; the places
+    // are rebuilt without the proc taken away
+    quota = 0;
+    write_quota(quota);
+    if (nprocs > 1) {
+      n = nprocs - 1;
+      write_cpuset(n);
+    }
+    usleep(20000);
+    err += check_region(team_size(n, quota), n, "cpuset");
+    err += check_region(team_size(n, quota), n, "cpuset again");
+  }
+
+  // A forked child picks up a new quota in its first region, the parent only
+  // once the recheck interval has passed. The child starts out with the procs
+  // the process is bound to, which our cpuset cannot take away, so give them
+  // all back first.
+  n = nprocs;
+  write_cpuset(n);
+  write_quota(1);
+  fflush(NULL);
+  pid = fork();
+  if (pid == 0)
+    exit(check_region(team_size(n, 1), n, "child") != 0);
+  if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "error: child failed\n");
+    err++;
+  }
+  if (!rechecking)
+    err += check_region(team_size(n, quota), n, "parent");
+
+  for (i = 0; i < 2; i++) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir,
+             i ? "cpu.max" : "cpuset.cpus.effective");
+    unlink(path);
+  }
+  rmdir(dir);
+  if (err)
+    fprintf(stderr, "error: %d failures\n", err);
+  else
+    printf("passed\n");
+  return err != 0;
+}
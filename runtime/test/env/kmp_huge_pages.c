@@ -0,0 +1,61 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_HUGE_PAGES=transparent %libomp-run
+// RUN: env KMP_HUGE_PAGES=explicit %libomp-run
+// RUN: env KMP_PREFAULT_PAGES=touch %libomp-run
+// RUN: env KMP_HUGE_PAGES=transparent KMP_PREFAULT_PAGES=mlock %libomp-run
+#include <stdio.h>
+#include <string.h>
+#include "omp_testsuite.h"
+
+// Worker stacks and fast memory pools come from the page mapper when huge
+// pages or prefaulting are requested. Use a deep stack in every worker and
+// enough tasks to grow the pools, then shrink and regrow the team so that
+// stacks are unmapped and mapped again.
+static int recurse(int depth) {
+  volatile unsigned char buf[1024];
+  memset((unsigned char *)buf, depth & 0xff, sizeof(buf));
+  if (depth == 0)
+    return buf[0];
+  return recurse(depth - 1) + buf[sizeof(buf) - 1] - (depth & 0xff);
+}
+
+int test_huge_pages() {
+  int nthreads[] = {4, 1, 3};
+  int err = 0;
+  int i;
+  for (i = 0; i < sizeof(nthreads) / sizeof(int); i++) {
+    int sum = 0;
+    #pragma omp parallel num_threads(nthreads[i]) shared(sum, err)
+    {
+      int t;
+      if (recurse(256) != 0) {
+        #pragma omp atomic
+        err++;
+      }
+      #pragma omp single
+      for (t = 0; t < 1000; t++) {
+        #pragma omp task shared(sum)
+        {
+          #pragma omp atomic
+          sum += 1;
+        }
+      }
+    }
+    if (sum != 1000) {
+      fprintf(stderr, "error: sum = %d\n", sum);
+      err++;
+    }
+  }
+  return err == 0;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_huge_pages()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
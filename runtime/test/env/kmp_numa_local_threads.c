@@ -0,0 +1,98 @@
+// RUN: %libomp-compile && env KMP_AFFINITY=compact %libomp-run
+// RUN: env KMP_AFFINITY=compact KMP_NUMA_LOCAL_THREADS=false %libomp-run
+// RUN: env OMP_PROC_BIND=spread OMP_PLACES=cores %libomp-run
+// RUN: env KMP_AFFINITY=none %libomp-run
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "omp_testsuite.h"
+
+// Workers move their descriptors to their NUMA node once they are bound, and
+// again when they are bound to another place. Grow and shrink the team so that
+// threads are created, parked in the pool and reused, on other places with
+// OMP_PROC_BIND=spread, while their barrier state is in use. On a machine with
+// several nodes, every bound worker checks in each region that the first page
+// of its descriptor is on the node it runs on.
+extern int __kmpc_global_thread_num(void *loc);
+extern void **__kmp_threads;
+
+static int check_nodes;
+
+static int count_numa_nodes() {
+  DIR *dir = opendir("/sys/devices/system/node");
+  struct dirent *entry;
+  int n = 0;
+  if (dir == NULL)
+    return 1;
+  while ((entry = readdir(dir)) != NULL)
+    if (strncmp(entry->d_name, "node", 4) == 0)
+      n++;
+  closedir(dir);
+  return n;
+}
+
+// Is the descriptor of the calling worker on the node of its CPU?
+static int descriptor_is_local() {
+  void *page = __kmp_threads[__kmpc_global_thread_num(NULL)];
+  unsigned cpu, node;
+  int status = -1;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 ||
+      syscall(SYS_move_pages, 0, 1L, &page, NULL, &status, 0) != 0 ||
+      status < 0)
+    return 1; // cannot tell
+  if (status != (int)node) {
+    fprintf(stderr, "error: T#%d on cpu %u of node %u has its descriptor on "
+            "node %d\n", omp_get_thread_num(), cpu, node, status);
+    return 0;
+  }
+  return 1;
+}
+
+int test_numa_local_threads() {
+  int nthreads[] = {2, 8, 3, 6, 1, 8};
+  int r, i;
+  int err = 0;
+  for (r = 0; r < 100; r++) {
+    for (i = 0; i < sizeof(nthreads) / sizeof(int); i++) {
+      int sum = 0;
+      int nth = 0;
+      #pragma omp parallel num_threads(nthreads[i]) reduction(+:sum) \
+          shared(err)
+      {
+        #pragma omp single
+        nth = omp_get_num_threads();
+        sum += omp_get_thread_num() + 1;
+        if (check_nodes && omp_get_thread_num() != 0 &&
+            omp_get_place_num() >= 0 && !descriptor_is_local()) {
+          #pragma omp atomic
+          err++;
+        }
+        #pragma omp barrier
+      }
+      if (sum != nth * (nth + 1) / 2) {
+        fprintf(stderr, "error: sum = %d for %d threads\n", sum, nth);
+        err++;
+      }
+    }
+  }
+  return err == 0;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  const char *local = getenv("KMP_NUMA_LOCAL_THREADS");
+  check_nodes = count_numa_nodes() > 1 &&
+                !(local && (strcmp(local, "false") == 0 ||
+                            strcmp(local, "0") == 0));
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_numa_local_threads()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
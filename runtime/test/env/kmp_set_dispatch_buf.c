@@ -4,6 +4,8 @@
 // RUN: %libomp-compile -DMY_SCHEDULE=guided && env KMP_DISP_NUM_BUFFERS=1 %libomp-run
 // RUN: env KMP_DISP_NUM_BUFFERS=3 %libomp-run && env KMP_DISP_NUM_BUFFERS=4 %libomp-run
 // RUN: env KMP_DISP_NUM_BUFFERS=7 %libomp-run
+// RUN: env KMP_DISP_GROW_BUFFERS=0 KMP_DISP_NUM_BUFFERS=1 %libomp-run
+// RUN: env KMP_DISP_GROW_BUFFERS=0 KMP_DISP_NUM_BUFFERS=3 %libomp-run
 #include <stdio.h>
 #include <omp.h>
 #include <stdlib.h>
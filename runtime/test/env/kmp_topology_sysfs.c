@@ -0,0 +1,196 @@
+// RUN: %libomp-compile && env KMP_TOPOLOGY_METHOD=sysfs KMP_AFFINITY=compact %libomp-run
+// RUN: env KMP_TOPOLOGY_METHOD=sysfs KMP_AFFINITY=scatter %libomp-run
+// RUN: env KMP_TOPOLOGY_METHOD=sysfs OMP_PLACES=cores OMP_PROC_BIND=spread %libomp-run
+// RUN: env KMP_TOPOLOGY_METHOD=sysfs OMP_PLACES=sockets OMP_PROC_BIND=close %libomp-run
+// RUN: env KMP_TOPOLOGY_METHOD=sysfs KMP_HW_SUBSET=1s KMP_AFFINITY=compact %libomp-run
+// RUN: env KMP_TOPOLOGY_METHOD=sysfs OMP_PLACES=numa_domains OMP_PROC_BIND=spread %libomp-run
+// RUN: env KMP_TOPOLOGY_METHOD=sysfs OMP_PLACES=ll_caches OMP_PROC_BIND=close %libomp-run
+// RUN: env KMP_TOPOLOGY_METHOD=sysfs OMP_PLACES=tiles %libomp-run
+// RUN: env OMP_PLACES=numa_domains %libomp-run
+// RUN: env OMP_PLACES=ll_caches %libomp-run
+// RUN: rm -f %t.cache && env KMP_TOPOLOGY_CACHE=%t.cache KMP_AFFINITY=scatter %libomp-run
+// RUN: env KMP_TOPOLOGY_CACHE=%t.cache KMP_AFFINITY=scatter %libomp-run
+// RUN: env KMP_TOPOLOGY_CACHE=%t.cache OMP_PLACES=cores %libomp-run
+// RUN: rm -f %t.flat && env KMP_TOPOLOGY_METHOD=flat KMP_TOPOLOGY_CACHE=%t.flat %libomp-run
+// RUN: env KMP_TOPOLOGY_METHOD=flat KMP_TOPOLOGY_CACHE=%t.flat OMP_PLACES=threads %libomp-run
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "omp_testsuite.h"
+
+static cpu_set_t mask;
+
+// Read the first word of a file, "" if there is none
+static void read_word(const char *path, char *buf, int size) {
+  FILE *f = fopen(path, "r");
+  buf[0] = '\0';
+  if (f != NULL) {
+    if (fscanf(f, "%255s", buf) != 1)
+      buf[0] = '\0';
+    fclose(f);
+  }
+  buf[size - 1] = '\0';
+}
+
+// Whether a sysfs cpu list such as "0-3,8-11" holds a proc of the process
+static int list_in_mask(const char *list) {
+  const char *scan = list;
+  while (*scan != '\0') {
+    char *next;
+    long first = strtol(scan, &next, 10), last = first, i;
+    if (next == scan)
+      return 0;
+    if (*next == '-')
+      last = strtol(next + 1, &next, 10);
+    for (i = first; i <= last && i < CPU_SETSIZE; i++)
+      if (CPU_ISSET(i, &mask))
+        return 1;
+    scan = *next == ',' ? next + 1 : next;
+    if (*next != ',' && *next != '\0')
+      return 0;
+  }
+  return 0;
+}
+
+// The number of NUMA nodes holding procs of the process, 0 if sysfs has none
+static int count_numa_domains() {
+  char path[256], list[256];
+  struct dirent *entry;
+  int count = 0;
+  DIR *dir = opendir("/sys/devices/system/node");
+  if (dir == NULL)
+    return 0;
+  while ((entry = readdir(dir)) != NULL) {
+    unsigned node;
+    if (sscanf(entry->d_name, "node%u", &node) != 1)
+      continue;
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist",
+             node);
+    read_word(path, list, sizeof(list));
+    count += list_in_mask(list);
+  }
+  closedir(dir);
+  return count;
+}
+
+// The number of distinct last level caches of the procs of the process, 0 if
+// sysfs has none
+static int count_ll_caches() {
+  static char seen[CPU_SETSIZE][256];
+  int count = 0;
+  int cpu, index, i;
+  for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    char path[256], word[256], llc[256] = "";
+    int llc_level = 0;
+    if (!CPU_ISSET(cpu, &mask))
+      continue;
+    for (index = 0;; index++) {
+      int level;
+      snprintf(path, sizeof(path),
+               "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+      read_word(path, word, sizeof(word));
+      if (word[0] == '\0')
+        break;
+      level = atoi(word);
+      snprintf(path, sizeof(path),
+               "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, index);
+      read_word(path, word, sizeof(word));
+      if (strcmp(word, "Instruction") == 0 || level < llc_level)
+        continue;
+      snprintf(path, sizeof(path),
+               "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list",
+               cpu, index);
+      read_word(path, llc, sizeof(llc));
+      llc_level = level;
+    }
+    if (llc[0] == '\0')
+      return 0;
+    for (i = 0; i < count && strcmp(seen[i], llc) != 0; i++)
+      ;
+    if (i == count)
+      strcpy(seen[count++], llc);
+  }
+  return count;
+}
+
+// The places built from the sysfs topology map, probed or read back from the
+// topology cache, must not overlap, whether they are threads, cores, caches or
+// NUMA domains, and every thread of a team must be bound to one of them. With
+// any topology method there is one numa_domains place per NUMA node and one
+// ll_caches place per last level cache that sysfs lists.
+int test_topology_sysfs() {
+  int nplaces = omp_get_num_places();
+  int maxproc = 0;
+  int err = 0;
+  int expected = 0;
+  int i, j;
+  char *seen;
+  const char *places;
+
+  for (i = 0; i < nplaces; i++) {
+    int n = omp_get_place_num_procs(i);
+    int *ids = (int *)malloc(sizeof(int) * (n > 0 ? n : 1));
+    if (n <= 0) {
+      fprintf(stderr, "error: place %d is empty\n", i);
+      err++;
+    }
+    omp_get_place_proc_ids(i, ids);
+    for (j = 0; j < n; j++)
+      if (ids[j] > maxproc)
+        maxproc = ids[j];
+    free(ids);
+  }
+  seen = (char *)calloc(maxproc + 1, 1);
+  for (i = 0; i < nplaces; i++) {
+    int n = omp_get_place_num_procs(i);
+    int *ids = (int *)malloc(sizeof(int) * (n > 0 ? n : 1));
+    omp_get_place_proc_ids(i, ids);
+    for (j = 0; j < n; j++) {
+      // Fine grained KMP_AFFINITY places may repeat a proc, OMP_PLACES not
+      if (seen[ids[j]] && getenv("OMP_PLACES")) {
+        fprintf(stderr, "error: proc %d is in two places\n", ids[j]);
+        err++;
+      }
+      seen[ids[j]] = 1;
+    }
+    free(ids);
+  }
+  free(seen);
+
+  places = getenv("OMP_PLACES");
+  if (places != NULL && strcmp(places, "numa_domains") == 0)
+    expected = count_numa_domains();
+  else if (places != NULL && strcmp(places, "ll_caches") == 0)
+    expected = count_ll_caches();
+  if (expected > 0 && nplaces != expected) {
+    fprintf(stderr, "error: %d %s places, sysfs lists %d\n", nplaces, places,
+            expected);
+    err++;
+  }
+
+  #pragma omp parallel shared(err)
+  {
+    int place = omp_get_place_num();
+    if (nplaces > 0 && (place < 0 || place >= nplaces)) {
+      #pragma omp atomic
+      err++;
+    }
+  }
+  return err == 0;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  if (sched_getaffinity(0, sizeof(mask), &mask) != 0)
+    return 1;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_topology_sysfs()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,90 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_LOCK_KIND=tas %libomp-run
+// RUN: env KMP_ADAPTIVE_LOCK_PROPS=1,1024,4,100 %libomp-run
+// RUN: env KMP_CONSISTENCY_CHECK=all %libomp-run
+/*
+  Critical sections and locks with every hint. Hosts without TSX exercise the
+  fallback locks; hosts with it also exercise elision and its learning, which
+  with KMP_ADAPTIVE_LOCK_PROPS turns speculation off after every few attempts.
+  The critical sections are entered through the runtime entry points, as the
+  hint clause is not supported by all compilers.
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include "omp_testsuite.h"
+
+// ---------------------------------------------------------------------------
+// Definitions copied from OpenMP RTL
+typedef int kmp_critical_name[8];
+extern int __kmpc_global_thread_num(void *loc);
+extern void __kmpc_critical_with_hint(void *loc, int gtid,
+                                      kmp_critical_name *crit, uintptr_t hint);
+extern void __kmpc_end_critical(void *loc, int gtid, kmp_critical_name *crit);
+// ---------------------------------------------------------------------------
+
+#define ITERS 1000
+#define NUM_HINTS 8
+
+static const uintptr_t hints[NUM_HINTS] = {
+    omp_lock_hint_none,          omp_lock_hint_uncontended,
+    omp_lock_hint_contended,     omp_lock_hint_speculative,
+    omp_lock_hint_nonspeculative, kmp_lock_hint_hle,
+    kmp_lock_hint_rtm,           kmp_lock_hint_adaptive};
+
+int test_critical_hint()
+{
+  kmp_critical_name crits[NUM_HINTS] = {{0}};
+  omp_lock_t locks[NUM_HINTS];
+  int crit_sums[NUM_HINTS] = {0}, lock_sums[NUM_HINTS] = {0};
+  int nthreads = 0;
+  int h, ok = 1;
+
+  for (h = 0; h < NUM_HINTS; h++)
+    omp_init_lock_with_hint(&locks[h], (omp_lock_hint_t)hints[h]);
+
+  #pragma omp parallel shared(crits, locks, crit_sums, lock_sums, nthreads)
+  {
+    int i, gtid = __kmpc_global_thread_num(NULL);
+    #pragma omp single
+    nthreads = omp_get_num_threads();
+    for (i = 0; i < ITERS; i++) {
+      int h = i % NUM_HINTS;
+      __kmpc_critical_with_hint(NULL, gtid, &crits[h], hints[h]);
+      crit_sums[h]++;
+      __kmpc_end_critical(NULL, gtid, &crits[h]);
+
+      omp_set_lock(&locks[h]);
+      lock_sums[h]++;
+      omp_unset_lock(&locks[h]);
+
+      while (!omp_test_lock(&locks[h]))
+        ;
+      lock_sums[h]++;
+      omp_unset_lock(&locks[h]);
+    }
+  }
+
+  for (h = 0; h < NUM_HINTS; h++) {
+    omp_destroy_lock(&locks[h]);
+    if (crit_sums[h] != nthreads * ITERS / NUM_HINTS ||
+        lock_sums[h] != 2 * nthreads * ITERS / NUM_HINTS) {
+      fprintf(stderr, "hint %d: critical %d, lock %d\n", (int)hints[h],
+              crit_sums[h], lock_sums[h]);
+      ok = 0;
+    }
+  }
+  return ok;
+}
+
+int main()
+{
+  int i;
+  int num_failed=0;
+
+  for(i = 0; i < REPETITIONS; i++) {
+    if(!test_critical_hint()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
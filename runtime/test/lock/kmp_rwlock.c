@@ -0,0 +1,72 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_CONSISTENCY_CHECK=all %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+#define ITERS 2000
+#define TABLE 16
+
+// Writers keep every entry of the table equal; readers check that they never
+// see a partial update and count how many readers are inside at once.
+int test_kmp_rwlock()
+{
+  kmp_rwlock_t rwlock;
+  int table[TABLE] = {0};
+  int writes = 0, bad_reads = 0, max_readers = 0;
+  int readers = 0;
+  int nthreads = 0;
+
+  kmp_rwlock_init(&rwlock);
+  #pragma omp parallel shared(table, writes, bad_reads, readers, nthreads)
+  {
+    int i, j;
+    #pragma omp single
+    nthreads = omp_get_num_threads();
+    for (i = 0; i < ITERS; i++) {
+      if (i % 8 == omp_get_thread_num() % 8) {
+        kmp_rwlock_wrlock(&rwlock);
+        if (readers != 0)
+          bad_reads++;
+        for (j = 0; j < TABLE; j++)
+          table[j]++;
+        writes++;
+        kmp_rwlock_unlock(&rwlock);
+      } else {
+        int inside;
+        kmp_rwlock_rdlock(&rwlock);
+        #pragma omp atomic capture
+        inside = ++readers;
+        if (inside > max_readers)
+          max_readers = inside;
+        for (j = 1; j < TABLE; j++) {
+          if (table[j] != table[0]) {
+            #pragma omp atomic
+            bad_reads++;
+          }
+        }
+        #pragma omp atomic
+        readers--;
+        kmp_rwlock_unlock(&rwlock);
+      }
+    }
+  }
+  kmp_rwlock_destroy(&rwlock);
+
+  if (bad_reads)
+    fprintf(stderr, "%d inconsistent reads\n", bad_reads);
+  return bad_reads == 0 && table[0] == writes && readers == 0 &&
+         max_readers <= nthreads;
+}
+
+int main()
+{
+  int i;
+  int num_failed=0;
+
+  for(i = 0; i < REPETITIONS; i++) {
+    if(!test_kmp_rwlock()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,61 @@
+// RUN: %libomp-compile-and-run
+// RUN: env OMP_PROC_BIND=spread OMP_PLACES=cores %libomp-run
+// RUN: env KMP_LOCK_KIND=cohort KMP_CONSISTENCY_CHECK=all %libomp-run
+// RUN: env KMP_AFFINITY=none KMP_LOCK_KIND=cohort %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// Exercise the cohort lock through the lock hint and, when KMP_LOCK_KIND
+// selects it, through critical sections. Enough iterations are run that the
+// lock is handed off within a package and passed between packages. Without
+// places, the threads go through the package of the proc they run on.
+#define NITERS 20000
+
+int test_omp_cohort_lock() {
+  omp_lock_t lck;
+  int count = 0, in_lock = 0, errors = 0;
+  int crit_count = 0;
+
+  omp_init_lock_with_hint(&lck, kmp_lock_hint_cohort);
+  #pragma omp parallel num_threads(4) shared(count, in_lock, errors)
+  {
+    int i;
+    #pragma omp for schedule(static, 1)
+    for (i = 0; i < NITERS; i++) {
+      if (i % 5 == 0) {
+        while (!omp_test_lock(&lck))
+          ;
+      } else {
+        omp_set_lock(&lck);
+      }
+      if (in_lock++ != 0)
+        errors++;
+      count++;
+      in_lock--;
+      omp_unset_lock(&lck);
+
+      #pragma omp critical
+      crit_count++;
+    }
+  }
+  omp_destroy_lock(&lck);
+
+  if (count != NITERS || crit_count != NITERS || errors) {
+    fprintf(stderr, "error: count = %d, crit_count = %d, errors = %d\n",
+            count, crit_count, errors);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_cohort_lock()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,71 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_CONSISTENCY_CHECK=all %libomp-run
+#include <stdio.h>
+#include <stdlib.h>
+#include "omp_testsuite.h"
+
+// Initialize and destroy many locks from all threads, destroying locks on
+// other threads than the ones that initialized them, so that locks move
+// through the per-thread caches and whole lock table chunks are reclaimed
+// and reused.
+#define NLOCKS 20000
+#define ROUNDS 4
+
+static omp_lock_t locks[NLOCKS];
+static omp_nest_lock_t nest_locks[NLOCKS / 10];
+static int counts[NLOCKS];
+
+int test_omp_init_lock_many() {
+  int r, i, errors = 0;
+  for (r = 0; r < ROUNDS; r++) {
+    #pragma omp parallel num_threads(4) private(i)
+    {
+      #pragma omp for schedule(static, 7)
+      for (i = 0; i < NLOCKS; i++) {
+        omp_init_lock(&locks[i]);
+        counts[i] = 0;
+      }
+      #pragma omp for schedule(static)
+      for (i = 0; i < NLOCKS / 10; i++)
+        omp_init_nest_lock(&nest_locks[i]);
+      // every thread increments every counter under its lock
+      for (i = 0; i < NLOCKS; i++) {
+        int j = (i + 997 * omp_get_thread_num()) % NLOCKS;
+        omp_set_lock(&locks[j]);
+        counts[j]++;
+        omp_unset_lock(&locks[j]);
+      }
+      #pragma omp for schedule(static)
+      for (i = 0; i < NLOCKS / 10; i++) {
+        omp_set_nest_lock(&nest_locks[i]);
+        omp_set_nest_lock(&nest_locks[i]);
+        omp_unset_nest_lock(&nest_locks[i]);
+        omp_unset_nest_lock(&nest_locks[i]);
+      }
+      #pragma omp barrier
+      #pragma omp for schedule(dynamic, 13) reduction(+:errors)
+      for (i = 0; i < NLOCKS; i++) {
+        if (counts[i] != omp_get_num_threads())
+          errors++;
+        omp_destroy_lock(&locks[i]);
+      }
+      #pragma omp for schedule(dynamic, 3)
+      for (i = 0; i < NLOCKS / 10; i++)
+        omp_destroy_nest_lock(&nest_locks[i]);
+    }
+  }
+  if (errors)
+    fprintf(stderr, "error: %d lock counters are wrong\n", errors);
+  return errors == 0;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_init_lock_many()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
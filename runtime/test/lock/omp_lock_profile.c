@@ -0,0 +1,60 @@
+// RUN: %libomp-compile && env KMP_LOCK_PROFILE=1 %libomp-run
+// RUN: env KMP_LOCK_PROFILE=3 %libomp-run
+// RUN: env KMP_LOCK_PROFILE=1 KMP_LOCK_KIND=queuing %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+extern void kmp_dump_lock_profile();
+
+#define ITERS 1000
+
+int test_omp_lock_profile()
+{
+  omp_lock_t lck;
+  omp_nest_lock_t nlck;
+  int lock_sum = 0, nest_sum = 0, critical_sum = 0;
+  int nthreads = 0;
+
+  omp_init_lock(&lck);
+  omp_init_nest_lock(&nlck);
+  #pragma omp parallel shared(lock_sum, nest_sum, critical_sum, nthreads)
+  {
+    int i;
+    #pragma omp single
+    nthreads = omp_get_num_threads();
+    for (i = 0; i < ITERS; i++) {
+      omp_set_lock(&lck);
+      lock_sum++;
+      omp_unset_lock(&lck);
+
+      omp_set_nest_lock(&nlck);
+      omp_set_nest_lock(&nlck);
+      nest_sum++;
+      omp_unset_nest_lock(&nlck);
+      omp_unset_nest_lock(&nlck);
+
+      #pragma omp critical (profiled)
+      critical_sum++;
+    }
+  }
+  // The profile can be printed while it is collected.
+  kmp_dump_lock_profile();
+  omp_destroy_lock(&lck);
+  omp_destroy_nest_lock(&nlck);
+
+  return lock_sum == nthreads * ITERS && nest_sum == nthreads * ITERS &&
+         critical_sum == nthreads * ITERS;
+}
+
+int main()
+{
+  int i;
+  int num_failed=0;
+
+  for(i = 0; i < REPETITIONS; i++) {
+    if(!test_omp_lock_profile()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,68 @@
+// RUN: %libomp-compile && env KMP_LOCK_KIND=morph %libomp-run
+// RUN: env KMP_LOCK_KIND=morph KMP_CONSISTENCY_CHECK=all %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// Alternate between phases where all threads contend for the lock, which
+// should inflate it, and phases where a single thread takes it, which should
+// deflate it again. Each phase checks mutual exclusion.
+#define NITERS 5000
+#define PHASES 4
+
+static omp_lock_t lck;
+static int count, in_lock, errors;
+
+static void locked_increment(int use_test) {
+  if (use_test) {
+    while (!omp_test_lock(&lck))
+      ;
+  } else {
+    omp_set_lock(&lck);
+  }
+  if (in_lock++ != 0)
+    errors++;
+  count++;
+  in_lock--;
+  omp_unset_lock(&lck);
+}
+
+int test_omp_morph_lock() {
+  int p, i, expected = 0, crit_count = 0;
+
+  count = in_lock = errors = 0;
+  omp_init_lock(&lck);
+  for (p = 0; p < PHASES; p++) {
+    #pragma omp parallel num_threads(4) private(i)
+    {
+      #pragma omp for schedule(static, 1)
+      for (i = 0; i < NITERS; i++) {
+        locked_increment(i % 7 == 0);
+        #pragma omp critical
+        crit_count++;
+      }
+    }
+    for (i = 0; i < NITERS; i++)
+      locked_increment(0);
+    expected += 2 * NITERS;
+  }
+  omp_destroy_lock(&lck);
+
+  if (count != expected || crit_count != PHASES * NITERS || errors) {
+    fprintf(stderr, "error: count = %d, crit_count = %d, errors = %d\n",
+            count, crit_count, errors);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_omp_morph_lock()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
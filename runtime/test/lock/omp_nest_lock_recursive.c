@@ -0,0 +1,71 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_LOCK_KIND=tas %libomp-run
+// RUN: env KMP_LOCK_KIND=tas KMP_CONSISTENCY_CHECK=all %libomp-run
+/*
+  Recursive acquisition of nest locks under contention, with the depths
+  returned by omp_test_nest_lock. With KMP_LOCK_KIND=tas, and for the
+  uncontended hint, the runtime keeps the lock in the nest lock variable.
+*/
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+#define ITERS 1000
+#define DEPTH 4
+
+static int recurse(omp_nest_lock_t *lck, int *count, int depth)
+{
+  int ok = 1;
+  omp_set_nest_lock(lck);
+  (*count)++;
+  if (depth > 1)
+    ok = recurse(lck, count, depth - 1);
+  if (omp_test_nest_lock(lck) != DEPTH - depth + 2)
+    ok = 0;
+  omp_unset_nest_lock(lck);
+  omp_unset_nest_lock(lck);
+  return ok;
+}
+
+int test_nest_lock_recursive(omp_nest_lock_t *lck)
+{
+  int count = 0, nthreads = 0, errors = 0;
+
+  #pragma omp parallel shared(count, nthreads, errors)
+  {
+    int i;
+    #pragma omp single
+    nthreads = omp_get_num_threads();
+    for (i = 0; i < ITERS; i++) {
+      if (!recurse(lck, &count, DEPTH)) {
+        #pragma omp atomic
+        errors++;
+      }
+    }
+  }
+
+  if (errors || count != nthreads * ITERS * DEPTH) {
+    fprintf(stderr, "error: count = %d, errors = %d\n", count, errors);
+    return 0;
+  }
+  return 1;
+}
+
+int main()
+{
+  int i;
+  int num_failed = 0;
+  omp_nest_lock_t lck;
+
+  for (i = 0; i < REPETITIONS; i++) {
+    omp_init_nest_lock(&lck);
+    if (!test_nest_lock_recursive(&lck))
+      num_failed++;
+    omp_destroy_nest_lock(&lck);
+
+    omp_init_nest_lock_with_hint(&lck, omp_lock_hint_uncontended);
+    if (!test_nest_lock_recursive(&lck))
+      num_failed++;
+    omp_destroy_nest_lock(&lck);
+  }
+  return num_failed;
+}
@@ -0,0 +1,55 @@
+// RUN: %libomp-compile -lpthread && %libomp-run
+// RUN: env KMP_GTID_MODE=1 %libomp-run
+// RUN: env KMP_GTID_MODE=2 %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// Foreign threads are registered the first time they call into the runtime.
+// Each gets its own global thread id, whichever way the id is looked up, and
+// sees itself as the master of its own teams.
+#define NUM_THREADS 8
+
+extern int __kmpc_global_thread_num(void *);
+
+static int gtids[NUM_THREADS];
+static int errs = 0;
+
+void *thread_function(void *arg) {
+  int id = (int)(long)arg;
+  int r;
+  if (omp_in_parallel() || omp_get_level() != 0 || omp_get_thread_num() != 0) {
+    #pragma omp atomic
+    errs++;
+  }
+  gtids[id] = __kmpc_global_thread_num(NULL);
+  for (r = 0; r < 10; r++) {
+    int sum = 0;
+    #pragma omp parallel num_threads(2) reduction(+:sum)
+    {
+      if (omp_get_level() != 1 || omp_get_num_threads() != 2)
+        sum += 100;
+      sum += omp_get_thread_num();
+    }
+    if (sum != 1 || __kmpc_global_thread_num(NULL) != gtids[id]) {
+      #pragma omp atomic
+      errs++;
+    }
+  }
+  return NULL;
+}
+
+int main() {
+  pthread_t threads[NUM_THREADS];
+  int i, j;
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_create(&threads[i], NULL, thread_function, (void *)(long)i);
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_join(threads[i], NULL);
+  for (i = 0; i < NUM_THREADS; i++)
+    for (j = i + 1; j < NUM_THREADS; j++)
+      if (gtids[i] == gtids[j] || gtids[i] < 0)
+        errs++;
+  if (errs)
+    fprintf(stderr, "error: %d failures\n", errs);
+  return errs;
+}
@@ -0,0 +1,84 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_FAST_MEMORY_ENGINE=bget %libomp-run
+// RUN: env KMP_FAST_MEMORY_ENGINE=slab %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// Every thread creates chains of dependent tasks of several descriptor sizes,
+// including ones larger than the biggest slab size class. Tasks, dependence
+// nodes and hash entries are then freed by whichever thread runs them, so
+// blocks keep going back to their owners.
+#define NCHAINS 64
+#define NLINKS 50
+#define NSIZES 4
+
+#define DEFINE_TASK(N)                                                         \
+  static void task_##N(int *cell, int *sum) {                                  \
+    int priv[N];                                                               \
+    int i;                                                                     \
+    for (i = 0; i < N; ++i)                                                    \
+      priv[i] = 1;                                                             \
+    _Pragma("omp task firstprivate(priv) depend(inout: cell[0])") {            \
+      int j, s = 0;                                                            \
+      for (j = 0; j < N; ++j)                                                  \
+        s += priv[j];                                                          \
+      cell[0] += 1;                                                            \
+      _Pragma("omp atomic") * sum += s;                                        \
+    }                                                                          \
+  }
+
+DEFINE_TASK(1)
+DEFINE_TASK(100)
+DEFINE_TASK(900)
+DEFINE_TASK(3000)
+
+int test_fast_memory_engine() {
+  static const int sizes[NSIZES] = {1, 100, 900, 3000};
+  int cells[NCHAINS];
+  int sum = 0;
+  int expected = 0;
+  int err = 0;
+  int i;
+
+  for (i = 0; i < NCHAINS; ++i) {
+    cells[i] = 0;
+    expected += NLINKS * sizes[i % NSIZES];
+  }
+  #pragma omp parallel num_threads(4) shared(sum, cells)
+  {
+    int c, l;
+    #pragma omp for schedule(static, 1)
+    for (c = 0; c < NCHAINS; ++c) {
+      for (l = 0; l < NLINKS; ++l) {
+        switch (c % NSIZES) {
+        case 0: task_1(&cells[c], &sum); break;
+        case 1: task_100(&cells[c], &sum); break;
+        case 2: task_900(&cells[c], &sum); break;
+        case 3: task_3000(&cells[c], &sum); break;
+        }
+      }
+    }
+  }
+  for (i = 0; i < NCHAINS; ++i) {
+    if (cells[i] != NLINKS) {
+      fprintf(stderr, "error: chain %d ran %d tasks\n", i, cells[i]);
+      err++;
+    }
+  }
+  if (sum != expected) {
+    fprintf(stderr, "error: sum = %d, expected %d\n", sum, expected);
+    err++;
+  }
+  return err == 0;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_fast_memory_engine()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
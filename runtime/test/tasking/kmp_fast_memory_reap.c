@@ -0,0 +1,57 @@
+// RUN: %libomp-compile -lpthread && %libomp-run
+#include <stdio.h>
+#include <pthread.h>
+#include "omp_testsuite.h"
+
+// Foreign threads create dependent tasks, whose descriptors and dependence
+// nodes are freed by the workers that run them, and exit right after their
+// parallel region. Their memory may still be batched in the workers, or in
+// use, when they are reaped; it must go back to them without touching freed
+// memory.
+#define NUM_ROOTS 4
+#define NROUNDS 20
+#define NLINKS 40
+
+static int errs = 0;
+
+static void *root_function(void *arg) {
+  int cells[8] = {0};
+  int sum = 0;
+  int i;
+  (void)arg;
+  #pragma omp parallel num_threads(4) shared(cells, sum)
+  #pragma omp single
+  for (i = 0; i < NLINKS * 8; i++) {
+    int *cell = &cells[i % 8];
+    #pragma omp task depend(inout: cell[0]) firstprivate(cell) shared(sum)
+    {
+      (*cell)++;
+      #pragma omp atomic
+      sum++;
+    }
+  }
+  for (i = 0; i < 8; i++)
+    if (cells[i] != NLINKS) {
+      #pragma omp atomic
+      errs++;
+    }
+  if (sum != NLINKS * 8) {
+    #pragma omp atomic
+    errs++;
+  }
+  return NULL;
+}
+
+int main() {
+  pthread_t roots[NUM_ROOTS];
+  int r, i;
+  for (r = 0; r < NROUNDS; r++) {
+    for (i = 0; i < NUM_ROOTS; i++)
+      pthread_create(&roots[i], NULL, root_function, NULL);
+    for (i = 0; i < NUM_ROOTS; i++)
+      pthread_join(roots[i], NULL);
+  }
+  if (errs)
+    fprintf(stderr, "error: %d failures\n", errs);
+  return errs;
+}
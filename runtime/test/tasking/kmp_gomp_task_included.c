@@ -0,0 +1,116 @@
+// RUN: %libomp-compile-and-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+// Call the GOMP tasking entry points directly, the way gcc-compiled code
+// does, so that included and merged tasks take the GOMP_task paths. A taskwait
+// or taskgroup in such a task must only wait for the tasks it generated, not
+// for its siblings.
+#define GOMP_TASK_FINAL 2
+#define GOMP_TASK_MERGEABLE 4
+#define TIMEOUT 5.0
+
+extern void GOMP_parallel(void (*fn)(void *), void *data, unsigned num_threads,
+                          unsigned flags);
+extern int GOMP_single_start(void);
+extern void GOMP_barrier(void);
+extern void GOMP_task(void (*fn)(void *), void *data,
+                      void (*cpyfn)(void *, void *), long arg_size,
+                      long arg_align, int if_clause, unsigned flags,
+                      void **depend);
+extern void GOMP_taskwait(void);
+extern void GOMP_taskgroup_start(void);
+extern void GOMP_taskgroup_end(void);
+
+static volatile int started, done;
+static int errors;
+
+static void increment(void *data) {
+  int *p = *(int **)data;
+  #pragma omp atomic
+  (*p)++;
+}
+
+// Runs next to the merged or included task until that task got past its own
+// taskwait; times out if the taskwait waited for it instead.
+static void sibling(void *data) {
+  double start = omp_get_wtime();
+  (void)data;
+  started = 1;
+  while (!done) {
+    if (omp_get_wtime() - start > TIMEOUT) {
+      #pragma omp atomic
+      errors++;
+      break;
+    }
+  }
+}
+
+// Generates a deferred child, waits for it and then releases the sibling.
+static void wait_for_child(void *data) {
+  int count = 0;
+  int *p = &count;
+  (void)data;
+  GOMP_task(increment, &p, NULL, sizeof(p), sizeof(p), 1, 0, NULL);
+  GOMP_taskwait();
+  if (count != 1)
+    errors++;
+  GOMP_taskgroup_start();
+  GOMP_task(increment, &p, NULL, sizeof(p), sizeof(p), 1, 0, NULL);
+  GOMP_taskgroup_end();
+  if (count != 2)
+    errors++;
+  done = 1;
+}
+
+// A final task whose included task waits for its own (included) child.
+static void final_task(void *data) {
+  GOMP_task(wait_for_child, NULL, NULL, 0, 1, 1, 0, NULL);
+  if (!done || !omp_in_final())
+    errors++;
+  (void)data;
+}
+
+static void run_next_to_sibling(void (*fn)(void *), int if_clause,
+                                unsigned flags) {
+  double start = omp_get_wtime();
+  started = done = 0;
+  GOMP_task(sibling, NULL, NULL, 0, 1, 1, 0, NULL);
+  while (!started && omp_get_wtime() - start < TIMEOUT)
+    ;
+  GOMP_task(fn, NULL, NULL, 0, 1, if_clause, flags, NULL);
+  GOMP_taskwait();
+}
+
+static void parallel_body(void *data) {
+  (void)data;
+  if (GOMP_single_start() && omp_get_num_threads() > 1) {
+    // merged: undeferred mergeable task in an implicit task
+    run_next_to_sibling(wait_for_child, 0, GOMP_TASK_MERGEABLE);
+    // included: task generated in a final task
+    run_next_to_sibling(final_task, 1, GOMP_TASK_FINAL);
+  }
+  GOMP_barrier();
+}
+
+int test_gomp_task_included() {
+  errors = 0;
+  GOMP_parallel(parallel_body, NULL, 4, 0);
+  if (errors) {
+    fprintf(stderr, "error: %d failures\n", errors);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_gomp_task_included()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
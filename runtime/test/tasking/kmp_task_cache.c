@@ -0,0 +1,75 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_TASKING=0 %libomp-run
+// RUN: env KMP_FAST_MEMORY_ENGINE=bget %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// Create tasks of several descriptor sizes on one thread and let the rest of
+// the team execute (and free) them, so blocks cycle through the fast memory
+// free lists of both the owner and the remote threads.
+#define NTASKS 2000
+#define NSIZES 5
+
+#define DEFINE_TASK(N)                                                         \
+  static void task_##N(int id, int *sum) {                                     \
+    int priv[N];                                                               \
+    int i;                                                                     \
+    for (i = 0; i < N; ++i)                                                    \
+      priv[i] = id;                                                            \
+    _Pragma("omp task firstprivate(priv, sum)") {                              \
+      int j, s = 0;                                                            \
+      for (j = 0; j < N; ++j)                                                  \
+        s += priv[j] - id + 1;                                                 \
+      _Pragma("omp atomic") * sum += s;                                        \
+    }                                                                          \
+  }
+
+DEFINE_TASK(1)
+DEFINE_TASK(40)
+DEFINE_TASK(100)
+DEFINE_TASK(300)
+DEFINE_TASK(1000)
+
+int test_task_cache() {
+  int sum = 0;
+  int expected = 0;
+  int i;
+  for (i = 0; i < NTASKS; ++i) {
+    static const int sizes[NSIZES] = {1, 40, 100, 300, 1000};
+    expected += sizes[i % NSIZES];
+  }
+  #pragma omp parallel num_threads(4) shared(sum)
+  {
+    int r;
+    for (r = 0; r < 3; ++r) {
+      #pragma omp single
+      {
+        for (i = 0; i < NTASKS; ++i) {
+          switch (i % NSIZES) {
+          case 0: task_1(i, &sum); break;
+          case 1: task_40(i, &sum); break;
+          case 2: task_100(i, &sum); break;
+          case 3: task_300(i, &sum); break;
+          case 4: task_1000(i, &sum); break;
+          }
+        }
+      }
+    }
+  }
+  if (sum != 3 * expected) {
+    fprintf(stderr, "error: sum = %d, expected %d\n", sum, 3 * expected);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_task_cache()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,85 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_TASKING=0 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+// Included tasks (generated inside a final task) may run without a task
+// descriptor; check that they, and undeferred mergeable tasks, still see the
+// right final state, firstprivate copies and task-local ICVs.
+#define CUTOFF 4
+
+static int errors;
+
+static long fib(int n, int depth) {
+  long x, y;
+  if (n < 2)
+    return n;
+  #pragma omp task shared(x) firstprivate(n, depth) final(depth > CUTOFF)
+  {
+    if (depth > CUTOFF && !omp_in_final()) {
+      #pragma omp atomic
+      errors++;
+    }
+    x = fib(n - 1, depth + 1);
+  }
+  #pragma omp task shared(y) firstprivate(n, depth) final(depth > CUTOFF)
+  y = fib(n - 2, depth + 1);
+  #pragma omp taskwait
+  return x + y;
+}
+
+int test_task_included() {
+  long result = 0;
+  errors = 0;
+  #pragma omp parallel num_threads(4)
+  #pragma omp single
+  {
+    int nthreads = omp_get_max_threads();
+    int i, v = 7;
+    result = fib(20, 0);
+    // ICV changes in an included task must not leak into the final task
+    #pragma omp task final(1)
+    {
+      #pragma omp task firstprivate(v)
+      {
+        omp_set_num_threads(nthreads + 3);
+        v++;
+        if (v != 8) {
+          #pragma omp atomic
+          errors++;
+        }
+      }
+      if (omp_get_max_threads() != nthreads || v != 7) {
+        #pragma omp atomic
+        errors++;
+      }
+    }
+    #pragma omp taskwait
+    // undeferred mergeable tasks run before the task construct completes
+    for (i = 0; i < 10; ++i) {
+      #pragma omp task if(0) mergeable shared(v)
+      v += i;
+    }
+    if (v != 52) {
+      #pragma omp atomic
+      errors++;
+    }
+  }
+  if (result != 6765 || errors) {
+    fprintf(stderr, "error: fib = %ld, errors = %d\n", result, errors);
+    return 0;
+  }
+  return 1;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_task_included()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}
@@ -0,0 +1,168 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_TASKING=0 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+#include "omp_testsuite.h"
+
+// Emulate the code the compiler generates for tasks inside a final task and
+// call the __kmpc_* entry points directly. Included tasks run through
+// __kmpc_omp_task_begin_if0/__kmpc_omp_task_complete_if0 (if(0) tasks) and
+// __kmpc_omp_task; check that they run in order on the encountering thread,
+// see omp_in_final(), get their destructors called, and leave the counts of
+// the final task, its taskgroup and the team balanced.
+#define DEPTH 4
+#define WIDTH 3
+
+#define TASK_TIED 1
+#define TASK_FINAL 2
+#define TASK_DESTRUCTORS 8
+
+typedef struct ident {
+  void *dummy;
+} ident_t;
+
+typedef int (*kmp_routine_entry_t)(int, void *);
+
+typedef union kmp_cmplrdata {
+  int priority;
+  kmp_routine_entry_t destructors;
+} kmp_cmplrdata_t;
+
+typedef struct task {
+  void *shareds;
+  int (*routine)(int, struct task *);
+  int part_id;
+  kmp_cmplrdata_t data1;
+  kmp_cmplrdata_t data2;
+  // privates:
+  int depth;
+  int owner;
+} kmp_task_t;
+
+typedef int (*task_entry_t)(int, kmp_task_t *);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+kmp_task_t *__kmpc_omp_task_alloc(ident_t *loc, int gtid, int flags,
+                                  size_t sizeof_kmp_task_t,
+                                  size_t sizeof_shareds,
+                                  task_entry_t task_entry);
+void __kmpc_omp_task_begin_if0(ident_t *loc, int gtid, kmp_task_t *task);
+void __kmpc_omp_task_complete_if0(ident_t *loc, int gtid, kmp_task_t *task);
+int __kmpc_omp_task(ident_t *loc, int gtid, kmp_task_t *task);
+int __kmpc_omp_taskwait(ident_t *loc, int gtid);
+void __kmpc_taskgroup(ident_t *loc, int gtid);
+void __kmpc_end_taskgroup(ident_t *loc, int gtid);
+int __kmpc_global_thread_num(ident_t *loc);
+#ifdef __cplusplus
+}
+#endif
+
+static int errors;
+static int executed[DEPTH + 2];
+static int destroyed;
+
+static int destructors(int gtid, void *task) {
+  #pragma omp atomic
+  destroyed++;
+  return 0;
+}
+
+static int task_entry(int gtid, kmp_task_t *task);
+
+// Generate the children of a task; every other one as an if(0) task
+static void spawn(int gtid, int depth) {
+  int i;
+  for (i = 0; i < WIDTH; i++) {
+    int flags = TASK_TIED | ((i & 1) ? TASK_DESTRUCTORS : 0);
+    kmp_task_t *task = __kmpc_omp_task_alloc(NULL, gtid, flags,
+                                             sizeof(kmp_task_t), 0,
+                                             task_entry);
+    task->depth = depth;
+    task->owner = omp_get_thread_num();
+    if (flags & TASK_DESTRUCTORS)
+      task->data1.destructors = destructors;
+    if (i & 1) {
+      __kmpc_omp_task_begin_if0(NULL, gtid, task);
+      task_entry(gtid, task);
+      __kmpc_omp_task_complete_if0(NULL, gtid, task);
+    } else {
+      __kmpc_omp_task(NULL, gtid, task);
+    }
+  }
+}
+
+static int task_entry(int gtid, kmp_task_t *task) {
+  if (!omp_in_final() || task->owner != omp_get_thread_num()) {
+    fprintf(stderr, "error: included task at depth %d: in_final %d, thread "
+            "%d ran a task of thread %d\n", task->depth, omp_in_final(),
+            omp_get_thread_num(), task->owner);
+    #pragma omp atomic
+    errors++;
+  }
+  #pragma omp atomic
+  executed[task->depth]++;
+  if (task->depth < DEPTH) {
+    spawn(gtid, task->depth + 1);
+    // the children of an included task are done by the time it gets here
+    __kmpc_omp_taskwait(NULL, gtid);
+  }
+  return 0;
+}
+
+static int final_entry(int gtid, kmp_task_t *task) {
+  if (!omp_in_final()) {
+    fprintf(stderr, "error: final task not in final\n");
+    #pragma omp atomic
+    errors++;
+  }
+  __kmpc_taskgroup(NULL, gtid);
+  spawn(gtid, 1);
+  __kmpc_end_taskgroup(NULL, gtid);
+  spawn(gtid, 1);
+  __kmpc_omp_taskwait(NULL, gtid);
+  return 0;
+}
+
+int main() {
+  int d, expected = 0, per_level = 1, nfinal = 0;
+
+  #pragma omp parallel shared(nfinal)
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    #pragma omp single
+    nfinal = omp_get_num_threads();
+    // each thread generates a deferrable final task
+    kmp_task_t *task = __kmpc_omp_task_alloc(NULL, gtid,
+                                             TASK_TIED | TASK_FINAL,
+                                             sizeof(kmp_task_t), 0,
+                                             final_entry);
+    task->depth = 0;
+    __kmpc_omp_task(NULL, gtid, task);
+    __kmpc_omp_taskwait(NULL, gtid);
+  }
+
+  // two batches of children per final task, WIDTH / 2 of them with
+  // destructors at each level
+  for (d = 1; d <= DEPTH; d++) {
+    per_level *= WIDTH;
+    if (executed[d] != 2 * nfinal * per_level) {
+      fprintf(stderr, "error: %d tasks ran at depth %d, expected %d\n",
+              executed[d], d, 2 * nfinal * per_level);
+      errors++;
+    }
+    expected += 2 * nfinal * per_level / WIDTH * (WIDTH / 2);
+  }
+  if (destroyed != expected) {
+    fprintf(stderr, "error: %d destructors ran, expected %d\n", destroyed,
+            expected);
+    errors++;
+  }
+  if (errors) {
+    fprintf(stderr, "error: %d failures\n", errors);
+    return 1;
+  }
+  printf("passed\n");
+  return 0;
+}
@@ -0,0 +1,146 @@
+// RUN: %libomp-compile && env KMP_TASKLOOP_LAZY_SPLIT=1 %libomp-run
+// RUN: env KMP_TASKLOOP_LAZY_SPLIT=1 KMP_TASKING=0 %libomp-run
+// RUN: env KMP_TASKLOOP_LAZY_SPLIT=0 %libomp-run
+#include <stdio.h>
+#include <omp.h>
+
+#define N 4
+#define NITER 10000
+#define STRIDE 3
+
+// globals
+int hits[NITER];
+int counter;
+
+// Compiler-generated code (emulation)
+typedef struct ident {
+    void* dummy;
+} ident_t;
+
+typedef struct shar {
+    int *pcounter;
+    int *pj;
+} *pshareds;
+
+typedef struct task {
+    pshareds shareds;
+    int(* routine)(int,struct task*);
+    int part_id;
+// privates:
+    unsigned long long lb; // library always uses ULONG
+    unsigned long long ub;
+    int st;
+    int last;
+    int i;
+    int j;
+} *ptask, kmp_task_t;
+
+typedef int(* task_entry_t)( int, ptask );
+
+void
+__task_dup_entry(ptask task_dst, ptask task_src, int lastpriv)
+{
+// setup lastprivate flag
+    task_dst->last = lastpriv;
+}
+
+// OpenMP RTL interfaces
+typedef unsigned long long kmp_uint64;
+typedef long long kmp_int64;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void
+__kmpc_taskloop(ident_t *loc, int gtid, kmp_task_t *task, int if_val,
+                kmp_uint64 *lb, kmp_uint64 *ub, kmp_int64 st,
+                int nogroup, int sched, kmp_int64 grainsize, void *task_dup );
+ptask
+__kmpc_omp_task_alloc( ident_t *loc, int gtid, int flags,
+                  size_t sizeof_kmp_task_t, size_t sizeof_shareds,
+                  task_entry_t task_entry );
+void __kmpc_atomic_fixed4_add(void *id_ref, int gtid, int * lhs, int rhs);
+int  __kmpc_global_thread_num(void *id_ref);
+#ifdef __cplusplus
+}
+#endif
+
+// User's code
+int task_entry(int gtid, ptask task)
+{
+    pshareds pshar = task->shareds;
+    for( task->i = task->lb; task->i <= (int)task->ub; task->i += task->st ) {
+        __kmpc_atomic_fixed4_add(NULL,gtid,pshar->pcounter,1);
+        __kmpc_atomic_fixed4_add(NULL,gtid,&hits[task->i / STRIDE],1);
+        task->j = task->i;
+    }
+    if( task->last ) {
+        *(pshar->pj) = task->j; // lastprivate
+    }
+    return 0;
+}
+
+int main()
+{
+    int i, j, gtid = __kmpc_global_thread_num(NULL);
+    ptask task;
+    pshareds psh;
+    counter = 0;
+    #pragma omp parallel num_threads(N)
+    {
+      #pragma omp master
+      {
+        int gtid = __kmpc_global_thread_num(NULL);
+/*
+ *  This is what the OpenMP runtime calls correspond to:
+    #pragma omp taskloop lastprivate(j)
+    for( i=0; i<NITER*STRIDE; i+=STRIDE )
+    {
+        #pragma omp atomic
+            counter++;
+        #pragma omp atomic
+            hits[i/STRIDE]++;
+        j = i;
+    }
+*/
+        task = __kmpc_omp_task_alloc(NULL,gtid,1,sizeof(struct task),sizeof(struct shar),&task_entry);
+        psh = task->shareds;
+        psh->pcounter = &counter;
+        psh->pj = &j;
+        task->lb = 0;
+        task->ub = NITER*STRIDE-1;
+        task->st = STRIDE;
+
+        __kmpc_taskloop(
+            NULL,             // location
+            gtid,             // gtid
+            task,             // task structure
+            1,                // if clause value
+            &task->lb,        // lower bound
+            &task->ub,        // upper bound
+            STRIDE,           // loop increment
+            0,                // 1 if nogroup specified
+            0,                // schedule type: 0-none, 1-grainsize, 2-num_tasks
+            0,                // schedule value (ignored for type 0)
+            (void*)&__task_dup_entry // tasks duplication routine
+            );
+      } // end master
+    } // end parallel
+// check results
+    if( j != NITER*STRIDE-STRIDE ) {
+        printf("Error in lastprivate, %d != %d\n",j,NITER*STRIDE-STRIDE);
+        return 1;
+    }
+    if( counter != NITER ) {
+        printf("Error, counter %d != %d\n",counter,NITER);
+        return 1;
+    }
+    for( i=0; i<NITER; ++i ) {
+        if( hits[i] != 1 ) {
+            printf("Error, iteration %d executed %d times\n",i*STRIDE,hits[i]);
+            return 1;
+        }
+    }
+    printf("passed\n");
+    return 0;
+}
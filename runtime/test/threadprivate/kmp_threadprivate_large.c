@@ -0,0 +1,62 @@
+// RUN: %libomp-compile-and-run
+// RUN: env KMP_LAZY_THREADPRIVATE=64k %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// Workers create their copies of a large threadprivate array at the same
+// time; each copy must start out as the original data, zeros included, and
+// stay private once written, also when it is mapped copy-on-write.
+#define NELEMS (4 * 1024 * 1024)
+#define NSET 1000
+
+extern void *__kmpc_threadprivate_cached(void *, int, void *, size_t,
+                                         void ***);
+extern int __kmpc_global_thread_num(void *);
+
+static int big[NELEMS];
+static void **big_cache;
+static int zero[NELEMS];
+static void **zero_cache;
+
+int test_threadprivate_large() {
+  int err = 0;
+  int i;
+
+  for (i = 0; i < NSET; i++)
+    big[i * (NELEMS / NSET)] = i + 1;
+  __kmpc_global_thread_num(NULL);
+
+  #pragma omp parallel num_threads(8) shared(err)
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    int tid = omp_get_thread_num();
+    int *p = (int *)__kmpc_threadprivate_cached(NULL, gtid, big, sizeof(big),
+                                                &big_cache);
+    int *z = (int *)__kmpc_threadprivate_cached(NULL, gtid, zero, sizeof(zero),
+                                                &zero_cache);
+    int j, bad = 0;
+    for (j = 0; j < NELEMS; j++) {
+      int expect = j % (NELEMS / NSET) == 0 && j / (NELEMS / NSET) < NSET
+                       ? j / (NELEMS / NSET) + 1
+                       : 0;
+      if (p[j] != expect || z[j] != 0)
+        bad++;
+    }
+    p[0] = z[NELEMS - 1] = tid + 1;
+    #pragma omp barrier
+    if (p[0] != tid + 1 || z[NELEMS - 1] != tid + 1 || z[0] != 0)
+      bad++;
+    if (bad) {
+      #pragma omp atomic
+      err += bad;
+    }
+  }
+  if (err)
+    fprintf(stderr, "error: %d bad elements\n", err);
+  return err == 0;
+}
+
+int main() {
+  // Copies persist, so the initial values can only be checked once
+  return !test_threadprivate_large();
+}
@@ -0,0 +1,89 @@
+// RUN: %libomp-compile-and-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// Threadprivate storage as a compiler that does not use TLS drives it:
+// many variables, some only reached through __kmpc_threadprivate, one with a
+// registered constructor, and copies that must survive between parallel
+// regions.
+#define NVARS 300
+
+typedef void *(*kmpc_ctor)(void *);
+extern void __kmpc_threadprivate_register(void *, void *, kmpc_ctor, void *,
+                                          void *);
+extern void *__kmpc_threadprivate(void *, int, void *, size_t);
+extern void *__kmpc_threadprivate_cached(void *, int, void *, size_t,
+                                         void ***);
+extern int __kmpc_global_thread_num(void *);
+
+static long vars[NVARS];
+static void **caches[NVARS];
+static long obj = -1;
+
+static void *obj_ctor(void *p) {
+  *(long *)p = 42;
+  return p;
+}
+
+static long *tp(int gtid, int i) {
+  if (i % 2)
+    return (long *)__kmpc_threadprivate(NULL, gtid, &vars[i], sizeof(long));
+  return (long *)__kmpc_threadprivate_cached(NULL, gtid, &vars[i],
+                                             sizeof(long), &caches[i]);
+}
+
+int test_threadprivate_slots() {
+  int err = 0;
+  int i;
+
+  for (i = 0; i < NVARS; i++)
+    vars[i] = i;
+  // Like compiled code, initialize the runtime before registering
+  __kmpc_global_thread_num(NULL);
+  __kmpc_threadprivate_register(NULL, &obj, obj_ctor, NULL, NULL);
+
+  #pragma omp parallel num_threads(4) shared(err)
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    int tid = omp_get_thread_num();
+    long *o = (long *)__kmpc_threadprivate(NULL, gtid, &obj, sizeof(long));
+    int j;
+    // Copies start out as the original value, or constructed
+    for (j = 0; j < NVARS; j++) {
+      if (*tp(gtid, j) != j) {
+        #pragma omp atomic
+        err++;
+      }
+    }
+    if (*o != (tid == 0 ? -1 : 42)) {
+      #pragma omp atomic
+      err++;
+    }
+    for (j = 0; j < NVARS; j++)
+      *tp(gtid, j) = tid * NVARS + j;
+  }
+
+  #pragma omp parallel num_threads(4) shared(err)
+  {
+    int gtid = __kmpc_global_thread_num(NULL);
+    int tid = omp_get_thread_num();
+    int j;
+    for (j = 0; j < NVARS; j++) {
+      // Both entry points return the same copy, kept from the last region
+      long *p = (long *)__kmpc_threadprivate(NULL, gtid, &vars[j],
+                                             sizeof(long));
+      if (p != tp(gtid, j) || *p != tid * NVARS + j) {
+        #pragma omp atomic
+        err++;
+      }
+    }
+  }
+  if (err)
+    fprintf(stderr, "error: %d bad threadprivate copies\n", err);
+  return err == 0;
+}
+
+int main() {
+  // Copies persist, so the initial values can only be checked once
+  return !test_threadprivate_slots();
+}
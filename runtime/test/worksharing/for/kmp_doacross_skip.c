@@ -0,0 +1,67 @@
+// RUN: %libomp-compile && env KMP_DOACROSS_DENSE_LIMIT=0 %libomp-run
+// RUN: env KMP_DOACROSS_DENSE_LIMIT=0 KMP_BLOCKTIME=0 %libomp-run
+// RUN: %libomp-run
+#include <stdio.h>
+#include <stdlib.h>
+
+// Some iterations never execute depend(source), which is legal as long as no
+// sink refers to them. This must not stall the loop when the runtime tracks
+// dependences in a sliding window of flag words (small
+// KMP_DOACROSS_DENSE_LIMIT).
+#define N 200000
+#define SKIPPED(i) ((i) % 5 == 3)
+
+struct dim {
+  long long lo; // lower
+  long long up; // upper
+  long long st; // stride
+};
+extern void __kmpc_doacross_init(void*, int, int, struct dim *);
+extern void __kmpc_doacross_wait(void*, int, long long*);
+extern void __kmpc_doacross_post(void*, int, long long*);
+extern void __kmpc_doacross_fini(void*, int);
+extern int __kmpc_global_thread_num(void*);
+
+int a[N];
+
+int main()
+{
+  int i, err = 0;
+  struct dim dims[1];
+  a[0] = 0;
+  dims[0].lo = 1;
+  dims[0].up = N - 1;
+  dims[0].st = 1;
+  #pragma omp parallel num_threads(4)
+  {
+    int i, gtid;
+    long long vec[1];
+    gtid = __kmpc_global_thread_num(NULL);
+    __kmpc_doacross_init(NULL, gtid, 1, dims);
+    #pragma omp for nowait schedule(static, 1)
+    for (i = 1; i < N; ++i) {
+      int prev = SKIPPED(i - 1) ? i - 2 : i - 1;
+      if (SKIPPED(i))
+        continue;
+      // #pragma omp ordered depend(sink:prev)
+      vec[0] = prev;
+      __kmpc_doacross_wait(NULL, gtid, vec);
+      a[i] = a[prev] + 1;
+      // #pragma omp ordered depend(source)
+      vec[0] = i;
+      __kmpc_doacross_post(NULL, gtid, vec);
+    }
+    __kmpc_doacross_fini(NULL, gtid);
+  }
+  // every posting iteration counts the posting iterations before it
+  for (i = 1; i < N; ++i)
+    if (!SKIPPED(i) && a[i] != i - (i + 2) / 5)
+      err++;
+  if (err == 0) {
+    printf("passed\n");
+  } else {
+    printf("failed: %d mismatches\n", err);
+    return 1;
+  }
+  return 0;
+}
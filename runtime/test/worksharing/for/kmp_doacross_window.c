@@ -0,0 +1,76 @@
+// RUN: %libomp-compile && env KMP_DOACROSS_DENSE_LIMIT=0 %libomp-run
+// RUN: env KMP_DOACROSS_DENSE_LIMIT=0 KMP_BLOCKTIME=0 %libomp-run
+// RUN: %libomp-run
+#include <stdio.h>
+#include <stdlib.h>
+
+// 2-D wavefront over an iteration space large enough for the runtime to track
+// dependences in a sliding window of flag words rather than the dense
+// bit-vector when KMP_DOACROSS_DENSE_LIMIT is small.
+#define N 600
+#define M 700
+
+struct dim {
+  long long lo; // lower
+  long long up; // upper
+  long long st; // stride
+};
+extern void __kmpc_doacross_init(void*, int, int, struct dim *);
+extern void __kmpc_doacross_wait(void*, int, long long*);
+extern void __kmpc_doacross_post(void*, int, long long*);
+extern void __kmpc_doacross_fini(void*, int);
+extern int __kmpc_global_thread_num(void*);
+
+int a[N][M];
+
+int main()
+{
+  int i, j, err = 0;
+  struct dim dims[2];
+  for (i = 0; i < N; ++i)
+    for (j = 0; j < M; ++j)
+      a[i][j] = (i == 0 || j == 0);
+  dims[0].lo = 1;
+  dims[0].up = N - 1;
+  dims[0].st = 1;
+  dims[1].lo = 1;
+  dims[1].up = M - 1;
+  dims[1].st = 1;
+  #pragma omp parallel num_threads(4)
+  {
+    int i, j, gtid;
+    long long vec[2];
+    gtid = __kmpc_global_thread_num(NULL);
+    __kmpc_doacross_init(NULL, gtid, 2, dims);
+    #pragma omp for nowait schedule(static, 1)
+    for (i = 1; i < N; ++i) {
+      for (j = 1; j < M; ++j) {
+        // #pragma omp ordered depend(sink:i-1,j) depend(sink:i,j-1)
+        vec[0] = i - 1;
+        vec[1] = j;
+        __kmpc_doacross_wait(NULL, gtid, vec);
+        vec[0] = i;
+        vec[1] = j - 1;
+        __kmpc_doacross_wait(NULL, gtid, vec);
+        a[i][j] = (a[i - 1][j] + a[i][j - 1]) % 1000003;
+        // #pragma omp ordered depend(source)
+        vec[0] = i;
+        vec[1] = j;
+        __kmpc_doacross_post(NULL, gtid, vec);
+      }
+    }
+    __kmpc_doacross_fini(NULL, gtid);
+  }
+  // any sink that was not honored leaves a stale value behind
+  for (i = 1; i < N; ++i)
+    for (j = 1; j < M; ++j)
+      if (a[i][j] != (a[i - 1][j] + a[i][j - 1]) % 1000003)
+        err++;
+  if (err == 0) {
+    printf("passed\n");
+  } else {
+    printf("failed: %d mismatches\n", err);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,79 @@
+// RUN: %libomp-compile && env OMP_SCHEDULE=static_steal %libomp-run
+// RUN: env OMP_SCHEDULE=static_steal,2 KMP_DISP_NUM_BUFFERS=2 %libomp-run
+// RUN: env OMP_SCHEDULE=static_steal KMP_DISP_GROW_BUFFERS=0 %libomp-run
+// RUN: env OMP_SCHEDULE=static_steal,2 KMP_DISP_GROW_BUFFERS=0 KMP_DISP_NUM_BUFFERS=2 %libomp-run
+// RUN: env OMP_SCHEDULE=dynamic KMP_DISP_GROW_BUFFERS=1 KMP_DISP_NUM_BUFFERS=1 %libomp-run
+#include <stdio.h>
+#include "omp_testsuite.h"
+
+// Back-to-back nowait loops, stealing and dynamic, where some threads lag far
+// behind the others: every iteration of every loop must run exactly once,
+// also when threads run ahead into loops whose buffers the lagging threads
+// have not released yet.
+#define NUM_LOOPS 300
+#define N 97
+
+static int count[NUM_LOOPS][N];
+static int lcount[NUM_LOOPS][N];
+
+static void lag(int j) {
+  int tid = omp_get_thread_num();
+  if (tid % 3 == 1 && j % 7 == 0) {
+    volatile int k;
+    for (k = 0; k < 20000 * (tid + 1); k++)
+      ;
+  }
+}
+
+int test_nowait_steal() {
+  int err = 0;
+  int i, j;
+
+  for (j = 0; j < NUM_LOOPS; j++)
+    for (i = 0; i < N; i++)
+      count[j][i] = lcount[j][i] = 0;
+
+  #pragma omp parallel num_threads(5) private(i, j)
+  {
+    long long l;
+    for (j = 0; j < NUM_LOOPS; j++) {
+      #pragma omp for schedule(runtime) nowait
+      for (i = 0; i < N; i++) {
+        lag(j);
+        #pragma omp atomic
+        count[j][i]++;
+      }
+      #pragma omp for schedule(runtime) nowait
+      for (l = N - 1; l >= 0; l--) {
+        #pragma omp atomic
+        lcount[j][l]++;
+      }
+      #pragma omp for schedule(dynamic, 3) nowait
+      for (i = 0; i < N; i++) {
+        lag(j + 1);
+        #pragma omp atomic
+        count[j][i]++;
+      }
+    }
+  }
+
+  for (j = 0; j < NUM_LOOPS; j++)
+    for (i = 0; i < N; i++)
+      if (count[j][i] != 2 || lcount[j][i] != 1) {
+        if (err++ < 10)
+          fprintf(stderr, "error: loop %d iteration %d ran %d/%d times\n", j,
+                  i, count[j][i], lcount[j][i]);
+      }
+  return err == 0;
+}
+
+int main() {
+  int i;
+  int num_failed = 0;
+  for (i = 0; i < REPETITIONS; i++) {
+    if (!test_nowait_steal()) {
+      num_failed++;
+    }
+  }
+  return num_failed;
+}